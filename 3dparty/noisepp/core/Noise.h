@@ -34,6 +34,7 @@
 #include "NoiseModule.h"
 #include "NoisePerlin.h"
 #include "NoiseBillow.h"
+#include "NoiseSimplex.h"
 #include "NoiseAddition.h"
 #include "NoiseAbsolute.h"
 #include "NoiseBlend.h"
@@ -55,6 +56,8 @@
 #include "NoiseTerrace.h"
 #include "NoiseTranslatePoint.h"
 #include "NoiseVoronoi.h"
+#include "NoiseShellMap.h"
+#include "NoiseCompiled.h"
 
 #if NOISEPP_ENABLE_THREADS
 #include "NoiseThreadedPipeline.h"
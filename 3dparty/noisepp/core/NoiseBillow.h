@@ -184,15 +184,22 @@ namespace noisepp
 			{
 				int seed;
 				Real scale;
+				/// The lattice shared with octaves of other elements or -1, see Pipeline::shareLattices().
+				int lattice;
 				Real persistence;
+				/// The average contribution, which is used when the octave is skipped.
+				Real mean;
 			};
 			Octave *mOctaves;
 			size_t mOctaveCount;
 			int mQuality;
 			Real mScale;
+			int mPrecision;
 
 			NOISEPP_INLINE Real calculateGradient (Real x, Real y, Real z, int seed) const
 			{
+				if (mPrecision == NOISE_PRECISION_SINGLE)
+					return Generator3D::calcGradientCoherentNoiseSingle (mQuality, x, y, z, seed, float(mScale));
 				if (mQuality == NOISE_QUALITY_STD)
 					return Generator3D::calcGradientCoherentNoiseStd (x, y, z, seed, mScale);
 				else if (mQuality == NOISE_QUALITY_HIGH)
@@ -206,8 +213,88 @@ namespace noisepp
 				else
 					return Generator3D::calcGradientCoherentFastNoiseLow (x, y, z, seed, mScale);
 			}
+			NOISEPP_INLINE void calculateGradients (size_t count, const Real *x, const Real *y, const Real *z, int seed, Real *values) const
+			{
+				if (mPrecision == NOISE_PRECISION_SINGLE)
+					Generator3D::calcGradientCoherentNoiseBatchSingle (mQuality, count, x, y, z, seed, float(mScale), values);
+				else
+					Generator3D::calcGradientCoherentNoiseBatch (mQuality, count, x, y, z, seed, mScale, values);
+			}
+			/// Calculates an octave at a single point, or takes it from the cache if another element shares its lattice.
+			NOISEPP_INLINE Real calculateOctave (const Octave &octave, Real x, Real y, Real z, Cache *cache) const
+			{
+				Real value;
+				if (cache && cache->findLatticeValue (octave.lattice, x, y, z, value))
+					return value;
+				value = calculateGradient (x, y, z, octave.seed);
+				if (cache)
+					cache->storeLatticeValue (octave.lattice, x, y, z, value);
+				return value;
+			}
+			/// Calculates an octave for a batch, see calculateOctave().
+			/// @param buffer Receives the values unless they are kept in the cache, must hold count values.
+			/// @return The values.
+			const Real *calculateOctaveBatch (const Octave &octave, size_t count, const Real *x, const Real *y, const Real *z, Real *buffer, Cache *cache) const
+			{
+				const Real *found = cache ? cache->findLatticeBatch (octave.lattice, false, count, x, y, z) : NULL;
+				if (found)
+					return found;
+				Real *values = cache ? cache->storeLatticeBatch (octave.lattice, false, count, x, y, z) : NULL;
+				if (!values)
+					values = buffer;
+				calculateGradients (count, x, y, z, octave.seed, values);
+				return values;
+			}
+			/// Calculates an octave for a batch together with its derivatives, see calculateOctave().
+			/// @param buffer Receives the results unless they are kept in the cache, must hold 4*count values.
+			/// @return The values, followed by the derivatives in x, y and z.
+			const Real *calculateOctaveDerivatives (const Octave &octave, size_t count, const Real *x, const Real *y, const Real *z, Real *buffer, Cache *cache) const
+			{
+				const Real *found = cache ? cache->findLatticeBatch (octave.lattice, true, count, x, y, z) : NULL;
+				if (found)
+					return found;
+				Real *results = cache ? cache->storeLatticeBatch (octave.lattice, true, count, x, y, z) : NULL;
+				if (!results)
+					results = buffer;
+				Generator3D::calcGradientCoherentNoiseDerivativesBatch (mQuality, count, x, y, z, octave.seed, mScale, results, results + count, results + 2*count, results + 3*count);
+				return results;
+			}
+			NOISEPP_INLINE void calculateGradientBounds (const Box3D &box, const Octave &octave, Real &lower, Real &upper) const
+			{
+				Real min[3], max[3];
+				for (int d=0;d<3;++d)
+				{
+					min[d] = box.min[d] * octave.scale;
+					max[d] = box.max[d] * octave.scale;
+					if (min[d] > max[d])
+						std::swap (min[d], max[d]);
+				}
+				Generator3D::calcGradientCoherentNoiseBounds (mQuality, min, max, octave.seed, mScale, lower, upper);
+			}
+			/// Number of points used to estimate the averages of the octaves.
+			enum { MEAN_SAMPLE_COUNT=4096 };
+			void calculateMeans ()
+			{
+				const size_t count = MEAN_SAMPLE_COUNT;
+				std::vector<Real> buffer(count*4);
+				Real *nx = &buffer[0];
+				Real *ny = nx + count;
+				Real *nz = ny + count;
+				Real *noise = nz + count;
+				Generator3D::getSamplePoints (count, nx, ny, nz);
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					calculateGradients (count, nx, ny, nz, mOctaves[o].seed, noise);
+					Real sum = 0.0;
+					for (size_t i=0;i<count;++i)
+					{
+						sum += Real(2.0) * std::fabs (noise[i]) - Real(1.0);
+					}
+					mOctaves[o].mean = sum / Real(count) * mOctaves[o].persistence;
+				}
+			}
 		public:
-			BillowElement3D (size_t octaves, Real frequency, Real lacunarity, Real persistence, int mainSeed, int quality, Real nscale) : mOctaveCount(octaves), mQuality(quality), mScale(nscale)
+			BillowElement3D (size_t octaves, Real frequency, Real lacunarity, Real persistence, int mainSeed, int quality, Real nscale, int precision=NOISE_PRECISION_REAL) : mOctaveCount(octaves), mQuality(quality), mScale(nscale), mPrecision(precision)
 			{
 				if (quality > NOISE_QUALITY_HIGH)
 					mScale *= FAST_NOISE_SCALE_FACTOR;
@@ -221,10 +308,12 @@ namespace noisepp
 					mOctaves[o].persistence = curPersistence;
 					mOctaves[o].scale = scale;
 					mOctaves[o].seed = seed;
+					mOctaves[o].lattice = -1;
 
 					scale *= lacunarity;
 					curPersistence *= persistence;
 				}
+				calculateMeans ();
 			}
 			virtual ~BillowElement3D ()
 			{
@@ -241,7 +330,7 @@ namespace noisepp
 					const Real nx = Math::MakeInt32Range (x * mOctaves[o].scale);
 					const Real ny = Math::MakeInt32Range (y * mOctaves[o].scale);
 					const Real nz = Math::MakeInt32Range (z * mOctaves[o].scale);
-					signal = calculateGradient(nx, ny, nz, mOctaves[o].seed);
+					signal = calculateOctave (mOctaves[o], nx, ny, nz, cache);
 					signal = Real(2.0) * std::fabs (signal) - Real(1.0);
 
 					value += signal * mOctaves[o].persistence;
@@ -249,6 +338,133 @@ namespace noisepp
 
 				return value;
 			}
+			/// Octaves which aren't resolved at the spacing are replaced by their average.
+			virtual void getValues (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Cache *cache, Real spacing=0.0) const
+			{
+				if (!count)
+					return;
+				std::vector<Real> buffer(count*4);
+				Real *nx = &buffer[0];
+				Real *ny = nx + count;
+				Real *nz = ny + count;
+				Real *octaveBuffer = nz + count;
+				Real skipped = 0.0;
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					if (!Generator3D::isResolved (mOctaves[o].scale, spacing))
+						skipped += mOctaves[o].mean;
+				}
+				std::fill (values, values+count, Real(0.5) + skipped);
+
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					const Octave &octave = mOctaves[o];
+					if (!Generator3D::isResolved (octave.scale, spacing))
+						continue;
+					for (size_t i=0;i<count;++i)
+					{
+						nx[i] = Math::MakeInt32Range (x[i] * octave.scale);
+						ny[i] = Math::MakeInt32Range (y[i] * octave.scale);
+						nz[i] = Math::MakeInt32Range (z[i] * octave.scale);
+					}
+					const Real *noise = calculateOctaveBatch (octave, count, nx, ny, nz, octaveBuffer, cache);
+					for (size_t i=0;i<count;++i)
+					{
+						Real signal = noise[i];
+						signal = Real(2.0) * std::fabs (signal) - Real(1.0);
+
+						values[i] += signal * octave.persistence;
+					}
+				}
+			}
+			/// Replaces the same octaves by their average as getValues(), they don't change the derivatives.
+			virtual bool getDerivatives (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Cache *cache, Real spacing=0.0) const
+			{
+				if (!count)
+					return true;
+				std::vector<Real> buffer(count*7);
+				Real *nx = &buffer[0];
+				Real *ny = nx + count;
+				Real *nz = ny + count;
+				Real *octaveBuffer = nz + count;
+				Real skipped = 0.0;
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					if (!Generator3D::isResolved (mOctaves[o].scale, spacing))
+						skipped += mOctaves[o].mean;
+				}
+				std::fill (values, values+count, Real(0.5) + skipped);
+				std::fill (dx, dx+count, Real(0.0));
+				std::fill (dy, dy+count, Real(0.0));
+				std::fill (dz, dz+count, Real(0.0));
+
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					const Octave &octave = mOctaves[o];
+					if (!Generator3D::isResolved (octave.scale, spacing))
+						continue;
+					for (size_t i=0;i<count;++i)
+					{
+						nx[i] = Math::MakeInt32Range (x[i] * octave.scale);
+						ny[i] = Math::MakeInt32Range (y[i] * octave.scale);
+						nz[i] = Math::MakeInt32Range (z[i] * octave.scale);
+					}
+					const Real *noise = calculateOctaveDerivatives (octave, count, nx, ny, nz, octaveBuffer, cache);
+					const Real *ndx = noise + count;
+					const Real *ndy = ndx + count;
+					const Real *ndz = ndy + count;
+					for (size_t i=0;i<count;++i)
+					{
+						Real signal = noise[i];
+						// derivative of 2 * |noise| - 1, scaled to the point coordinates
+						const Real factor = (signal < Real(0.0) ? Real(-2.0) : Real(2.0)) * octave.persistence * octave.scale;
+						signal = Real(2.0) * std::fabs (signal) - Real(1.0);
+
+						values[i] += signal * octave.persistence;
+						dx[i] += ndx[i] * factor;
+						dy[i] += ndy[i] * factor;
+						dz[i] += ndz[i] * factor;
+					}
+				}
+				return true;
+			}
+			/// @copydoc noisepp::PipelineElement3D::getLatticeOctaves()
+			virtual void getLatticeOctaves (std::vector<LatticeOctave3D> &octaves)
+			{
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					LatticeOctave3D octave;
+					octave.frequency[0] = octave.frequency[1] = octave.frequency[2] = mOctaves[o].scale;
+					octave.seed = mOctaves[o].seed;
+					octave.quality = mQuality;
+					octave.noiseScale = mScale;
+					octave.precision = mPrecision;
+					octave.lattice = &mOctaves[o].lattice;
+					octaves.push_back (octave);
+				}
+			}
+			virtual bool getBounds (const Box3D &box, Real &lower, Real &upper, Real spacing=0.0) const
+			{
+				lower = upper = 0.5;
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					if (!Generator3D::isResolved (mOctaves[o].scale, spacing))
+					{
+						lower += mOctaves[o].mean;
+						upper += mOctaves[o].mean;
+						continue;
+					}
+					Real signalLower, signalUpper;
+					calculateGradientBounds (box, mOctaves[o], signalLower, signalUpper);
+					Math::AbsBounds (signalLower, signalUpper);
+					signalLower = Real(2.0) * signalLower - Real(1.0);
+					signalUpper = Real(2.0) * signalUpper - Real(1.0);
+					Math::ScaleBounds (mOctaves[o].persistence, signalLower, signalUpper);
+					lower += signalLower;
+					upper += signalUpper;
+				}
+				return true;
+			}
 	};
 
 	/** Module for generating "billowy" perlin noise.
@@ -270,7 +486,7 @@ namespace noisepp
 			/// @copydoc noisepp::Module::addToPipeline()
 			ElementID addToPipeline (Pipeline3D *pipe) const
 			{
-				return pipe->addElement (this, new BillowElement3D(mOctaveCount, mFrequency, mLacunarity, mPersistence, mSeed+pipe->getSeed(), mQuality, mScale));
+				return pipe->addElement (this, new BillowElement3D(mOctaveCount, mFrequency, mLacunarity, mPersistence, mSeed+pipe->getSeed(), mQuality, mScale, pipe->getPrecision()));
 			}
 			/// @copydoc noisepp::Module::getType()
 			ModuleTypeId getType() const { return MODULE_BILLOW; }
@@ -0,0 +1,762 @@
+// Noise++ Library
+// Copyright (c) 2008, Urs C. Hanselmann
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above copyright notice,
+//      this list of conditions and the following disclaimer in the documentation
+//      and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef NOISEPP_COMPILED_H
+#define NOISEPP_COMPILED_H
+
+#include "NoisePipeline.h"
+#include "NoiseConstant.h"
+#include "NoiseScaleBias.h"
+#include "NoiseScalePoint.h"
+#include "NoiseSelect.h"
+#include "NoiseShellMap.h"
+
+namespace noisepp
+{
+	/** Compiled pipelines.
+		A module graph which is known at compile time can be written as a nested type of the templates
+		in this namespace, i.e. Select<Constant, ScaleBias<Element<PerlinElement3D> >, Element<PerlinElement3D> >.
+		All calls are resolved at compile time, so the compiler can inline the whole graph into a single function.
+		The generator elements are still created by a Pipeline3D, which owns them and whose seed and precision are used.
+		There is no cache, so modules which are used more than once in the graph are calculated more than once,
+		and the generator elements don't share their lattices, see Pipeline::shareLattices().
+		Use the dynamic Pipeline3D for graphs which are built or loaded at runtime.
+		getDerivatives() only compiles for graphs whose nodes all have it, and Element throws if its element can't calculate them.
+	*/
+	namespace compiled
+	{
+		/// Generator element, created by a pipeline.
+		/// Only use it for elements without source elements, they get no cache.
+		template <class T>
+		class Element
+		{
+			private:
+				const T *mElement;
+#if NOISEPP_ENABLE_PROFILING
+				Profile *mProfile;
+#endif
+
+			public:
+				/// Constructor.
+				/// @param pipe The pipeline which creates and owns the element.
+				/// @param module The module, must create an element of type T.
+				Element (Pipeline3D *pipe, const Module &module)
+				{
+					NoiseAssert (pipe != NULL, pipe);
+					mElement = dynamic_cast<const T*>(pipe->getElement (module.addToPipeline (pipe)));
+					NoiseAssert (mElement != NULL, module);
+#if NOISEPP_ENABLE_PROFILING
+					mProfile = &module.getProfile ();
+#endif
+				}
+				NOISEPP_INLINE Real getValue (Real x, Real y, Real z) const
+				{
+					NOISEPP_PROFILE_SCOPE(mProfile, 1);
+					return mElement->T::getValue (x, y, z, NULL);
+				}
+				void getValues (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real spacing=0.0) const
+				{
+					NOISEPP_PROFILE_SCOPE(mProfile, count);
+					mElement->T::getValues (count, x, y, z, values, NULL, spacing);
+				}
+				void getDerivatives (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Real spacing=0.0) const
+				{
+					NOISEPP_PROFILE_SCOPE(mProfile, count);
+					if (!mElement->T::getDerivatives (count, x, y, z, values, dx, dy, dz, NULL, spacing))
+						NoiseThrowNotImplementedException;
+				}
+				bool getBounds (const Box3D &box, Real &lower, Real &upper, Real spacing=0.0) const
+				{
+					return mElement->T::getBounds (box, lower, upper, spacing);
+				}
+		};
+
+		/// Same as Element<PerlinElement3D>, but takes the lowest octaves from a ShellMap if there is one.
+		/// Only use it for points on the sphere of the map, the values differ from the ones of the element by the
+		/// interpolation error of the map. The octaves are the ones the element calculates at the spacing.
+		/// A ShellPatch of the map replaces it for the batches whose spacing resolves all the octaves of the patch.
+		class BakedPerlin
+		{
+			private:
+				const PerlinElement3D *mElement;
+				const ShellMap *mMap;
+				const ShellPatch *mPatch;
+
+				/// Returns the patch if it has more octaves than the map has for the spacing, and the spacing resolves them.
+				const ShellPatch *getPatch (size_t level, Real spacing) const
+				{
+					if (!mPatch || mPatch->getOctaveCount () <= level)
+						return NULL;
+					for (size_t o=level;o<mPatch->getOctaveCount ();++o)
+					{
+						if (!Generator3D::isResolved (mElement->getOctaveFrequency (o), spacing))
+							return NULL;
+					}
+					return mPatch;
+				}
+#if NOISEPP_ENABLE_PROFILING
+				Profile *mProfile;
+#endif
+
+			public:
+				/// Constructor.
+				/// @param pipe The pipeline which creates and owns the element.
+				/// @param module The module, must create a PerlinElement3D.
+				/// @param map The baked octaves of the element or NULL, it must outlive the node. It may be the map of the element of
+				/// the module in another pipeline, whose element then calculates the octaves the map doesn't have, to the same bits.
+				/// @param patch A patch of the map or NULL, it must outlive the node. It can be rebuilt between batches.
+				BakedPerlin (Pipeline3D *pipe, const Module &module, const ShellMap *map=NULL, const ShellPatch *patch=NULL) : mMap(map), mPatch(patch)
+				{
+					NoiseAssert (pipe != NULL, pipe);
+					mElement = dynamic_cast<const PerlinElement3D*>(pipe->getElement (module.addToPipeline (pipe)));
+					NoiseAssert (mElement != NULL, module);
+					NoiseAssert (map == NULL || map->getElement ()->getOctaveCount () == mElement->getOctaveCount (), map);
+					if (map)
+						mElement = map->getElement ();
+					NoiseAssert (patch == NULL || patch->getMap () == map, patch);
+#if NOISEPP_ENABLE_PROFILING
+					mProfile = &module.getProfile ();
+#endif
+				}
+				NOISEPP_INLINE Real getValue (Real x, Real y, Real z) const
+				{
+					NOISEPP_PROFILE_SCOPE(mProfile, 1);
+					if (!mMap)
+						return mElement->PerlinElement3D::getValue (x, y, z, NULL);
+					Real baked, value;
+					const size_t level = mMap->getOctaveCount ();
+					mMap->getValues (level, 1, &x, &y, &z, &baked);
+					mElement->getOctaveValues (level, mElement->getOctaveCount (), 1, &x, &y, &z, &value, NULL);
+					return baked + value;
+				}
+				void getValues (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real spacing=0.0) const
+				{
+					NOISEPP_PROFILE_SCOPE(mProfile, count);
+					if (!mMap)
+					{
+						mElement->PerlinElement3D::getValues (count, x, y, z, values, NULL, spacing);
+						return;
+					}
+					if (!count)
+						return;
+					size_t level = mMap->getLevel (spacing);
+					std::vector<Real> baked(count);
+					if (const ShellPatch *patch = getPatch (level, spacing))
+					{
+						level = patch->getOctaveCount ();
+						patch->getValues (count, x, y, z, &baked[0]);
+					}
+					else
+						mMap->getValues (level, count, x, y, z, &baked[0]);
+					mElement->getOctaveValues (level, mElement->getOctaveCount (), count, x, y, z, values, NULL, spacing);
+					for (size_t i=0;i<count;++i)
+					{
+						values[i] += baked[i];
+					}
+				}
+				void getDerivatives (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Real spacing=0.0) const
+				{
+					NOISEPP_PROFILE_SCOPE(mProfile, count);
+					if (!mMap)
+					{
+						mElement->PerlinElement3D::getDerivatives (count, x, y, z, values, dx, dy, dz, NULL, spacing);
+						return;
+					}
+					if (!count)
+						return;
+					size_t level = mMap->getLevel (spacing);
+					std::vector<Real> baked(count * 4);
+					if (const ShellPatch *patch = getPatch (level, spacing))
+					{
+						level = patch->getOctaveCount ();
+						patch->getDerivatives (count, x, y, z, &baked[0], &baked[count], &baked[2*count], &baked[3*count]);
+					}
+					else
+						mMap->getDerivatives (level, count, x, y, z, &baked[0], &baked[count], &baked[2*count], &baked[3*count]);
+					mElement->getOctaveDerivatives (level, mElement->getOctaveCount (), count, x, y, z, values, dx, dy, dz, NULL, spacing);
+					for (size_t i=0;i<count;++i)
+					{
+						values[i] += baked[i];
+						dx[i] += baked[count + i];
+						dy[i] += baked[2*count + i];
+						dz[i] += baked[3*count + i];
+					}
+				}
+				bool getBounds (const Box3D &box, Real &lower, Real &upper, Real spacing=0.0) const
+				{
+					if (!mMap)
+						return mElement->PerlinElement3D::getBounds (box, lower, upper, spacing);
+					size_t level = mMap->getLevel (spacing);
+					Real bakedLower, bakedUpper;
+					if (const ShellPatch *patch = getPatch (level, spacing))
+					{
+						level = patch->getOctaveCount ();
+						patch->getBounds (box, bakedLower, bakedUpper);
+					}
+					else
+						mMap->getBounds (level, box, bakedLower, bakedUpper);
+					mElement->getOctaveBounds (level, mElement->getOctaveCount (), box, lower, upper, spacing);
+					lower += bakedLower;
+					upper += bakedUpper;
+					return true;
+				}
+		};
+
+		/// Same as ConstantModule.
+		class Constant
+		{
+			private:
+				Real mValue;
+#if NOISEPP_ENABLE_PROFILING
+				Profile *mProfile;
+#endif
+
+			public:
+				/// Constructor.
+				Constant (const ConstantModule &module) : mValue(module.getValue())
+				{
+#if NOISEPP_ENABLE_PROFILING
+					mProfile = &module.getProfile ();
+#endif
+				}
+				NOISEPP_INLINE Real getValue (Real x, Real y, Real z) const
+				{
+					NOISEPP_PROFILE_SCOPE(mProfile, 1);
+					return mValue;
+				}
+				void getValues (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real spacing=0.0) const
+				{
+					NOISEPP_PROFILE_SCOPE(mProfile, count);
+					std::fill (values, values+count, mValue);
+				}
+				void getDerivatives (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Real spacing=0.0) const
+				{
+					NOISEPP_PROFILE_SCOPE(mProfile, count);
+					std::fill (values, values+count, mValue);
+					std::fill (dx, dx+count, Real(0.0));
+					std::fill (dy, dy+count, Real(0.0));
+					std::fill (dz, dz+count, Real(0.0));
+				}
+				bool getBounds (const Box3D &box, Real &lower, Real &upper, Real spacing=0.0) const
+				{
+					lower = upper = mValue;
+					return true;
+				}
+		};
+
+		/// Same as ScaleBiasModule.
+		template <class Source>
+		class ScaleBias
+		{
+			private:
+				Source mSource;
+				Real mScale, mBias;
+#if NOISEPP_ENABLE_PROFILING
+				Profile *mProfile;
+#endif
+
+			public:
+				/// Constructor.
+				ScaleBias (const ScaleBiasModule &module, const Source &source) : mSource(source), mScale(module.getScale()), mBias(module.getBias())
+				{
+#if NOISEPP_ENABLE_PROFILING
+					mProfile = &module.getProfile ();
+#endif
+				}
+				NOISEPP_INLINE Real getValue (Real x, Real y, Real z) const
+				{
+					NOISEPP_PROFILE_SCOPE(mProfile, 1);
+					return mSource.getValue (x, y, z) * mScale + mBias;
+				}
+				void getValues (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real spacing=0.0) const
+				{
+					NOISEPP_PROFILE_SCOPE(mProfile, count);
+					mSource.getValues (count, x, y, z, values, spacing);
+					for (size_t i=0;i<count;++i)
+					{
+						values[i] = values[i] * mScale + mBias;
+					}
+				}
+				void getDerivatives (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Real spacing=0.0) const
+				{
+					NOISEPP_PROFILE_SCOPE(mProfile, count);
+					mSource.getDerivatives (count, x, y, z, values, dx, dy, dz, spacing);
+					for (size_t i=0;i<count;++i)
+					{
+						values[i] = values[i] * mScale + mBias;
+						dx[i] *= mScale;
+						dy[i] *= mScale;
+						dz[i] *= mScale;
+					}
+				}
+				bool getBounds (const Box3D &box, Real &lower, Real &upper, Real spacing=0.0) const
+				{
+					if (!mSource.getBounds (box, lower, upper, spacing))
+						return false;
+					Math::ScaleBounds (mScale, lower, upper);
+					lower += mBias;
+					upper += mBias;
+					return true;
+				}
+		};
+
+		/// Same as ScalePointModule.
+		template <class Source>
+		class ScalePoint
+		{
+			private:
+				Source mSource;
+				Real mScaleX, mScaleY, mScaleZ;
+#if NOISEPP_ENABLE_PROFILING
+				Profile *mProfile;
+#endif
+
+				Real getSpacingScale () const
+				{
+					return std::max (std::fabs (mScaleX), std::max (std::fabs (mScaleY), std::fabs (mScaleZ)));
+				}
+
+			public:
+				/// Constructor.
+				ScalePoint (const ScalePointModule &module, const Source &source) : mSource(source), mScaleX(module.getScaleX()), mScaleY(module.getScaleY()), mScaleZ(module.getScaleZ())
+				{
+#if NOISEPP_ENABLE_PROFILING
+					mProfile = &module.getProfile ();
+#endif
+				}
+				NOISEPP_INLINE Real getValue (Real x, Real y, Real z) const
+				{
+					NOISEPP_PROFILE_SCOPE(mProfile, 1);
+					return mSource.getValue (x*mScaleX, y*mScaleY, z*mScaleZ);
+				}
+				void getValues (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real spacing=0.0) const
+				{
+					NOISEPP_PROFILE_SCOPE(mProfile, count);
+					if (!count)
+						return;
+					std::vector<Real> coords(count * 3);
+					Real *sx = &coords[0];
+					Real *sy = sx + count;
+					Real *sz = sy + count;
+					for (size_t i=0;i<count;++i)
+					{
+						sx[i] = x[i] * mScaleX;
+						sy[i] = y[i] * mScaleY;
+						sz[i] = z[i] * mScaleZ;
+					}
+					mSource.getValues (count, sx, sy, sz, values, spacing * getSpacingScale ());
+				}
+				void getDerivatives (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Real spacing=0.0) const
+				{
+					NOISEPP_PROFILE_SCOPE(mProfile, count);
+					if (!count)
+						return;
+					std::vector<Real> coords(count * 3);
+					Real *sx = &coords[0];
+					Real *sy = sx + count;
+					Real *sz = sy + count;
+					for (size_t i=0;i<count;++i)
+					{
+						sx[i] = x[i] * mScaleX;
+						sy[i] = y[i] * mScaleY;
+						sz[i] = z[i] * mScaleZ;
+					}
+					mSource.getDerivatives (count, sx, sy, sz, values, dx, dy, dz, spacing * getSpacingScale ());
+					for (size_t i=0;i<count;++i)
+					{
+						dx[i] *= mScaleX;
+						dy[i] *= mScaleY;
+						dz[i] *= mScaleZ;
+					}
+				}
+				bool getBounds (const Box3D &box, Real &lower, Real &upper, Real spacing=0.0) const
+				{
+					const Real scale[3] = { mScaleX, mScaleY, mScaleZ };
+					Box3D scaledBox;
+					for (int d=0;d<3;++d)
+					{
+						scaledBox.min[d] = box.min[d] * scale[d];
+						scaledBox.max[d] = box.max[d] * scale[d];
+						if (scaledBox.min[d] > scaledBox.max[d])
+							std::swap (scaledBox.min[d], scaledBox.max[d]);
+					}
+					return mSource.getBounds (scaledBox, lower, upper, spacing * getSpacingScale ());
+				}
+		};
+
+		/// Same as SelectModule.
+		/// Left, Right and Control are the source modules 0, 1 and 2.
+		template <class Left, class Right, class Control>
+		class Select
+		{
+			private:
+				Left mLeft;
+				Right mRight;
+				Control mControl;
+				Real mLowerBound, mUpperBound;
+				Real mLowerBoundPlusFalloff, mLowerBoundMinusFalloff;
+				Real mUpperBoundPlusFalloff, mUpperBoundMinusFalloff;
+				Real mEdgeFalloff, mTwoEdgeFalloff;
+#if NOISEPP_ENABLE_PROFILING
+				Profile *mProfile;
+#endif
+
+				enum { SELECT_LEFT=0, SELECT_LEFT_RIGHT=1, SELECT_RIGHT=2, SELECT_RIGHT_LEFT=3 };
+				enum { BOUNDS_MIN_COUNT=64 };
+
+				/// Same as SelectElement3D::getBoundsMode().
+				int getBoundsMode (Real lower, Real upper) const
+				{
+					if (mEdgeFalloff > 0.0)
+					{
+						if (upper < mLowerBoundMinusFalloff || lower >= mUpperBoundPlusFalloff)
+							return SELECT_LEFT;
+						if (lower >= mLowerBoundPlusFalloff && upper < mUpperBoundMinusFalloff)
+							return SELECT_RIGHT;
+					}
+					else
+					{
+						if (upper < mLowerBound || lower > mUpperBound)
+							return SELECT_LEFT;
+						if (lower >= mLowerBound && upper <= mUpperBound)
+							return SELECT_RIGHT;
+					}
+					return SELECT_LEFT_RIGHT;
+				}
+
+				/// Same as SelectElement3D::getMode().
+				int getMode (Real controlValue) const
+				{
+					if (mEdgeFalloff > 0.0)
+					{
+						if (controlValue < mLowerBoundMinusFalloff)
+							return SELECT_LEFT;
+						else if (controlValue < mLowerBoundPlusFalloff)
+							return SELECT_LEFT_RIGHT;
+						else if (controlValue < mUpperBoundMinusFalloff)
+							return SELECT_RIGHT;
+						else if (controlValue < mUpperBoundPlusFalloff)
+							return SELECT_RIGHT_LEFT;
+						return SELECT_LEFT;
+					}
+					if (controlValue < mLowerBound || controlValue > mUpperBound)
+						return SELECT_LEFT;
+					return SELECT_RIGHT;
+				}
+
+				/// Same as SelectElement3D::blendDerivatives().
+				NOISEPP_INLINE void blendDerivatives (Real *const *from, Real *const *to, Real *const *control, size_t i, Real a, Real *const *result) const
+				{
+					const Real alpha = Math::CubicCurve3 (a);
+					const Real alphaDerivative = Math::CubicCurve3Derivative (a) / mTwoEdgeFalloff;
+					const Real difference = to[0][i] - from[0][i];
+					result[0][i] = Math::InterpLinear (from[0][i], to[0][i], alpha);
+					for (int k=1;k<4;++k)
+					{
+						result[k][i] = Math::InterpLinear (from[k][i], to[k][i], alpha) + alphaDerivative * control[k][i] * difference;
+					}
+				}
+
+				template <class Source>
+				static void getSubsetDerivatives (const Source &source, const std::vector<size_t> &indices, size_t count, const Real *x, const Real *y, const Real *z, Real *const *derivatives, Real spacing)
+				{
+					const size_t n = indices.size ();
+					if (n == 0)
+						return;
+					if (n == count)
+					{
+						source.getDerivatives (count, x, y, z, derivatives[0], derivatives[1], derivatives[2], derivatives[3], spacing);
+						return;
+					}
+					std::vector<Real> buffer(n * 7);
+					Real *sx = &buffer[0];
+					Real *sy = sx + n;
+					Real *sz = sy + n;
+					Real *sv = sz + n;
+					for (size_t i=0;i<n;++i)
+					{
+						sx[i] = x[indices[i]];
+						sy[i] = y[indices[i]];
+						sz[i] = z[indices[i]];
+					}
+					source.getDerivatives (n, sx, sy, sz, sv, sv + n, sv + 2*n, sv + 3*n, spacing);
+					for (int k=0;k<4;++k)
+					{
+						for (size_t i=0;i<n;++i)
+						{
+							derivatives[k][indices[i]] = sv[k*n + i];
+						}
+					}
+				}
+
+				template <class Source>
+				static void getSubsetValues (const Source &source, const std::vector<size_t> &indices, size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real spacing)
+				{
+					const size_t n = indices.size ();
+					if (n == 0)
+						return;
+					if (n == count)
+					{
+						source.getValues (count, x, y, z, values, spacing);
+						return;
+					}
+					std::vector<Real> buffer(n * 4);
+					Real *sx = &buffer[0];
+					Real *sy = sx + n;
+					Real *sz = sy + n;
+					Real *sv = sz + n;
+					for (size_t i=0;i<n;++i)
+					{
+						sx[i] = x[indices[i]];
+						sy[i] = y[indices[i]];
+						sz[i] = z[indices[i]];
+					}
+					source.getValues (n, sx, sy, sz, sv, spacing);
+					for (size_t i=0;i<n;++i)
+					{
+						values[indices[i]] = sv[i];
+					}
+				}
+
+			public:
+				/// Constructor.
+				Select (const SelectModule &module, const Left &left, const Right &right, const Control &control) :
+					mLeft(left), mRight(right), mControl(control),
+					mLowerBound(module.getLowerBound()), mUpperBound(module.getUpperBound()), mEdgeFalloff(module.getEdgeFalloff())
+				{
+					NoiseAssert (mLowerBound < mUpperBound, (mLowerBound, mUpperBound));
+
+					mLowerBoundPlusFalloff = mLowerBound + mEdgeFalloff;
+					mLowerBoundMinusFalloff = mLowerBound - mEdgeFalloff;
+					mUpperBoundPlusFalloff = mUpperBound + mEdgeFalloff;
+					mUpperBoundMinusFalloff = mUpperBound - mEdgeFalloff;
+					mTwoEdgeFalloff = Real(2.0) * mEdgeFalloff;
+#if NOISEPP_ENABLE_PROFILING
+					mProfile = &module.getProfile ();
+#endif
+				}
+				NOISEPP_INLINE Real getValue (Real x, Real y, Real z) const
+				{
+					NOISEPP_PROFILE_SCOPE(mProfile, 1);
+					const Real controlValue = mControl.getValue (x, y, z);
+					Real alpha;
+					if (mEdgeFalloff > 0.0)
+					{
+						if (controlValue < mLowerBoundMinusFalloff)
+						{
+							return mLeft.getValue (x, y, z);
+						}
+						else if (controlValue < mLowerBoundPlusFalloff)
+						{
+							alpha = Math::CubicCurve3 ((controlValue - mLowerBoundMinusFalloff) / mTwoEdgeFalloff);
+							return Math::InterpLinear (mLeft.getValue (x, y, z), mRight.getValue (x, y, z), alpha);
+						}
+						else if (controlValue < mUpperBoundMinusFalloff)
+						{
+							return mRight.getValue (x, y, z);
+						}
+						else if (controlValue < mUpperBoundPlusFalloff)
+						{
+							alpha = Math::CubicCurve3 ((controlValue - mUpperBoundMinusFalloff) / mTwoEdgeFalloff);
+							return Math::InterpLinear (mRight.getValue (x, y, z), mLeft.getValue (x, y, z), alpha);
+						}
+						else
+						{
+							return mLeft.getValue (x, y, z);
+						}
+					}
+					else
+					{
+						if (controlValue < mLowerBound || controlValue > mUpperBound)
+							return mLeft.getValue (x, y, z);
+						else
+							return mRight.getValue (x, y, z);
+					}
+				}
+				/// Only the sources a point actually selects are calculated for it, as in SelectElement3D::getValues().
+				void getValues (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real spacing=0.0) const
+				{
+					if (!count)
+						return;
+					NOISEPP_PROFILE_SCOPE(mProfile, count);
+
+					if (count >= BOUNDS_MIN_COUNT)
+					{
+						Box3D box;
+						box.set (count, x, y, z);
+						Real controlLower, controlUpper;
+						if (mControl.getBounds (box, controlLower, controlUpper, spacing))
+						{
+							const int mode = getBoundsMode (controlLower, controlUpper);
+							if (mode == SELECT_LEFT)
+							{
+								mLeft.getValues (count, x, y, z, values, spacing);
+								return;
+							}
+							else if (mode == SELECT_RIGHT)
+							{
+								mRight.getValues (count, x, y, z, values, spacing);
+								return;
+							}
+						}
+					}
+
+					std::vector<Real> buffer(count * 3);
+					Real *controlValues = &buffer[0];
+					Real *leftValues = controlValues + count;
+					Real *rightValues = leftValues + count;
+					std::vector<unsigned char> modes(count);
+					std::vector<size_t> leftIndices, rightIndices;
+
+					mControl.getValues (count, x, y, z, controlValues, spacing);
+					for (size_t i=0;i<count;++i)
+					{
+						const unsigned char mode = getMode (controlValues[i]);
+						modes[i] = mode;
+						if (mode != SELECT_RIGHT)
+							leftIndices.push_back (i);
+						if (mode != SELECT_LEFT)
+							rightIndices.push_back (i);
+					}
+
+					getSubsetValues (mLeft, leftIndices, count, x, y, z, leftValues, spacing);
+					getSubsetValues (mRight, rightIndices, count, x, y, z, rightValues, spacing);
+
+					for (size_t i=0;i<count;++i)
+					{
+						Real alpha;
+						switch (modes[i])
+						{
+							case SELECT_LEFT:
+								values[i] = leftValues[i];
+								break;
+							case SELECT_LEFT_RIGHT:
+								alpha = Math::CubicCurve3 ((controlValues[i] - mLowerBoundMinusFalloff) / mTwoEdgeFalloff);
+								values[i] = Math::InterpLinear (leftValues[i], rightValues[i], alpha);
+								break;
+							case SELECT_RIGHT:
+								values[i] = rightValues[i];
+								break;
+							default:
+								alpha = Math::CubicCurve3 ((controlValues[i] - mUpperBoundMinusFalloff) / mTwoEdgeFalloff);
+								values[i] = Math::InterpLinear (rightValues[i], leftValues[i], alpha);
+								break;
+						}
+					}
+				}
+				/// Same as SelectElement3D::getDerivatives().
+				void getDerivatives (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Real spacing=0.0) const
+				{
+					if (!count)
+						return;
+					NOISEPP_PROFILE_SCOPE(mProfile, count);
+
+					if (count >= BOUNDS_MIN_COUNT)
+					{
+						Box3D box;
+						box.set (count, x, y, z);
+						Real controlLower, controlUpper;
+						if (mControl.getBounds (box, controlLower, controlUpper, spacing))
+						{
+							const int mode = getBoundsMode (controlLower, controlUpper);
+							if (mode == SELECT_LEFT)
+							{
+								mLeft.getDerivatives (count, x, y, z, values, dx, dy, dz, spacing);
+								return;
+							}
+							else if (mode == SELECT_RIGHT)
+							{
+								mRight.getDerivatives (count, x, y, z, values, dx, dy, dz, spacing);
+								return;
+							}
+						}
+					}
+
+					std::vector<Real> buffer(count * 12);
+					Real *const control[4] = { &buffer[0], &buffer[count], &buffer[2*count], &buffer[3*count] };
+					Real *const left[4] = { &buffer[4*count], &buffer[5*count], &buffer[6*count], &buffer[7*count] };
+					Real *const right[4] = { &buffer[8*count], &buffer[9*count], &buffer[10*count], &buffer[11*count] };
+					Real *const result[4] = { values, dx, dy, dz };
+					std::vector<unsigned char> modes(count);
+					std::vector<size_t> leftIndices, rightIndices;
+
+					mControl.getDerivatives (count, x, y, z, control[0], control[1], control[2], control[3], spacing);
+					for (size_t i=0;i<count;++i)
+					{
+						const unsigned char mode = getMode (control[0][i]);
+						modes[i] = mode;
+						if (mode != SELECT_RIGHT)
+							leftIndices.push_back (i);
+						if (mode != SELECT_LEFT)
+							rightIndices.push_back (i);
+					}
+
+					getSubsetDerivatives (mLeft, leftIndices, count, x, y, z, left, spacing);
+					getSubsetDerivatives (mRight, rightIndices, count, x, y, z, right, spacing);
+
+					for (size_t i=0;i<count;++i)
+					{
+						switch (modes[i])
+						{
+							case SELECT_LEFT:
+								for (int k=0;k<4;++k)
+									result[k][i] = left[k][i];
+								break;
+							case SELECT_LEFT_RIGHT:
+								blendDerivatives (left, right, control, i, (control[0][i] - mLowerBoundMinusFalloff) / mTwoEdgeFalloff, result);
+								break;
+							case SELECT_RIGHT:
+								for (int k=0;k<4;++k)
+									result[k][i] = right[k][i];
+								break;
+							default:
+								blendDerivatives (right, left, control, i, (control[0][i] - mUpperBoundMinusFalloff) / mTwoEdgeFalloff, result);
+								break;
+						}
+					}
+				}
+				bool getBounds (const Box3D &box, Real &lower, Real &upper, Real spacing=0.0) const
+				{
+					Real controlLower, controlUpper;
+					int mode = SELECT_LEFT_RIGHT;
+					if (mControl.getBounds (box, controlLower, controlUpper, spacing))
+						mode = getBoundsMode (controlLower, controlUpper);
+					if (mode == SELECT_LEFT)
+						return mLeft.getBounds (box, lower, upper, spacing);
+					else if (mode == SELECT_RIGHT)
+						return mRight.getBounds (box, lower, upper, spacing);
+
+					Real leftLower, leftUpper, rightLower, rightUpper;
+					if (!mLeft.getBounds (box, leftLower, leftUpper, spacing) || !mRight.getBounds (box, rightLower, rightUpper, spacing))
+						return false;
+					lower = std::min (leftLower, rightLower);
+					upper = std::max (leftUpper, rightUpper);
+					return true;
+				}
+		};
+	};
+};
+
+#endif
@@ -39,8 +39,20 @@
 #define NOISEPP_BIG_ENDIAN 0
 #endif
 
+// Defines whether the SSE4.1/AVX2 noise kernels are compiled in. They are selected at runtime
+// depending on the CPU, the scalar code is used as fallback
+#ifndef NOISEPP_ENABLE_SIMD
+#define NOISEPP_ENABLE_SIMD 1
+#endif
+
 #ifndef NOISEPP_ENABLE_UTILS
 #define NOISEPP_ENABLE_UTILS 1
 #endif
 
+// Defines whether the pipeline elements count their evaluations and cache hits and sample the time
+// spent in them, see NoiseProfile.h. When disabled the counters don't exist at all
+#ifndef NOISEPP_ENABLE_PROFILING
+#define NOISEPP_ENABLE_PROFILING 0
+#endif
+
 #endif
@@ -53,6 +53,23 @@ namespace noisepp
 			{
 				return mValue;
 			}
+			virtual void getValues (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Cache *cache, Real spacing=0.0) const
+			{
+				std::fill (values, values+count, mValue);
+			}
+			virtual bool getDerivatives (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Cache *cache, Real spacing=0.0) const
+			{
+				std::fill (values, values+count, mValue);
+				std::fill (dx, dx+count, Real(0.0));
+				std::fill (dy, dy+count, Real(0.0));
+				std::fill (dz, dz+count, Real(0.0));
+				return true;
+			}
+			virtual bool getBounds (const Box3D &box, Real &lower, Real &upper, Real spacing=0.0) const
+			{
+				lower = upper = mValue;
+				return true;
+			}
 	};
 
 	typedef ConstantElement<PipelineElement1D> ConstantElement1D;
@@ -137,6 +137,12 @@ namespace noisepp
 			}
 			/// @copydoc noisepp::Module::getType()
 			ModuleTypeId getType() const { return MODULE_EXPONENT; }
+			/// @copydoc noisepp::Module::getSourceScale()
+			virtual bool getSourceScale (Real *scale) const
+			{
+				scale[0] = scale[1] = scale[2] = 1.0;
+				return true;
+			}
 #if NOISEPP_ENABLE_UTILS
 			/// @copydoc noisepp::Module::write()
 			virtual void write (utils::OutStream &stream) const;
@@ -29,6 +29,7 @@
 #include "NoiseMath.h"
 #include "NoiseVectorTable.h"
 #include "NoisePlatform.h"
+#include "NoiseSIMD.h"
 
 namespace noisepp
 {
@@ -103,11 +104,12 @@ namespace noisepp
 				return Math::InterpLinear (n0, n1, xs) * scale;
 			}
 
+			/// The hash wraps around, so it's calculated unsigned, see Generator3D::intNoise().
 			static NOISEPP_INLINE int intNoise (int x, int seed)
 			{
-				int n = (NOISE_X_FACTOR * x + NOISE_SEED_FACTOR * seed) & 0x7fffffff;
+				unsigned int n = (unsigned(NOISE_X_FACTOR) * unsigned(x) + unsigned(NOISE_SEED_FACTOR) * unsigned(seed)) & 0x7fffffffu;
 				n = (n >> 13) ^ n;
-				return (n * (n * n * 60493 + 19990303) + 1376312589) & 0x7fffffff;
+				return int((n * (n * n * 60493u + 19990303u) + 1376312589u) & 0x7fffffffu);
 			}
 		public:
 			static NOISEPP_INLINE Real calcGradientCoherentNoiseHigh (Real x, int seed, Real scale)
@@ -218,11 +220,12 @@ namespace noisepp
 				return Math::InterpLinear (ix0, ix1, ys) * scale;
 			}
 
+			/// The hash wraps around, so it's calculated unsigned, see Generator3D::intNoise().
 			static NOISEPP_INLINE int intNoise (int x, int y, int seed)
 			{
-				int n = (NOISE_X_FACTOR * x + NOISE_Y_FACTOR * y + NOISE_SEED_FACTOR * seed) & 0x7fffffff;
+				unsigned int n = (unsigned(NOISE_X_FACTOR) * unsigned(x) + unsigned(NOISE_Y_FACTOR) * unsigned(y) + unsigned(NOISE_SEED_FACTOR) * unsigned(seed)) & 0x7fffffffu;
 				n = (n >> 13) ^ n;
-				return (n * (n * n * 60493 + 19990303) + 1376312589) & 0x7fffffff;
+				return int((n * (n * n * 60493u + 19990303u) + 1376312589u) & 0x7fffffffu);
 			}
 		public:
 			static NOISEPP_INLINE Real calcGradientCoherentNoiseHigh (Real x, Real y, int seed, Real scale)
@@ -359,11 +362,800 @@ namespace noisepp
 				return gradientVector[vIndex];
 			}
 
+			/// The hash wraps around, so it's calculated unsigned. Signed overflow is undefined, optimizing compilers
+			/// dropped the masks and the values weren't always inside [0, 2^31).
 			static NOISEPP_INLINE int intNoise (int x, int y, int z, int seed)
 			{
-				int n = (NOISE_X_FACTOR * x + NOISE_Y_FACTOR * y + NOISE_Z_FACTOR * z + NOISE_SEED_FACTOR * seed) & 0x7fffffff;
+				unsigned int n = (unsigned(NOISE_X_FACTOR) * unsigned(x) + unsigned(NOISE_Y_FACTOR) * unsigned(y) + unsigned(NOISE_Z_FACTOR) * unsigned(z) + unsigned(NOISE_SEED_FACTOR) * unsigned(seed)) & 0x7fffffffu;
 				n = (n >> 13) ^ n;
-				return (n * (n * n * 60493 + 19990303) + 1376312589) & 0x7fffffff;
+				return int((n * (n * n * 60493u + 19990303u) + 1376312589u) & 0x7fffffffu);
+			}
+
+#if NOISEPP_SIMD_X86 && NOISEPP_DOUBLE_PRECISION
+			template <int Quality>
+			static NOISEPP_SIMD_AVX2_INLINE __m256d curveAVX2 (__m256d a)
+			{
+				if (Quality % 3 == NOISE_QUALITY_STD)
+					return _mm256_mul_pd (_mm256_mul_pd (a, a), _mm256_sub_pd (_mm256_set1_pd (3.0), _mm256_mul_pd (_mm256_set1_pd (2.0), a)));
+				else if (Quality % 3 == NOISE_QUALITY_HIGH)
+				{
+					const __m256d a3 = _mm256_mul_pd (_mm256_mul_pd (a, a), a);
+					const __m256d a4 = _mm256_mul_pd (a3, a);
+					const __m256d a5 = _mm256_mul_pd (a4, a);
+					return _mm256_add_pd (_mm256_sub_pd (_mm256_mul_pd (_mm256_set1_pd (10.0), a3), _mm256_mul_pd (_mm256_set1_pd (15.0), a4)), _mm256_mul_pd (_mm256_set1_pd (6.0), a5));
+				}
+				return a;
+			}
+
+			static NOISEPP_SIMD_AVX2_INLINE __m256d interpLinearAVX2 (__m256d left, __m256d right, __m256d a)
+			{
+				return _mm256_add_pd (_mm256_mul_pd (_mm256_sub_pd (_mm256_set1_pd (1.0), a), left), _mm256_mul_pd (a, right));
+			}
+
+			static NOISEPP_SIMD_AVX2_INLINE __m256d gatherAVX2 (const Real *table, __m128i index)
+			{
+				// the masked gather with a defined source avoids bogus uninitialized warnings of some GCC versions
+				return _mm256_mask_i32gather_pd (_mm256_setzero_pd (), table, index, _mm256_castsi256_pd (_mm256_set1_epi64x (-1)), 8);
+			}
+
+			template <int Quality>
+			static NOISEPP_SIMD_AVX2_INLINE __m256d calcGradientNoiseAVX2 (__m128i vIndex, __m256d xDelta, __m256d yDelta, __m256d zDelta)
+			{
+				vIndex = _mm_xor_si128 (vIndex, _mm_srai_epi32 (vIndex, NOISE_SHIFT));
+				vIndex = _mm_and_si128 (vIndex, _mm_set1_epi32 (0xff));
+				if (Quality > NOISE_QUALITY_HIGH)
+					return gatherAVX2 (gradientVector, vIndex);
+
+				vIndex = _mm_slli_epi32 (vIndex, 2);
+				const __m256d xGradient = gatherAVX2 (randomVectors3D, vIndex);
+				const __m256d yGradient = gatherAVX2 (randomVectors3D+1, vIndex);
+				const __m256d zGradient = gatherAVX2 (randomVectors3D+2, vIndex);
+				return _mm256_add_pd (_mm256_add_pd (_mm256_mul_pd (xGradient, xDelta), _mm256_mul_pd (yGradient, yDelta)), _mm256_mul_pd (zGradient, zDelta));
+			}
+
+			/// AVX2 version of the coherent noise functions, calculates 4 points per iteration.
+			/// Returns the number of points calculated.
+			template <int Quality>
+			static NOISEPP_SIMD_AVX2 size_t calcGradientCoherentNoiseAVX2 (size_t count, const Real *x, const Real *y, const Real *z, int seed, Real scale, Real *values)
+			{
+				const __m256d zero = _mm256_setzero_pd ();
+				const __m256d one = _mm256_set1_pd (1.0);
+				const __m256d vScale = _mm256_set1_pd (scale);
+				const __m128i xFactor = _mm_set1_epi32 (NOISE_X_FACTOR);
+				const __m128i yFactor = _mm_set1_epi32 (NOISE_Y_FACTOR);
+				const __m128i zFactor = _mm_set1_epi32 (NOISE_Z_FACTOR);
+				const __m128i seedIndex = _mm_set1_epi32 (NOISE_SEED_FACTOR * seed);
+
+				size_t i = 0;
+				for (;i+4<=count;i+=4)
+				{
+					const __m256d fx = _mm256_loadu_pd (x+i);
+					const __m256d fy = _mm256_loadu_pd (y+i);
+					const __m256d fz = _mm256_loadu_pd (z+i);
+
+					// same as NOISE_GENERATOR_INTEGER_CLAMP_3D
+					const __m256d x0 = _mm256_sub_pd (_mm256_round_pd (fx, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC), _mm256_and_pd (_mm256_cmp_pd (fx, zero, _CMP_NGT_UQ), one));
+					const __m256d y0 = _mm256_sub_pd (_mm256_round_pd (fy, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC), _mm256_and_pd (_mm256_cmp_pd (fy, zero, _CMP_NGT_UQ), one));
+					const __m256d z0 = _mm256_sub_pd (_mm256_round_pd (fz, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC), _mm256_and_pd (_mm256_cmp_pd (fz, zero, _CMP_NGT_UQ), one));
+
+					const __m128i ix0 = _mm_mullo_epi32 (_mm256_cvttpd_epi32 (x0), xFactor);
+					const __m128i ix1 = _mm_add_epi32 (ix0, xFactor);
+					const __m128i iy0 = _mm_mullo_epi32 (_mm256_cvttpd_epi32 (y0), yFactor);
+					const __m128i iy1 = _mm_add_epi32 (iy0, yFactor);
+					const __m128i iz0 = _mm_add_epi32 (_mm_mullo_epi32 (_mm256_cvttpd_epi32 (z0), zFactor), seedIndex);
+					const __m128i iz1 = _mm_add_epi32 (iz0, zFactor);
+
+					const __m256d xd0 = _mm256_sub_pd (fx, x0);
+					const __m256d xd1 = _mm256_sub_pd (fx, _mm256_add_pd (x0, one));
+					const __m256d yd0 = _mm256_sub_pd (fy, y0);
+					const __m256d yd1 = _mm256_sub_pd (fy, _mm256_add_pd (y0, one));
+					const __m256d zd0 = _mm256_sub_pd (fz, z0);
+					const __m256d zd1 = _mm256_sub_pd (fz, _mm256_add_pd (z0, one));
+
+					const __m256d xs = curveAVX2<Quality> (xd0);
+					const __m256d ys = curveAVX2<Quality> (yd0);
+					const __m256d zs = curveAVX2<Quality> (zd0);
+
+					__m256d n0, n1, ix0v, ix1v, iy0v, iy1v;
+					n0 = calcGradientNoiseAVX2<Quality> (_mm_add_epi32 (_mm_add_epi32 (ix0, iy0), iz0), xd0, yd0, zd0);
+					n1 = calcGradientNoiseAVX2<Quality> (_mm_add_epi32 (_mm_add_epi32 (ix1, iy0), iz0), xd1, yd0, zd0);
+					ix0v = interpLinearAVX2 (n0, n1, xs);
+					n0 = calcGradientNoiseAVX2<Quality> (_mm_add_epi32 (_mm_add_epi32 (ix0, iy1), iz0), xd0, yd1, zd0);
+					n1 = calcGradientNoiseAVX2<Quality> (_mm_add_epi32 (_mm_add_epi32 (ix1, iy1), iz0), xd1, yd1, zd0);
+					ix1v = interpLinearAVX2 (n0, n1, xs);
+					iy0v = interpLinearAVX2 (ix0v, ix1v, ys);
+					n0 = calcGradientNoiseAVX2<Quality> (_mm_add_epi32 (_mm_add_epi32 (ix0, iy0), iz1), xd0, yd0, zd1);
+					n1 = calcGradientNoiseAVX2<Quality> (_mm_add_epi32 (_mm_add_epi32 (ix1, iy0), iz1), xd1, yd0, zd1);
+					ix0v = interpLinearAVX2 (n0, n1, xs);
+					n0 = calcGradientNoiseAVX2<Quality> (_mm_add_epi32 (_mm_add_epi32 (ix0, iy1), iz1), xd0, yd1, zd1);
+					n1 = calcGradientNoiseAVX2<Quality> (_mm_add_epi32 (_mm_add_epi32 (ix1, iy1), iz1), xd1, yd1, zd1);
+					ix1v = interpLinearAVX2 (n0, n1, xs);
+					iy1v = interpLinearAVX2 (ix0v, ix1v, ys);
+
+					_mm256_storeu_pd (values+i, _mm256_mul_pd (interpLinearAVX2 (iy0v, iy1v, zs), vScale));
+				}
+				return i;
+			}
+
+			template <int Quality>
+			static NOISEPP_SIMD_AVX2_INLINE __m256d curveDerivativeAVX2 (__m256d a)
+			{
+				if (Quality % 3 == NOISE_QUALITY_STD)
+					return _mm256_mul_pd (_mm256_mul_pd (_mm256_set1_pd (6.0), a), _mm256_sub_pd (_mm256_set1_pd (1.0), a));
+				else if (Quality % 3 == NOISE_QUALITY_HIGH)
+				{
+					const __m256d b = _mm256_mul_pd (a, _mm256_sub_pd (_mm256_set1_pd (1.0), a));
+					return _mm256_mul_pd (_mm256_mul_pd (_mm256_set1_pd (30.0), b), b);
+				}
+				return _mm256_set1_pd (1.0);
+			}
+
+			/// AVX2 version of calcGradientNoiseDerivatives().
+			template <int Quality>
+			static NOISEPP_SIMD_AVX2_INLINE void calcGradientNoiseDerivativesAVX2 (__m128i vIndex, __m256d xDelta, __m256d yDelta, __m256d zDelta, __m256d *noise)
+			{
+				vIndex = _mm_xor_si128 (vIndex, _mm_srai_epi32 (vIndex, NOISE_SHIFT));
+				vIndex = _mm_and_si128 (vIndex, _mm_set1_epi32 (0xff));
+				if (Quality > NOISE_QUALITY_HIGH)
+				{
+					noise[0] = gatherAVX2 (gradientVector, vIndex);
+					noise[1] = noise[2] = noise[3] = _mm256_setzero_pd ();
+					return;
+				}
+
+				vIndex = _mm_slli_epi32 (vIndex, 2);
+				noise[1] = gatherAVX2 (randomVectors3D, vIndex);
+				noise[2] = gatherAVX2 (randomVectors3D+1, vIndex);
+				noise[3] = gatherAVX2 (randomVectors3D+2, vIndex);
+				noise[0] = _mm256_add_pd (_mm256_add_pd (_mm256_mul_pd (noise[1], xDelta), _mm256_mul_pd (noise[2], yDelta)), _mm256_mul_pd (noise[3], zDelta));
+			}
+
+			/// AVX2 version of interpLinearDerivatives().
+			static NOISEPP_SIMD_AVX2_INLINE void interpLinearDerivativesAVX2 (const __m256d *left, const __m256d *right, __m256d a, __m256d derivative, int axis, __m256d *result)
+			{
+				const __m256d difference = _mm256_sub_pd (right[0], left[0]);
+				for (int k=0;k<4;++k)
+					result[k] = interpLinearAVX2 (left[k], right[k], a);
+				result[axis+1] = _mm256_add_pd (result[axis+1], _mm256_mul_pd (derivative, difference));
+			}
+
+			/// AVX2 version of calcGradientCoherentNoiseDerivatives(), calculates 4 points per iteration.
+			/// Returns the number of points calculated.
+			template <int Quality>
+			static NOISEPP_SIMD_AVX2 size_t calcGradientCoherentNoiseDerivativesAVX2 (size_t count, const Real *x, const Real *y, const Real *z, int seed, Real scale, Real *values, Real *dx, Real *dy, Real *dz)
+			{
+				const __m256d zero = _mm256_setzero_pd ();
+				const __m256d one = _mm256_set1_pd (1.0);
+				const __m256d vScale = _mm256_set1_pd (scale);
+				const __m128i xFactor = _mm_set1_epi32 (NOISE_X_FACTOR);
+				const __m128i yFactor = _mm_set1_epi32 (NOISE_Y_FACTOR);
+				const __m128i zFactor = _mm_set1_epi32 (NOISE_Z_FACTOR);
+				const __m128i seedIndex = _mm_set1_epi32 (NOISE_SEED_FACTOR * seed);
+
+				size_t i = 0;
+				for (;i+4<=count;i+=4)
+				{
+					const __m256d fx = _mm256_loadu_pd (x+i);
+					const __m256d fy = _mm256_loadu_pd (y+i);
+					const __m256d fz = _mm256_loadu_pd (z+i);
+
+					// same as NOISE_GENERATOR_INTEGER_CLAMP_3D
+					const __m256d x0 = _mm256_sub_pd (_mm256_round_pd (fx, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC), _mm256_and_pd (_mm256_cmp_pd (fx, zero, _CMP_NGT_UQ), one));
+					const __m256d y0 = _mm256_sub_pd (_mm256_round_pd (fy, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC), _mm256_and_pd (_mm256_cmp_pd (fy, zero, _CMP_NGT_UQ), one));
+					const __m256d z0 = _mm256_sub_pd (_mm256_round_pd (fz, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC), _mm256_and_pd (_mm256_cmp_pd (fz, zero, _CMP_NGT_UQ), one));
+
+					const __m128i ix0 = _mm_mullo_epi32 (_mm256_cvttpd_epi32 (x0), xFactor);
+					const __m128i iy0 = _mm_mullo_epi32 (_mm256_cvttpd_epi32 (y0), yFactor);
+					const __m128i iz0 = _mm_add_epi32 (_mm_mullo_epi32 (_mm256_cvttpd_epi32 (z0), zFactor), seedIndex);
+					const __m128i ix[2] = { ix0, _mm_add_epi32 (ix0, xFactor) };
+					const __m128i iy[2] = { iy0, _mm_add_epi32 (iy0, yFactor) };
+					const __m128i iz[2] = { iz0, _mm_add_epi32 (iz0, zFactor) };
+
+					const __m256d xd[2] = { _mm256_sub_pd (fx, x0), _mm256_sub_pd (fx, _mm256_add_pd (x0, one)) };
+					const __m256d yd[2] = { _mm256_sub_pd (fy, y0), _mm256_sub_pd (fy, _mm256_add_pd (y0, one)) };
+					const __m256d zd[2] = { _mm256_sub_pd (fz, z0), _mm256_sub_pd (fz, _mm256_add_pd (z0, one)) };
+
+					const __m256d curve[3] = { curveAVX2<Quality> (xd[0]), curveAVX2<Quality> (yd[0]), curveAVX2<Quality> (zd[0]) };
+					const __m256d derivative[3] = { curveDerivativeAVX2<Quality> (xd[0]), curveDerivativeAVX2<Quality> (yd[0]), curveDerivativeAVX2<Quality> (zd[0]) };
+
+					__m256d noise[8][4];
+					for (int corner=0;corner<8;++corner)
+					{
+						const int cx = corner & 1, cy = (corner >> 1) & 1, cz = (corner >> 2) & 1;
+						calcGradientNoiseDerivativesAVX2<Quality> (_mm_add_epi32 (_mm_add_epi32 (ix[cx], iy[cy]), iz[cz]), xd[cx], yd[cy], zd[cz], noise[corner]);
+					}
+					for (int d=0,n=8;d<3;++d,n/=2)
+					{
+						for (int c=0;c<n/2;++c)
+						{
+							interpLinearDerivativesAVX2 (noise[2*c], noise[2*c+1], curve[d], derivative[d], d, noise[c]);
+						}
+					}
+
+					_mm256_storeu_pd (values+i, _mm256_mul_pd (noise[0][0], vScale));
+					_mm256_storeu_pd (dx+i, _mm256_mul_pd (noise[0][1], vScale));
+					_mm256_storeu_pd (dy+i, _mm256_mul_pd (noise[0][2], vScale));
+					_mm256_storeu_pd (dz+i, _mm256_mul_pd (noise[0][3], vScale));
+				}
+				return i;
+			}
+
+			template <int Quality>
+			static NOISEPP_SIMD_SSE41_INLINE __m128d curveSSE41 (__m128d a)
+			{
+				if (Quality % 3 == NOISE_QUALITY_STD)
+					return _mm_mul_pd (_mm_mul_pd (a, a), _mm_sub_pd (_mm_set1_pd (3.0), _mm_mul_pd (_mm_set1_pd (2.0), a)));
+				else if (Quality % 3 == NOISE_QUALITY_HIGH)
+				{
+					const __m128d a3 = _mm_mul_pd (_mm_mul_pd (a, a), a);
+					const __m128d a4 = _mm_mul_pd (a3, a);
+					const __m128d a5 = _mm_mul_pd (a4, a);
+					return _mm_add_pd (_mm_sub_pd (_mm_mul_pd (_mm_set1_pd (10.0), a3), _mm_mul_pd (_mm_set1_pd (15.0), a4)), _mm_mul_pd (_mm_set1_pd (6.0), a5));
+				}
+				return a;
+			}
+
+			static NOISEPP_SIMD_SSE41_INLINE __m128d interpLinearSSE41 (__m128d left, __m128d right, __m128d a)
+			{
+				return _mm_add_pd (_mm_mul_pd (_mm_sub_pd (_mm_set1_pd (1.0), a), left), _mm_mul_pd (a, right));
+			}
+
+			template <int Quality>
+			static NOISEPP_SIMD_SSE41_INLINE __m128d calcGradientNoiseSSE41 (__m128i vIndex, __m128d xDelta, __m128d yDelta, __m128d zDelta)
+			{
+				vIndex = _mm_xor_si128 (vIndex, _mm_srai_epi32 (vIndex, NOISE_SHIFT));
+				vIndex = _mm_and_si128 (vIndex, _mm_set1_epi32 (0xff));
+				const int i0 = _mm_cvtsi128_si32 (vIndex);
+				const int i1 = _mm_extract_epi32 (vIndex, 1);
+				if (Quality > NOISE_QUALITY_HIGH)
+					return _mm_set_pd (gradientVector[i1], gradientVector[i0]);
+
+				// x and y gradients are adjacent in the table, load them in pairs and transpose
+				const __m128d g0 = _mm_loadu_pd (randomVectors3D + (i0<<2));
+				const __m128d g1 = _mm_loadu_pd (randomVectors3D + (i1<<2));
+				const __m128d xGradient = _mm_unpacklo_pd (g0, g1);
+				const __m128d yGradient = _mm_unpackhi_pd (g0, g1);
+				const __m128d zGradient = _mm_set_pd (randomVectors3D[(i1<<2)+2], randomVectors3D[(i0<<2)+2]);
+				return _mm_add_pd (_mm_add_pd (_mm_mul_pd (xGradient, xDelta), _mm_mul_pd (yGradient, yDelta)), _mm_mul_pd (zGradient, zDelta));
+			}
+
+			/// SSE4.1 version of the coherent noise functions, calculates 2 points per iteration.
+			/// Returns the number of points calculated.
+			template <int Quality>
+			static NOISEPP_SIMD_SSE41 size_t calcGradientCoherentNoiseSSE41 (size_t count, const Real *x, const Real *y, const Real *z, int seed, Real scale, Real *values)
+			{
+				const __m128d zero = _mm_setzero_pd ();
+				const __m128d one = _mm_set1_pd (1.0);
+				const __m128d vScale = _mm_set1_pd (scale);
+				const __m128i xFactor = _mm_set1_epi32 (NOISE_X_FACTOR);
+				const __m128i yFactor = _mm_set1_epi32 (NOISE_Y_FACTOR);
+				const __m128i zFactor = _mm_set1_epi32 (NOISE_Z_FACTOR);
+				const __m128i seedIndex = _mm_set1_epi32 (NOISE_SEED_FACTOR * seed);
+
+				size_t i = 0;
+				for (;i+2<=count;i+=2)
+				{
+					const __m128d fx = _mm_loadu_pd (x+i);
+					const __m128d fy = _mm_loadu_pd (y+i);
+					const __m128d fz = _mm_loadu_pd (z+i);
+
+					// same as NOISE_GENERATOR_INTEGER_CLAMP_3D
+					const __m128d x0 = _mm_sub_pd (_mm_round_pd (fx, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC), _mm_and_pd (_mm_cmpngt_pd (fx, zero), one));
+					const __m128d y0 = _mm_sub_pd (_mm_round_pd (fy, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC), _mm_and_pd (_mm_cmpngt_pd (fy, zero), one));
+					const __m128d z0 = _mm_sub_pd (_mm_round_pd (fz, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC), _mm_and_pd (_mm_cmpngt_pd (fz, zero), one));
+
+					const __m128i ix0 = _mm_mullo_epi32 (_mm_cvttpd_epi32 (x0), xFactor);
+					const __m128i ix1 = _mm_add_epi32 (ix0, xFactor);
+					const __m128i iy0 = _mm_mullo_epi32 (_mm_cvttpd_epi32 (y0), yFactor);
+					const __m128i iy1 = _mm_add_epi32 (iy0, yFactor);
+					const __m128i iz0 = _mm_add_epi32 (_mm_mullo_epi32 (_mm_cvttpd_epi32 (z0), zFactor), seedIndex);
+					const __m128i iz1 = _mm_add_epi32 (iz0, zFactor);
+
+					const __m128d xd0 = _mm_sub_pd (fx, x0);
+					const __m128d xd1 = _mm_sub_pd (fx, _mm_add_pd (x0, one));
+					const __m128d yd0 = _mm_sub_pd (fy, y0);
+					const __m128d yd1 = _mm_sub_pd (fy, _mm_add_pd (y0, one));
+					const __m128d zd0 = _mm_sub_pd (fz, z0);
+					const __m128d zd1 = _mm_sub_pd (fz, _mm_add_pd (z0, one));
+
+					const __m128d xs = curveSSE41<Quality> (xd0);
+					const __m128d ys = curveSSE41<Quality> (yd0);
+					const __m128d zs = curveSSE41<Quality> (zd0);
+
+					__m128d n0, n1, ix0v, ix1v, iy0v, iy1v;
+					n0 = calcGradientNoiseSSE41<Quality> (_mm_add_epi32 (_mm_add_epi32 (ix0, iy0), iz0), xd0, yd0, zd0);
+					n1 = calcGradientNoiseSSE41<Quality> (_mm_add_epi32 (_mm_add_epi32 (ix1, iy0), iz0), xd1, yd0, zd0);
+					ix0v = interpLinearSSE41 (n0, n1, xs);
+					n0 = calcGradientNoiseSSE41<Quality> (_mm_add_epi32 (_mm_add_epi32 (ix0, iy1), iz0), xd0, yd1, zd0);
+					n1 = calcGradientNoiseSSE41<Quality> (_mm_add_epi32 (_mm_add_epi32 (ix1, iy1), iz0), xd1, yd1, zd0);
+					ix1v = interpLinearSSE41 (n0, n1, xs);
+					iy0v = interpLinearSSE41 (ix0v, ix1v, ys);
+					n0 = calcGradientNoiseSSE41<Quality> (_mm_add_epi32 (_mm_add_epi32 (ix0, iy0), iz1), xd0, yd0, zd1);
+					n1 = calcGradientNoiseSSE41<Quality> (_mm_add_epi32 (_mm_add_epi32 (ix1, iy0), iz1), xd1, yd0, zd1);
+					ix0v = interpLinearSSE41 (n0, n1, xs);
+					n0 = calcGradientNoiseSSE41<Quality> (_mm_add_epi32 (_mm_add_epi32 (ix0, iy1), iz1), xd0, yd1, zd1);
+					n1 = calcGradientNoiseSSE41<Quality> (_mm_add_epi32 (_mm_add_epi32 (ix1, iy1), iz1), xd1, yd1, zd1);
+					ix1v = interpLinearSSE41 (n0, n1, xs);
+					iy1v = interpLinearSSE41 (ix0v, ix1v, ys);
+
+					_mm_storeu_pd (values+i, _mm_mul_pd (interpLinearSSE41 (iy0v, iy1v, zs), vScale));
+				}
+				return i;
+			}
+#endif
+
+			template <int Quality>
+			static size_t calcGradientCoherentNoiseSIMD (size_t count, const Real *x, const Real *y, const Real *z, int seed, Real scale, Real *values)
+			{
+#if NOISEPP_SIMD_X86 && NOISEPP_DOUBLE_PRECISION
+				const int level = SIMD::getLevel ();
+				if (level >= SIMD_AVX2)
+					return calcGradientCoherentNoiseAVX2<Quality> (count, x, y, z, seed, scale, values);
+				else if (level >= SIMD_SSE41)
+					return calcGradientCoherentNoiseSSE41<Quality> (count, x, y, z, seed, scale, values);
+#endif
+				return 0;
+			}
+
+			static NOISEPP_INLINE Real curveBounds (int quality, Real a)
+			{
+				if (quality % 3 == NOISE_QUALITY_STD)
+					return Math::CubicCurve3 (a);
+				else if (quality % 3 == NOISE_QUALITY_HIGH)
+					return Math::CubicCurve5 (a);
+				return a;
+			}
+
+			/// Bounds of InterpLinear for left in [leftLower, leftUpper], right in [rightLower, rightUpper] and a in [aLower, aUpper].
+			/// The result is linear in a, so the extremes are at the ends of its interval.
+			static NOISEPP_INLINE void interpLinearBounds (Real leftLower, Real leftUpper, Real rightLower, Real rightUpper, Real aLower, Real aUpper, Real &lower, Real &upper)
+			{
+				lower = std::min (Math::InterpLinear (leftLower, rightLower, aLower), Math::InterpLinear (leftLower, rightLower, aUpper));
+				upper = std::max (Math::InterpLinear (leftUpper, rightUpper, aLower), Math::InterpLinear (leftUpper, rightUpper, aUpper));
+			}
+
+			/// Single precision copies of the gradient tables.
+			struct SingleTables
+			{
+				float vectors[256 * 4];
+				float gradients[256];
+				SingleTables ()
+				{
+					for (int i=0;i<256*4;++i)
+						vectors[i] = float(randomVectors3D[i]);
+					for (int i=0;i<256;++i)
+						gradients[i] = float(gradientVector[i]);
+				}
+			};
+			static const SingleTables &getSingleTables ()
+			{
+				static const SingleTables tables;
+				return tables;
+			}
+
+			template <int Quality>
+			static NOISEPP_INLINE float curveSingle (float a)
+			{
+				if (Quality % 3 == NOISE_QUALITY_STD)
+					return (a * a * (3.0f - 2.0f * a));
+				else if (Quality % 3 == NOISE_QUALITY_HIGH)
+				{
+					const float a3 = a * a * a;
+					const float a4 = a3 * a;
+					const float a5 = a4 * a;
+					return 10.0f * a3 - 15.0f * a4 + 6.0f * a5;
+				}
+				return a;
+			}
+
+			static NOISEPP_INLINE float interpLinearSingle (float left, float right, float a)
+			{
+				return ((1.0f - a) * left) + (a * right);
+			}
+
+			template <int Quality>
+			static NOISEPP_INLINE float calcGradientNoiseSingle (const SingleTables &tables, int vIndex, float xDelta, float yDelta, float zDelta)
+			{
+				vIndex ^= (vIndex >> NOISE_SHIFT);
+				vIndex &= 0xff;
+				if (Quality > NOISE_QUALITY_HIGH)
+					return tables.gradients[vIndex];
+
+				const float *vector = tables.vectors + (vIndex<<2);
+				return (vector[0] * xDelta + vector[1] * yDelta + vector[2] * zDelta);
+			}
+
+			/// Single precision version of the coherent noise functions.
+			/// The lattice cell and the position inside it are calculated in Real precision,
+			/// so the result doesn't degrade with large coordinates.
+			template <int Quality>
+			static NOISEPP_INLINE float calcGradientCoherentNoiseSingle (const SingleTables &tables, Real x, Real y, Real z, int seed, float scale)
+			{
+				const int x0 = (x > Real(0.0) ? (int)x : (int)x - 1);
+				const int y0 = (y > Real(0.0) ? (int)y : (int)y - 1);
+				const int z0 = (z > Real(0.0) ? (int)z : (int)z - 1);
+
+				const int ix0 = NOISE_X_FACTOR * x0;
+				const int ix1 = ix0 + NOISE_X_FACTOR;
+				const int iy0 = NOISE_Y_FACTOR * y0;
+				const int iy1 = iy0 + NOISE_Y_FACTOR;
+				const int iz0 = NOISE_Z_FACTOR * z0 + NOISE_SEED_FACTOR * seed;
+				const int iz1 = iz0 + NOISE_Z_FACTOR;
+
+				const float xd0 = float(x - Real(x0));
+				const float xd1 = xd0 - 1.0f;
+				const float yd0 = float(y - Real(y0));
+				const float yd1 = yd0 - 1.0f;
+				const float zd0 = float(z - Real(z0));
+				const float zd1 = zd0 - 1.0f;
+
+				const float xs = curveSingle<Quality> (xd0);
+				const float ys = curveSingle<Quality> (yd0);
+				const float zs = curveSingle<Quality> (zd0);
+
+				float n0, n1, ix0v, ix1v, iy0v, iy1v;
+				n0 = calcGradientNoiseSingle<Quality> (tables, ix0 + iy0 + iz0, xd0, yd0, zd0);
+				n1 = calcGradientNoiseSingle<Quality> (tables, ix1 + iy0 + iz0, xd1, yd0, zd0);
+				ix0v = interpLinearSingle (n0, n1, xs);
+				n0 = calcGradientNoiseSingle<Quality> (tables, ix0 + iy1 + iz0, xd0, yd1, zd0);
+				n1 = calcGradientNoiseSingle<Quality> (tables, ix1 + iy1 + iz0, xd1, yd1, zd0);
+				ix1v = interpLinearSingle (n0, n1, xs);
+				iy0v = interpLinearSingle (ix0v, ix1v, ys);
+				n0 = calcGradientNoiseSingle<Quality> (tables, ix0 + iy0 + iz1, xd0, yd0, zd1);
+				n1 = calcGradientNoiseSingle<Quality> (tables, ix1 + iy0 + iz1, xd1, yd0, zd1);
+				ix0v = interpLinearSingle (n0, n1, xs);
+				n0 = calcGradientNoiseSingle<Quality> (tables, ix0 + iy1 + iz1, xd0, yd1, zd1);
+				n1 = calcGradientNoiseSingle<Quality> (tables, ix1 + iy1 + iz1, xd1, yd1, zd1);
+				ix1v = interpLinearSingle (n0, n1, xs);
+				iy1v = interpLinearSingle (ix0v, ix1v, ys);
+
+				return interpLinearSingle (iy0v, iy1v, zs) * scale;
+			}
+
+#if NOISEPP_SIMD_X86 && NOISEPP_DOUBLE_PRECISION
+			template <int Quality>
+			static NOISEPP_SIMD_AVX2_INLINE __m256 curveSingleAVX2 (__m256 a)
+			{
+				if (Quality % 3 == NOISE_QUALITY_STD)
+					return _mm256_mul_ps (_mm256_mul_ps (a, a), _mm256_sub_ps (_mm256_set1_ps (3.0f), _mm256_mul_ps (_mm256_set1_ps (2.0f), a)));
+				else if (Quality % 3 == NOISE_QUALITY_HIGH)
+				{
+					const __m256 a3 = _mm256_mul_ps (_mm256_mul_ps (a, a), a);
+					const __m256 a4 = _mm256_mul_ps (a3, a);
+					const __m256 a5 = _mm256_mul_ps (a4, a);
+					return _mm256_add_ps (_mm256_sub_ps (_mm256_mul_ps (_mm256_set1_ps (10.0f), a3), _mm256_mul_ps (_mm256_set1_ps (15.0f), a4)), _mm256_mul_ps (_mm256_set1_ps (6.0f), a5));
+				}
+				return a;
+			}
+
+			static NOISEPP_SIMD_AVX2_INLINE __m256 interpLinearSingleAVX2 (__m256 left, __m256 right, __m256 a)
+			{
+				return _mm256_add_ps (_mm256_mul_ps (_mm256_sub_ps (_mm256_set1_ps (1.0f), a), left), _mm256_mul_ps (a, right));
+			}
+
+			static NOISEPP_SIMD_AVX2_INLINE __m256 gatherSingleAVX2 (const float *table, __m256i index)
+			{
+				return _mm256_mask_i32gather_ps (_mm256_setzero_ps (), table, index, _mm256_castsi256_ps (_mm256_set1_epi32 (-1)), 4);
+			}
+
+			template <int Quality>
+			static NOISEPP_SIMD_AVX2_INLINE __m256 calcGradientNoiseSingleAVX2 (const SingleTables &tables, __m256i vIndex, __m256 xDelta, __m256 yDelta, __m256 zDelta)
+			{
+				vIndex = _mm256_xor_si256 (vIndex, _mm256_srai_epi32 (vIndex, NOISE_SHIFT));
+				vIndex = _mm256_and_si256 (vIndex, _mm256_set1_epi32 (0xff));
+				if (Quality > NOISE_QUALITY_HIGH)
+					return gatherSingleAVX2 (tables.gradients, vIndex);
+
+				vIndex = _mm256_slli_epi32 (vIndex, 2);
+				const __m256 xGradient = gatherSingleAVX2 (tables.vectors, vIndex);
+				const __m256 yGradient = gatherSingleAVX2 (tables.vectors+1, vIndex);
+				const __m256 zGradient = gatherSingleAVX2 (tables.vectors+2, vIndex);
+				return _mm256_add_ps (_mm256_add_ps (_mm256_mul_ps (xGradient, xDelta), _mm256_mul_ps (yGradient, yDelta)), _mm256_mul_ps (zGradient, zDelta));
+			}
+
+			/// Splits 8 coordinates into the lattice cell and the single precision position inside it.
+			static NOISEPP_SIMD_AVX2_INLINE void splitSingleAVX2 (const Real *v, __m256i &cell, __m256 &delta)
+			{
+				const __m256d zero = _mm256_setzero_pd ();
+				const __m256d one = _mm256_set1_pd (1.0);
+				const __m256d lo = _mm256_loadu_pd (v);
+				const __m256d hi = _mm256_loadu_pd (v+4);
+				// same as NOISE_GENERATOR_INTEGER_CLAMP_3D
+				const __m256d lo0 = _mm256_sub_pd (_mm256_round_pd (lo, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC), _mm256_and_pd (_mm256_cmp_pd (lo, zero, _CMP_NGT_UQ), one));
+				const __m256d hi0 = _mm256_sub_pd (_mm256_round_pd (hi, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC), _mm256_and_pd (_mm256_cmp_pd (hi, zero, _CMP_NGT_UQ), one));
+				cell = _mm256_inserti128_si256 (_mm256_castsi128_si256 (_mm256_cvttpd_epi32 (lo0)), _mm256_cvttpd_epi32 (hi0), 1);
+				delta = _mm256_insertf128_ps (_mm256_castps128_ps256 (_mm256_cvtpd_ps (_mm256_sub_pd (lo, lo0))), _mm256_cvtpd_ps (_mm256_sub_pd (hi, hi0)), 1);
+			}
+
+			/// AVX2 version of the single precision coherent noise functions, calculates 8 points per iteration.
+			/// Returns the number of points calculated.
+			template <int Quality>
+			static NOISEPP_SIMD_AVX2 size_t calcGradientCoherentNoiseSingleAVX2 (const SingleTables &tables, size_t count, const Real *x, const Real *y, const Real *z, int seed, float scale, Real *values)
+			{
+				const __m256 one = _mm256_set1_ps (1.0f);
+				const __m256 vScale = _mm256_set1_ps (scale);
+				const __m256i xFactor = _mm256_set1_epi32 (NOISE_X_FACTOR);
+				const __m256i yFactor = _mm256_set1_epi32 (NOISE_Y_FACTOR);
+				const __m256i zFactor = _mm256_set1_epi32 (NOISE_Z_FACTOR);
+				const __m256i seedIndex = _mm256_set1_epi32 (NOISE_SEED_FACTOR * seed);
+
+				size_t i = 0;
+				for (;i+8<=count;i+=8)
+				{
+					__m256i x0, y0, z0;
+					__m256 xd0, yd0, zd0;
+					splitSingleAVX2 (x+i, x0, xd0);
+					splitSingleAVX2 (y+i, y0, yd0);
+					splitSingleAVX2 (z+i, z0, zd0);
+
+					const __m256i ix0 = _mm256_mullo_epi32 (x0, xFactor);
+					const __m256i ix1 = _mm256_add_epi32 (ix0, xFactor);
+					const __m256i iy0 = _mm256_mullo_epi32 (y0, yFactor);
+					const __m256i iy1 = _mm256_add_epi32 (iy0, yFactor);
+					const __m256i iz0 = _mm256_add_epi32 (_mm256_mullo_epi32 (z0, zFactor), seedIndex);
+					const __m256i iz1 = _mm256_add_epi32 (iz0, zFactor);
+
+					const __m256 xd1 = _mm256_sub_ps (xd0, one);
+					const __m256 yd1 = _mm256_sub_ps (yd0, one);
+					const __m256 zd1 = _mm256_sub_ps (zd0, one);
+
+					const __m256 xs = curveSingleAVX2<Quality> (xd0);
+					const __m256 ys = curveSingleAVX2<Quality> (yd0);
+					const __m256 zs = curveSingleAVX2<Quality> (zd0);
+
+					__m256 n0, n1, ix0v, ix1v, iy0v, iy1v;
+					n0 = calcGradientNoiseSingleAVX2<Quality> (tables, _mm256_add_epi32 (_mm256_add_epi32 (ix0, iy0), iz0), xd0, yd0, zd0);
+					n1 = calcGradientNoiseSingleAVX2<Quality> (tables, _mm256_add_epi32 (_mm256_add_epi32 (ix1, iy0), iz0), xd1, yd0, zd0);
+					ix0v = interpLinearSingleAVX2 (n0, n1, xs);
+					n0 = calcGradientNoiseSingleAVX2<Quality> (tables, _mm256_add_epi32 (_mm256_add_epi32 (ix0, iy1), iz0), xd0, yd1, zd0);
+					n1 = calcGradientNoiseSingleAVX2<Quality> (tables, _mm256_add_epi32 (_mm256_add_epi32 (ix1, iy1), iz0), xd1, yd1, zd0);
+					ix1v = interpLinearSingleAVX2 (n0, n1, xs);
+					iy0v = interpLinearSingleAVX2 (ix0v, ix1v, ys);
+					n0 = calcGradientNoiseSingleAVX2<Quality> (tables, _mm256_add_epi32 (_mm256_add_epi32 (ix0, iy0), iz1), xd0, yd0, zd1);
+					n1 = calcGradientNoiseSingleAVX2<Quality> (tables, _mm256_add_epi32 (_mm256_add_epi32 (ix1, iy0), iz1), xd1, yd0, zd1);
+					ix0v = interpLinearSingleAVX2 (n0, n1, xs);
+					n0 = calcGradientNoiseSingleAVX2<Quality> (tables, _mm256_add_epi32 (_mm256_add_epi32 (ix0, iy1), iz1), xd0, yd1, zd1);
+					n1 = calcGradientNoiseSingleAVX2<Quality> (tables, _mm256_add_epi32 (_mm256_add_epi32 (ix1, iy1), iz1), xd1, yd1, zd1);
+					ix1v = interpLinearSingleAVX2 (n0, n1, xs);
+					iy1v = interpLinearSingleAVX2 (ix0v, ix1v, ys);
+
+					const __m256 result = _mm256_mul_ps (interpLinearSingleAVX2 (iy0v, iy1v, zs), vScale);
+					_mm256_storeu_pd (values+i, _mm256_cvtps_pd (_mm256_castps256_ps128 (result)));
+					_mm256_storeu_pd (values+i+4, _mm256_cvtps_pd (_mm256_extractf128_ps (result, 1)));
+				}
+				return i;
+			}
+
+			template <int Quality>
+			static NOISEPP_SIMD_SSE41_INLINE __m128 curveSingleSSE41 (__m128 a)
+			{
+				if (Quality % 3 == NOISE_QUALITY_STD)
+					return _mm_mul_ps (_mm_mul_ps (a, a), _mm_sub_ps (_mm_set1_ps (3.0f), _mm_mul_ps (_mm_set1_ps (2.0f), a)));
+				else if (Quality % 3 == NOISE_QUALITY_HIGH)
+				{
+					const __m128 a3 = _mm_mul_ps (_mm_mul_ps (a, a), a);
+					const __m128 a4 = _mm_mul_ps (a3, a);
+					const __m128 a5 = _mm_mul_ps (a4, a);
+					return _mm_add_ps (_mm_sub_ps (_mm_mul_ps (_mm_set1_ps (10.0f), a3), _mm_mul_ps (_mm_set1_ps (15.0f), a4)), _mm_mul_ps (_mm_set1_ps (6.0f), a5));
+				}
+				return a;
+			}
+
+			static NOISEPP_SIMD_SSE41_INLINE __m128 interpLinearSingleSSE41 (__m128 left, __m128 right, __m128 a)
+			{
+				return _mm_add_ps (_mm_mul_ps (_mm_sub_ps (_mm_set1_ps (1.0f), a), left), _mm_mul_ps (a, right));
+			}
+
+			template <int Quality>
+			static NOISEPP_SIMD_SSE41_INLINE __m128 calcGradientNoiseSingleSSE41 (const SingleTables &tables, __m128i vIndex, __m128 xDelta, __m128 yDelta, __m128 zDelta)
+			{
+				vIndex = _mm_xor_si128 (vIndex, _mm_srai_epi32 (vIndex, NOISE_SHIFT));
+				vIndex = _mm_and_si128 (vIndex, _mm_set1_epi32 (0xff));
+				const int i0 = _mm_cvtsi128_si32 (vIndex);
+				const int i1 = _mm_extract_epi32 (vIndex, 1);
+				const int i2 = _mm_extract_epi32 (vIndex, 2);
+				const int i3 = _mm_extract_epi32 (vIndex, 3);
+				if (Quality > NOISE_QUALITY_HIGH)
+					return _mm_set_ps (tables.gradients[i3], tables.gradients[i2], tables.gradients[i1], tables.gradients[i0]);
+
+				// each table entry is 4 floats, load the 4 vectors and transpose them
+				__m128 xGradient = _mm_loadu_ps (tables.vectors + (i0<<2));
+				__m128 yGradient = _mm_loadu_ps (tables.vectors + (i1<<2));
+				__m128 zGradient = _mm_loadu_ps (tables.vectors + (i2<<2));
+				__m128 wGradient = _mm_loadu_ps (tables.vectors + (i3<<2));
+				_MM_TRANSPOSE4_PS (xGradient, yGradient, zGradient, wGradient);
+				return _mm_add_ps (_mm_add_ps (_mm_mul_ps (xGradient, xDelta), _mm_mul_ps (yGradient, yDelta)), _mm_mul_ps (zGradient, zDelta));
+			}
+
+			/// Splits 4 coordinates into the lattice cell and the single precision position inside it.
+			static NOISEPP_SIMD_SSE41_INLINE void splitSingleSSE41 (const Real *v, __m128i &cell, __m128 &delta)
+			{
+				const __m128d zero = _mm_setzero_pd ();
+				const __m128d one = _mm_set1_pd (1.0);
+				const __m128d lo = _mm_loadu_pd (v);
+				const __m128d hi = _mm_loadu_pd (v+2);
+				// same as NOISE_GENERATOR_INTEGER_CLAMP_3D
+				const __m128d lo0 = _mm_sub_pd (_mm_round_pd (lo, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC), _mm_and_pd (_mm_cmpngt_pd (lo, zero), one));
+				const __m128d hi0 = _mm_sub_pd (_mm_round_pd (hi, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC), _mm_and_pd (_mm_cmpngt_pd (hi, zero), one));
+				cell = _mm_unpacklo_epi64 (_mm_cvttpd_epi32 (lo0), _mm_cvttpd_epi32 (hi0));
+				delta = _mm_movelh_ps (_mm_cvtpd_ps (_mm_sub_pd (lo, lo0)), _mm_cvtpd_ps (_mm_sub_pd (hi, hi0)));
+			}
+
+			/// SSE4.1 version of the single precision coherent noise functions, calculates 4 points per iteration.
+			/// Returns the number of points calculated.
+			template <int Quality>
+			static NOISEPP_SIMD_SSE41 size_t calcGradientCoherentNoiseSingleSSE41 (const SingleTables &tables, size_t count, const Real *x, const Real *y, const Real *z, int seed, float scale, Real *values)
+			{
+				const __m128 one = _mm_set1_ps (1.0f);
+				const __m128 vScale = _mm_set1_ps (scale);
+				const __m128i xFactor = _mm_set1_epi32 (NOISE_X_FACTOR);
+				const __m128i yFactor = _mm_set1_epi32 (NOISE_Y_FACTOR);
+				const __m128i zFactor = _mm_set1_epi32 (NOISE_Z_FACTOR);
+				const __m128i seedIndex = _mm_set1_epi32 (NOISE_SEED_FACTOR * seed);
+
+				size_t i = 0;
+				for (;i+4<=count;i+=4)
+				{
+					__m128i x0, y0, z0;
+					__m128 xd0, yd0, zd0;
+					splitSingleSSE41 (x+i, x0, xd0);
+					splitSingleSSE41 (y+i, y0, yd0);
+					splitSingleSSE41 (z+i, z0, zd0);
+
+					const __m128i ix0 = _mm_mullo_epi32 (x0, xFactor);
+					const __m128i ix1 = _mm_add_epi32 (ix0, xFactor);
+					const __m128i iy0 = _mm_mullo_epi32 (y0, yFactor);
+					const __m128i iy1 = _mm_add_epi32 (iy0, yFactor);
+					const __m128i iz0 = _mm_add_epi32 (_mm_mullo_epi32 (z0, zFactor), seedIndex);
+					const __m128i iz1 = _mm_add_epi32 (iz0, zFactor);
+
+					const __m128 xd1 = _mm_sub_ps (xd0, one);
+					const __m128 yd1 = _mm_sub_ps (yd0, one);
+					const __m128 zd1 = _mm_sub_ps (zd0, one);
+
+					const __m128 xs = curveSingleSSE41<Quality> (xd0);
+					const __m128 ys = curveSingleSSE41<Quality> (yd0);
+					const __m128 zs = curveSingleSSE41<Quality> (zd0);
+
+					__m128 n0, n1, ix0v, ix1v, iy0v, iy1v;
+					n0 = calcGradientNoiseSingleSSE41<Quality> (tables, _mm_add_epi32 (_mm_add_epi32 (ix0, iy0), iz0), xd0, yd0, zd0);
+					n1 = calcGradientNoiseSingleSSE41<Quality> (tables, _mm_add_epi32 (_mm_add_epi32 (ix1, iy0), iz0), xd1, yd0, zd0);
+					ix0v = interpLinearSingleSSE41 (n0, n1, xs);
+					n0 = calcGradientNoiseSingleSSE41<Quality> (tables, _mm_add_epi32 (_mm_add_epi32 (ix0, iy1), iz0), xd0, yd1, zd0);
+					n1 = calcGradientNoiseSingleSSE41<Quality> (tables, _mm_add_epi32 (_mm_add_epi32 (ix1, iy1), iz0), xd1, yd1, zd0);
+					ix1v = interpLinearSingleSSE41 (n0, n1, xs);
+					iy0v = interpLinearSingleSSE41 (ix0v, ix1v, ys);
+					n0 = calcGradientNoiseSingleSSE41<Quality> (tables, _mm_add_epi32 (_mm_add_epi32 (ix0, iy0), iz1), xd0, yd0, zd1);
+					n1 = calcGradientNoiseSingleSSE41<Quality> (tables, _mm_add_epi32 (_mm_add_epi32 (ix1, iy0), iz1), xd1, yd0, zd1);
+					ix0v = interpLinearSingleSSE41 (n0, n1, xs);
+					n0 = calcGradientNoiseSingleSSE41<Quality> (tables, _mm_add_epi32 (_mm_add_epi32 (ix0, iy1), iz1), xd0, yd1, zd1);
+					n1 = calcGradientNoiseSingleSSE41<Quality> (tables, _mm_add_epi32 (_mm_add_epi32 (ix1, iy1), iz1), xd1, yd1, zd1);
+					ix1v = interpLinearSingleSSE41 (n0, n1, xs);
+					iy1v = interpLinearSingleSSE41 (ix0v, ix1v, ys);
+
+					const __m128 result = _mm_mul_ps (interpLinearSingleSSE41 (iy0v, iy1v, zs), vScale);
+					_mm_storeu_pd (values+i, _mm_cvtps_pd (result));
+					_mm_storeu_pd (values+i+2, _mm_cvtps_pd (_mm_movehl_ps (result, result)));
+				}
+				return i;
+			}
+#endif
+
+			template <int Quality>
+			static void calcGradientCoherentNoiseBatchSingle (size_t count, const Real *x, const Real *y, const Real *z, int seed, float scale, Real *values)
+			{
+				const SingleTables &tables = getSingleTables ();
+				size_t i = 0;
+#if NOISEPP_SIMD_X86 && NOISEPP_DOUBLE_PRECISION
+				const int level = SIMD::getLevel ();
+				if (level >= SIMD_AVX2)
+					i = calcGradientCoherentNoiseSingleAVX2<Quality> (tables, count, x, y, z, seed, scale, values);
+				else if (level >= SIMD_SSE41)
+					i = calcGradientCoherentNoiseSingleSSE41<Quality> (tables, count, x, y, z, seed, scale, values);
+#endif
+				for (;i<count;++i)
+					values[i] = calcGradientCoherentNoiseSingle<Quality> (tables, x[i], y[i], z[i], seed, scale);
+			}
+
+			/// Derivative of the interpolation curve of the quality.
+			template <int Quality>
+			static NOISEPP_INLINE Real curveDerivative (Real a)
+			{
+				if (Quality % 3 == NOISE_QUALITY_STD)
+					return Math::CubicCurve3Derivative (a);
+				else if (Quality % 3 == NOISE_QUALITY_HIGH)
+					return Math::CubicCurve5Derivative (a);
+				return Real(1.0);
+			}
+
+			/// Calculates the noise of a lattice corner and its gradient, stored as { value, d/dx, d/dy, d/dz }.
+			/// The gradient of the fast noise corners is 0, they are constant.
+			template <int Quality>
+			static NOISEPP_INLINE void calcGradientNoiseDerivatives (Real fx, Real fy, Real fz, int ix, int iy, int iz, int seed, Real *noise)
+			{
+				int vIndex = (NOISE_X_FACTOR * ix + NOISE_Y_FACTOR * iy + NOISE_Z_FACTOR * iz + NOISE_SEED_FACTOR * seed) & 0xffffffff;
+				vIndex ^= (vIndex >> NOISE_SHIFT);
+				vIndex &= 0xff;
+				if (Quality > NOISE_QUALITY_HIGH)
+				{
+					noise[0] = gradientVector[vIndex];
+					noise[1] = noise[2] = noise[3] = 0.0;
+					return;
+				}
+
+				const Real xGradient = randomVectors3D[(vIndex<<2)];
+				const Real yGradient = randomVectors3D[(vIndex<<2)+1];
+				const Real zGradient = randomVectors3D[(vIndex<<2)+2];
+
+				const Real xDelta = fx - Real(ix);
+				const Real yDelta = fy - Real(iy);
+				const Real zDelta = fz - Real(iz);
+				noise[0] = (xGradient * xDelta + yGradient * yDelta + zGradient * zDelta);
+				noise[1] = xGradient;
+				noise[2] = yGradient;
+				noise[3] = zGradient;
+			}
+
+			/// Interpolates the values and gradients of left and right along an axis.
+			/// a is the interpolation weight and derivative the derivative of the curve at the position on the axis.
+			static NOISEPP_INLINE void interpLinearDerivatives (const Real *left, const Real *right, Real a, Real derivative, int axis, Real *result)
+			{
+				const Real difference = right[0] - left[0];
+				for (int k=0;k<4;++k)
+					result[k] = Math::InterpLinear (left[k], right[k], a);
+				result[axis+1] += derivative * difference;
+			}
+
+			/// Coherent noise and its partial derivatives, the value is the same as the one of calcGradientCoherentNoise*().
+			template <int Quality>
+			static NOISEPP_INLINE Real calcGradientCoherentNoiseDerivatives (Real x, Real y, Real z, int seed, Real scale, Real *gradient)
+			{
+				NOISE_GENERATOR_INTEGER_CLAMP_3D;
+
+				const Real delta[3] = { x - Real(x0), y - Real(y0), z - Real(z0) };
+				Real curve[3], derivative[3];
+				for (int d=0;d<3;++d)
+				{
+					curve[d] = curveBounds (Quality, delta[d]);
+					derivative[d] = curveDerivative<Quality> (delta[d]);
+				}
+
+				Real noise[8][4];
+				for (int corner=0;corner<8;++corner)
+				{
+					calcGradientNoiseDerivatives<Quality> (x, y, z, (corner & 1) ? x1 : x0, (corner & 2) ? y1 : y0, (corner & 4) ? z1 : z0, seed, noise[corner]);
+				}
+				// same interpolation order as interpGradientCoherentNoise
+				for (int d=0,n=8;d<3;++d,n/=2)
+				{
+					for (int i=0;i<n/2;++i)
+					{
+						interpLinearDerivatives (noise[2*i], noise[2*i+1], curve[d], derivative[d], d, noise[i]);
+					}
+				}
+
+				gradient[0] = noise[0][1] * scale;
+				gradient[1] = noise[0][2] * scale;
+				gradient[2] = noise[0][3] * scale;
+				return noise[0][0] * scale;
+			}
+
+			template <int Quality>
+			static void calcGradientCoherentNoiseDerivativesBatch (size_t count, const Real *x, const Real *y, const Real *z, int seed, Real scale, Real *values, Real *dx, Real *dy, Real *dz)
+			{
+				size_t i = 0;
+#if NOISEPP_SIMD_X86 && NOISEPP_DOUBLE_PRECISION
+				if (SIMD::getLevel () >= SIMD_AVX2)
+					i = calcGradientCoherentNoiseDerivativesAVX2<Quality> (count, x, y, z, seed, scale, values, dx, dy, dz);
+#endif
+				Real gradient[3];
+				for (;i<count;++i)
+				{
+					values[i] = calcGradientCoherentNoiseDerivatives<Quality> (x[i], y[i], z[i], seed, scale, gradient);
+					dx[i] = gradient[0];
+					dy[i] = gradient[1];
+					dz[i] = gradient[2];
+				}
 			}
 		public:
 			static NOISEPP_INLINE Real calcGradientCoherentNoiseHigh (Real x, Real y, Real z, int seed, Real scale)
@@ -432,6 +1224,263 @@ namespace noisepp
 				return interpGradientCoherentFastNoise(x, y, z, x0, x1, y0, y1, z0, z1, xs, ys, zs, seed, scale);
 			}
 
+			/// Calculates coherent gradient noise for a batch of points.
+			/// Uses the AVX2 or SSE4.1 kernels if supported by the CPU (see SIMD::getLevel()) and the scalar functions
+			/// for the remaining points. The results are identical to the single point functions.
+			static void calcGradientCoherentNoiseBatch (int quality, size_t count, const Real *x, const Real *y, const Real *z, int seed, Real scale, Real *values)
+			{
+				size_t i = 0;
+				switch (quality)
+				{
+					case NOISE_QUALITY_LOW:
+						i = calcGradientCoherentNoiseSIMD<NOISE_QUALITY_LOW> (count, x, y, z, seed, scale, values);
+						for (;i<count;++i)
+							values[i] = calcGradientCoherentNoiseLow (x[i], y[i], z[i], seed, scale);
+						break;
+					case NOISE_QUALITY_STD:
+						i = calcGradientCoherentNoiseSIMD<NOISE_QUALITY_STD> (count, x, y, z, seed, scale, values);
+						for (;i<count;++i)
+							values[i] = calcGradientCoherentNoiseStd (x[i], y[i], z[i], seed, scale);
+						break;
+					case NOISE_QUALITY_HIGH:
+						i = calcGradientCoherentNoiseSIMD<NOISE_QUALITY_HIGH> (count, x, y, z, seed, scale, values);
+						for (;i<count;++i)
+							values[i] = calcGradientCoherentNoiseHigh (x[i], y[i], z[i], seed, scale);
+						break;
+					case NOISE_QUALITY_FAST_STD:
+						i = calcGradientCoherentNoiseSIMD<NOISE_QUALITY_FAST_STD> (count, x, y, z, seed, scale, values);
+						for (;i<count;++i)
+							values[i] = calcGradientCoherentFastNoiseStd (x[i], y[i], z[i], seed, scale);
+						break;
+					case NOISE_QUALITY_FAST_HIGH:
+						i = calcGradientCoherentNoiseSIMD<NOISE_QUALITY_FAST_HIGH> (count, x, y, z, seed, scale, values);
+						for (;i<count;++i)
+							values[i] = calcGradientCoherentFastNoiseHigh (x[i], y[i], z[i], seed, scale);
+						break;
+					default:
+						i = calcGradientCoherentNoiseSIMD<NOISE_QUALITY_FAST_LOW> (count, x, y, z, seed, scale, values);
+						for (;i<count;++i)
+							values[i] = calcGradientCoherentFastNoiseLow (x[i], y[i], z[i], seed, scale);
+						break;
+				}
+			}
+
+			/// Calculates single precision coherent gradient noise.
+			/// Used by pipelines with NOISE_PRECISION_SINGLE, the lattice cell is still calculated in Real precision.
+			static float calcGradientCoherentNoiseSingle (int quality, Real x, Real y, Real z, int seed, float scale)
+			{
+				const SingleTables &tables = getSingleTables ();
+				switch (quality)
+				{
+					case NOISE_QUALITY_LOW:
+						return calcGradientCoherentNoiseSingle<NOISE_QUALITY_LOW> (tables, x, y, z, seed, scale);
+					case NOISE_QUALITY_STD:
+						return calcGradientCoherentNoiseSingle<NOISE_QUALITY_STD> (tables, x, y, z, seed, scale);
+					case NOISE_QUALITY_HIGH:
+						return calcGradientCoherentNoiseSingle<NOISE_QUALITY_HIGH> (tables, x, y, z, seed, scale);
+					case NOISE_QUALITY_FAST_STD:
+						return calcGradientCoherentNoiseSingle<NOISE_QUALITY_FAST_STD> (tables, x, y, z, seed, scale);
+					case NOISE_QUALITY_FAST_HIGH:
+						return calcGradientCoherentNoiseSingle<NOISE_QUALITY_FAST_HIGH> (tables, x, y, z, seed, scale);
+					default:
+						return calcGradientCoherentNoiseSingle<NOISE_QUALITY_FAST_LOW> (tables, x, y, z, seed, scale);
+				}
+			}
+
+			/// Batch version of calcGradientCoherentNoiseSingle().
+			/// The AVX2 kernel calculates 8 points per iteration, the SSE4.1 kernel 4. The results are identical on all levels.
+			static void calcGradientCoherentNoiseBatchSingle (int quality, size_t count, const Real *x, const Real *y, const Real *z, int seed, float scale, Real *values)
+			{
+				switch (quality)
+				{
+					case NOISE_QUALITY_LOW:
+						calcGradientCoherentNoiseBatchSingle<NOISE_QUALITY_LOW> (count, x, y, z, seed, scale, values);
+						break;
+					case NOISE_QUALITY_STD:
+						calcGradientCoherentNoiseBatchSingle<NOISE_QUALITY_STD> (count, x, y, z, seed, scale, values);
+						break;
+					case NOISE_QUALITY_HIGH:
+						calcGradientCoherentNoiseBatchSingle<NOISE_QUALITY_HIGH> (count, x, y, z, seed, scale, values);
+						break;
+					case NOISE_QUALITY_FAST_STD:
+						calcGradientCoherentNoiseBatchSingle<NOISE_QUALITY_FAST_STD> (count, x, y, z, seed, scale, values);
+						break;
+					case NOISE_QUALITY_FAST_HIGH:
+						calcGradientCoherentNoiseBatchSingle<NOISE_QUALITY_FAST_HIGH> (count, x, y, z, seed, scale, values);
+						break;
+					default:
+						calcGradientCoherentNoiseBatchSingle<NOISE_QUALITY_FAST_LOW> (count, x, y, z, seed, scale, values);
+						break;
+				}
+			}
+
+			/// Calculates coherent gradient noise and its partial derivatives.
+			/// The value is the one of the scalar functions, the derivatives are the exact ones of the interpolated noise.
+			/// They are continuous across the lattice cells for the STD and HIGH qualities.
+			/// @param gradient Receives the derivatives in x, y and z.
+			static Real calcGradientCoherentNoiseDerivatives (int quality, Real x, Real y, Real z, int seed, Real scale, Real *gradient)
+			{
+				switch (quality)
+				{
+					case NOISE_QUALITY_LOW:
+						return calcGradientCoherentNoiseDerivatives<NOISE_QUALITY_LOW> (x, y, z, seed, scale, gradient);
+					case NOISE_QUALITY_STD:
+						return calcGradientCoherentNoiseDerivatives<NOISE_QUALITY_STD> (x, y, z, seed, scale, gradient);
+					case NOISE_QUALITY_HIGH:
+						return calcGradientCoherentNoiseDerivatives<NOISE_QUALITY_HIGH> (x, y, z, seed, scale, gradient);
+					case NOISE_QUALITY_FAST_STD:
+						return calcGradientCoherentNoiseDerivatives<NOISE_QUALITY_FAST_STD> (x, y, z, seed, scale, gradient);
+					case NOISE_QUALITY_FAST_HIGH:
+						return calcGradientCoherentNoiseDerivatives<NOISE_QUALITY_FAST_HIGH> (x, y, z, seed, scale, gradient);
+					default:
+						return calcGradientCoherentNoiseDerivatives<NOISE_QUALITY_FAST_LOW> (x, y, z, seed, scale, gradient);
+				}
+			}
+
+			/// Batch version of calcGradientCoherentNoiseDerivatives().
+			/// Uses an AVX2 kernel if supported by the CPU, the results are identical to the single point function.
+			static void calcGradientCoherentNoiseDerivativesBatch (int quality, size_t count, const Real *x, const Real *y, const Real *z, int seed, Real scale, Real *values, Real *dx, Real *dy, Real *dz)
+			{
+				switch (quality)
+				{
+					case NOISE_QUALITY_LOW:
+						calcGradientCoherentNoiseDerivativesBatch<NOISE_QUALITY_LOW> (count, x, y, z, seed, scale, values, dx, dy, dz);
+						break;
+					case NOISE_QUALITY_STD:
+						calcGradientCoherentNoiseDerivativesBatch<NOISE_QUALITY_STD> (count, x, y, z, seed, scale, values, dx, dy, dz);
+						break;
+					case NOISE_QUALITY_HIGH:
+						calcGradientCoherentNoiseDerivativesBatch<NOISE_QUALITY_HIGH> (count, x, y, z, seed, scale, values, dx, dy, dz);
+						break;
+					case NOISE_QUALITY_FAST_STD:
+						calcGradientCoherentNoiseDerivativesBatch<NOISE_QUALITY_FAST_STD> (count, x, y, z, seed, scale, values, dx, dy, dz);
+						break;
+					case NOISE_QUALITY_FAST_HIGH:
+						calcGradientCoherentNoiseDerivativesBatch<NOISE_QUALITY_FAST_HIGH> (count, x, y, z, seed, scale, values, dx, dy, dz);
+						break;
+					default:
+						calcGradientCoherentNoiseDerivativesBatch<NOISE_QUALITY_FAST_LOW> (count, x, y, z, seed, scale, values, dx, dy, dz);
+						break;
+				}
+			}
+
+			/// Returns false if an octave with the specified frequency can't be represented by points with the specified spacing.
+			/// That is the case if there are less than two points per lattice cell (Nyquist limit), sampling the octave then only adds aliasing.
+			/// Spacing 0 resolves everything.
+			static NOISEPP_INLINE bool isResolved (Real frequency, Real spacing)
+			{
+				return std::fabs (frequency) * spacing <= Real(0.5);
+			}
+
+			/// Fills the buffers with count well distributed points inside [0, 4096) in each direction.
+			/// Elements use them to estimate the average of their octaves.
+			static void getSamplePoints (size_t count, Real *x, Real *y, Real *z)
+			{
+				// additive recurrence with the plastic number, which has low discrepancy in three dimensions
+				const double a1 = 0.8191725133961645, a2 = 0.6710436067037893, a3 = 0.5497004779019703;
+				for (size_t i=0;i<count;++i)
+				{
+					const double n = double(i) + 0.5;
+					x[i] = Real(4096.0 * (n * a1 - std::floor (n * a1)));
+					y[i] = Real(4096.0 * (n * a2 - std::floor (n * a2)));
+					z[i] = Real(4096.0 * (n * a3 - std::floor (n * a3)));
+				}
+			}
+
+			/// Returns the bound of the absolute value of the coherent noise functions.
+			/// For random unit gradients the maximum is reached in the cell centre and is sqrt(3)/2.
+			static Real getGradientCoherentNoiseMaximum (int quality, Real scale)
+			{
+				const Real gradientMax = (quality > NOISE_QUALITY_HIGH) ? Real(0.7) : Real(0.8660254037844386);
+				return gradientMax * std::fabs (scale);
+			}
+
+			/// Calculates conservative bounds of the coherent noise functions inside the box [min, max].
+			/// The gradients and interpolation weights of each lattice cell the box touches are bounded with interval arithmetic.
+			/// If the box touches more than maxCells cells the bounds of the whole function are returned.
+			static void calcGradientCoherentNoiseBounds (int quality, const Real *min, const Real *max, int seed, Real scale, Real &lower, Real &upper, int maxCells=27)
+			{
+				const Real maximum = getGradientCoherentNoiseMaximum (quality, scale);
+				int c0[3], c1[3];
+				double cells = 1.0;
+				for (int d=0;d<3;++d)
+				{
+					if (!(min[d] > Real(-1073741824.0) && max[d] < Real(1073741824.0)))
+					{
+						lower = -maximum;
+						upper = maximum;
+						return;
+					}
+					c0[d] = (min[d] > Real(0.0) ? (int)min[d] : (int)min[d] - 1);
+					c1[d] = (max[d] > Real(0.0) ? (int)max[d] : (int)max[d] - 1);
+					cells *= double(c1[d] - c0[d] + 1);
+				}
+				if (cells > double(maxCells))
+				{
+					lower = -maximum;
+					upper = maximum;
+					return;
+				}
+
+				lower = std::numeric_limits<Real>::max ();
+				upper = -std::numeric_limits<Real>::max ();
+				for (int cz=c0[2];cz<=c1[2];++cz)
+				for (int cy=c0[1];cy<=c1[1];++cy)
+				for (int cx=c0[0];cx<=c1[0];++cx)
+				{
+					const int cell[3] = { cx, cy, cz };
+					// part of the box inside the cell, relative to the cell origin
+					Real lo[3], hi[3], wlo[3], whi[3];
+					for (int d=0;d<3;++d)
+					{
+						lo[d] = std::max (min[d] - Real(cell[d]), Real(0.0));
+						hi[d] = std::min (max[d] - Real(cell[d]), Real(1.0));
+						wlo[d] = curveBounds (quality, lo[d]);
+						whi[d] = curveBounds (quality, hi[d]);
+					}
+					Real nlo[8], nhi[8];
+					for (int corner=0;corner<8;++corner)
+					{
+						const int offset[3] = { corner & 1, (corner >> 1) & 1, (corner >> 2) & 1 };
+						int vIndex = (NOISE_X_FACTOR * (cx + offset[0]) + NOISE_Y_FACTOR * (cy + offset[1]) + NOISE_Z_FACTOR * (cz + offset[2]) + NOISE_SEED_FACTOR * seed) & 0xffffffff;
+						vIndex ^= (vIndex >> NOISE_SHIFT);
+						vIndex &= 0xff;
+						if (quality > NOISE_QUALITY_HIGH)
+						{
+							nlo[corner] = nhi[corner] = gradientVector[vIndex];
+							continue;
+						}
+						nlo[corner] = nhi[corner] = 0.0;
+						for (int d=0;d<3;++d)
+						{
+							const Real gradient = randomVectors3D[(vIndex<<2)+d];
+							const Real a = gradient * (lo[d] - Real(offset[d]));
+							const Real b = gradient * (hi[d] - Real(offset[d]));
+							nlo[corner] += std::min (a, b);
+							nhi[corner] += std::max (a, b);
+						}
+					}
+					// same interpolation order as interpGradientCoherentNoise
+					for (int d=0,n=8;d<3;++d,n/=2)
+					{
+						for (int i=0;i<n/2;++i)
+						{
+							interpLinearBounds (nlo[2*i], nhi[2*i], nlo[2*i+1], nhi[2*i+1], wlo[d], whi[d], nlo[i], nhi[i]);
+						}
+					}
+					lower = std::min (lower, nlo[0]);
+					upper = std::max (upper, nhi[0]);
+				}
+				if (scale < Real(0.0))
+				{
+					std::swap (lower, upper);
+				}
+				// leave room for rounding and for single precision pipelines
+				const Real epsilon = Real(1e-4) * std::fabs (scale);
+				lower = std::max (lower * scale - epsilon, -maximum);
+				upper = std::min (upper * scale + epsilon, maximum);
+			}
+
 			static NOISEPP_INLINE Real calcNoise (int x, int y, int z, int seed=0)
 			{
 				return Real(1.0) - ((Real)intNoise(x, y, z, seed) / Real(1073741824.0));
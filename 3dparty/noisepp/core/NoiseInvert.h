@@ -96,6 +96,12 @@ namespace noisepp
 		public:
 			/// @copydoc noisepp::Module::getType()
 			ModuleTypeId getType() const { return MODULE_INVERT; }
+			/// @copydoc noisepp::Module::getSourceScale()
+			virtual bool getSourceScale (Real *scale) const
+			{
+				scale[0] = scale[1] = scale[2] = 1.0;
+				return true;
+			}
 	};
 };
 
@@ -59,6 +59,17 @@ namespace noisepp
 				const Real a5 = a4 * a;
 				return Real(10) * a3 - Real(15) * a4 + Real(6) * a5;
 			}
+			/// Calculates the derivative of CubicCurve3()
+			static NOISEPP_INLINE Real CubicCurve3Derivative (Real a)
+			{
+				return Real(6) * a * (Real(1) - a);
+			}
+			/// Calculates the derivative of CubicCurve5()
+			static NOISEPP_INLINE Real CubicCurve5Derivative (Real a)
+			{
+				const Real b = a * (Real(1) - a);
+				return Real(30) * b * b;
+			}
 			/// Clamps the parameter into integer range
 			static NOISEPP_INLINE Real MakeInt32Range (Real n)
 			{
@@ -73,6 +84,35 @@ namespace noisepp
 				else
 					return n;
 			}
+			/// Multiplies the interval [lower, upper] by v
+			static NOISEPP_INLINE void ScaleBounds (Real v, Real &lower, Real &upper)
+			{
+				const Real a = lower * v;
+				const Real b = upper * v;
+				lower = std::min (a, b);
+				upper = std::max (a, b);
+			}
+			/// Calculates the interval of the absolute values of the interval [lower, upper]
+			static NOISEPP_INLINE void AbsBounds (Real &lower, Real &upper)
+			{
+				const Real a = std::fabs (lower);
+				const Real b = std::fabs (upper);
+				if (lower <= Real(0.0) && upper >= Real(0.0))
+					lower = Real(0.0);
+				else
+					lower = std::min (a, b);
+				upper = std::max (a, b);
+			}
+			/// Calculates the interval of the products of the intervals [aLower, aUpper] and [bLower, bUpper]
+			static NOISEPP_INLINE void MulBounds (Real aLower, Real aUpper, Real bLower, Real bUpper, Real &lower, Real &upper)
+			{
+				const Real p0 = aLower * bLower;
+				const Real p1 = aLower * bUpper;
+				const Real p2 = aUpper * bLower;
+				const Real p3 = aUpper * bUpper;
+				lower = std::min (std::min (p0, p1), std::min (p2, p3));
+				upper = std::max (std::max (p0, p1), std::max (p2, p3));
+			}
 	};
 };
 
@@ -56,7 +56,8 @@ namespace noisepp
 		MODULE_TURBULENCE=19,
 		MODULE_TERRACE=20,
 		MODULE_TRANSLATEPOINT=21,
-		MODULE_VORONOI=22
+		MODULE_VORONOI=22,
+		MODULE_SIMPLEX=23
 	};
 
 #if NOISEPP_ENABLE_UTILS
@@ -75,6 +76,10 @@ namespace noisepp
 			const Module **mSourceModules;
 			/// Number of source modules.
 			size_t mSourceModuleCount;
+#if NOISEPP_ENABLE_PROFILING
+			/// Profiling counters, updated by the elements of the module in all pipelines.
+			mutable Profile mProfile;
+#endif
 
 		public:
 			/// @param sourceModuleCount The number of source modules.
@@ -152,6 +157,22 @@ namespace noisepp
 			}
 			/// Returns the module type ID.
 			virtual ModuleTypeId getType() const = 0;
+			/// Returns the factors the module scales the coordinates with before passing them to its sources,
+			/// see Pipeline::shareLattices(). Returns false if it transforms them in any other way.
+			/// The default returns false, so the sources of a module which doesn't tell never share their lattices.
+			/// Modules which pass the coordinates unchanged must override this and return factors of 1.
+			/// @param scale Receives the factors in x, y and z.
+			virtual bool getSourceScale (Real *scale) const
+			{
+				return false;
+			}
+#if NOISEPP_ENABLE_PROFILING
+			/// Returns the profiling counters of the module.
+			Profile &getProfile () const
+			{
+				return mProfile;
+			}
+#endif
 			virtual ~Module ()
 			{
 				if (mSourceModules)
@@ -168,6 +189,99 @@ namespace noisepp
 #endif
 	};
 
+#if NOISEPP_ENABLE_PROFILING
+	template <class Element>
+	void setElementProfile (Element *element, const Module *module)
+	{
+		element->mProfile = &module->getProfile ();
+	}
+#endif
+
+	template <class Element>
+	void Pipeline<Element>::propagatePointScale (const Module *module, const PointScale &scale, std::map<const Module*, PointScale> &scales)
+	{
+		typename std::map<const Module*, PointScale>::iterator it = scales.find (module);
+		if (it == scales.end ())
+			it = scales.insert (std::make_pair (module, scale)).first;
+		else if (it->second.known && (!scale.known || !std::equal (scale.scale, scale.scale+3, it->second.scale)))
+			it->second.known = false;
+		else
+			return;
+
+		// first visit, or the module turned out to be calculated at different coordinates
+		PointScale sourceScale = it->second;
+		Real factors[3];
+		if (sourceScale.known && module->getSourceScale (factors))
+		{
+			for (int d=0;d<3;++d)
+				sourceScale.scale[d] *= factors[d];
+		}
+		else
+			sourceScale.known = false;
+		for (size_t i=0;i<module->getSourceModuleCount ();++i)
+		{
+			if (module->getSourceModule (i))
+				propagatePointScale (module->getSourceModule (i), sourceScale, scales);
+		}
+	}
+
+	template <class Element>
+	size_t Pipeline<Element>::shareLattices ()
+	{
+		typedef std::map<const Module*, ElementID>::const_iterator ElementIterator;
+
+		// the pipeline coordinates go to the modules which aren't a source of another one
+		std::set<const Module*> sources;
+		for (ElementIterator it=mElementIDs.begin();it!=mElementIDs.end();++it)
+		{
+			for (size_t i=0;i<it->first->getSourceModuleCount ();++i)
+				sources.insert (it->first->getSourceModule (i));
+		}
+		std::map<const Module*, PointScale> scales;
+		const PointScale identity = { { 1.0, 1.0, 1.0 }, true };
+		for (ElementIterator it=mElementIDs.begin();it!=mElementIDs.end();++it)
+		{
+			if (sources.find (it->first) == sources.end ())
+				propagatePointScale (it->first, identity, scales);
+		}
+
+		std::vector<LatticeOctave3D> octaves;
+		for (ElementIterator it=mElementIDs.begin();it!=mElementIDs.end();++it)
+		{
+			const size_t first = octaves.size ();
+			mElements[it->second]->getLatticeOctaves (octaves);
+			typename std::map<const Module*, PointScale>::const_iterator scale = scales.find (it->first);
+			for (size_t o=first;o<octaves.size ();++o)
+			{
+				*octaves[o].lattice = -1;
+				if (scale != scales.end ())
+				{
+					for (int d=0;d<3;++d)
+						octaves[o].frequency[d] *= scale->second.scale[d];
+				}
+			}
+			if (scale == scales.end () || !scale->second.known)
+				octaves.resize (first);
+		}
+
+		std::sort (octaves.begin (), octaves.end ());
+		mLatticeCount = 0;
+		for (size_t begin=0;begin<octaves.size ();)
+		{
+			size_t end = begin + 1;
+			while (end < octaves.size () && octaves[end].sharesLattice (octaves[begin]))
+				++end;
+			if (end - begin > 1)
+			{
+				for (size_t o=begin;o<end;++o)
+					*octaves[o].lattice = int(mLatticeCount);
+				++mLatticeCount;
+			}
+			begin = end;
+		}
+		return mLatticeCount;
+	}
+
 	#define NoiseModuleCheckSourceModules \
 		for (size_t n=0;n<mSourceModuleCount;++n) \
 		{ \
@@ -286,15 +286,20 @@ namespace noisepp
 			{
 				int seed;
 				Real scale;
+				/// The lattice shared with octaves of other elements or -1, see Pipeline::shareLattices().
+				int lattice;
 				Real persistence;
 			};
 			Octave *mOctaves;
 			size_t mOctaveCount;
 			int mQuality;
 			Real mScale;
+			int mPrecision;
 
 			NOISEPP_INLINE Real calculateGradient (Real x, Real y, Real z, int seed) const
 			{
+				if (mPrecision == NOISE_PRECISION_SINGLE)
+					return Generator3D::calcGradientCoherentNoiseSingle (mQuality, x, y, z, seed, float(mScale));
 				if (mQuality == NOISE_QUALITY_STD)
 					return Generator3D::calcGradientCoherentNoiseStd (x, y, z, seed, mScale);
 				else if (mQuality == NOISE_QUALITY_HIGH)
@@ -308,8 +313,66 @@ namespace noisepp
 				else
 					return Generator3D::calcGradientCoherentFastNoiseLow (x, y, z, seed, mScale);
 			}
+			NOISEPP_INLINE void calculateGradients (size_t count, const Real *x, const Real *y, const Real *z, int seed, Real *values) const
+			{
+				if (mPrecision == NOISE_PRECISION_SINGLE)
+					Generator3D::calcGradientCoherentNoiseBatchSingle (mQuality, count, x, y, z, seed, float(mScale), values);
+				else
+					Generator3D::calcGradientCoherentNoiseBatch (mQuality, count, x, y, z, seed, mScale, values);
+			}
+			/// Calculates an octave at a single point, or takes it from the cache if another element shares its lattice.
+			NOISEPP_INLINE Real calculateOctave (const Octave &octave, Real x, Real y, Real z, Cache *cache) const
+			{
+				Real value;
+				if (cache && cache->findLatticeValue (octave.lattice, x, y, z, value))
+					return value;
+				value = calculateGradient (x, y, z, octave.seed);
+				if (cache)
+					cache->storeLatticeValue (octave.lattice, x, y, z, value);
+				return value;
+			}
+			/// Calculates an octave for a batch, see calculateOctave().
+			/// @param buffer Receives the values unless they are kept in the cache, must hold count values.
+			/// @return The values.
+			const Real *calculateOctaveBatch (const Octave &octave, size_t count, const Real *x, const Real *y, const Real *z, Real *buffer, Cache *cache) const
+			{
+				const Real *found = cache ? cache->findLatticeBatch (octave.lattice, false, count, x, y, z) : NULL;
+				if (found)
+					return found;
+				Real *values = cache ? cache->storeLatticeBatch (octave.lattice, false, count, x, y, z) : NULL;
+				if (!values)
+					values = buffer;
+				calculateGradients (count, x, y, z, octave.seed, values);
+				return values;
+			}
+			/// Calculates an octave for a batch together with its derivatives, see calculateOctave().
+			/// @param buffer Receives the results unless they are kept in the cache, must hold 4*count values.
+			/// @return The values, followed by the derivatives in x, y and z.
+			const Real *calculateOctaveDerivatives (const Octave &octave, size_t count, const Real *x, const Real *y, const Real *z, Real *buffer, Cache *cache) const
+			{
+				const Real *found = cache ? cache->findLatticeBatch (octave.lattice, true, count, x, y, z) : NULL;
+				if (found)
+					return found;
+				Real *results = cache ? cache->storeLatticeBatch (octave.lattice, true, count, x, y, z) : NULL;
+				if (!results)
+					results = buffer;
+				Generator3D::calcGradientCoherentNoiseDerivativesBatch (mQuality, count, x, y, z, octave.seed, mScale, results, results + count, results + 2*count, results + 3*count);
+				return results;
+			}
+			NOISEPP_INLINE void calculateGradientBounds (const Box3D &box, const Octave &octave, Real &lower, Real &upper) const
+			{
+				Real min[3], max[3];
+				for (int d=0;d<3;++d)
+				{
+					min[d] = box.min[d] * octave.scale;
+					max[d] = box.max[d] * octave.scale;
+					if (min[d] > max[d])
+						std::swap (min[d], max[d]);
+				}
+				Generator3D::calcGradientCoherentNoiseBounds (mQuality, min, max, octave.seed, mScale, lower, upper);
+			}
 		public:
-			PerlinElement3D (size_t octaves, Real frequency, Real lacunarity, Real persistence, int mainSeed, int quality, Real nscale) : mOctaveCount(octaves), mQuality(quality), mScale(nscale)
+			PerlinElement3D (size_t octaves, Real frequency, Real lacunarity, Real persistence, int mainSeed, int quality, Real nscale, int precision=NOISE_PRECISION_REAL) : mOctaveCount(octaves), mQuality(quality), mScale(nscale), mPrecision(precision)
 			{
 				if (quality > NOISE_QUALITY_HIGH)
 					mScale *= FAST_NOISE_SCALE_FACTOR;
@@ -323,6 +386,7 @@ namespace noisepp
 					mOctaves[o].persistence = curPersistence;
 					mOctaves[o].scale = scale;
 					mOctaves[o].seed = seed;
+					mOctaves[o].lattice = -1;
 
 					scale *= lacunarity;
 					curPersistence *= persistence;
@@ -343,13 +407,143 @@ namespace noisepp
 					const Real nx = Math::MakeInt32Range (x * mOctaves[o].scale);
 					const Real ny = Math::MakeInt32Range (y * mOctaves[o].scale);
 					const Real nz = Math::MakeInt32Range (z * mOctaves[o].scale);
-					signal = calculateGradient(nx, ny, nz, mOctaves[o].seed);
+					signal = calculateOctave (mOctaves[o], nx, ny, nz, cache);
 
 					value += signal * mOctaves[o].persistence;
 				}
 
 				return value;
 			}
+			/// Octaves which aren't resolved at the spacing are skipped, they average to 0.
+			/// This changes the values by at most Generator3D::getGradientCoherentNoiseMaximum() times the sum of their persistences.
+			virtual void getValues (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Cache *cache, Real spacing=0.0) const
+			{
+				getOctaveValues (0, mOctaveCount, count, x, y, z, values, cache, spacing);
+			}
+			/// Skips the same octaves as getValues().
+			virtual bool getDerivatives (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Cache *cache, Real spacing=0.0) const
+			{
+				return getOctaveDerivatives (0, mOctaveCount, count, x, y, z, values, dx, dy, dz, cache, spacing);
+			}
+			/// Returns the number of octaves.
+			size_t getOctaveCount () const
+			{
+				return mOctaveCount;
+			}
+			/// Returns the frequency of an octave, the frequency of the module times the lacunarity to the power of the octave.
+			Real getOctaveFrequency (size_t octave) const
+			{
+				NoiseAssert (octave < mOctaveCount, octave);
+				return mOctaves[octave].scale;
+			}
+			/// Same as getValues(), but only sums the octaves from first up to, but excluding, last.
+			/// ShellMap uses it to calculate the octaves it doesn't store.
+			void getOctaveValues (size_t first, size_t last, size_t count, const Real *x, const Real *y, const Real *z, Real *values, Cache *cache, Real spacing=0.0) const
+			{
+				if (!count)
+					return;
+				std::vector<Real> buffer(count*4);
+				Real *nx = &buffer[0];
+				Real *ny = nx + count;
+				Real *nz = ny + count;
+				Real *octaveBuffer = nz + count;
+				std::fill (values, values+count, Real(0.0));
+
+				for (size_t o=first;o<last;++o)
+				{
+					const Octave &octave = mOctaves[o];
+					if (!Generator3D::isResolved (octave.scale, spacing))
+						continue;
+					for (size_t i=0;i<count;++i)
+					{
+						nx[i] = Math::MakeInt32Range (x[i] * octave.scale);
+						ny[i] = Math::MakeInt32Range (y[i] * octave.scale);
+						nz[i] = Math::MakeInt32Range (z[i] * octave.scale);
+					}
+					const Real *noise = calculateOctaveBatch (octave, count, nx, ny, nz, octaveBuffer, cache);
+					for (size_t i=0;i<count;++i)
+					{
+						values[i] += noise[i] * octave.persistence;
+					}
+				}
+			}
+			/// Same as getDerivatives(), but only sums the octaves from first up to, but excluding, last.
+			bool getOctaveDerivatives (size_t first, size_t last, size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Cache *cache, Real spacing=0.0) const
+			{
+				if (!count)
+					return true;
+				std::vector<Real> buffer(count*7);
+				Real *nx = &buffer[0];
+				Real *ny = nx + count;
+				Real *nz = ny + count;
+				Real *octaveBuffer = nz + count;
+				std::fill (values, values+count, Real(0.0));
+				std::fill (dx, dx+count, Real(0.0));
+				std::fill (dy, dy+count, Real(0.0));
+				std::fill (dz, dz+count, Real(0.0));
+
+				for (size_t o=first;o<last;++o)
+				{
+					const Octave &octave = mOctaves[o];
+					if (!Generator3D::isResolved (octave.scale, spacing))
+						continue;
+					for (size_t i=0;i<count;++i)
+					{
+						nx[i] = Math::MakeInt32Range (x[i] * octave.scale);
+						ny[i] = Math::MakeInt32Range (y[i] * octave.scale);
+						nz[i] = Math::MakeInt32Range (z[i] * octave.scale);
+					}
+					const Real *noise = calculateOctaveDerivatives (octave, count, nx, ny, nz, octaveBuffer, cache);
+					const Real *ndx = noise + count;
+					const Real *ndy = ndx + count;
+					const Real *ndz = ndy + count;
+					// the lattice coordinates are the point scaled by the octave scale
+					const Real factor = octave.persistence * octave.scale;
+					for (size_t i=0;i<count;++i)
+					{
+						values[i] += noise[i] * octave.persistence;
+						dx[i] += ndx[i] * factor;
+						dy[i] += ndy[i] * factor;
+						dz[i] += ndz[i] * factor;
+					}
+				}
+				return true;
+			}
+			/// Same as getBounds(), but only for the octaves from first up to, but excluding, last.
+			void getOctaveBounds (size_t first, size_t last, const Box3D &box, Real &lower, Real &upper, Real spacing=0.0) const
+			{
+				lower = upper = 0.0;
+				for (size_t o=first;o<last;++o)
+				{
+					if (!Generator3D::isResolved (mOctaves[o].scale, spacing))
+						continue;
+					Real signalLower, signalUpper;
+					calculateGradientBounds (box, mOctaves[o], signalLower, signalUpper);
+					Math::ScaleBounds (mOctaves[o].persistence, signalLower, signalUpper);
+					lower += signalLower;
+					upper += signalUpper;
+				}
+			}
+			/// @copydoc noisepp::PipelineElement3D::getLatticeOctaves()
+			virtual void getLatticeOctaves (std::vector<LatticeOctave3D> &octaves)
+			{
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					LatticeOctave3D octave;
+					octave.frequency[0] = octave.frequency[1] = octave.frequency[2] = mOctaves[o].scale;
+					octave.seed = mOctaves[o].seed;
+					octave.quality = mQuality;
+					octave.noiseScale = mScale;
+					octave.precision = mPrecision;
+					octave.lattice = &mOctaves[o].lattice;
+					octaves.push_back (octave);
+				}
+			}
+			virtual bool getBounds (const Box3D &box, Real &lower, Real &upper, Real spacing=0.0) const
+			{
+				getOctaveBounds (0, mOctaveCount, box, lower, upper, spacing);
+				return true;
+			}
 	};
 
 	/** Module for generating perlin noise.
@@ -371,7 +565,7 @@ namespace noisepp
 			/// @copydoc noisepp::Module::addToPipeline()
 			ElementID addToPipeline (Pipeline3D *pipe) const
 			{
-				return pipe->addElement (this, new PerlinElement3D(mOctaveCount, mFrequency, mLacunarity, mPersistence, mSeed+pipe->getSeed(), mQuality, mScale));
+				return pipe->addElement (this, new PerlinElement3D(mOctaveCount, mFrequency, mLacunarity, mPersistence, mSeed+pipe->getSeed(), mQuality, mScale, pipe->getPrecision()));
 			}
 			/// @copydoc noisepp::Module::getType()
 			ModuleTypeId getType() const { return MODULE_PERLIN; }
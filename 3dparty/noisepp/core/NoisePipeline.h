@@ -27,26 +27,173 @@
 #define NOISEPP_PIPELINE_H
 
 #include "NoisePrerequisites.h"
+#include "NoiseProfile.h"
 
 namespace noisepp
 {
 	class Module;
 
-	/// Cache structure for faster pipeline processing.
+#if NOISEPP_ENABLE_PROFILING
+	/// Points the element to the profiling counters of its module. Defined in NoiseModule.h.
+	template <class Element>
+	void setElementProfile (Element *element, const Module *module);
+#endif
+
+	/** Cache structure for faster pipeline processing.
+		Holds the last value of each element of a pipeline, stamped with the generation it was calculated in.
+		A generation stands for one set of coordinates: cleaning the cache starts a new generation,
+		so invalidating all values is one increment and a lookup is one integer comparison.
+		Elements which call their sources at other coordinates use a new generation for them, see getTransformedElementValue().
+		It also holds the last octave calculated on each lattice shared by several generator elements, see Pipeline::shareLattices().
+		Those are looked up by their lattice coordinates instead of the generation, since the elements usually are
+		behind different transform elements, and are only dropped when the cache is cleaned.
+	*/
 	struct Cache
 	{
-		/// Cached value.
-		Real value;
-		/// Cache filled flag.
-		bool filled;
-		/// Last x coordinate.
-		Real x;
-		/// Last y coordinate.
-		Real y;
-		/// Last z coordinate.
-		Real z;
+		/// The last octave of a shared lattice calculated at a single point.
+		struct LatticeValue
+		{
+			Real point[3];
+			Real value;
+			bool valid;
+		};
+		/// The last octave of a shared lattice calculated for a batch.
+		struct LatticeBatch
+		{
+			/// The x-, y- and z-coordinates of the points.
+			std::vector<Real> points;
+			/// The values, followed by the derivatives in x, y and z if derivatives is true.
+			std::vector<Real> results;
+			bool derivatives;
+		};
+
+		/// The generation each value was calculated in.
+		unsigned *generations;
+		/// Cached values.
+		Real *values;
+		/// The number of elements.
+		size_t size;
+		/// The current generation.
+		unsigned generation;
+		/// The last generation which was started.
+		unsigned lastGeneration;
+		/// Octaves of the shared lattices.
+		LatticeValue *latticeValues;
+		LatticeBatch *latticeBatches;
+		/// The number of shared lattices.
+		size_t latticeCount;
+
 		/// Constructor.
-		Cache () : value(0), filled(false) {}
+		/// @param size The number of elements of the pipeline.
+		/// @param latticeCount The number of lattices shared by the elements of the pipeline.
+		Cache (size_t size, size_t latticeCount=0) : generations(new unsigned[size]), values(new Real[size]), size(size), generation(1), lastGeneration(1),
+			latticeValues(new LatticeValue[latticeCount]), latticeBatches(new LatticeBatch[latticeCount]), latticeCount(latticeCount)
+		{
+			std::fill (generations, generations+size, 0u);
+			std::fill (values, values+size, Real(0.0));
+			for (size_t i=0;i<latticeCount;++i)
+			{
+				latticeValues[i].valid = false;
+				latticeBatches[i].derivatives = false;
+			}
+		}
+		/// Destructor.
+		~Cache ()
+		{
+			delete[] generations;
+			delete[] values;
+			delete[] latticeValues;
+			delete[] latticeBatches;
+		}
+		/// Looks for an octave of a shared lattice at the specified lattice coordinates.
+		/// @param lattice The lattice, negative for octaves which aren't shared.
+		/// @param value Receives the value if found.
+		/// @return True if the last point the lattice was calculated at has the same coordinates.
+		NOISEPP_INLINE bool findLatticeValue (int lattice, Real x, Real y, Real z, Real &value) const
+		{
+			if (lattice < 0 || size_t(lattice) >= latticeCount)
+				return false;
+			const LatticeValue &entry = latticeValues[lattice];
+			const Real point[3] = { x, y, z };
+			// bitwise, so a -0.0 doesn't take the value of a 0.0
+			if (!entry.valid || memcmp (entry.point, point, sizeof(point)) != 0)
+				return false;
+			value = entry.value;
+			return true;
+		}
+		/// Stores an octave of a shared lattice calculated at a single point, see findLatticeValue().
+		NOISEPP_INLINE void storeLatticeValue (int lattice, Real x, Real y, Real z, Real value)
+		{
+			if (lattice < 0 || size_t(lattice) >= latticeCount)
+				return;
+			LatticeValue &entry = latticeValues[lattice];
+			entry.point[0] = x;
+			entry.point[1] = y;
+			entry.point[2] = z;
+			entry.value = value;
+			entry.valid = true;
+		}
+		/// Looks for an octave of a shared lattice calculated for a batch.
+		/// @param lattice The lattice, negative for octaves which aren't shared.
+		/// @param derivatives Whether the derivatives are needed too. Values calculated without them aren't
+		/// reused with them or vice versa, the calculations don't round in the same way.
+		/// @return The results of the last batch of the lattice if it has the same coordinates, in the layout of
+		/// LatticeBatch::results, or NULL.
+		const Real *findLatticeBatch (int lattice, bool derivatives, size_t count, const Real *x, const Real *y, const Real *z) const
+		{
+			if (lattice < 0 || size_t(lattice) >= latticeCount || count == 0)
+				return NULL;
+			const LatticeBatch &entry = latticeBatches[lattice];
+			if (entry.derivatives != derivatives || entry.points.size () != count*3)
+				return NULL;
+			const Real *points = &entry.points[0];
+			if (memcmp (points, x, count*sizeof(Real)) != 0 || memcmp (points + count, y, count*sizeof(Real)) != 0 || memcmp (points + 2*count, z, count*sizeof(Real)) != 0)
+				return NULL;
+			return &entry.results[0];
+		}
+		/// Stores the coordinates of a batch of a shared lattice, see findLatticeBatch().
+		/// @return The buffer the results have to be written to, or NULL if the octave isn't shared.
+		Real *storeLatticeBatch (int lattice, bool derivatives, size_t count, const Real *x, const Real *y, const Real *z)
+		{
+			if (lattice < 0 || size_t(lattice) >= latticeCount || count == 0)
+				return NULL;
+			LatticeBatch &entry = latticeBatches[lattice];
+			entry.points.resize (count*3);
+			std::copy (x, x+count, entry.points.begin ());
+			std::copy (y, y+count, entry.points.begin () + count);
+			std::copy (z, z+count, entry.points.begin () + 2*count);
+			entry.results.resize (derivatives ? count*4 : count);
+			entry.derivatives = derivatives;
+			return &entry.results[0];
+		}
+		/// Starts a new generation, the values cached so far aren't used anymore.
+		/// @return The previous generation, which can be restored by setting generation.
+		NOISEPP_INLINE unsigned newGeneration ()
+		{
+			const unsigned previous = generation;
+			if (++lastGeneration == 0)
+			{
+				// wrapped around, no stamp must match a new generation
+				std::fill (generations, generations+size, 0u);
+				lastGeneration = 1;
+			}
+			generation = lastGeneration;
+			return previous;
+		}
+		/// Forgets everything calculated so far, see Pipeline::cleanCache().
+		NOISEPP_INLINE void clean ()
+		{
+			newGeneration ();
+			for (size_t i=0;i<latticeCount;++i)
+			{
+				latticeValues[i].valid = false;
+				latticeBatches[i].points.clear ();
+			}
+		}
+
+		private:
+			Cache (const Cache &);
+			Cache &operator= (const Cache &);
 	};
 
 	/// A job which can be added to the queue inside a pipeline for multi-threaded execution.
@@ -66,6 +213,74 @@ namespace noisepp
 	/// A queue of pipeline jobs
 	typedef std::queue<PipelineJob*> PipelineJobQueue;
 
+	/// An axis aligned box, used for calculating bounds.
+	struct Box3D
+	{
+		/// Minimum corner.
+		Real min[3];
+		/// Maximum corner.
+		Real max[3];
+		/// Sets the box to the bounding box of the specified points.
+		void set (size_t count, const Real *x, const Real *y, const Real *z)
+		{
+			NoiseAssert (count > 0, count);
+			min[0] = max[0] = x[0];
+			min[1] = max[1] = y[0];
+			min[2] = max[2] = z[0];
+			for (size_t i=1;i<count;++i)
+			{
+				min[0] = std::min (min[0], x[i]);
+				max[0] = std::max (max[0], x[i]);
+				min[1] = std::min (min[1], y[i]);
+				max[1] = std::max (max[1], y[i]);
+				min[2] = std::min (min[2], z[i]);
+				max[2] = std::max (max[2], z[i]);
+			}
+		}
+	};
+
+	/// Precision of the pipeline calculations.
+	/// NOISE_PRECISION_SINGLE makes the 3D gradient noise modules (Perlin, Billow, RidgedMulti)
+	/// calculate their octaves in single precision, the lattice cell is still calculated in Real precision.
+	enum { NOISE_PRECISION_REAL=0, NOISE_PRECISION_SINGLE=1 };
+
+	/// An octave of a gradient noise generator element, as seen by Pipeline::shareLattices().
+	/// Two octaves with the same lattice calculate the same noise if they get the same lattice coordinates.
+	struct LatticeOctave3D
+	{
+		/// The frequency of the octave in x, y and z, relative to the coordinates of the pipeline.
+		Real frequency[3];
+		int seed;
+		int quality;
+		/// The scale of the noise values.
+		Real noiseScale;
+		int precision;
+		/// Receives the index of the shared lattice in the cache, or -1.
+		int *lattice;
+
+		/// Orders the octaves by lattice.
+		bool operator< (const LatticeOctave3D &other) const
+		{
+			for (int d=0;d<3;++d)
+			{
+				if (frequency[d] != other.frequency[d])
+					return frequency[d] < other.frequency[d];
+			}
+			if (seed != other.seed)
+				return seed < other.seed;
+			if (quality != other.quality)
+				return quality < other.quality;
+			if (noiseScale != other.noiseScale)
+				return noiseScale < other.noiseScale;
+			return precision < other.precision;
+		}
+		/// Returns true if the octaves have the same lattice.
+		bool sharesLattice (const LatticeOctave3D &other) const
+		{
+			return !(*this < other) && !(other < *this);
+		}
+	};
+
 	/** Pipeline base class.
 		In Noise++ the noise generation process is different to other libraries.
 		Instead of calling a noise generation function from your module instances directly,
@@ -78,6 +293,19 @@ namespace noisepp
 	{
 		private:
 			int mSeed;
+			int mPrecision;
+			size_t mLatticeCount;
+
+			/// The scale of the coordinates a module is calculated at, relative to the ones of the pipeline.
+			struct PointScale
+			{
+				Real scale[3];
+				/// False if the module is reached with different coordinates or the coordinates are transformed otherwise.
+				bool known;
+			};
+			/// Propagates the scale of the coordinates from a module to its sources, see shareLattices().
+			/// Defined in NoiseModule.h.
+			static void propagatePointScale (const Module *module, const PointScale &scale, std::map<const Module*, PointScale> &scales);
 
 		protected:
 			/// Element vector.
@@ -89,7 +317,7 @@ namespace noisepp
 
 		public:
 			/// Constructor.
-			Pipeline () : mSeed(0)
+			Pipeline () : mSeed(0), mPrecision(NOISE_PRECISION_REAL), mLatticeCount(0)
 			{
 			}
 			/// Returns the element with the specified ID.
@@ -114,24 +342,37 @@ namespace noisepp
 			{
 				return mSeed;
 			}
+			/// Sets the precision of the noise calculations, see NOISE_PRECISION_REAL and NOISE_PRECISION_SINGLE.
+			/// You have to call this BEFORE adding your modules or this will have no effect.
+			void setPrecision (int precision)
+			{
+				mPrecision = precision;
+			}
+			/// Returns the precision of the noise calculations.
+			int getPrecision () const
+			{
+				return mPrecision;
+			}
 			/// Creates a clean cache.
 			/// You need only one cache per pipeline and thread.
 			/// You have to call this AFTER adding your modules or there will be memory acces errors.
 			/// Don't forget to free the cache.
 			Cache *createCache () const
 			{
-				return new Cache[mElements.size()];
+				return new Cache (mElements.size(), mLatticeCount);
 			}
-			/// Cleans the specified cache.
-			/// You should call this each time you use it.
+			/// Cleans the specified cache. Nothing calculated before is returned afterwards, neither the values of the
+			/// elements nor the octaves of the shared lattices, which are otherwise reused whenever their coordinates match.
+			/// You must call this each time the coordinates change, and before using the cache again with elements whose
+			/// parameters changed since it was last used.
 			NOISEPP_INLINE void cleanCache (Cache *cache) const
 			{
-				memset (cache, 0, sizeof(Cache)*mElements.size());
+				cache->clean ();
 			}
 			/// Frees the specified cache.
 			void freeCache (Cache *cache) const
 			{
-				delete[] cache;
+				delete cache;
 			}
 			/// Adds the specified element to the pipeline.
 			/// This is used internally by modules.
@@ -148,8 +389,21 @@ namespace noisepp
 				ElementID id = mElements.size ();
 				mElementIDs.insert (std::make_pair(parent, id));
 				mElements.push_back(element);
+#if NOISEPP_ENABLE_PROFILING
+				setElementProfile (element, parent);
+#endif
 				return id;
 			}
+			/// Looks for octaves of different generator elements which calculate the same noise, because they have the
+			/// same frequency relative to the pipeline coordinates, seed, quality and scale, and lets them share their results.
+			/// The frequency includes the ScalePoint modules between the pipeline and the element, other coordinate
+			/// transforms and the modules which don't report how they pass the coordinates, see Module::getSourceScale(),
+			/// exclude their sources. The octave calculated by the first of the elements is kept in the cache
+			/// and reused by the others if their lattice coordinates match bit for bit, so the values never change.
+			/// The 3D Perlin, Billow and RidgedMulti elements share their octaves, both for single points and for batches.
+			/// You have to call this AFTER adding your modules and BEFORE creating the caches.
+			/// @return The number of shared lattices.
+			size_t shareLattices ();
 			/// Returns the ID of the element belonging to the specified module or ELEMENTID_INVALID if not found.
 			ElementID getElementID (const Module *module) const
 			{
@@ -176,7 +430,45 @@ namespace noisepp
 			{
 				return getElementPtr(&module);
 			}
+#if NOISEPP_ENABLE_PROFILING
+			/// Returns the profiling counters of the element with the specified ID.
+			Profile &getProfile (ElementID i) const
+			{
+				return *getElement(i)->mProfile;
+			}
+			/// Writes the profiling counters of all elements, one line per ElementID.
+			/// Use getElementID() to find the element of a module.
+			/// The share is the time of the element relative to the most expensive one, which usually is
+			/// the root since the times include the sources.
+			void dumpProfile (std::ostream &stream) const
+			{
+				double maxTicks = 0.0;
+				for (ElementID i=0;i<mElements.size();++i)
+				{
+					maxTicks = std::max (maxTicks, getProfile(i).getTicks ());
+				}
+				stream << "element evaluations cache-hits calls ticks share" << std::endl;
+				for (ElementID i=0;i<mElements.size();++i)
+				{
+					const Profile &profile = getProfile (i);
+					const double ticks = profile.getTicks ();
+					stream << i << " " << profile.evaluations << " " << profile.cacheHits << " " << profile.calls << " "
+						<< (unsigned long long)ticks << " " << (maxTicks > 0.0 ? 100.0 * ticks / maxTicks : 0.0) << "%" << std::endl;
+				}
+			}
+			/// Resets the profiling counters of all elements.
+			void resetProfile ()
+			{
+				for (ElementID i=0;i<mElements.size();++i)
+				{
+					getProfile(i).reset ();
+				}
+			}
+#endif
 			/// Adds a job to the queue.
+			/// Only call this from the thread which calls executeJobs(), never from a job or from another thread.
+			/// There is no limit on the number of jobs added, but ThreadedPipeline hands at most
+			/// threadpp::JobPool::QUEUE_SIZE of them to the workers at a time and keeps the others until some finish.
 			virtual void addJob (PipelineJob *job)
 			{
 				NoiseAssert (job != NULL, job);
@@ -245,20 +537,37 @@ namespace noisepp
 		protected:
 			NOISEPP_INLINE Real getElementValue (const PipelineElement1D *elementPtr, ElementID element, Real x, Cache *cache) const
 			{
-				if (cache[element].filled && cache[element].x == x)
+				if (cache->generations[element] == cache->generation)
 				{
-					return cache[element].value;
+					NOISEPP_PROFILE_HIT(elementPtr->mProfile);
+					return cache->values[element];
 				}
 				else
 				{
-					cache[element].filled = true;
-					cache[element].x = x;
-					return (cache[element].value = elementPtr->getValue(x, cache));
+					NOISEPP_PROFILE_SCOPE(elementPtr->mProfile, 1);
+					const Real value = elementPtr->getValue(x, cache);
+					cache->generations[element] = cache->generation;
+					return (cache->values[element] = value);
 				}
 			}
+			/// Returns the value of a source element at other coordinates than the ones this element is calculated at.
+			/// The source is calculated in a new cache generation, the values cached for the coordinates of this element don't apply to it.
+			NOISEPP_INLINE Real getTransformedElementValue (const PipelineElement1D *elementPtr, ElementID element, Real x, Cache *cache) const
+			{
+				const unsigned generation = cache->newGeneration ();
+				const Real value = getElementValue (elementPtr, element, x, cache);
+				cache->generation = generation;
+				return value;
+			}
 
 			bool mCached;
 		public:
+#if NOISEPP_ENABLE_PROFILING
+			/// Profiling counters of the module of the element, set by the pipeline.
+			Profile *mProfile;
+
+			PipelineElement1D () : mProfile(NULL) {}
+#endif
 			virtual Real getValue (Real x, Cache *cache) const = 0;
 			virtual ~PipelineElement1D () {}
 	};
@@ -268,20 +577,35 @@ namespace noisepp
 		protected:
 			NOISEPP_INLINE Real getElementValue (const PipelineElement2D *elementPtr, ElementID element, Real x, Real y, Cache *cache) const
 			{
-				if (cache[element].filled && cache[element].x == x && cache[element].y == y)
+				if (cache->generations[element] == cache->generation)
 				{
-					return cache[element].value;
+					NOISEPP_PROFILE_HIT(elementPtr->mProfile);
+					return cache->values[element];
 				}
 				else
 				{
-					cache[element].filled = true;
-					cache[element].x = x;
-					cache[element].y = y;
-					return (cache[element].value = elementPtr->getValue(x, y, cache));
+					NOISEPP_PROFILE_SCOPE(elementPtr->mProfile, 1);
+					const Real value = elementPtr->getValue(x, y, cache);
+					cache->generations[element] = cache->generation;
+					return (cache->values[element] = value);
 				}
 			}
+			/// @copydoc noisepp::PipelineElement1D::getTransformedElementValue()
+			NOISEPP_INLINE Real getTransformedElementValue (const PipelineElement2D *elementPtr, ElementID element, Real x, Real y, Cache *cache) const
+			{
+				const unsigned generation = cache->newGeneration ();
+				const Real value = getElementValue (elementPtr, element, x, y, cache);
+				cache->generation = generation;
+				return value;
+			}
 
 		public:
+#if NOISEPP_ENABLE_PROFILING
+			/// Profiling counters of the module of the element, set by the pipeline.
+			Profile *mProfile;
+
+			PipelineElement2D () : mProfile(NULL) {}
+#endif
 			virtual Real getValue (Real x, Real y, Cache *cache) const = 0;
 			virtual ~PipelineElement2D () {}
 	};
@@ -291,22 +615,96 @@ namespace noisepp
 		protected:
 			NOISEPP_INLINE Real getElementValue (const PipelineElement3D *elementPtr, ElementID element, Real x, Real y, Real z, Cache *cache) const
 			{
-				if (cache[element].filled && cache[element].x == x && cache[element].y == y && cache[element].z == z)
+				if (cache->generations[element] == cache->generation)
 				{
-					return cache[element].value;
+					NOISEPP_PROFILE_HIT(elementPtr->mProfile);
+					return cache->values[element];
 				}
 				else
 				{
-					cache[element].filled = true;
-					cache[element].x = x;
-					cache[element].y = y;
-					cache[element].z = z;
-					return (cache[element].value = elementPtr->getValue(x, y, z, cache));
+					NOISEPP_PROFILE_SCOPE(elementPtr->mProfile, 1);
+					const Real value = elementPtr->getValue(x, y, z, cache);
+					cache->generations[element] = cache->generation;
+					return (cache->values[element] = value);
 				}
 			}
+			/// @copydoc noisepp::PipelineElement1D::getTransformedElementValue()
+			NOISEPP_INLINE Real getTransformedElementValue (const PipelineElement3D *elementPtr, ElementID element, Real x, Real y, Real z, Cache *cache) const
+			{
+				const unsigned generation = cache->newGeneration ();
+				const Real value = getElementValue (elementPtr, element, x, y, z, cache);
+				cache->generation = generation;
+				return value;
+			}
+			/// Calculates a batch of values of a source element, see getValues().
+			static NOISEPP_INLINE void getElementValues (const PipelineElement3D *elementPtr, size_t count, const Real *x, const Real *y, const Real *z, Real *values, Cache *cache, Real spacing)
+			{
+				NOISEPP_PROFILE_SCOPE(elementPtr->mProfile, count);
+				elementPtr->getValues (count, x, y, z, values, cache, spacing);
+			}
+			/// Calculates a batch of values and derivatives of a source element, see getDerivatives().
+			static NOISEPP_INLINE bool getElementDerivatives (const PipelineElement3D *elementPtr, size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Cache *cache, Real spacing)
+			{
+				NOISEPP_PROFILE_SCOPE(elementPtr->mProfile, count);
+				return elementPtr->getDerivatives (count, x, y, z, values, dx, dy, dz, cache, spacing);
+			}
 
 		public:
+#if NOISEPP_ENABLE_PROFILING
+			/// Profiling counters of the module of the element, set by the pipeline.
+			Profile *mProfile;
+
+			PipelineElement3D () : mProfile(NULL) {}
+#endif
 			virtual Real getValue (Real x, Real y, Real z, Cache *cache) const = 0;
+			/// Calculates the values of a batch of points.
+			/// The default implementation calls getValue() for each point in a new cache generation. Elements override this
+			/// to run the whole batch through the graph in one pass.
+			/// Batch evaluation doesn't fill the cache, the values of shared elements are calculated for each caller.
+			/// Only the octaves of shared lattices are reused, see Pipeline::shareLattices().
+			/// @param count The number of points.
+			/// @param x The x-coordinates.
+			/// @param y The y-coordinates.
+			/// @param z The z-coordinates.
+			/// @param values The output buffer, must hold count values.
+			/// @param cache The cache.
+			/// @param spacing The distance between neighbouring points. Generator elements skip the octaves which are
+			/// too fine to be represented at this spacing, see Generator3D::isResolved(). 0 calculates all octaves.
+			virtual void getValues (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Cache *cache, Real spacing=0.0) const
+			{
+				for (size_t i=0;i<count;++i)
+				{
+					if (cache)
+						cache->newGeneration ();
+					values[i] = getValue (x[i], y[i], z[i], cache);
+				}
+			}
+			/// Calculates the values of a batch of points together with their partial derivatives.
+			/// Returns false if the element can't calculate derivatives, which is the default. The buffers are undefined then.
+			/// The values are the ones of getValues() with the same spacing, but always calculated in Real precision.
+			/// @param dx Receives the derivatives in x, must hold count values.
+			/// @param dy Receives the derivatives in y, must hold count values.
+			/// @param dz Receives the derivatives in z, must hold count values.
+			/// @see getValues()
+			virtual bool getDerivatives (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Cache *cache, Real spacing=0.0) const
+			{
+				return false;
+			}
+			/// Appends the octaves of a gradient noise generator element, see Pipeline::shareLattices().
+			/// Their frequency is relative to the coordinates of the element. The default is to have none.
+			virtual void getLatticeOctaves (std::vector<LatticeOctave3D> &octaves)
+			{
+			}
+			/// Calculates conservative bounds of the values inside the specified box.
+			/// Returns false if the element can't tell, which is the default.
+			/// @param box The box.
+			/// @param lower Receives the lower bound.
+			/// @param upper Receives the upper bound.
+			/// @param spacing The bounds are the ones of getValues() with the same spacing.
+			virtual bool getBounds (const Box3D &box, Real &lower, Real &upper, Real spacing=0.0) const
+			{
+				return false;
+			}
 			virtual ~PipelineElement3D () {}
 	};
 };
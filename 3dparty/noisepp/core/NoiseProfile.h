@@ -0,0 +1,154 @@
+// Noise++ Library
+// Copyright (c) 2008, Urs C. Hanselmann
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above copyright notice,
+//      this list of conditions and the following disclaimer in the documentation
+//      and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef NOISEPP_PROFILE_H
+#define NOISEPP_PROFILE_H
+
+#include "NoisePrerequisites.h"
+
+#if NOISEPP_ENABLE_PROFILING
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#	include <x86intrin.h>
+#	define NOISEPP_PROFILE_TICKS() __rdtsc()
+#elif defined(_MSC_VER)
+#	include <intrin.h>
+#	define NOISEPP_PROFILE_TICKS() __rdtsc()
+#else
+#	include <chrono>
+#	define NOISEPP_PROFILE_TICKS() std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+#endif
+
+namespace noisepp
+{
+	/** Profiling counters of a module.
+		Every pipeline element and compiled pipeline node updates the counters of its module, so a module
+		shared by several pipelines sums them up. The time is inclusive, it contains the time spent in the
+		sources of the module. To keep the overhead low only one call out of SAMPLE_INTERVAL is timed,
+		getTicks() extrapolates the total from the sampled calls.
+	*/
+	class Profile
+	{
+		public:
+			enum { SAMPLE_INTERVAL=16 };
+
+			/// Number of points calculated.
+			std::atomic<unsigned long long> evaluations;
+			/// Number of values taken from the cache instead of calculating them.
+			std::atomic<unsigned long long> cacheHits;
+			/// Number of calls, a batch counts as one.
+			std::atomic<unsigned long long> calls;
+			/// Number of timed calls.
+			std::atomic<unsigned long long> sampledCalls;
+			/// Ticks spent in the timed calls.
+			std::atomic<unsigned long long> sampledTicks;
+
+			Profile ()
+			{
+				reset ();
+			}
+			/// Copies start with clean counters.
+			Profile (const Profile &)
+			{
+				reset ();
+			}
+			Profile &operator= (const Profile &)
+			{
+				return *this;
+			}
+			/// Resets all counters.
+			void reset ()
+			{
+				evaluations = 0;
+				cacheHits = 0;
+				calls = 0;
+				sampledCalls = 0;
+				sampledTicks = 0;
+			}
+			/// Returns the estimated number of ticks spent in all calls.
+			/// The ticks are CPU timestamp counter cycles where available, nanoseconds otherwise.
+			double getTicks () const
+			{
+				const unsigned long long sampled = sampledCalls.load (std::memory_order_relaxed);
+				if (sampled == 0)
+					return 0.0;
+				return double(sampledTicks.load (std::memory_order_relaxed)) * double(calls.load (std::memory_order_relaxed)) / double(sampled);
+			}
+	};
+
+	/// Counts a call of an element in its profile and times it, if it is one of the sampled calls.
+	class ProfileScope
+	{
+		private:
+			Profile *mProfile;
+			unsigned long long mStart;
+
+			ProfileScope (const ProfileScope &);
+			ProfileScope &operator= (const ProfileScope &);
+
+		public:
+			/// @param profile The profile, may be NULL.
+			/// @param count The number of points calculated in the call.
+			NOISEPP_INLINE ProfileScope (Profile *profile, size_t count) : mProfile(NULL), mStart(0)
+			{
+				if (!profile)
+					return;
+				profile->evaluations.fetch_add (count, std::memory_order_relaxed);
+				if (profile->calls.fetch_add (1, std::memory_order_relaxed) % Profile::SAMPLE_INTERVAL == 0)
+				{
+					mProfile = profile;
+					mStart = NOISEPP_PROFILE_TICKS();
+				}
+			}
+			NOISEPP_INLINE ~ProfileScope ()
+			{
+				if (mProfile)
+				{
+					mProfile->sampledTicks.fetch_add (NOISEPP_PROFILE_TICKS() - mStart, std::memory_order_relaxed);
+					mProfile->sampledCalls.fetch_add (1, std::memory_order_relaxed);
+				}
+			}
+			/// Counts a value taken from the cache.
+			static NOISEPP_INLINE void hit (Profile *profile)
+			{
+				if (profile)
+					profile->cacheHits.fetch_add (1, std::memory_order_relaxed);
+			}
+	};
+};
+
+/// Counts and samples the enclosing scope in the specified profile.
+#define NOISEPP_PROFILE_SCOPE(profile, count) noisepp::ProfileScope noiseppProfileScope_ (profile, count)
+/// Counts a cache hit in the specified profile.
+#define NOISEPP_PROFILE_HIT(profile) noisepp::ProfileScope::hit (profile)
+
+#else
+
+#define NOISEPP_PROFILE_SCOPE(profile, count)
+#define NOISEPP_PROFILE_HIT(profile)
+
+#endif
+
+#endif
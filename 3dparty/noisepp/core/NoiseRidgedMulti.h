@@ -205,7 +205,11 @@ namespace noisepp
 			{
 				int seed;
 				Real scale;
+				/// The lattice shared with octaves of other elements or -1, see Pipeline::shareLattices().
+				int lattice;
 				Real spectralWeight;
+				/// The average contribution of this and the following octaves, which is used when they are skipped.
+				Real tailMean;
 			};
 			Octave *mOctaves;
 			size_t mOctaveCount;
@@ -213,9 +217,12 @@ namespace noisepp
 			Real mOffset;
 			Real mGain;
 			Real mScale;
+			int mPrecision;
 
 			NOISEPP_INLINE Real calculateGradient (Real x, Real y, Real z, int seed) const
 			{
+				if (mPrecision == NOISE_PRECISION_SINGLE)
+					return Generator3D::calcGradientCoherentNoiseSingle (mQuality, x, y, z, seed, float(mScale));
 				if (mQuality == NOISE_QUALITY_STD)
 					return Generator3D::calcGradientCoherentNoiseStd (x, y, z, seed, mScale);
 				else if (mQuality == NOISE_QUALITY_HIGH)
@@ -229,8 +236,119 @@ namespace noisepp
 				else
 					return Generator3D::calcGradientCoherentFastNoiseLow (x, y, z, seed, mScale);
 			}
+			NOISEPP_INLINE void calculateGradients (size_t count, const Real *x, const Real *y, const Real *z, int seed, Real *values) const
+			{
+				if (mPrecision == NOISE_PRECISION_SINGLE)
+					Generator3D::calcGradientCoherentNoiseBatchSingle (mQuality, count, x, y, z, seed, float(mScale), values);
+				else
+					Generator3D::calcGradientCoherentNoiseBatch (mQuality, count, x, y, z, seed, mScale, values);
+			}
+			/// Calculates an octave at a single point, or takes it from the cache if another element shares its lattice.
+			NOISEPP_INLINE Real calculateOctave (const Octave &octave, Real x, Real y, Real z, Cache *cache) const
+			{
+				Real value;
+				if (cache && cache->findLatticeValue (octave.lattice, x, y, z, value))
+					return value;
+				value = calculateGradient (x, y, z, octave.seed);
+				if (cache)
+					cache->storeLatticeValue (octave.lattice, x, y, z, value);
+				return value;
+			}
+			/// Calculates an octave for a batch, see calculateOctave().
+			/// @param buffer Receives the values unless they are kept in the cache, must hold count values.
+			/// @return The values.
+			const Real *calculateOctaveBatch (const Octave &octave, size_t count, const Real *x, const Real *y, const Real *z, Real *buffer, Cache *cache) const
+			{
+				const Real *found = cache ? cache->findLatticeBatch (octave.lattice, false, count, x, y, z) : NULL;
+				if (found)
+					return found;
+				Real *values = cache ? cache->storeLatticeBatch (octave.lattice, false, count, x, y, z) : NULL;
+				if (!values)
+					values = buffer;
+				calculateGradients (count, x, y, z, octave.seed, values);
+				return values;
+			}
+			/// Calculates an octave for a batch together with its derivatives, see calculateOctave().
+			/// @param buffer Receives the results unless they are kept in the cache, must hold 4*count values.
+			/// @return The values, followed by the derivatives in x, y and z.
+			const Real *calculateOctaveDerivatives (const Octave &octave, size_t count, const Real *x, const Real *y, const Real *z, Real *buffer, Cache *cache) const
+			{
+				const Real *found = cache ? cache->findLatticeBatch (octave.lattice, true, count, x, y, z) : NULL;
+				if (found)
+					return found;
+				Real *results = cache ? cache->storeLatticeBatch (octave.lattice, true, count, x, y, z) : NULL;
+				if (!results)
+					results = buffer;
+				Generator3D::calcGradientCoherentNoiseDerivativesBatch (mQuality, count, x, y, z, octave.seed, mScale, results, results + count, results + 2*count, results + 3*count);
+				return results;
+			}
+			NOISEPP_INLINE void calculateGradientBounds (const Box3D &box, const Octave &octave, Real &lower, Real &upper) const
+			{
+				Real min[3], max[3];
+				for (int d=0;d<3;++d)
+				{
+					min[d] = box.min[d] * octave.scale;
+					max[d] = box.max[d] * octave.scale;
+					if (min[d] > max[d])
+						std::swap (min[d], max[d]);
+				}
+				Generator3D::calcGradientCoherentNoiseBounds (mQuality, min, max, octave.seed, mScale, lower, upper);
+			}
+			/// Number of points used to estimate the averages of the octaves.
+			enum { MEAN_SAMPLE_COUNT=4096 };
+			void calculateMeans ()
+			{
+				if (!mOctaveCount)
+					return;
+				const size_t count = MEAN_SAMPLE_COUNT;
+				std::vector<Real> buffer(count*7);
+				Real *px = &buffer[0];
+				Real *py = px + count;
+				Real *pz = py + count;
+				Real *nx = pz + count;
+				Real *ny = nx + count;
+				Real *nz = ny + count;
+				Real *noise = nz + count;
+				std::vector<Real> weights(count, Real(1.0));
+				// the octaves depend on each other through the weights, so they are sampled at the same points
+				// in the lattice space of the first octave
+				Generator3D::getSamplePoints (count, px, py, pz);
+				const Real baseScale = mOctaves[0].scale;
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					const Real scale = (baseScale != Real(0.0)) ? mOctaves[o].scale / baseScale : mOctaves[o].scale;
+					for (size_t i=0;i<count;++i)
+					{
+						nx[i] = Math::MakeInt32Range (px[i] * scale);
+						ny[i] = Math::MakeInt32Range (py[i] * scale);
+						nz[i] = Math::MakeInt32Range (pz[i] * scale);
+					}
+					calculateGradients (count, nx, ny, nz, mOctaves[o].seed, noise);
+					Real sum = 0.0;
+					for (size_t i=0;i<count;++i)
+					{
+						Real signal = noise[i];
+						signal = mOffset - std::fabs(signal);
+						signal *= signal;
+						signal *= weights[i];
+						Real weight = signal * mGain;
+						if (weight > Real(1.0))
+							weight = Real(1.0);
+						if (weight < Real(-1.0))
+							weight = Real(-1.0);
+						weights[i] = weight;
+
+						sum += signal * mOctaves[o].spectralWeight;
+					}
+					mOctaves[o].tailMean = sum / Real(count);
+				}
+				for (size_t o=mOctaveCount-1;o>0;--o)
+				{
+					mOctaves[o-1].tailMean += mOctaves[o].tailMean;
+				}
+			}
 		public:
-			RidgedMultiElement3D (size_t octaves, Real frequency, Real lacunarity, Real exponent, Real offset, Real gain, int mainSeed, int quality, Real nscale) : mOctaveCount(octaves), mQuality(quality), mOffset(offset), mGain(gain), mScale(nscale)
+			RidgedMultiElement3D (size_t octaves, Real frequency, Real lacunarity, Real exponent, Real offset, Real gain, int mainSeed, int quality, Real nscale, int precision=NOISE_PRECISION_REAL) : mOctaveCount(octaves), mQuality(quality), mOffset(offset), mGain(gain), mScale(nscale), mPrecision(precision)
 			{
 				if (quality > NOISE_QUALITY_HIGH)
 					mScale *= FAST_NOISE_SCALE_FACTOR;
@@ -244,10 +362,12 @@ namespace noisepp
 					mOctaves[o].spectralWeight = pow(sw_freq, -exponent);
 					mOctaves[o].scale = scale;
 					mOctaves[o].seed = seed;
+					mOctaves[o].lattice = -1;
 
 					scale *= lacunarity;
 					sw_freq *= lacunarity;
 				}
+				calculateMeans ();
 			}
 			virtual ~RidgedMultiElement3D ()
 			{
@@ -265,7 +385,7 @@ namespace noisepp
 					const Real nx = Math::MakeInt32Range (x * mOctaves[o].scale);
 					const Real ny = Math::MakeInt32Range (y * mOctaves[o].scale);
 					const Real nz = Math::MakeInt32Range (z * mOctaves[o].scale);
-					signal = calculateGradient(nx, ny, nz, mOctaves[o].seed);
+					signal = calculateOctave (mOctaves[o], nx, ny, nz, cache);
 					signal = mOffset - std::fabs(signal);
 					signal *= signal;
 					signal *= weight;
@@ -280,6 +400,193 @@ namespace noisepp
 
 				return (value * Real(1.25)) - Real(1.0);
 			}
+			/// The first octave which isn't resolved at the spacing and all the following ones are replaced by their average.
+			virtual void getValues (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Cache *cache, Real spacing=0.0) const
+			{
+				if (!count)
+					return;
+				std::vector<Real> buffer(count*4);
+				Real *nx = &buffer[0];
+				Real *ny = nx + count;
+				Real *nz = ny + count;
+				Real *octaveBuffer = nz + count;
+				std::vector<Real> weights(count, Real(1.0));
+				std::fill (values, values+count, Real(0.0));
+
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					const Octave &octave = mOctaves[o];
+					if (!Generator3D::isResolved (octave.scale, spacing))
+					{
+						for (size_t i=0;i<count;++i)
+						{
+							values[i] += octave.tailMean;
+						}
+						break;
+					}
+					for (size_t i=0;i<count;++i)
+					{
+						nx[i] = Math::MakeInt32Range (x[i] * octave.scale);
+						ny[i] = Math::MakeInt32Range (y[i] * octave.scale);
+						nz[i] = Math::MakeInt32Range (z[i] * octave.scale);
+					}
+					const Real *noise = calculateOctaveBatch (octave, count, nx, ny, nz, octaveBuffer, cache);
+					for (size_t i=0;i<count;++i)
+					{
+						Real signal = noise[i];
+						signal = mOffset - std::fabs(signal);
+						signal *= signal;
+						signal *= weights[i];
+						Real weight = signal * mGain;
+						if (weight > Real(1.0))
+							weight = Real(1.0);
+						if (weight < Real(-1.0))
+							weight = Real(-1.0);
+						weights[i] = weight;
+
+						values[i] += signal * octave.spectralWeight;
+					}
+				}
+
+				for (size_t i=0;i<count;++i)
+				{
+					values[i] = (values[i] * Real(1.25)) - Real(1.0);
+				}
+			}
+			/// Replaces the same octaves by their average as getValues(), they don't change the derivatives.
+			/// The weight of an octave depends on the previous one, so its derivative is carried along.
+			virtual bool getDerivatives (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Cache *cache, Real spacing=0.0) const
+			{
+				if (!count)
+					return true;
+				std::vector<Real> buffer(count*7);
+				Real *nx = &buffer[0];
+				Real *ny = nx + count;
+				Real *nz = ny + count;
+				Real *octaveBuffer = nz + count;
+				std::vector<Real> weights(count, Real(1.0));
+				std::vector<Real> weightDerivatives(count*3, Real(0.0));
+				Real *wdx = &weightDerivatives[0];
+				Real *wdy = wdx + count;
+				Real *wdz = wdy + count;
+				std::fill (values, values+count, Real(0.0));
+				std::fill (dx, dx+count, Real(0.0));
+				std::fill (dy, dy+count, Real(0.0));
+				std::fill (dz, dz+count, Real(0.0));
+
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					const Octave &octave = mOctaves[o];
+					if (!Generator3D::isResolved (octave.scale, spacing))
+					{
+						for (size_t i=0;i<count;++i)
+						{
+							values[i] += octave.tailMean;
+						}
+						break;
+					}
+					for (size_t i=0;i<count;++i)
+					{
+						nx[i] = Math::MakeInt32Range (x[i] * octave.scale);
+						ny[i] = Math::MakeInt32Range (y[i] * octave.scale);
+						nz[i] = Math::MakeInt32Range (z[i] * octave.scale);
+					}
+					const Real *noise = calculateOctaveDerivatives (octave, count, nx, ny, nz, octaveBuffer, cache);
+					const Real *ndx = noise + count;
+					const Real *ndy = ndx + count;
+					const Real *ndz = ndy + count;
+					for (size_t i=0;i<count;++i)
+					{
+						// signal = (offset - |noise|)^2 * weight
+						const Real ridge = mOffset - std::fabs(noise[i]);
+						const Real ridgeFactor = (noise[i] < Real(0.0) ? Real(2.0) : Real(-2.0)) * ridge * weights[i] * octave.scale;
+						Real signal = ridge * ridge;
+						const Real signalDx = ndx[i] * ridgeFactor + signal * wdx[i];
+						const Real signalDy = ndy[i] * ridgeFactor + signal * wdy[i];
+						const Real signalDz = ndz[i] * ridgeFactor + signal * wdz[i];
+						signal *= weights[i];
+						Real weight = signal * mGain;
+						if (weight > Real(1.0) || weight < Real(-1.0))
+						{
+							weights[i] = (weight > Real(1.0)) ? Real(1.0) : Real(-1.0);
+							wdx[i] = wdy[i] = wdz[i] = 0.0;
+						}
+						else
+						{
+							weights[i] = weight;
+							wdx[i] = signalDx * mGain;
+							wdy[i] = signalDy * mGain;
+							wdz[i] = signalDz * mGain;
+						}
+
+						values[i] += signal * octave.spectralWeight;
+						dx[i] += signalDx * octave.spectralWeight;
+						dy[i] += signalDy * octave.spectralWeight;
+						dz[i] += signalDz * octave.spectralWeight;
+					}
+				}
+
+				for (size_t i=0;i<count;++i)
+				{
+					values[i] = (values[i] * Real(1.25)) - Real(1.0);
+					dx[i] *= Real(1.25);
+					dy[i] *= Real(1.25);
+					dz[i] *= Real(1.25);
+				}
+				return true;
+			}
+			/// @copydoc noisepp::PipelineElement3D::getLatticeOctaves()
+			virtual void getLatticeOctaves (std::vector<LatticeOctave3D> &octaves)
+			{
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					LatticeOctave3D octave;
+					octave.frequency[0] = octave.frequency[1] = octave.frequency[2] = mOctaves[o].scale;
+					octave.seed = mOctaves[o].seed;
+					octave.quality = mQuality;
+					octave.noiseScale = mScale;
+					octave.precision = mPrecision;
+					octave.lattice = &mOctaves[o].lattice;
+					octaves.push_back (octave);
+				}
+			}
+			virtual bool getBounds (const Box3D &box, Real &lower, Real &upper, Real spacing=0.0) const
+			{
+				Real weightLower = 1.0, weightUpper = 1.0;
+				lower = upper = 0.0;
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					if (!Generator3D::isResolved (mOctaves[o].scale, spacing))
+					{
+						lower += mOctaves[o].tailMean;
+						upper += mOctaves[o].tailMean;
+						break;
+					}
+					Real signalLower, signalUpper;
+					calculateGradientBounds (box, mOctaves[o], signalLower, signalUpper);
+					Math::AbsBounds (signalLower, signalUpper);
+					const Real offsetLower = mOffset - signalUpper;
+					const Real offsetUpper = mOffset - signalLower;
+					signalLower = offsetLower;
+					signalUpper = offsetUpper;
+					Math::AbsBounds (signalLower, signalUpper);
+					signalLower *= signalLower;
+					signalUpper *= signalUpper;
+					Math::MulBounds (signalLower, signalUpper, weightLower, weightUpper, signalLower, signalUpper);
+					weightLower = signalLower;
+					weightUpper = signalUpper;
+					Math::ScaleBounds (mGain, weightLower, weightUpper);
+					weightLower = std::min (std::max (weightLower, Real(-1.0)), Real(1.0));
+					weightUpper = std::min (std::max (weightUpper, Real(-1.0)), Real(1.0));
+
+					Math::ScaleBounds (mOctaves[o].spectralWeight, signalLower, signalUpper);
+					lower += signalLower;
+					upper += signalUpper;
+				}
+				lower = (lower * Real(1.25)) - Real(1.0);
+				upper = (upper * Real(1.25)) - Real(1.0);
+				return true;
+			}
 	};
 
 	/** Module for generating ridged-multifractal noise.
@@ -415,7 +722,7 @@ namespace noisepp
 			/// @copydoc noisepp::Module::addToPipeline()
 			ElementID addToPipeline (Pipeline3D *pipe) const
 			{
-				return pipe->addElement (this, new RidgedMultiElement3D(mOctaveCount, mFrequency, mLacunarity, mExponent, mOffset, mGain, mSeed+pipe->getSeed(), mQuality, mScale));
+				return pipe->addElement (this, new RidgedMultiElement3D(mOctaveCount, mFrequency, mLacunarity, mExponent, mOffset, mGain, mSeed+pipe->getSeed(), mQuality, mScale, pipe->getPrecision()));
 			}
 			/// @copydoc noisepp::Module::getType()
 			ModuleTypeId getType() const { return MODULE_RIDGEDMULTI; }
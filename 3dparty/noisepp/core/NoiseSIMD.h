@@ -0,0 +1,82 @@
+// Noise++ Library
+// Copyright (c) 2008, Urs C. Hanselmann
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above copyright notice,
+//      this list of conditions and the following disclaimer in the documentation
+//      and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef NOISEPP_SIMD_H
+#define NOISEPP_SIMD_H
+
+#include "NoisePrerequisites.h"
+
+#if NOISEPP_ENABLE_SIMD && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#	define NOISEPP_SIMD_X86 1
+#	include <immintrin.h>
+#	define NOISEPP_SIMD_SSE41 __attribute__((target("sse4.1")))
+#	define NOISEPP_SIMD_AVX2 __attribute__((target("avx2")))
+#	define NOISEPP_SIMD_SSE41_INLINE __attribute__((always_inline, target("sse4.1"))) inline
+#	define NOISEPP_SIMD_AVX2_INLINE __attribute__((always_inline, target("avx2"))) inline
+#else
+#	define NOISEPP_SIMD_X86 0
+#endif
+
+namespace noisepp
+{
+	enum { SIMD_NONE=0, SIMD_SSE41=1, SIMD_AVX2=2 };
+
+	/// Runtime selection of the SIMD noise kernels.
+	class SIMD
+	{
+		private:
+			static int detectLevel ()
+			{
+#if NOISEPP_SIMD_X86
+				__builtin_cpu_init ();
+				if (__builtin_cpu_supports ("avx2"))
+					return SIMD_AVX2;
+				if (__builtin_cpu_supports ("sse4.1"))
+					return SIMD_SSE41;
+#endif
+				return SIMD_NONE;
+			}
+			static int &levelRef ()
+			{
+				static int level = detectLevel ();
+				return level;
+			}
+
+		public:
+			/// Returns the instruction set used by the batch noise functions.
+			static NOISEPP_INLINE int getLevel ()
+			{
+				return levelRef ();
+			}
+			/// Restricts the instruction set used by the batch noise functions, i.e. for benchmarking the fallback.
+			/// Levels the CPU doesn't support are ignored.
+			static void setLevel (int level)
+			{
+				levelRef () = std::min (level, detectLevel ());
+			}
+	};
+};
+
+#endif
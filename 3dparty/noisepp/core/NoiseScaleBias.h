@@ -28,6 +28,7 @@
 
 #include "NoisePipeline.h"
 #include "NoiseModule.h"
+#include "NoiseMath.h"
 
 namespace noisepp
 {
@@ -89,6 +90,36 @@ namespace noisepp
 				value = getElementValue (mElementPtr, mElement, x, y, z, cache);
 				return value * mScale + mBias;
 			}
+			virtual void getValues (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Cache *cache, Real spacing=0.0) const
+			{
+				getElementValues (mElementPtr, count, x, y, z, values, cache, spacing);
+				for (size_t i=0;i<count;++i)
+				{
+					values[i] = values[i] * mScale + mBias;
+				}
+			}
+			virtual bool getDerivatives (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Cache *cache, Real spacing=0.0) const
+			{
+				if (!getElementDerivatives (mElementPtr, count, x, y, z, values, dx, dy, dz, cache, spacing))
+					return false;
+				for (size_t i=0;i<count;++i)
+				{
+					values[i] = values[i] * mScale + mBias;
+					dx[i] *= mScale;
+					dy[i] *= mScale;
+					dz[i] *= mScale;
+				}
+				return true;
+			}
+			virtual bool getBounds (const Box3D &box, Real &lower, Real &upper, Real spacing=0.0) const
+			{
+				if (!mElementPtr->getBounds (box, lower, upper, spacing))
+					return false;
+				Math::ScaleBounds (mScale, lower, upper);
+				lower += mBias;
+				upper += mBias;
+				return true;
+			}
 	};
 
 	/** Module for scaling with bias.
@@ -147,6 +178,12 @@ namespace noisepp
 			}
 			/// @copydoc noisepp::Module::getType()
 			ModuleTypeId getType() const { return MODULE_SCALEBIAS; }
+			/// @copydoc noisepp::Module::getSourceScale()
+			virtual bool getSourceScale (Real *scale) const
+			{
+				scale[0] = scale[1] = scale[2] = 1.0;
+				return true;
+			}
 #if NOISEPP_ENABLE_UTILS
 			/// @copydoc noisepp::Module::write()
 			virtual void write (utils::OutStream &stream) const;
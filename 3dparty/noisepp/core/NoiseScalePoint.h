@@ -46,7 +46,7 @@ namespace noisepp
 			}
 			virtual Real getValue (Real x, Cache *cache) const
 			{
-				return getElementValue (mElementPtr, mElement, x*mScaleX, cache);
+				return getTransformedElementValue (mElementPtr, mElement, x*mScaleX, cache);
 			}
 
 	};
@@ -67,7 +67,7 @@ namespace noisepp
 			}
 			virtual Real getValue (Real x, Real y, Cache *cache) const
 			{
-				return getElementValue (mElementPtr, mElement, x*mScaleX, y*mScaleY, cache);
+				return getTransformedElementValue (mElementPtr, mElement, x*mScaleX, y*mScaleY, cache);
 			}
 
 	};
@@ -81,6 +81,12 @@ namespace noisepp
 			Real mScaleY;
 			Real mScaleZ;
 
+			/// Returns the factor the distance between points is scaled by, the largest one of the three axes.
+			Real getSpacingScale () const
+			{
+				return std::max (std::fabs (mScaleX), std::max (std::fabs (mScaleY), std::fabs (mScaleZ)));
+			}
+
 		public:
 			ScalePointElement3D (const Pipeline3D *pipe, ElementID element, Real scaleX, Real scaleY, Real scaleZ) :
 				mElement(element), mScaleX(scaleX), mScaleY(scaleY), mScaleZ(scaleZ)
@@ -89,7 +95,60 @@ namespace noisepp
 			}
 			virtual Real getValue (Real x, Real y, Real z, Cache *cache) const
 			{
-				return getElementValue (mElementPtr, mElement, x*mScaleX, y*mScaleY, z*mScaleZ, cache);
+				return getTransformedElementValue (mElementPtr, mElement, x*mScaleX, y*mScaleY, z*mScaleZ, cache);
+			}
+			virtual void getValues (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Cache *cache, Real spacing=0.0) const
+			{
+				if (!count)
+					return;
+				std::vector<Real> coords(count * 3);
+				Real *sx = &coords[0];
+				Real *sy = sx + count;
+				Real *sz = sy + count;
+				for (size_t i=0;i<count;++i)
+				{
+					sx[i] = x[i] * mScaleX;
+					sy[i] = y[i] * mScaleY;
+					sz[i] = z[i] * mScaleZ;
+				}
+				getElementValues (mElementPtr, count, sx, sy, sz, values, cache, spacing * getSpacingScale ());
+			}
+			virtual bool getDerivatives (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Cache *cache, Real spacing=0.0) const
+			{
+				if (!count)
+					return true;
+				std::vector<Real> coords(count * 3);
+				Real *sx = &coords[0];
+				Real *sy = sx + count;
+				Real *sz = sy + count;
+				for (size_t i=0;i<count;++i)
+				{
+					sx[i] = x[i] * mScaleX;
+					sy[i] = y[i] * mScaleY;
+					sz[i] = z[i] * mScaleZ;
+				}
+				if (!getElementDerivatives (mElementPtr, count, sx, sy, sz, values, dx, dy, dz, cache, spacing * getSpacingScale ()))
+					return false;
+				for (size_t i=0;i<count;++i)
+				{
+					dx[i] *= mScaleX;
+					dy[i] *= mScaleY;
+					dz[i] *= mScaleZ;
+				}
+				return true;
+			}
+			virtual bool getBounds (const Box3D &box, Real &lower, Real &upper, Real spacing=0.0) const
+			{
+				const Real scale[3] = { mScaleX, mScaleY, mScaleZ };
+				Box3D scaledBox;
+				for (int d=0;d<3;++d)
+				{
+					scaledBox.min[d] = box.min[d] * scale[d];
+					scaledBox.max[d] = box.max[d] * scale[d];
+					if (scaledBox.min[d] > scaledBox.max[d])
+						std::swap (scaledBox.min[d], scaledBox.max[d]);
+				}
+				return mElementPtr->getBounds (scaledBox, lower, upper, spacing * getSpacingScale ());
 			}
 
 	};
@@ -162,6 +221,14 @@ namespace noisepp
 			}
 			/// @copydoc noisepp::Module::getType()
 			ModuleTypeId getType() const { return MODULE_SCALEPOINT; }
+			/// @copydoc noisepp::Module::getSourceScale()
+			virtual bool getSourceScale (Real *scale) const
+			{
+				scale[0] = mScaleX;
+				scale[1] = mScaleY;
+				scale[2] = mScaleZ;
+				return true;
+			}
 #if NOISEPP_ENABLE_UTILS
 			/// @copydoc noisepp::Module::write()
 			virtual void write (utils::OutStream &stream) const;
@@ -195,6 +195,129 @@ namespace noisepp
 			Real mUpperBoundPlusFalloff, mUpperBoundMinusFalloff;
 			Real mEdgeFalloff, mTwoEdgeFalloff;
 
+			/// What a point of a batch takes from the source elements.
+			enum { SELECT_LEFT=0, SELECT_LEFT_RIGHT=1, SELECT_RIGHT=2, SELECT_RIGHT_LEFT=3 };
+
+			/// Batches with fewer points don't check the bounds of the control element.
+			enum { BOUNDS_MIN_COUNT=64 };
+
+			/// Returns SELECT_LEFT or SELECT_RIGHT if all control values in [lower, upper] select the same source element, SELECT_LEFT_RIGHT otherwise.
+			int getBoundsMode (Real lower, Real upper) const
+			{
+				if (mEdgeFalloff > 0.0)
+				{
+					if (upper < mLowerBoundMinusFalloff || lower >= mUpperBoundPlusFalloff)
+						return SELECT_LEFT;
+					if (lower >= mLowerBoundPlusFalloff && upper < mUpperBoundMinusFalloff)
+						return SELECT_RIGHT;
+				}
+				else
+				{
+					if (upper < mLowerBound || lower > mUpperBound)
+						return SELECT_LEFT;
+					if (lower >= mLowerBound && upper <= mUpperBound)
+						return SELECT_RIGHT;
+				}
+				return SELECT_LEFT_RIGHT;
+			}
+
+			/// Returns what a point with the specified control value takes from the source elements.
+			int getMode (Real controlValue) const
+			{
+				if (mEdgeFalloff > 0.0)
+				{
+					if (controlValue < mLowerBoundMinusFalloff)
+						return SELECT_LEFT;
+					else if (controlValue < mLowerBoundPlusFalloff)
+						return SELECT_LEFT_RIGHT;
+					else if (controlValue < mUpperBoundMinusFalloff)
+						return SELECT_RIGHT;
+					else if (controlValue < mUpperBoundPlusFalloff)
+						return SELECT_RIGHT_LEFT;
+					return SELECT_LEFT;
+				}
+				if (controlValue < mLowerBound || controlValue > mUpperBound)
+					return SELECT_LEFT;
+				return SELECT_RIGHT;
+			}
+
+			/// Blends the value and the derivatives of point i of the planes from and to, which hold { values, dx, dy, dz }.
+			/// a is the position of the control value in the falloff. The weight of the blend depends on the control value,
+			/// so its derivatives add to the ones of the sources.
+			NOISEPP_INLINE void blendDerivatives (Real *const *from, Real *const *to, Real *const *control, size_t i, Real a, Real *const *result) const
+			{
+				const Real alpha = Math::CubicCurve3 (a);
+				const Real alphaDerivative = Math::CubicCurve3Derivative (a) / mTwoEdgeFalloff;
+				const Real difference = to[0][i] - from[0][i];
+				result[0][i] = Math::InterpLinear (from[0][i], to[0][i], alpha);
+				for (int k=1;k<4;++k)
+				{
+					result[k][i] = Math::InterpLinear (from[k][i], to[k][i], alpha) + alphaDerivative * control[k][i] * difference;
+				}
+			}
+
+			/// Calculates the values and derivatives of the points of a batch listed in indices, like getSubsetValues().
+			/// derivatives holds the buffers of the values and the derivatives in x, y and z.
+			static bool getSubsetDerivatives (const PipelineElement3D *elementPtr, const std::vector<size_t> &indices, size_t count, const Real *x, const Real *y, const Real *z, Real *const *derivatives, Cache *cache, Real spacing)
+			{
+				const size_t n = indices.size ();
+				if (n == 0)
+					return true;
+				if (n == count)
+					return getElementDerivatives (elementPtr, count, x, y, z, derivatives[0], derivatives[1], derivatives[2], derivatives[3], cache, spacing);
+				std::vector<Real> buffer(n * 7);
+				Real *sx = &buffer[0];
+				Real *sy = sx + n;
+				Real *sz = sy + n;
+				Real *sv = sz + n;
+				for (size_t i=0;i<n;++i)
+				{
+					sx[i] = x[indices[i]];
+					sy[i] = y[indices[i]];
+					sz[i] = z[indices[i]];
+				}
+				if (!getElementDerivatives (elementPtr, n, sx, sy, sz, sv, sv + n, sv + 2*n, sv + 3*n, cache, spacing))
+					return false;
+				for (int k=0;k<4;++k)
+				{
+					for (size_t i=0;i<n;++i)
+					{
+						derivatives[k][indices[i]] = sv[k*n + i];
+					}
+				}
+				return true;
+			}
+
+			/// Calculates the values of the points of a batch listed in indices.
+			/// The values are written to values at the original positions of the points.
+			static void getSubsetValues (const PipelineElement3D *elementPtr, const std::vector<size_t> &indices, size_t count, const Real *x, const Real *y, const Real *z, Real *values, Cache *cache, Real spacing)
+			{
+				const size_t n = indices.size ();
+				if (n == 0)
+					return;
+				if (n == count)
+				{
+					getElementValues (elementPtr, count, x, y, z, values, cache, spacing);
+					return;
+				}
+				std::vector<Real> buffer(n * 4);
+				Real *sx = &buffer[0];
+				Real *sy = sx + n;
+				Real *sz = sy + n;
+				Real *sv = sz + n;
+				for (size_t i=0;i<n;++i)
+				{
+					sx[i] = x[indices[i]];
+					sy[i] = y[indices[i]];
+					sz[i] = z[indices[i]];
+				}
+				getElementValues (elementPtr, n, sx, sy, sz, sv, cache, spacing);
+				for (size_t i=0;i<n;++i)
+				{
+					values[indices[i]] = sv[i];
+				}
+			}
+
 		public:
 			SelectElement3D (const Pipeline3D *pipe, ElementID left, ElementID right, ElementID control, Real lowerBound, Real upperBound, Real edgeFalloff) : mLeft(left), mRight(right), mControl(control), mLowerBound(lowerBound), mUpperBound(upperBound), mEdgeFalloff(edgeFalloff)
 			{
@@ -257,6 +380,162 @@ namespace noisepp
 					}
 				}
 			}
+			/// Only the source elements a point actually selects are evaluated for it.
+			virtual void getValues (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Cache *cache, Real spacing=0.0) const
+			{
+				if (!count)
+					return;
+
+				// if the bounds of the control element select one source for the whole batch the control isn't calculated at all
+				if (count >= BOUNDS_MIN_COUNT)
+				{
+					Box3D box;
+					box.set (count, x, y, z);
+					Real controlLower, controlUpper;
+					if (mControlPtr->getBounds (box, controlLower, controlUpper, spacing))
+					{
+						const int mode = getBoundsMode (controlLower, controlUpper);
+						if (mode == SELECT_LEFT)
+						{
+							getElementValues (mLeftPtr, count, x, y, z, values, cache, spacing);
+							return;
+						}
+						else if (mode == SELECT_RIGHT)
+						{
+							getElementValues (mRightPtr, count, x, y, z, values, cache, spacing);
+							return;
+						}
+					}
+				}
+
+				std::vector<Real> buffer(count * 3);
+				Real *controlValues = &buffer[0];
+				Real *leftValues = controlValues + count;
+				Real *rightValues = leftValues + count;
+				std::vector<unsigned char> modes(count);
+				std::vector<size_t> leftIndices, rightIndices;
+
+				getElementValues (mControlPtr, count, x, y, z, controlValues, cache, spacing);
+				for (size_t i=0;i<count;++i)
+				{
+					const unsigned char mode = getMode (controlValues[i]);
+					modes[i] = mode;
+					if (mode != SELECT_RIGHT)
+						leftIndices.push_back (i);
+					if (mode != SELECT_LEFT)
+						rightIndices.push_back (i);
+				}
+
+				getSubsetValues (mLeftPtr, leftIndices, count, x, y, z, leftValues, cache, spacing);
+				getSubsetValues (mRightPtr, rightIndices, count, x, y, z, rightValues, cache, spacing);
+
+				for (size_t i=0;i<count;++i)
+				{
+					Real alpha;
+					switch (modes[i])
+					{
+						case SELECT_LEFT:
+							values[i] = leftValues[i];
+							break;
+						case SELECT_LEFT_RIGHT:
+							alpha = Math::CubicCurve3 ((controlValues[i] - mLowerBoundMinusFalloff) / mTwoEdgeFalloff);
+							values[i] = Math::InterpLinear (leftValues[i], rightValues[i], alpha);
+							break;
+						case SELECT_RIGHT:
+							values[i] = rightValues[i];
+							break;
+						default:
+							alpha = Math::CubicCurve3 ((controlValues[i] - mUpperBoundMinusFalloff) / mTwoEdgeFalloff);
+							values[i] = Math::InterpLinear (rightValues[i], leftValues[i], alpha);
+							break;
+					}
+				}
+			}
+			/// Only the source elements a point actually selects are evaluated for it, as in getValues().
+			virtual bool getDerivatives (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Cache *cache, Real spacing=0.0) const
+			{
+				if (!count)
+					return true;
+
+				if (count >= BOUNDS_MIN_COUNT)
+				{
+					Box3D box;
+					box.set (count, x, y, z);
+					Real controlLower, controlUpper;
+					if (mControlPtr->getBounds (box, controlLower, controlUpper, spacing))
+					{
+						const int mode = getBoundsMode (controlLower, controlUpper);
+						if (mode == SELECT_LEFT)
+							return getElementDerivatives (mLeftPtr, count, x, y, z, values, dx, dy, dz, cache, spacing);
+						else if (mode == SELECT_RIGHT)
+							return getElementDerivatives (mRightPtr, count, x, y, z, values, dx, dy, dz, cache, spacing);
+					}
+				}
+
+				std::vector<Real> buffer(count * 12);
+				Real *const control[4] = { &buffer[0], &buffer[count], &buffer[2*count], &buffer[3*count] };
+				Real *const left[4] = { &buffer[4*count], &buffer[5*count], &buffer[6*count], &buffer[7*count] };
+				Real *const right[4] = { &buffer[8*count], &buffer[9*count], &buffer[10*count], &buffer[11*count] };
+				Real *const result[4] = { values, dx, dy, dz };
+				std::vector<unsigned char> modes(count);
+				std::vector<size_t> leftIndices, rightIndices;
+
+				if (!getElementDerivatives (mControlPtr, count, x, y, z, control[0], control[1], control[2], control[3], cache, spacing))
+					return false;
+				for (size_t i=0;i<count;++i)
+				{
+					const unsigned char mode = getMode (control[0][i]);
+					modes[i] = mode;
+					if (mode != SELECT_RIGHT)
+						leftIndices.push_back (i);
+					if (mode != SELECT_LEFT)
+						rightIndices.push_back (i);
+				}
+
+				if (!getSubsetDerivatives (mLeftPtr, leftIndices, count, x, y, z, left, cache, spacing) ||
+					!getSubsetDerivatives (mRightPtr, rightIndices, count, x, y, z, right, cache, spacing))
+					return false;
+
+				for (size_t i=0;i<count;++i)
+				{
+					switch (modes[i])
+					{
+						case SELECT_LEFT:
+							for (int k=0;k<4;++k)
+								result[k][i] = left[k][i];
+							break;
+						case SELECT_LEFT_RIGHT:
+							blendDerivatives (left, right, control, i, (control[0][i] - mLowerBoundMinusFalloff) / mTwoEdgeFalloff, result);
+							break;
+						case SELECT_RIGHT:
+							for (int k=0;k<4;++k)
+								result[k][i] = right[k][i];
+							break;
+						default:
+							blendDerivatives (right, left, control, i, (control[0][i] - mUpperBoundMinusFalloff) / mTwoEdgeFalloff, result);
+							break;
+					}
+				}
+				return true;
+			}
+			virtual bool getBounds (const Box3D &box, Real &lower, Real &upper, Real spacing=0.0) const
+			{
+				Real controlLower, controlUpper;
+				int mode = SELECT_LEFT_RIGHT;
+				if (mControlPtr->getBounds (box, controlLower, controlUpper, spacing))
+					mode = getBoundsMode (controlLower, controlUpper);
+				if (mode == SELECT_LEFT)
+					return mLeftPtr->getBounds (box, lower, upper, spacing);
+				else if (mode == SELECT_RIGHT)
+					return mRightPtr->getBounds (box, lower, upper, spacing);
+
+				Real leftLower, leftUpper, rightLower, rightUpper;
+				if (!mLeftPtr->getBounds (box, leftLower, leftUpper, spacing) || !mRightPtr->getBounds (box, rightLower, rightUpper, spacing))
+					return false;
+				lower = std::min (leftLower, rightLower);
+				upper = std::max (leftUpper, rightUpper);
+				return true;
+			}
 	};
 
 	/** Select module.
@@ -336,6 +615,12 @@ namespace noisepp
 			}
 			/// @copydoc noisepp::Module::getType()
 			ModuleTypeId getType() const { return MODULE_SELECT; }
+			/// @copydoc noisepp::Module::getSourceScale()
+			virtual bool getSourceScale (Real *scale) const
+			{
+				scale[0] = scale[1] = scale[2] = 1.0;
+				return true;
+			}
 #if NOISEPP_ENABLE_UTILS
 			/// @copydoc noisepp::Module::write()
 			virtual void write (utils::OutStream &stream) const;
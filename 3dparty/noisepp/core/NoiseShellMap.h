@@ -0,0 +1,662 @@
+// Noise++ Library
+// Copyright (c) 2008, Urs C. Hanselmann
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above copyright notice,
+//      this list of conditions and the following disclaimer in the documentation
+//      and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef NOISEPP_SHELLMAP_H
+#define NOISEPP_SHELLMAP_H
+
+#include "NoisePerlin.h"
+
+namespace noisepp
+{
+	/** The lowest octaves of a PerlinElement3D, baked on a sphere.
+		For points on a sphere the slow octaves can be sampled from a table instead of calculated for every point.
+		The table is a cube map: every face of the cube around the sphere is a grid of samples, and a point
+		is projected on the face its direction points to. Every sample holds the value of the octaves and
+		its derivatives, both are interpolated bilinearly, so the map only approximates the octaves.
+
+		There is one level per octave which is baked: level n holds the sum of the first n octaves,
+		with a grid just fine enough for the n-th one. So the levels use about a third more memory than
+		the last one alone, and a batch can take as many octaves from the map as its spacing resolves,
+		without adding octaves the element would skip. See getLevel().
+
+		The map is only valid for the element and the radius it was built for. Points off the sphere
+		get the value of their projection on it.
+
+		The levels which are too fine to bake for the whole sphere can be baked for a region, see ShellPatch.
+	*/
+	class ShellMap
+	{
+		private:
+			struct Level
+			{
+				/// The number of samples along the edges of the faces.
+				size_t size;
+				/// The distance between the samples at the centre of the faces, the largest one.
+				Real spacing;
+				/// Value and derivatives of every sample, face by face and row by row.
+				std::vector<float> samples;
+			};
+
+			/// Bakes some rows of a face of a level.
+			class BuildJob : public PipelineJob
+			{
+				private:
+					const ShellMap *mMap;
+					Level *mLevel;
+					size_t mOctaves, mFace, mRow, mRows;
+
+				public:
+					BuildJob (const ShellMap *map, Level *level, size_t octaves, size_t face, size_t row, size_t rows) :
+						mMap(map), mLevel(level), mOctaves(octaves), mFace(face), mRow(row), mRows(rows)
+					{}
+					/// @copydoc noisepp::PipelineJob::execute()
+					void execute (Cache *cache)
+					{
+						const size_t size = mLevel->size;
+						const size_t count = mRows * size;
+						std::vector<Real> buffer(count * 7);
+						Real *x = &buffer[0];
+						Real *y = x + count;
+						Real *z = y + count;
+						Real *values = z + count;
+						Real *dx = values + count;
+						Real *dy = dx + count;
+						Real *dz = dy + count;
+						for (size_t row=0;row<mRows;++row)
+						{
+							for (size_t column=0;column<size;++column)
+							{
+								const size_t i = row * size + column;
+								Real point[3];
+								mMap->getSamplePoint (mFace, column, mRow + row, size, point);
+								x[i] = point[0];
+								y[i] = point[1];
+								z[i] = point[2];
+							}
+						}
+						mMap->mElement->getOctaveDerivatives (0, mOctaves, count, x, y, z, values, dx, dy, dz, cache);
+						float *samples = &mLevel->samples[(mFace * size + mRow) * size * 4];
+						for (size_t i=0;i<count;++i)
+						{
+							samples[i*4] = float(values[i]);
+							samples[i*4+1] = float(dx[i]);
+							samples[i*4+2] = float(dy[i]);
+							samples[i*4+3] = float(dz[i]);
+						}
+					}
+			};
+
+			const PerlinElement3D *mElement;
+			Real mRadius;
+			Real mSamplesPerWave;
+			std::vector<Level> mLevels;
+
+			friend class ShellPatch;
+
+			/// Face f is the one around the axis f/2, on its positive side if f is even.
+			/// The samples of a face are the point along the axis plus u times aAxis plus v times bAxis.
+			static NOISEPP_INLINE void getFaceAxes (size_t face, size_t &axis, size_t &aAxis, size_t &bAxis, Real &sign)
+			{
+				axis = face / 2;
+				aAxis = (axis + 1) % 3;
+				bAxis = (axis + 2) % 3;
+				sign = (face & 1) ? Real(-1.0) : Real(1.0);
+			}
+			/// Returns the coordinate of a row or column of samples on the face, in [-1, 1].
+			static NOISEPP_INLINE Real getFaceCoordinate (size_t i, size_t size)
+			{
+				return Real(-1.0) + Real(2.0) * Real(i) / Real(size - 1);
+			}
+			/// Projects a point on the face its direction points to.
+			/// @param size The number of samples along the edges of the faces.
+			/// @param u Receives the column of the projection, in samples.
+			/// @param v Receives the row of the projection, in samples.
+			/// @return The face.
+			static NOISEPP_INLINE size_t project (Real x, Real y, Real z, size_t size, Real &u, Real &v)
+			{
+				const Real p[3] = { x, y, z };
+				const Real ax = std::fabs (x), ay = std::fabs (y), az = std::fabs (z);
+				const size_t axis = (ax >= ay && ax >= az) ? 0 : (ay >= az ? 1 : 2);
+				const Real major = std::max (ax, std::max (ay, az));
+				const Real inverse = major > Real(0.0) ? Real(1.0) / major : Real(0.0);
+				const Real scale = Real(0.5) * Real(size - 1);
+				u = (p[(axis + 1) % 3] * inverse + Real(1.0)) * scale;
+				v = (p[(axis + 2) % 3] * inverse + Real(1.0)) * scale;
+				return axis * 2 + (p[axis] < Real(0.0) ? 1 : 0);
+			}
+			/// Finds the four samples around a point and the weights for interpolating between them.
+			static NOISEPP_INLINE const float *findSamples (const Level &level, Real x, Real y, Real z, Real &s, Real &t)
+			{
+				const size_t size = level.size;
+				Real u, v;
+				const size_t face = project (x, y, z, size, u, v);
+				const size_t column = std::min (size_t(std::max (u, Real(0.0))), size - 2);
+				const size_t row = std::min (size_t(std::max (v, Real(0.0))), size - 2);
+				s = u - Real(column);
+				t = v - Real(row);
+				return &level.samples[((face * size + row) * size + column) * 4];
+			}
+			/// Returns the point on the sphere of a sample of a face.
+			NOISEPP_INLINE void getSamplePoint (size_t face, size_t column, size_t row, size_t size, Real *point) const
+			{
+				size_t axis, aAxis, bAxis;
+				Real sign;
+				getFaceAxes (face, axis, aAxis, bAxis, sign);
+				const Real u = getFaceCoordinate (column, size);
+				const Real v = getFaceCoordinate (row, size);
+				const Real scale = mRadius / std::sqrt (Real(1.0) + u*u + v*v);
+				point[axis] = sign * scale;
+				point[aAxis] = u * scale;
+				point[bAxis] = v * scale;
+			}
+			/// Returns the samples along the edges of the faces and their spacing for the level whose highest octave is the specified one.
+			void getLevelGeometry (size_t octave, size_t &size, Real &spacing) const
+			{
+				// the faces span [-radius, radius] on the plane touching the sphere at their centre
+				const Real wave = Real(1.0) / std::fabs (mElement->getOctaveFrequency (octave));
+				size = std::max (size_t(std::ceil (Real(2.0) * mRadius * mSamplesPerWave / wave)) + 1, size_t(2));
+				spacing = Real(2.0) * mRadius / Real(size - 1);
+			}
+			/// Returns the largest distance of the points of the box from the sphere.
+			Real getSphereDistance (const Box3D &box) const
+			{
+				Real nearest = 0.0, farthest = 0.0;
+				for (int d=0;d<3;++d)
+				{
+					const Real closest = box.min[d] > 0.0 ? box.min[d] : (box.max[d] < 0.0 ? -box.max[d] : Real(0.0));
+					const Real furthest = std::max (std::fabs (box.min[d]), std::fabs (box.max[d]));
+					nearest += closest * closest;
+					farthest += furthest * furthest;
+				}
+				return std::max (std::max (mRadius - std::sqrt (nearest), std::sqrt (farthest) - mRadius), Real(0.0));
+			}
+
+		public:
+			/// Constructor. The map is empty until build() is called.
+			/// @param element The element whose octaves are baked, it must outlive the map.
+			/// @param radius The radius of the sphere, in the coordinates of the element.
+			/// @param octaves The number of octaves to bake, at most the octaves of the element.
+			/// @param samplesPerWave The number of samples per wavelength of the highest octave of each level, at the centre of the faces.
+			ShellMap (const PerlinElement3D *element, Real radius, size_t octaves, Real samplesPerWave=8.0) :
+				mElement(element), mRadius(radius), mSamplesPerWave(samplesPerWave)
+			{
+				NoiseAssert (element != NULL, element);
+				NoiseAssert (radius > 0.0, radius);
+				NoiseAssert (octaves <= element->getOctaveCount (), octaves);
+				NoiseAssert (samplesPerWave > 0.0, samplesPerWave);
+				mLevels.resize (octaves);
+				for (size_t n=0;n<octaves;++n)
+				{
+					getLevelGeometry (n, mLevels[n].size, mLevels[n].spacing);
+				}
+			}
+			/// Bakes the octaves.
+			/// The work is split in jobs of a few rows which are executed by the pipeline, so a ThreadedPipeline3D builds the map in parallel.
+			void build (Pipeline3D *pipe)
+			{
+				NoiseAssert (pipe != NULL, pipe);
+				for (size_t n=0;n<mLevels.size();++n)
+				{
+					Level &level = mLevels[n];
+					level.samples.resize (6 * level.size * level.size * 4);
+					// about 4096 samples per job
+					const size_t rowsPerJob = std::max (size_t(4096) / level.size, size_t(1));
+					for (size_t face=0;face<6;++face)
+					{
+						for (size_t row=0;row<level.size;row+=rowsPerJob)
+						{
+							pipe->addJob (new BuildJob(this, &level, n + 1, face, row, std::min (rowsPerJob, level.size - row)));
+						}
+					}
+				}
+				pipe->executeJobs ();
+			}
+			/// Returns the element whose octaves are baked.
+			const PerlinElement3D *getElement () const
+			{
+				return mElement;
+			}
+			/// Returns the radius of the sphere, in the coordinates of the element.
+			Real getRadius () const
+			{
+				return mRadius;
+			}
+			/// Returns the number of octaves which are baked.
+			size_t getOctaveCount () const
+			{
+				return mLevels.size ();
+			}
+			/// Returns the largest distance between the samples of a level, which can also be one too fine to be baked.
+			/// @param level The number of octaves of the level, from 1 to the octaves of the element.
+			Real getLevelSpacing (size_t level) const
+			{
+				NoiseAssert (level > 0 && level <= mElement->getOctaveCount (), level);
+				size_t size;
+				Real spacing;
+				getLevelGeometry (level - 1, size, spacing);
+				return spacing;
+			}
+			/// Returns the size of the samples in bytes.
+			size_t getMemoryUsage () const
+			{
+				size_t bytes = 0;
+				for (size_t n=0;n<mLevels.size();++n)
+				{
+					bytes += mLevels[n].samples.size () * sizeof(float);
+				}
+				return bytes;
+			}
+			/// Returns the number of octaves a batch with the spacing can take from the map.
+			/// These are the leading octaves which the element wouldn't skip, up to getOctaveCount().
+			size_t getLevel (Real spacing) const
+			{
+				size_t n = 0;
+				while (n < mLevels.size() && Generator3D::isResolved (mElement->getOctaveFrequency (n), spacing))
+					++n;
+				return n;
+			}
+			/// Returns the largest difference between a level and the octaves it bakes at the middle of its cells, where
+			/// the interpolation is the furthest from the samples. Since every level has the same samples per wave of
+			/// its highest octave, this is about the same share of the amplitude of that octave at every level.
+			/// @param level The number of octaves of the level, from 1 to getOctaveCount().
+			/// @param stride Only every stride-th row and column of cells of every face is checked.
+			/// @param cache The cache passed to the element.
+			Real getInterpolationError (size_t level, size_t stride, Cache *cache) const
+			{
+				NoiseAssert (level > 0 && level <= mLevels.size(), level);
+				NoiseAssert (stride > 0, stride);
+				const Level &l = mLevels[level - 1];
+				std::vector<Real> x, y, z;
+				for (size_t face=0;face<6;++face)
+				{
+					size_t axis, aAxis, bAxis;
+					Real sign;
+					getFaceAxes (face, axis, aAxis, bAxis, sign);
+					for (size_t row=0;row+1<l.size;row+=stride)
+					{
+						for (size_t column=0;column+1<l.size;column+=stride)
+						{
+							const Real u = (getFaceCoordinate (column, l.size) + getFaceCoordinate (column + 1, l.size)) * Real(0.5);
+							const Real v = (getFaceCoordinate (row, l.size) + getFaceCoordinate (row + 1, l.size)) * Real(0.5);
+							const Real scale = mRadius / std::sqrt (Real(1.0) + u*u + v*v);
+							Real point[3];
+							point[axis] = sign * scale;
+							point[aAxis] = u * scale;
+							point[bAxis] = v * scale;
+							x.push_back (point[0]);
+							y.push_back (point[1]);
+							z.push_back (point[2]);
+						}
+					}
+				}
+				const size_t count = x.size ();
+				std::vector<Real> interpolated(count), octaves(count);
+				getValues (level, count, &x[0], &y[0], &z[0], &interpolated[0]);
+				mElement->getOctaveValues (0, level, count, &x[0], &y[0], &z[0], &octaves[0], cache);
+				Real error = 0.0;
+				for (size_t i=0;i<count;++i)
+				{
+					error = std::max (error, std::fabs (interpolated[i] - octaves[i]));
+				}
+				return error;
+			}
+			/// Samples the sum of the first level octaves.
+			void getValues (size_t level, size_t count, const Real *x, const Real *y, const Real *z, Real *values) const
+			{
+				if (level == 0)
+				{
+					std::fill (values, values+count, Real(0.0));
+					return;
+				}
+				NoiseAssert (level <= mLevels.size(), level);
+				const Level &l = mLevels[level - 1];
+				const size_t row = l.size * 4;
+				for (size_t i=0;i<count;++i)
+				{
+					Real s, t;
+					const float *p = findSamples (l, x[i], y[i], z[i], s, t);
+					const Real bottom = Math::InterpLinear (Real(p[0]), Real(p[4]), s);
+					const Real top = Math::InterpLinear (Real(p[row]), Real(p[row+4]), s);
+					values[i] = Math::InterpLinear (bottom, top, t);
+				}
+			}
+			/// Samples the sum of the first level octaves and its derivatives.
+			void getDerivatives (size_t level, size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz) const
+			{
+				Real *const results[4] = { values, dx, dy, dz };
+				if (level == 0)
+				{
+					for (int k=0;k<4;++k)
+						std::fill (results[k], results[k]+count, Real(0.0));
+					return;
+				}
+				NoiseAssert (level <= mLevels.size(), level);
+				const Level &l = mLevels[level - 1];
+				const size_t row = l.size * 4;
+				for (size_t i=0;i<count;++i)
+				{
+					Real s, t;
+					const float *p = findSamples (l, x[i], y[i], z[i], s, t);
+					for (int k=0;k<4;++k)
+					{
+						const Real bottom = Math::InterpLinear (Real(p[k]), Real(p[k+4]), s);
+						const Real top = Math::InterpLinear (Real(p[row+k]), Real(p[row+k+4]), s);
+						results[k][i] = Math::InterpLinear (bottom, top, t);
+					}
+				}
+			}
+			/// Calculates bounds of the values getValues() returns for the points inside the box.
+			/// The samples around the points lie within the largest sample spacing from their projections on the sphere,
+			/// so these are the bounds of the octaves in the box grown by that distance.
+			void getBounds (size_t level, const Box3D &box, Real &lower, Real &upper) const
+			{
+				if (level == 0)
+				{
+					lower = upper = 0.0;
+					return;
+				}
+				NoiseAssert (level <= mLevels.size(), level);
+				const Real grow = getSphereDistance (box) + Real(1.5) * mLevels[level - 1].spacing;
+				Box3D grown = box;
+				for (int d=0;d<3;++d)
+				{
+					grown.min[d] -= grow;
+					grown.max[d] += grow;
+				}
+				mElement->getOctaveBounds (0, level, grown, lower, upper);
+				// the samples are rounded to floats
+				const Real rounding = (std::fabs (lower) + std::fabs (upper)) * std::numeric_limits<float>::epsilon ();
+				lower -= rounding;
+				upper += rounding;
+			}
+	};
+
+	/** A window of a level of a ShellMap, for the levels which are too fine to bake for the whole sphere.
+		A region which is sampled at smaller and smaller spacings, like a terrain tile and the tiles refining it,
+		can keep the octaves its spacing resolves in a patch. The patch of a part of the region is then built
+		from the one of the whole region: its samples interpolate that one and only calculate the octaves in
+		between, instead of all of them. The samples lie on the grid of the level, as if it was baked.
+
+		A patch covers the points of one face. The points outside of it take the octaves from the map and the
+		element instead, so a patch can be used for any batch, it is just slower for the points it misses.
+		Inside the patch the values only depend on the point, as long as the patches are built from the same
+		chain of levels, so regions sharing some points agree on them.
+	*/
+	class ShellPatch
+	{
+		private:
+			const ShellMap *mMap;
+			/// The number of octaves, 0 if the patch is empty.
+			size_t mLevel;
+			size_t mFace;
+			/// The number of samples along the edges of the faces of the level.
+			size_t mSize;
+			/// The first column and row of the window, and its size.
+			size_t mColumn, mRow, mColumns, mRows;
+			/// Value and derivatives of every sample of the window, row by row.
+			std::vector<float> mSamples;
+
+			/// Same as ShellMap::findSamples(), but returns NULL if the point is outside the window.
+			NOISEPP_INLINE const float *findSamples (Real x, Real y, Real z, Real &s, Real &t) const
+			{
+				Real u, v;
+				if (ShellMap::project (x, y, z, mSize, u, v) != mFace)
+					return NULL;
+				u -= Real(mColumn);
+				v -= Real(mRow);
+				if (!(u >= Real(0.0) && u <= Real(mColumns - 1) && v >= Real(0.0) && v <= Real(mRows - 1)))
+					return NULL;
+				const size_t column = std::min (size_t(u), mColumns - 2);
+				const size_t row = std::min (size_t(v), mRows - 2);
+				s = u - Real(column);
+				t = v - Real(row);
+				return &mSamples[(row * mColumns + column) * 4];
+			}
+			/// Calculates the octaves of the points outside the window with the map and the element.
+			void getMissingDerivatives (const std::vector<size_t> &missing, const Real *x, const Real *y, const Real *z,
+				Real *values, Real *dx, Real *dy, Real *dz, Cache *cache) const
+			{
+				const size_t count = missing.size ();
+				if (!count)
+					return;
+				std::vector<Real> buffer(count * 11);
+				Real *sx = &buffer[0];
+				Real *sy = sx + count;
+				Real *sz = sy + count;
+				Real *const baked[4] = { sz + count, sz + 2*count, sz + 3*count, sz + 4*count };
+				Real *const octaves[4] = { sz + 5*count, sz + 6*count, sz + 7*count, sz + 8*count };
+				Real *const results[4] = { values, dx, dy, dz };
+				for (size_t i=0;i<count;++i)
+				{
+					sx[i] = x[missing[i]];
+					sy[i] = y[missing[i]];
+					sz[i] = z[missing[i]];
+				}
+				const size_t mapLevel = std::min (mLevel, mMap->getOctaveCount ());
+				mMap->getDerivatives (mapLevel, count, sx, sy, sz, baked[0], baked[1], baked[2], baked[3]);
+				mMap->getElement ()->getOctaveDerivatives (mapLevel, mLevel, count, sx, sy, sz, octaves[0], octaves[1], octaves[2], octaves[3], cache);
+				for (size_t i=0;i<count;++i)
+				{
+					for (int k=0;k<4;++k)
+						results[k][missing[i]] = baked[k][i] + octaves[k][i];
+				}
+			}
+
+		public:
+			/// Constructor. The patch is empty until build() is called.
+			/// @param map The map whose level the patch is a window of, it must outlive the patch.
+			ShellPatch (const ShellMap *map) : mMap(map), mLevel(0), mFace(0), mSize(0), mColumn(0), mRow(0), mColumns(0), mRows(0)
+			{
+				NoiseAssert (map != NULL, map);
+			}
+			/// Returns the map.
+			const ShellMap *getMap () const
+			{
+				return mMap;
+			}
+			/// Returns the number of octaves in the patch, 0 if it is empty.
+			size_t getOctaveCount () const
+			{
+				return mLevel;
+			}
+			/// Returns the size of the samples in bytes.
+			size_t getMemoryUsage () const
+			{
+				return mSamples.size () * sizeof(float);
+			}
+			/// Empties the patch.
+			void clear ()
+			{
+				mLevel = 0;
+				mSamples.clear ();
+			}
+			/// Returns the number of octaves a patch for a batch with the spacing should have, so that the distance
+			/// between its samples is at least twice the spacing. Then the patch has fewer samples than the batch.
+			/// Returns 0 if that level is baked in the map anyway.
+			size_t getLevel (Real spacing) const
+			{
+				const size_t octaves = mMap->getElement ()->getOctaveCount ();
+				size_t n = mMap->getOctaveCount ();
+				while (n < octaves && mMap->getLevelSpacing (n + 1) >= Real(2.0) * spacing)
+					++n;
+				return n > mMap->getOctaveCount () ? n : 0;
+			}
+			/// Bakes the first level octaves for the window of the face which covers the points.
+			/// The face is the one the middle point projects on.
+			/// @param level The number of octaves, more than the map holds and at most the octaves of the element.
+			/// @param parent A patch of a region covering the points, with fewer octaves, or NULL. The samples interpolate
+			/// its octaves where it covers them, and calculate the remaining ones. Without a parent they are all calculated
+			/// except the ones of the map.
+			/// @param cache The cache passed to the element.
+			void build (size_t level, size_t count, const Real *x, const Real *y, const Real *z, const ShellPatch *parent=NULL, Cache *cache=NULL)
+			{
+				NoiseAssert (level > mMap->getOctaveCount () && level <= mMap->getElement ()->getOctaveCount (), level);
+				NoiseAssert (parent != this, parent);
+				clear ();
+				if (!count)
+					return;
+
+				Real spacing;
+				mMap->getLevelGeometry (level - 1, mSize, spacing);
+				Real u, v;
+				mFace = ShellMap::project (x[count/2], y[count/2], z[count/2], mSize, u, v);
+				Real minU = u, maxU = u, minV = v, maxV = v;
+				for (size_t i=0;i<count;++i)
+				{
+					if (ShellMap::project (x[i], y[i], z[i], mSize, u, v) != mFace)
+						continue;
+					minU = std::min (minU, u);
+					maxU = std::max (maxU, u);
+					minV = std::min (minV, v);
+					maxV = std::max (maxV, v);
+				}
+				// one more sample on every side, so that the patches of the parts of the region are inside this one
+				mColumn = size_t(std::max (minU, Real(1.0))) - 1;
+				mRow = size_t(std::max (minV, Real(1.0))) - 1;
+				mColumns = std::min (size_t(std::max (maxU, Real(0.0))) + 3, mSize) - mColumn;
+				mRows = std::min (size_t(std::max (maxV, Real(0.0))) + 3, mSize) - mRow;
+				if (mColumns < 2 || mRows < 2)
+					return;
+
+				const size_t samples = mColumns * mRows;
+				std::vector<Real> buffer(samples * 11);
+				Real *sx = &buffer[0];
+				Real *sy = sx + samples;
+				Real *sz = sy + samples;
+				Real *const prefix[4] = { sz + samples, sz + 2*samples, sz + 3*samples, sz + 4*samples };
+				Real *const octaves[4] = { sz + 5*samples, sz + 6*samples, sz + 7*samples, sz + 8*samples };
+				for (size_t row=0;row<mRows;++row)
+				{
+					for (size_t column=0;column<mColumns;++column)
+					{
+						const size_t i = row * mColumns + column;
+						Real point[3];
+						mMap->getSamplePoint (mFace, mColumn + column, mRow + row, mSize, point);
+						sx[i] = point[0];
+						sy[i] = point[1];
+						sz[i] = point[2];
+					}
+				}
+
+				size_t first;
+				if (parent && parent->mMap == mMap && parent->mLevel > 0 && parent->mLevel <= level)
+				{
+					first = parent->mLevel;
+					parent->getDerivatives (samples, sx, sy, sz, prefix[0], prefix[1], prefix[2], prefix[3], cache);
+				}
+				else
+				{
+					first = mMap->getOctaveCount ();
+					mMap->getDerivatives (first, samples, sx, sy, sz, prefix[0], prefix[1], prefix[2], prefix[3]);
+				}
+				mMap->getElement ()->getOctaveDerivatives (first, level, samples, sx, sy, sz, octaves[0], octaves[1], octaves[2], octaves[3], cache);
+
+				mSamples.resize (samples * 4);
+				for (size_t i=0;i<samples;++i)
+				{
+					for (int k=0;k<4;++k)
+						mSamples[i*4+k] = float(prefix[k][i] + octaves[k][i]);
+				}
+				mLevel = level;
+			}
+			/// Samples the sum of the octaves of the patch.
+			void getValues (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Cache *cache=NULL) const
+			{
+				NoiseAssert (mLevel > 0, mLevel);
+				std::vector<size_t> missing;
+				const size_t row = mColumns * 4;
+				for (size_t i=0;i<count;++i)
+				{
+					Real s, t;
+					const float *p = findSamples (x[i], y[i], z[i], s, t);
+					if (!p)
+					{
+						missing.push_back (i);
+						continue;
+					}
+					const Real bottom = Math::InterpLinear (Real(p[0]), Real(p[4]), s);
+					const Real top = Math::InterpLinear (Real(p[row]), Real(p[row+4]), s);
+					values[i] = Math::InterpLinear (bottom, top, t);
+				}
+				if (!missing.empty ())
+				{
+					// the derivatives are cheap next to the octaves
+					std::vector<Real> derivatives(count * 3);
+					getMissingDerivatives (missing, x, y, z, values, &derivatives[0], &derivatives[count], &derivatives[2*count], cache);
+				}
+			}
+			/// Samples the sum of the octaves of the patch and its derivatives.
+			void getDerivatives (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Cache *cache=NULL) const
+			{
+				NoiseAssert (mLevel > 0, mLevel);
+				Real *const results[4] = { values, dx, dy, dz };
+				std::vector<size_t> missing;
+				const size_t row = mColumns * 4;
+				for (size_t i=0;i<count;++i)
+				{
+					Real s, t;
+					const float *p = findSamples (x[i], y[i], z[i], s, t);
+					if (!p)
+					{
+						missing.push_back (i);
+						continue;
+					}
+					for (int k=0;k<4;++k)
+					{
+						const Real bottom = Math::InterpLinear (Real(p[k]), Real(p[k+4]), s);
+						const Real top = Math::InterpLinear (Real(p[row+k]), Real(p[row+k+4]), s);
+						results[k][i] = Math::InterpLinear (bottom, top, t);
+					}
+				}
+				getMissingDerivatives (missing, x, y, z, values, dx, dy, dz, cache);
+			}
+			/// Calculates bounds of the values getValues() returns for the points inside the box.
+			/// The octaves of the map are interpolated at points within one and a half of its spacing, like in
+			/// ShellMap::getBounds(). Every patch of the chain after it interpolates its parent at points within
+			/// one and a half of its own spacing, which halves with every level, so these add up to at most three
+			/// times the spacing of the first patch.
+			void getBounds (const Box3D &box, Real &lower, Real &upper) const
+			{
+				NoiseAssert (mLevel > 0, mLevel);
+				const size_t mapLevel = mMap->getOctaveCount ();
+				Real grow = mMap->getSphereDistance (box) + Real(3.0) * mMap->getLevelSpacing (mapLevel + 1);
+				if (mapLevel > 0)
+					grow += Real(1.5) * mMap->getLevelSpacing (mapLevel);
+				Box3D grown = box;
+				for (int d=0;d<3;++d)
+				{
+					grown.min[d] -= grow;
+					grown.max[d] += grow;
+				}
+				mMap->getElement ()->getOctaveBounds (0, mLevel, grown, lower, upper);
+				// the map and every patch of the chain round the samples to floats
+				const Real rounding = (std::fabs (lower) + std::fabs (upper)) * std::numeric_limits<float>::epsilon () * Real(mLevel - mapLevel + 1);
+				lower -= rounding;
+				upper += rounding;
+			}
+	};
+};
+
+#endif
@@ -0,0 +1,598 @@
+// Noise++ Library
+// Copyright (c) 2008, Urs C. Hanselmann
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above copyright notice,
+//      this list of conditions and the following disclaimer in the documentation
+//      and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef NOISEPP_SIMPLEX_H
+#define NOISEPP_SIMPLEX_H
+
+#include "NoisePerlin.h"
+
+namespace noisepp
+{
+	/// Default noise scale factor of SimplexModule.
+	/// Gives the octaves the standard deviation of the ones of PerlinModule, their values stay inside [-1.004, 1.004].
+	const Real SIMPLEX_SCALE = 108.0;
+
+	typedef PerlinModuleBase SimplexModuleBase;
+
+	/** Simplex noise generator.
+		The space is split in tetrahedra instead of cubes, so every value only needs the
+		gradients of 4 lattice points instead of 8 and no interpolation.
+		The gradients and the lattice hash are the same as the ones of Generator3D.
+	*/
+	class SimplexGenerator3D
+	{
+		private:
+			/// Returns the contribution of a corner of the simplex and adds its derivatives to gradient if it isn't NULL.
+			/// vIndex is the lattice hash of the corner, before it's mixed.
+			static NOISEPP_INLINE Real calcCorner (Real dx, Real dy, Real dz, int vIndex, Real *gradient)
+			{
+				const Real t = std::max (Real(0.5) - dx*dx - dy*dy - dz*dz, Real(0.0));
+				vIndex ^= (vIndex >> NOISE_SHIFT);
+				vIndex &= 0xff;
+
+				const Real xGradient = randomVectors3D[(vIndex<<2)];
+				const Real yGradient = randomVectors3D[(vIndex<<2)+1];
+				const Real zGradient = randomVectors3D[(vIndex<<2)+2];
+				const Real dot = xGradient * dx + yGradient * dy + zGradient * dz;
+				const Real t2 = t * t;
+				const Real t4 = t2 * t2;
+				if (gradient)
+				{
+					const Real f = Real(8.0) * t2 * t * dot;
+					gradient[0] += t4 * xGradient - f * dx;
+					gradient[1] += t4 * yGradient - f * dy;
+					gradient[2] += t4 * zGradient - f * dz;
+				}
+				return t4 * dot;
+			}
+
+			/// Finds the simplex containing the point: the skewed lattice cell, the offset of the point from
+			/// the cell origin and the steps from the origin to the second and third corners.
+			static NOISEPP_INLINE void locateSimplex (Real x, Real y, Real z, int *cell, Real *offset, int *steps)
+			{
+				const Real F3 = Real(1.0/3.0);
+				const Real G3 = Real(1.0/6.0);
+
+				// skews the point to find the cube containing the simplex
+				const Real s = (x + y + z) * F3;
+				const Real sx = x + s, sy = y + s, sz = z + s;
+				cell[0] = (sx > Real(0.0) ? (int)sx : (int)sx - 1);
+				cell[1] = (sy > Real(0.0) ? (int)sy : (int)sy - 1);
+				cell[2] = (sz > Real(0.0) ? (int)sz : (int)sz - 1);
+				const Real t = Real(cell[0] + cell[1] + cell[2]) * G3;
+				offset[0] = x - (Real(cell[0]) - t);
+				offset[1] = y - (Real(cell[1]) - t);
+				offset[2] = z - (Real(cell[2]) - t);
+
+				// the order of the offsets picks one of the six simplices of the cube,
+				// the second corner steps along the largest offset and the third one along the two largest.
+				// Branchless, which simplex a point falls in is hard to predict.
+				const int xy = offset[0] >= offset[1];
+				const int yz = offset[1] >= offset[2];
+				const int xz = offset[0] >= offset[2];
+				steps[0] = xy & xz;
+				steps[1] = (xy ^ 1) & yz;
+				steps[2] = (xz | yz) ^ 1;
+				steps[3] = xy | xz;
+				steps[4] = (xy & (yz ^ 1)) ^ 1;
+				steps[5] = (xz & yz) ^ 1;
+			}
+
+			/// Bounds the contribution of the lattice point (ci, cj, ck) inside the box [min, max].
+			/// Returns false if the box is out of its reach.
+			static bool calcCornerBounds (const Real *min, const Real *max, int ci, int cj, int ck, int seed, Real &lower, Real &upper)
+			{
+				const Real G3 = Real(1.0/6.0);
+				const Real t = Real(ci + cj + ck) * G3;
+				const Real corner[3] = { Real(ci) - t, Real(cj) - t, Real(ck) - t };
+				// offsets of the box from the lattice point
+				Real lo[3], hi[3];
+				Real distLower = 0.0, distUpper = 0.0;
+				for (int d=0;d<3;++d)
+				{
+					lo[d] = min[d] - corner[d];
+					hi[d] = max[d] - corner[d];
+					const Real nearest = (lo[d] > Real(0.0)) ? lo[d] : ((hi[d] < Real(0.0)) ? -hi[d] : Real(0.0));
+					distLower += nearest * nearest;
+					distUpper += std::max (lo[d] * lo[d], hi[d] * hi[d]);
+				}
+				if (distLower >= Real(0.5))
+					return false;
+
+				int vIndex = (NOISE_X_FACTOR * ci + NOISE_Y_FACTOR * cj + NOISE_Z_FACTOR * ck + NOISE_SEED_FACTOR * seed) & 0xffffffff;
+				vIndex ^= (vIndex >> NOISE_SHIFT);
+				vIndex &= 0xff;
+				Real dotLower = 0.0, dotUpper = 0.0;
+				for (int d=0;d<3;++d)
+				{
+					const Real gradient = randomVectors3D[(vIndex<<2)+d];
+					const Real a = gradient * lo[d];
+					const Real b = gradient * hi[d];
+					dotLower += std::min (a, b);
+					dotUpper += std::max (a, b);
+				}
+				// t^4 is in [t4Lower, t4Upper] and never negative
+				const Real tLower = std::max (Real(0.5) - distUpper, Real(0.0));
+				const Real tUpper = Real(0.5) - distLower;
+				const Real t4Lower = tLower * tLower * tLower * tLower;
+				const Real t4Upper = tUpper * tUpper * tUpper * tUpper;
+				lower = std::min (t4Lower * dotLower, t4Upper * dotLower);
+				upper = std::max (t4Lower * dotUpper, t4Upper * dotUpper);
+				return true;
+			}
+
+			/// Bounds the sum of the contributions of the corners of a simplex inside the box [min, max].
+			static void calcSimplexBounds (const Real *min, const Real *max, const int *cell, const int *steps, int seed, Real &lower, Real &upper)
+			{
+				const int corners[4][3] = { { 0, 0, 0 }, { steps[0], steps[1], steps[2] }, { steps[3], steps[4], steps[5] }, { 1, 1, 1 } };
+				lower = upper = 0.0;
+				for (int corner=0;corner<4;++corner)
+				{
+					Real cornerLower, cornerUpper;
+					if (calcCornerBounds (min, max, cell[0] + corners[corner][0], cell[1] + corners[corner][1], cell[2] + corners[corner][2], seed, cornerLower, cornerUpper))
+					{
+						lower += cornerLower;
+						upper += cornerUpper;
+					}
+				}
+			}
+
+#if NOISEPP_SIMD_X86 && NOISEPP_DOUBLE_PRECISION
+			static NOISEPP_SIMD_AVX2_INLINE __m256d gatherAVX2 (const Real *table, __m128i index)
+			{
+				return _mm256_mask_i32gather_pd (_mm256_setzero_pd (), table, index, _mm256_castsi256_pd (_mm256_set1_epi64x (-1)), 8);
+			}
+
+			template <bool Derivatives>
+			static NOISEPP_SIMD_AVX2_INLINE __m256d calcCornerAVX2 (__m256d dx, __m256d dy, __m256d dz, __m128i vIndex, __m256d *gradient)
+			{
+				__m256d t = _mm256_sub_pd (_mm256_sub_pd (_mm256_sub_pd (_mm256_set1_pd (0.5), _mm256_mul_pd (dx, dx)), _mm256_mul_pd (dy, dy)), _mm256_mul_pd (dz, dz));
+				t = _mm256_max_pd (t, _mm256_setzero_pd ());
+				vIndex = _mm_xor_si128 (vIndex, _mm_srai_epi32 (vIndex, NOISE_SHIFT));
+				vIndex = _mm_slli_epi32 (_mm_and_si128 (vIndex, _mm_set1_epi32 (0xff)), 2);
+
+				const __m256d xGradient = gatherAVX2 (randomVectors3D, vIndex);
+				const __m256d yGradient = gatherAVX2 (randomVectors3D+1, vIndex);
+				const __m256d zGradient = gatherAVX2 (randomVectors3D+2, vIndex);
+				const __m256d dot = _mm256_add_pd (_mm256_add_pd (_mm256_mul_pd (xGradient, dx), _mm256_mul_pd (yGradient, dy)), _mm256_mul_pd (zGradient, dz));
+				const __m256d t2 = _mm256_mul_pd (t, t);
+				const __m256d t4 = _mm256_mul_pd (t2, t2);
+				if (Derivatives)
+				{
+					const __m256d f = _mm256_mul_pd (_mm256_mul_pd (_mm256_mul_pd (_mm256_set1_pd (8.0), t2), t), dot);
+					gradient[0] = _mm256_add_pd (gradient[0], _mm256_sub_pd (_mm256_mul_pd (t4, xGradient), _mm256_mul_pd (f, dx)));
+					gradient[1] = _mm256_add_pd (gradient[1], _mm256_sub_pd (_mm256_mul_pd (t4, yGradient), _mm256_mul_pd (f, dy)));
+					gradient[2] = _mm256_add_pd (gradient[2], _mm256_sub_pd (_mm256_mul_pd (t4, zGradient), _mm256_mul_pd (f, dz)));
+				}
+				return _mm256_mul_pd (t4, dot);
+			}
+
+			/// AVX2 version of calcSimplexNoise(), calculates 4 points per iteration.
+			/// Returns the number of points calculated.
+			template <bool Derivatives>
+			static NOISEPP_SIMD_AVX2 size_t calcSimplexNoiseAVX2 (size_t count, const Real *x, const Real *y, const Real *z, int seed, Real scale, Real *values, Real *dx, Real *dy, Real *dz)
+			{
+				const __m256d zero = _mm256_setzero_pd ();
+				const __m256d one = _mm256_set1_pd (1.0);
+				const __m256d F3 = _mm256_set1_pd (Real(1.0/3.0));
+				const __m256d G3 = _mm256_set1_pd (Real(1.0/6.0));
+				const __m256d G3x2 = _mm256_set1_pd (Real(2.0) * Real(1.0/6.0));
+				const __m256d G3x3 = _mm256_set1_pd (Real(3.0) * Real(1.0/6.0));
+				const __m256d vScale = _mm256_set1_pd (scale);
+				const __m128i xFactor = _mm_set1_epi32 (NOISE_X_FACTOR);
+				const __m128i yFactor = _mm_set1_epi32 (NOISE_Y_FACTOR);
+				const __m128i zFactor = _mm_set1_epi32 (NOISE_Z_FACTOR);
+				const __m128i seedIndex = _mm_set1_epi32 (NOISE_SEED_FACTOR * seed);
+
+				size_t i = 0;
+				for (;i+4<=count;i+=4)
+				{
+					const __m256d fx = _mm256_loadu_pd (x+i);
+					const __m256d fy = _mm256_loadu_pd (y+i);
+					const __m256d fz = _mm256_loadu_pd (z+i);
+
+					const __m256d s = _mm256_mul_pd (_mm256_add_pd (_mm256_add_pd (fx, fy), fz), F3);
+					const __m256d sx = _mm256_add_pd (fx, s);
+					const __m256d sy = _mm256_add_pd (fy, s);
+					const __m256d sz = _mm256_add_pd (fz, s);
+					const __m256d ci = _mm256_sub_pd (_mm256_round_pd (sx, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC), _mm256_and_pd (_mm256_cmp_pd (sx, zero, _CMP_NGT_UQ), one));
+					const __m256d cj = _mm256_sub_pd (_mm256_round_pd (sy, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC), _mm256_and_pd (_mm256_cmp_pd (sy, zero, _CMP_NGT_UQ), one));
+					const __m256d ck = _mm256_sub_pd (_mm256_round_pd (sz, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC), _mm256_and_pd (_mm256_cmp_pd (sz, zero, _CMP_NGT_UQ), one));
+					const __m256d t = _mm256_mul_pd (_mm256_add_pd (_mm256_add_pd (ci, cj), ck), G3);
+					const __m256d x0 = _mm256_sub_pd (fx, _mm256_sub_pd (ci, t));
+					const __m256d y0 = _mm256_sub_pd (fy, _mm256_sub_pd (cj, t));
+					const __m256d z0 = _mm256_sub_pd (fz, _mm256_sub_pd (ck, t));
+
+					// same as the comparisons of calcSimplexNoise()
+					const __m256d xy = _mm256_cmp_pd (x0, y0, _CMP_GE_OQ);
+					const __m256d yz = _mm256_cmp_pd (y0, z0, _CMP_GE_OQ);
+					const __m256d xz = _mm256_cmp_pd (x0, z0, _CMP_GE_OQ);
+					const __m256d i1 = _mm256_and_pd (_mm256_and_pd (xy, xz), one);
+					const __m256d j1 = _mm256_and_pd (_mm256_andnot_pd (xy, yz), one);
+					const __m256d k1 = _mm256_andnot_pd (_mm256_or_pd (xz, yz), one);
+					const __m256d i2 = _mm256_and_pd (_mm256_or_pd (xy, xz), one);
+					const __m256d j2 = _mm256_andnot_pd (_mm256_andnot_pd (yz, xy), one);
+					const __m256d k2 = _mm256_andnot_pd (_mm256_and_pd (xz, yz), one);
+
+					const __m128i hash = _mm_add_epi32 (_mm_add_epi32 (_mm_add_epi32 (_mm_mullo_epi32 (_mm256_cvttpd_epi32 (ci), xFactor), _mm_mullo_epi32 (_mm256_cvttpd_epi32 (cj), yFactor)), _mm_mullo_epi32 (_mm256_cvttpd_epi32 (ck), zFactor)), seedIndex);
+					const __m128i hash1 = _mm_add_epi32 (_mm_add_epi32 (_mm_add_epi32 (hash, _mm_mullo_epi32 (_mm256_cvttpd_epi32 (i1), xFactor)), _mm_mullo_epi32 (_mm256_cvttpd_epi32 (j1), yFactor)), _mm_mullo_epi32 (_mm256_cvttpd_epi32 (k1), zFactor));
+					const __m128i hash2 = _mm_add_epi32 (_mm_add_epi32 (_mm_add_epi32 (hash, _mm_mullo_epi32 (_mm256_cvttpd_epi32 (i2), xFactor)), _mm_mullo_epi32 (_mm256_cvttpd_epi32 (j2), yFactor)), _mm_mullo_epi32 (_mm256_cvttpd_epi32 (k2), zFactor));
+					const __m128i hash3 = _mm_add_epi32 (_mm_add_epi32 (_mm_add_epi32 (hash, xFactor), yFactor), zFactor);
+
+					__m256d gradient[3] = { zero, zero, zero };
+					__m256d value = calcCornerAVX2<Derivatives> (x0, y0, z0, hash, gradient);
+					value = _mm256_add_pd (value, calcCornerAVX2<Derivatives> (_mm256_add_pd (_mm256_sub_pd (x0, i1), G3), _mm256_add_pd (_mm256_sub_pd (y0, j1), G3), _mm256_add_pd (_mm256_sub_pd (z0, k1), G3), hash1, gradient));
+					value = _mm256_add_pd (value, calcCornerAVX2<Derivatives> (_mm256_add_pd (_mm256_sub_pd (x0, i2), G3x2), _mm256_add_pd (_mm256_sub_pd (y0, j2), G3x2), _mm256_add_pd (_mm256_sub_pd (z0, k2), G3x2), hash2, gradient));
+					value = _mm256_add_pd (value, calcCornerAVX2<Derivatives> (_mm256_add_pd (_mm256_sub_pd (x0, one), G3x3), _mm256_add_pd (_mm256_sub_pd (y0, one), G3x3), _mm256_add_pd (_mm256_sub_pd (z0, one), G3x3), hash3, gradient));
+
+					_mm256_storeu_pd (values+i, _mm256_mul_pd (value, vScale));
+					if (Derivatives)
+					{
+						_mm256_storeu_pd (dx+i, _mm256_mul_pd (gradient[0], vScale));
+						_mm256_storeu_pd (dy+i, _mm256_mul_pd (gradient[1], vScale));
+						_mm256_storeu_pd (dz+i, _mm256_mul_pd (gradient[2], vScale));
+					}
+				}
+				return i;
+			}
+#endif
+
+			template <bool Derivatives>
+			static size_t calcSimplexNoiseSIMD (size_t count, const Real *x, const Real *y, const Real *z, int seed, Real scale, Real *values, Real *dx, Real *dy, Real *dz)
+			{
+#if NOISEPP_SIMD_X86 && NOISEPP_DOUBLE_PRECISION
+				if (SIMD::getLevel () >= SIMD_AVX2)
+					return calcSimplexNoiseAVX2<Derivatives> (count, x, y, z, seed, scale, values, dx, dy, dz);
+#endif
+				return 0;
+			}
+
+		public:
+			/// Calculates the noise value and, if gradient isn't NULL, its partial derivatives.
+			static NOISEPP_INLINE Real calcSimplexNoise (Real x, Real y, Real z, int seed, Real scale, Real *gradient=NULL)
+			{
+				const Real G3 = Real(1.0/6.0);
+				int cell[3], steps[6];
+				Real offset[3];
+				locateSimplex (x, y, z, cell, offset, steps);
+				const int i = cell[0], j = cell[1], k = cell[2];
+				const Real x0 = offset[0], y0 = offset[1], z0 = offset[2];
+				const int i1 = steps[0], j1 = steps[1], k1 = steps[2];
+				const int i2 = steps[3], j2 = steps[4], k2 = steps[5];
+
+				if (gradient)
+					gradient[0] = gradient[1] = gradient[2] = Real(0.0);
+				const int hash = NOISE_X_FACTOR * i + NOISE_Y_FACTOR * j + NOISE_Z_FACTOR * k + NOISE_SEED_FACTOR * seed;
+				Real value = calcCorner (x0, y0, z0, hash, gradient);
+				value += calcCorner (x0 - Real(i1) + G3, y0 - Real(j1) + G3, z0 - Real(k1) + G3, hash + NOISE_X_FACTOR * i1 + NOISE_Y_FACTOR * j1 + NOISE_Z_FACTOR * k1, gradient);
+				value += calcCorner (x0 - Real(i2) + Real(2.0) * G3, y0 - Real(j2) + Real(2.0) * G3, z0 - Real(k2) + Real(2.0) * G3, hash + NOISE_X_FACTOR * i2 + NOISE_Y_FACTOR * j2 + NOISE_Z_FACTOR * k2, gradient);
+				value += calcCorner (x0 - Real(1.0) + Real(3.0) * G3, y0 - Real(1.0) + Real(3.0) * G3, z0 - Real(1.0) + Real(3.0) * G3, hash + NOISE_X_FACTOR + NOISE_Y_FACTOR + NOISE_Z_FACTOR, gradient);
+				if (gradient)
+				{
+					gradient[0] *= scale;
+					gradient[1] *= scale;
+					gradient[2] *= scale;
+				}
+				return value * scale;
+			}
+
+			/// Calculates simplex noise for a batch of points.
+			/// Uses the AVX2 kernel if supported by the CPU (see SIMD::getLevel()), the results are identical to calcSimplexNoise().
+			static void calcSimplexNoiseBatch (size_t count, const Real *x, const Real *y, const Real *z, int seed, Real scale, Real *values)
+			{
+				size_t i = calcSimplexNoiseSIMD<false> (count, x, y, z, seed, scale, values, NULL, NULL, NULL);
+				for (;i<count;++i)
+					values[i] = calcSimplexNoise (x[i], y[i], z[i], seed, scale);
+			}
+
+			/// Batch version of calcSimplexNoise() with derivatives.
+			static void calcSimplexNoiseDerivativesBatch (size_t count, const Real *x, const Real *y, const Real *z, int seed, Real scale, Real *values, Real *dx, Real *dy, Real *dz)
+			{
+				size_t i = calcSimplexNoiseSIMD<true> (count, x, y, z, seed, scale, values, dx, dy, dz);
+				for (;i<count;++i)
+				{
+					Real gradient[3];
+					values[i] = calcSimplexNoise (x[i], y[i], z[i], seed, scale, gradient);
+					dx[i] = gradient[0];
+					dy[i] = gradient[1];
+					dz[i] = gradient[2];
+				}
+			}
+
+			/// Returns the maximum absolute value of calcSimplexNoise().
+			static Real getSimplexNoiseMaximum (Real scale)
+			{
+				// a corner contributes (0.5 - r^2)^4 * (g . d), at most (0.5 - r^2)^4 * r since the gradients are at most
+				// 1.0000007 long. The largest sum of that over the four corners of a simplex is 0.00929 on a grid of
+				// 800 steps along the edges, every point is within 0.0034 of the grid and the sum changes by at most
+				// 0.315 over a unit of distance, so it stays below 0.0104
+				return Real(0.0105) * std::fabs (scale);
+			}
+
+			/// Calculates conservative bounds of calcSimplexNoise() inside the box [min, max].
+			/// The contributions of the four corners of every simplex the box might touch are bounded with interval
+			/// arithmetic over the whole box. If the box touches more than maxCells skewed lattice cells, which have six
+			/// simplices each, the bounds of the whole function are returned.
+			static void calcSimplexNoiseBounds (const Real *min, const Real *max, int seed, Real scale, Real &lower, Real &upper, int maxCells=27)
+			{
+				const Real maximum = getSimplexNoiseMaximum (scale);
+				int cell[3], steps[6];
+				Real offset[3];
+				for (int d=0;d<3;++d)
+				{
+					if (!(min[d] > Real(-1073741824.0) && max[d] < Real(1073741824.0)))
+					{
+						lower = -maximum;
+						upper = maximum;
+						return;
+					}
+				}
+
+				// the simplices are convex, so the box is inside one if all its corners are
+				locateSimplex (min[0], min[1], min[2], cell, offset, steps);
+				bool single = true;
+				for (int corner=1;corner<8 && single;++corner)
+				{
+					int otherCell[3], otherSteps[6];
+					locateSimplex ((corner & 1) ? max[0] : min[0], (corner & 2) ? max[1] : min[1], (corner & 4) ? max[2] : min[2], otherCell, offset, otherSteps);
+					single = std::equal (cell, cell+3, otherCell) && std::equal (steps, steps+6, otherSteps);
+				}
+				if (single)
+				{
+					calcSimplexBounds (min, max, cell, steps, seed, lower, upper);
+				}
+				else
+				{
+					const Real F3 = Real(1.0/3.0);
+					const Real sumMin = (min[0] + min[1] + min[2]) * F3;
+					const Real sumMax = (max[0] + max[1] + max[2]) * F3;
+					int c0[3], c1[3];
+					double cells = 1.0;
+					for (int d=0;d<3;++d)
+					{
+						// skewed coordinates of the box
+						const Real lo = min[d] + sumMin;
+						const Real hi = max[d] + sumMax;
+						c0[d] = (lo > Real(0.0) ? (int)lo : (int)lo - 1);
+						c1[d] = (hi > Real(0.0) ? (int)hi : (int)hi - 1);
+						cells *= double(c1[d] - c0[d] + 1);
+					}
+					if (cells > double(maxCells))
+					{
+						lower = -maximum;
+						upper = maximum;
+						return;
+					}
+
+					// the steps of the six simplices of a cell
+					const int simplices[6][6] = {
+						{ 1, 0, 0, 1, 1, 0 }, { 1, 0, 0, 1, 0, 1 }, { 0, 0, 1, 1, 0, 1 },
+						{ 0, 0, 1, 0, 1, 1 }, { 0, 1, 0, 0, 1, 1 }, { 0, 1, 0, 1, 1, 0 } };
+					lower = std::numeric_limits<Real>::max ();
+					upper = -std::numeric_limits<Real>::max ();
+					for (cell[2]=c0[2];cell[2]<=c1[2];++cell[2])
+					for (cell[1]=c0[1];cell[1]<=c1[1];++cell[1])
+					for (cell[0]=c0[0];cell[0]<=c1[0];++cell[0])
+					{
+						for (int i=0;i<6;++i)
+						{
+							Real simplexLower, simplexUpper;
+							calcSimplexBounds (min, max, cell, simplices[i], seed, simplexLower, simplexUpper);
+							lower = std::min (lower, simplexLower);
+							upper = std::max (upper, simplexUpper);
+						}
+					}
+				}
+				if (scale < Real(0.0))
+				{
+					std::swap (lower, upper);
+				}
+				// leave room for rounding
+				const Real epsilon = Real(1e-4) * std::fabs (scale);
+				lower = std::max (lower * scale - epsilon, -maximum);
+				upper = std::min (upper * scale + epsilon, maximum);
+			}
+	};
+
+	class SimplexElement3D : public PipelineElement3D
+	{
+		private:
+			struct Octave
+			{
+				int seed;
+				Real scale;
+				Real persistence;
+			};
+			Octave *mOctaves;
+			size_t mOctaveCount;
+			Real mScale;
+
+		public:
+			SimplexElement3D (size_t octaves, Real frequency, Real lacunarity, Real persistence, int mainSeed, Real nscale) : mOctaveCount(octaves), mScale(nscale)
+			{
+				mOctaves = new Octave[mOctaveCount];
+				Real curPersistence = 1.0;
+				int seed;
+				Real scale = frequency;
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					seed = (mainSeed + int(o)) & 0xffffffff;
+					mOctaves[o].persistence = curPersistence;
+					mOctaves[o].scale = scale;
+					mOctaves[o].seed = seed;
+
+					scale *= lacunarity;
+					curPersistence *= persistence;
+				}
+			}
+			virtual ~SimplexElement3D ()
+			{
+				delete[] mOctaves;
+				mOctaves = NULL;
+			}
+			virtual Real getValue (Real x, Real y, Real z, Cache *cache) const
+			{
+				Real value = 0.0;
+
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					const Real nx = Math::MakeInt32Range (x * mOctaves[o].scale);
+					const Real ny = Math::MakeInt32Range (y * mOctaves[o].scale);
+					const Real nz = Math::MakeInt32Range (z * mOctaves[o].scale);
+					value += SimplexGenerator3D::calcSimplexNoise (nx, ny, nz, mOctaves[o].seed, mScale) * mOctaves[o].persistence;
+				}
+
+				return value;
+			}
+			/// Octaves which aren't resolved at the spacing are skipped, like PerlinElement3D does.
+			virtual void getValues (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Cache *cache, Real spacing=0.0) const
+			{
+				if (!count)
+					return;
+				std::vector<Real> buffer(count*4);
+				Real *nx = &buffer[0];
+				Real *ny = nx + count;
+				Real *nz = ny + count;
+				Real *noise = nz + count;
+				std::fill (values, values+count, Real(0.0));
+
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					const Octave &octave = mOctaves[o];
+					if (!Generator3D::isResolved (octave.scale, spacing))
+						continue;
+					for (size_t i=0;i<count;++i)
+					{
+						nx[i] = Math::MakeInt32Range (x[i] * octave.scale);
+						ny[i] = Math::MakeInt32Range (y[i] * octave.scale);
+						nz[i] = Math::MakeInt32Range (z[i] * octave.scale);
+					}
+					SimplexGenerator3D::calcSimplexNoiseBatch (count, nx, ny, nz, octave.seed, mScale, noise);
+					for (size_t i=0;i<count;++i)
+					{
+						values[i] += noise[i] * octave.persistence;
+					}
+				}
+			}
+			/// Skips the same octaves as getValues().
+			virtual bool getDerivatives (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Real *dx, Real *dy, Real *dz, Cache *cache, Real spacing=0.0) const
+			{
+				if (!count)
+					return true;
+				std::vector<Real> buffer(count*7);
+				Real *nx = &buffer[0];
+				Real *ny = nx + count;
+				Real *nz = ny + count;
+				Real *noise = nz + count;
+				Real *ndx = noise + count;
+				Real *ndy = ndx + count;
+				Real *ndz = ndy + count;
+				std::fill (values, values+count, Real(0.0));
+				std::fill (dx, dx+count, Real(0.0));
+				std::fill (dy, dy+count, Real(0.0));
+				std::fill (dz, dz+count, Real(0.0));
+
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					const Octave &octave = mOctaves[o];
+					if (!Generator3D::isResolved (octave.scale, spacing))
+						continue;
+					for (size_t i=0;i<count;++i)
+					{
+						nx[i] = Math::MakeInt32Range (x[i] * octave.scale);
+						ny[i] = Math::MakeInt32Range (y[i] * octave.scale);
+						nz[i] = Math::MakeInt32Range (z[i] * octave.scale);
+					}
+					SimplexGenerator3D::calcSimplexNoiseDerivativesBatch (count, nx, ny, nz, octave.seed, mScale, noise, ndx, ndy, ndz);
+					const Real factor = octave.persistence * octave.scale;
+					for (size_t i=0;i<count;++i)
+					{
+						values[i] += noise[i] * octave.persistence;
+						dx[i] += ndx[i] * factor;
+						dy[i] += ndy[i] * factor;
+						dz[i] += ndz[i] * factor;
+					}
+				}
+				return true;
+			}
+			virtual bool getBounds (const Box3D &box, Real &lower, Real &upper, Real spacing=0.0) const
+			{
+				lower = upper = 0.0;
+				for (size_t o=0;o<mOctaveCount;++o)
+				{
+					const Octave &octave = mOctaves[o];
+					if (!Generator3D::isResolved (octave.scale, spacing))
+						continue;
+					Real min[3], max[3];
+					for (int d=0;d<3;++d)
+					{
+						min[d] = box.min[d] * octave.scale;
+						max[d] = box.max[d] * octave.scale;
+						if (min[d] > max[d])
+							std::swap (min[d], max[d]);
+					}
+					Real signalLower, signalUpper;
+					SimplexGenerator3D::calcSimplexNoiseBounds (min, max, octave.seed, mScale, signalLower, signalUpper);
+					Math::ScaleBounds (octave.persistence, signalLower, signalUpper);
+					lower += signalLower;
+					upper += signalUpper;
+				}
+				return true;
+			}
+	};
+
+	/** Module for generating simplex noise.
+		Takes the same parameters as PerlinModule and can replace it where the look of the noise
+		doesn't need to stay the same, the quality is ignored. Only 3D pipelines are supported.
+	*/
+	class SimplexModule : public SimplexModuleBase
+	{
+		public:
+			/// Constructor.
+			SimplexModule ()
+			{
+				mScale = SIMPLEX_SCALE;
+			}
+			/// @copydoc noisepp::Module::addToPipeline()
+			ElementID addToPipeline (Pipeline1D *pipe) const
+			{
+				NoiseThrowNotImplementedException;
+			}
+			/// @copydoc noisepp::Module::addToPipeline()
+			ElementID addToPipeline (Pipeline2D *pipe) const
+			{
+				NoiseThrowNotImplementedException;
+			}
+			/// @copydoc noisepp::Module::addToPipeline()
+			ElementID addToPipeline (Pipeline3D *pipe) const
+			{
+				return pipe->addElement (this, new SimplexElement3D(mOctaveCount, mFrequency, mLacunarity, mPersistence, mSeed+pipe->getSeed(), mScale));
+			}
+			/// @copydoc noisepp::Module::getType()
+			ModuleTypeId getType() const { return MODULE_SIMPLEX; }
+	};
+};
+
+#endif
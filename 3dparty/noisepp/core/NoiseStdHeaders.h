@@ -37,6 +37,7 @@
 #include <algorithm>
 #include <memory>
 #include <map>
+#include <set>
 #include <queue>
 #include <stdexcept>
 #include <string>
@@ -46,4 +47,9 @@
 #include "Thread.h"
 #endif
 
+#if NOISEPP_ENABLE_PROFILING
+#include <atomic>
+#include <ostream>
+#endif
+
 #endif
@@ -43,96 +43,47 @@ namespace noisepp
 		run them in several threads.
 	*/
 	template <class Element>
-	class ThreadedPipeline : public Pipeline<Element>
+	class ThreadedPipeline : public Pipeline<Element>, private threadpp::JobPool<PipelineJob>
 	{
 		private:
-			threadpp::ThreadGroup mThreads;
-			threadpp::Mutex mMutex;
-			threadpp::Condition mCond, mMainCond;
+			/// One cache per thread, created the first time the thread executes a job
+			std::vector<Cache*> mCaches;
 
-			bool mThreadsDone;
-			unsigned mWorkingThreads;
-			PipelineJobQueue mJobsDone;
-			void threadFunction ()
+			virtual void runJob (PipelineJob *job, size_t thread)
 			{
-				Cache *cache = NULL;
-				threadpp::Mutex::Lock lk(mMutex);
-				while (!mThreadsDone)
-				{
-					if (Pipeline<Element>::mJobs.empty())
-						mCond.wait(lk);
-					if (!Pipeline<Element>::mJobs.empty())
-					{
-						PipelineJob *job = Pipeline<Element>::mJobs.front ();
-						Pipeline<Element>::mJobs.pop ();
-						++mWorkingThreads;
-						lk.unlock ();
-						if (!cache)
-							cache = Pipeline<Element>::createCache();
-						job->execute(cache);
-						lk.lock ();
-						--mWorkingThreads;
-						mJobsDone.push (job);
-						mMainCond.notifyOne ();
-					}
-				}
-				lk.unlock ();
-				if (cache)
-				{
-					Pipeline<Element>::freeCache (cache);
-				}
-			}
-			static void *threadEntry (void *pipe)
-			{
-				(static_cast<ThreadedPipeline<Element>*>(pipe))->threadFunction ();
-				return NULL;
+				if (!mCaches[thread])
+					mCaches[thread] = Pipeline<Element>::createCache();
+				job->execute (mCaches[thread]);
 			}
 
 		public:
 			/// Constructor.
-			/// @param numberOfThreads The number of threads
-			ThreadedPipeline (size_t numberOfThreads) : mThreadsDone(false), mWorkingThreads(0)
+			/// @param numberOfThreads The number of worker threads. The thread calling executeJobs() helps executing the jobs too.
+			ThreadedPipeline (size_t numberOfThreads) : threadpp::JobPool<PipelineJob>(numberOfThreads), mCaches(numberOfThreads + 1, (Cache*)NULL)
 			{
 				NoiseAssert (numberOfThreads > 0, numberOfThreads);
-				for (size_t i=0;i<numberOfThreads;++i)
-				{
-					mThreads.createThread (threadEntry, this);
-				}
 			}
 			/// executes the jobs in queue
 			/// WARNING: Don't change the pipeline after calling this function
 			virtual void executeJobs ()
 			{
-				mCond.notifyAll();
-				threadpp::Mutex::Lock lk(mMutex);
-				while (!Pipeline<Element>::mJobs.empty() || mWorkingThreads > 0)
-				{
-					if (!Pipeline<Element>::mJobs.empty() || mWorkingThreads > 0)
-						mMainCond.wait(lk);
-					while (!mJobsDone.empty())
-					{
-						PipelineJob *job = mJobsDone.front ();
-						mJobsDone.pop ();
-						lk.unlock ();
-						job->finish ();
-						delete job;
-						lk.lock ();
-					}
-				}
+				threadpp::JobPool<PipelineJob>::executeJobs ();
 			}
 			/// @copydoc noisepp::Pipeline::addJob()
 			virtual void addJob (PipelineJob *job)
 			{
 				NoiseAssert (job != NULL, job);
-				threadpp::Mutex::Lock lk(mMutex);
-				Pipeline<Element>::mJobs.push (job);
+				threadpp::JobPool<PipelineJob>::addJob (job);
 			}
 			/// Destructor.
 			virtual ~ThreadedPipeline ()
 			{
-				mThreadsDone = true;
-				mCond.notifyAll();
-				mThreads.join ();
+				threadpp::JobPool<PipelineJob>::stopThreads ();
+				for (size_t i=0;i<mCaches.size();++i)
+				{
+					if (mCaches[i])
+						Pipeline<Element>::freeCache (mCaches[i]);
+				}
 			}
 	};
 
@@ -18,7 +18,7 @@ namespace noisepp
 			}
 			virtual Real getValue (Real x, Cache *cache) const
 			{
-				return getElementValue (mElementPtr, mElement, x+mTranslationX, cache);
+				return getTransformedElementValue (mElementPtr, mElement, x+mTranslationX, cache);
 			}
 
 	};
@@ -39,7 +39,7 @@ namespace noisepp
 			}
 			virtual Real getValue (Real x, Real y, Cache *cache) const
 			{
-				return getElementValue (mElementPtr, mElement, x+mTranslationX, y+mTranslationY, cache);
+				return getTransformedElementValue (mElementPtr, mElement, x+mTranslationX, y+mTranslationY, cache);
 			}
 
 	};
@@ -61,7 +61,7 @@ namespace noisepp
 			}
 			virtual Real getValue (Real x, Real y, Real z, Cache *cache) const
 			{
-				return getElementValue (mElementPtr, mElement, x+mTranslationX, y+mTranslationY, z+mTranslationZ, cache);
+				return getTransformedElementValue (mElementPtr, mElement, x+mTranslationX, y+mTranslationY, z+mTranslationZ, cache);
 			}
 
 	};
@@ -134,6 +134,11 @@ namespace noisepp
 			}
 			/// @copydoc noisepp::Module::getType()
 			ModuleTypeId getType() const { return MODULE_TRANSLATEPOINT; }
+			/// @copydoc noisepp::Module::getSourceScale()
+			virtual bool getSourceScale (Real *scale) const
+			{
+				return false;
+			}
 #if NOISEPP_ENABLE_UTILS
 			/// @copydoc noisepp::Module::write()
 			virtual void write (utils::OutStream &stream) const;
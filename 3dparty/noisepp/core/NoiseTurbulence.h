@@ -50,8 +50,8 @@ namespace noisepp
 			{
 				Real x0;
 				x0 = x + Real(12414.0 / 65536.0);
-				Real xFinal = x + (getElementValue (mPerlinXPtr, mPerlinX, x0, cache) * mPower);
-				return getElementValue (mElementPtr, mElement, xFinal, cache);
+				Real xFinal = x + (getTransformedElementValue (mPerlinXPtr, mPerlinX, x0, cache) * mPower);
+				return getTransformedElementValue (mElementPtr, mElement, xFinal, cache);
 			}
 
 	};
@@ -83,9 +83,9 @@ namespace noisepp
 				y0 = y + Real(65124.0 / 65536.0);
 				x1 = x + Real(26519.0 / 65536.0);
 				y1 = y + Real(18128.0 / 65536.0);
-				Real xFinal = x + (getElementValue (mPerlinXPtr, mPerlinX, x0, y0, cache) * mPower);
-				Real yFinal = y + (getElementValue (mPerlinYPtr, mPerlinY, x1, y1, cache) * mPower);
-				return getElementValue (mElementPtr, mElement, xFinal, yFinal, cache);
+				Real xFinal = x + (getTransformedElementValue (mPerlinXPtr, mPerlinX, x0, y0, cache) * mPower);
+				Real yFinal = y + (getTransformedElementValue (mPerlinYPtr, mPerlinY, x1, y1, cache) * mPower);
+				return getTransformedElementValue (mElementPtr, mElement, xFinal, yFinal, cache);
 			}
 
 	};
@@ -126,10 +126,10 @@ namespace noisepp
 				x2 = x + Real(53820.0 / 65536.0);
 				y2 = y + Real(11213.0 / 65536.0);
 				z2 = z + Real(44845.0 / 65536.0);
-				Real xFinal = x + (getElementValue (mPerlinXPtr, mPerlinX, x0, y0, z0, cache) * mPower);
-				Real yFinal = y + (getElementValue (mPerlinYPtr, mPerlinY, x1, y1, z1, cache) * mPower);
-				Real zFinal = z + (getElementValue (mPerlinZPtr, mPerlinZ, x2, y2, z2, cache) * mPower);
-				return getElementValue (mElementPtr, mElement, xFinal, yFinal, zFinal, cache);
+				Real xFinal = x + (getTransformedElementValue (mPerlinXPtr, mPerlinX, x0, y0, z0, cache) * mPower);
+				Real yFinal = y + (getTransformedElementValue (mPerlinYPtr, mPerlinY, x1, y1, z1, cache) * mPower);
+				Real zFinal = z + (getTransformedElementValue (mPerlinZPtr, mPerlinZ, x2, y2, z2, cache) * mPower);
+				return getTransformedElementValue (mElementPtr, mElement, xFinal, yFinal, zFinal, cache);
 			}
 
 	};
@@ -239,6 +239,11 @@ namespace noisepp
 			}
 			/// @copydoc noisepp::Module::getType()
 			ModuleTypeId getType() const { return MODULE_TURBULENCE; }
+			/// @copydoc noisepp::Module::getSourceScale()
+			virtual bool getSourceScale (Real *scale) const
+			{
+				return false;
+			}
 #if NOISEPP_ENABLE_UTILS
 			/// @copydoc noisepp::Module::write()
 			virtual void write (utils::OutStream &stream) const;
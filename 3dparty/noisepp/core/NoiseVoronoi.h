@@ -100,34 +100,143 @@ namespace noisepp
 			Real mDisplacement;
 			bool mEnableDistance;
 
-		public:
-			VoronoiElement3D (Real frequency, int seed, Real displacement, bool enableDistance) : mFrequency(frequency), mSeed(seed), mDisplacement(displacement), mEnableDistance(enableDistance)
+			/// A batch builds a table of feature points if it has less than this many cells per point, see getValues().
+			/// Finding the nearest one of a point looks at 125 cells, 3 noise values each.
+			enum { TABLE_CELLS_PER_POINT=32 };
+
+			/// Calculates the feature points on the fly.
+			class FeaturePoints
 			{
-			}
-			virtual Real getValue (Real x, Real y, Real z, Cache *cache) const
+				private:
+					int mSeed;
+
+				public:
+					FeaturePoints (int seed) : mSeed(seed)
+					{}
+					NOISEPP_INLINE void get (int xc, int yc, int zc, Real &xp, Real &yp, Real &zp) const
+					{
+						xp = xc + Generator3D::calcNoise(xc, yc, zc, mSeed);
+						yp = yc + Generator3D::calcNoise(xc, yc, zc, mSeed+1);
+						zp = zc + Generator3D::calcNoise(xc, yc, zc, mSeed+2);
+					}
+			};
+
+			/// The feature points of a box of cells, calculated once for a whole batch.
+			class FeaturePointTable
 			{
-				x *= mFrequency;
-				y *= mFrequency;
-				z *= mFrequency;
+				private:
+					int mMin[3];
+					int mSize[3];
+					std::vector<Real> mPoints;
 
-				int xi = (x > Real(0.0) ? (int)x : (int)x - 1);
-				int yi = (y > Real(0.0) ? (int)y : (int)y - 1);
-				int zi = (z > Real(0.0) ? (int)z : (int)z - 1);
+				public:
+					FeaturePointTable (const int *min, const int *max, int seed)
+					{
+						for (int d=0;d<3;++d)
+						{
+							mMin[d] = min[d];
+							mSize[d] = max[d] - min[d] + 1;
+						}
+						mPoints.resize (size_t(mSize[0]) * mSize[1] * mSize[2] * 3);
+						const FeaturePoints points(seed);
+						Real *p = &mPoints[0];
+						// in the order calculateValue() looks at them
+						for (int xc=min[0];xc<=max[0];++xc)
+						{
+							for (int yc=min[1];yc<=max[1];++yc)
+							{
+								for (int zc=min[2];zc<=max[2];++zc)
+								{
+									points.get (xc, yc, zc, p[0], p[1], p[2]);
+									p += 3;
+								}
+							}
+						}
+					}
+					NOISEPP_INLINE void get (int xc, int yc, int zc, Real &xp, Real &yp, Real &zp) const
+					{
+						const Real *p = &mPoints[((size_t(xc - mMin[0]) * mSize[1] + (yc - mMin[1])) * mSize[2] + (zc - mMin[2])) * 3];
+						xp = p[0];
+						yp = p[1];
+						zp = p[2];
+					}
+			};
+
+			static NOISEPP_INLINE int getCell (Real v)
+			{
+				return (v > Real(0.0) ? (int)v : (int)v - 1);
+			}
+
+			/// Calculates the value at a point which is already scaled by the frequency.
+			/// @param nearest If not NULL, the cell of the nearest feature point of a previous point, which is a
+			/// good guess for this one. Receives the cell of the nearest feature point of this one.
+			template <class Points>
+			NOISEPP_INLINE Real calculateValue (Real x, Real y, Real z, const Points &points, int *nearest=NULL) const
+			{
+				int xi = getCell (x);
+				int yi = getCell (y);
+				int zi = getCell (z);
 
 				Real minDist = Real(2147483647.0);
 				Real xmin = Real(0);
 				Real ymin = Real(0);
 				Real zmin = Real(0);
 
+				// The feature point of a cell is at most 1 away from its corner along each axis, so the cells which can't
+				// beat the guessed point, or else the nearest point of the 27 closest cells, are skipped. The rest are searched
+				// in the same order as always, so the result is the same as the one of the full search even for ties.
+				// The bounds are shrunk a little so rounding never skips a cell it shouldn't.
+				Real bounds[3][5];
+				const Real p[3] = { x, y, z };
+				const int c[3] = { xi, yi, zi };
+				for (int d=0;d<3;++d)
+				{
+					for (int k=0;k<5;++k)
+					{
+						const Real b = std::max (std::fabs (p[d] - Real(c[d] - 2 + k)) - Real(1.0), Real(0.0)) * Real(0.999);
+						bounds[d][k] = b * b;
+					}
+				}
+				Real threshold = minDist;
+				if (nearest && nearest[0] >= xi-2 && nearest[0] <= xi+2 && nearest[1] >= yi-2 && nearest[1] <= yi+2 && nearest[2] >= zi-2 && nearest[2] <= zi+2)
+				{
+					Real xp, yp, zp;
+					points.get (nearest[0], nearest[1], nearest[2], xp, yp, zp);
+					threshold = (xp - x) * (xp - x) + (yp - y) * (yp - y) + (zp - z) * (zp - z);
+				}
+				else
+				{
+					for (int xc=xi-1;xc<=xi+1;++xc)
+					{
+						for (int yc=yi-1;yc<=yi+1;++yc)
+						{
+							for (int zc=zi-1;zc<=zi+1;++zc)
+							{
+								Real xp, yp, zp;
+								points.get (xc, yc, zc, xp, yp, zp);
+								threshold = std::min (threshold, (xp - x) * (xp - x) + (yp - y) * (yp - y) + (zp - z) * (zp - z));
+							}
+						}
+					}
+				}
+				int nearestCell[3] = { xi, yi, zi };
+
 				for (int xc=xi-2;xc<=xi+2;++xc)
 				{
+					const Real xBound = bounds[0][xc - xi + 2];
+					if (xBound > threshold)
+						continue;
 					for (int yc=yi-2;yc<=yi+2;++yc)
 					{
+						const Real xyBound = xBound + bounds[1][yc - yi + 2];
+						if (xyBound > threshold)
+							continue;
 						for (int zc=zi-2;zc<=zi+2;++zc)
 						{
-							Real xp = xc + Generator3D::calcNoise(xc, yc, zc, mSeed);
-							Real yp = yc + Generator3D::calcNoise(xc, yc, zc, mSeed+1);
-							Real zp = zc + Generator3D::calcNoise(xc, yc, zc, mSeed+2);
+							if (xyBound + bounds[2][zc - zi + 2] > threshold)
+								continue;
+							Real xp, yp, zp;
+							points.get (xc, yc, zc, xp, yp, zp);
 							Real xd = xp - x;
 							Real yd = yp - y;
 							Real zd = zp - z;
@@ -138,10 +247,18 @@ namespace noisepp
 								xmin = xp;
 								ymin = yp;
 								zmin = zp;
+								nearestCell[0] = xc;
+								nearestCell[1] = yc;
+								nearestCell[2] = zc;
 							}
 						}
 					}
 				}
+				if (nearest)
+				{
+					for (int d=0;d<3;++d)
+						nearest[d] = nearestCell[d];
+				}
 
 				Real value;
 				if (mEnableDistance)
@@ -159,6 +276,68 @@ namespace noisepp
 
 				return value + (mDisplacement * (Real)Generator3D::calcNoise((int)floor(xmin), (int)floor(ymin), (int)floor(zmin)));
 			}
+
+		public:
+			VoronoiElement3D (Real frequency, int seed, Real displacement, bool enableDistance) : mFrequency(frequency), mSeed(seed), mDisplacement(displacement), mEnableDistance(enableDistance)
+			{
+			}
+			virtual Real getValue (Real x, Real y, Real z, Cache *cache) const
+			{
+				return calculateValue (x * mFrequency, y * mFrequency, z * mFrequency, FeaturePoints(mSeed));
+			}
+			/// Neighbouring points search mostly the same cells, so if the batch covers few enough cells
+			/// their feature points are calculated once up front. The values are the same as the ones of getValue().
+			virtual void getValues (size_t count, const Real *x, const Real *y, const Real *z, Real *values, Cache *cache, Real spacing=0.0) const
+			{
+				if (!count)
+					return;
+				std::vector<Real> buffer(count*3);
+				Real *sx = &buffer[0];
+				Real *sy = sx + count;
+				Real *sz = sy + count;
+				int min[3], max[3];
+				for (size_t i=0;i<count;++i)
+				{
+					sx[i] = x[i] * mFrequency;
+					sy[i] = y[i] * mFrequency;
+					sz[i] = z[i] * mFrequency;
+					const int cell[3] = { getCell (sx[i]), getCell (sy[i]), getCell (sz[i]) };
+					for (int d=0;d<3;++d)
+					{
+						if (i == 0 || cell[d] < min[d])
+							min[d] = cell[d];
+						if (i == 0 || cell[d] > max[d])
+							max[d] = cell[d];
+					}
+				}
+				// the points look at the cells up to two away from theirs
+				double cells = 1.0;
+				for (int d=0;d<3;++d)
+				{
+					min[d] -= 2;
+					max[d] += 2;
+					cells *= double(max[d]) - double(min[d]) + 1.0;
+				}
+				if (cells <= double(count) * TABLE_CELLS_PER_POINT)
+				{
+					const FeaturePointTable table(min, max, mSeed);
+					// the batches are usually rows of points, so the nearest feature point of the previous point is a good guess
+					int nearest[3] = { max[0] + 3, max[1] + 3, max[2] + 3 };
+					for (size_t i=0;i<count;++i)
+					{
+						values[i] = calculateValue (sx[i], sy[i], sz[i], table, nearest);
+					}
+				}
+				else
+				{
+					const FeaturePoints points(mSeed);
+					int nearest[3] = { max[0] + 3, max[1] + 3, max[2] + 3 };
+					for (size_t i=0;i<count;++i)
+					{
+						values[i] = calculateValue (sx[i], sy[i], sz[i], points, nearest);
+					}
+				}
+			}
 	};
 
 	/** Module for generating Voronoi cells.
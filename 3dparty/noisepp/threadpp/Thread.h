@@ -26,5 +26,6 @@
 #include "ThreadImplementation.h"
 #include "ThreadMutex.h"
 #include "ThreadCondition.h"
+#include "ThreadJobPool.h"
 
 #endif
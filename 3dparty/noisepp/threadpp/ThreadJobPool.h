@@ -0,0 +1,330 @@
+// Thread++ Library
+// Copyright (c) 2008 Urs C. Hanselmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef THREADPP_JOBPOOL_H
+#define THREADPP_JOBPOOL_H
+
+#include "ThreadImplementation.h"
+#include "ThreadCondition.h"
+
+namespace threadpp
+{
+	/// Bounded lock-free multi-producer multi-consumer queue.
+	/// Every cell carries a sequence number which tells producers and consumers whether
+	/// the cell is free for the current lap, so push and pop only need one compare and swap.
+	template <class T>
+	class BoundedQueue
+	{
+		private:
+			struct Cell
+			{
+				std::atomic<size_t> sequence;
+				T data;
+			};
+			// keeps the two positions in different cache lines
+			enum { CACHE_LINE_SIZE=64 };
+
+			Cell *mCells;
+			size_t mMask;
+			char mPad0[CACHE_LINE_SIZE];
+			std::atomic<size_t> mPushPos;
+			char mPad1[CACHE_LINE_SIZE];
+			std::atomic<size_t> mPopPos;
+			char mPad2[CACHE_LINE_SIZE];
+
+			BoundedQueue (const BoundedQueue &);
+			BoundedQueue &operator= (const BoundedQueue &);
+
+		public:
+			/// Constructor.
+			/// @param capacity The capacity, must be a power of two
+			BoundedQueue (size_t capacity) : mCells(new Cell[capacity]), mMask(capacity - 1), mPushPos(0), mPopPos(0)
+			{
+				assert (capacity >= 2 && (capacity & (capacity - 1)) == 0);
+				for (size_t i=0;i<capacity;++i)
+				{
+					mCells[i].sequence.store (i, std::memory_order_relaxed);
+				}
+			}
+			/// Destructor.
+			~BoundedQueue ()
+			{
+				delete[] mCells;
+			}
+			/// Returns the capacity.
+			size_t capacity () const
+			{
+				return mMask + 1;
+			}
+			/// Adds an item. Returns false if the queue is full.
+			bool push (const T &data)
+			{
+				Cell *cell;
+				size_t pos = mPushPos.load (std::memory_order_relaxed);
+				for (;;)
+				{
+					cell = &mCells[pos & mMask];
+					const size_t seq = cell->sequence.load (std::memory_order_acquire);
+					const ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+					if (diff == 0)
+					{
+						if (mPushPos.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed))
+							break;
+					}
+					else if (diff < 0)
+						return false;
+					else
+						pos = mPushPos.load (std::memory_order_relaxed);
+				}
+				cell->data = data;
+				cell->sequence.store (pos + 1, std::memory_order_release);
+				return true;
+			}
+			/// Removes an item. Returns false if the queue is empty.
+			bool pop (T &data)
+			{
+				Cell *cell;
+				size_t pos = mPopPos.load (std::memory_order_relaxed);
+				for (;;)
+				{
+					cell = &mCells[pos & mMask];
+					const size_t seq = cell->sequence.load (std::memory_order_acquire);
+					const ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)(pos + 1);
+					if (diff == 0)
+					{
+						if (mPopPos.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed))
+							break;
+					}
+					else if (diff < 0)
+						return false;
+					else
+						pos = mPopPos.load (std::memory_order_relaxed);
+				}
+				data = cell->data;
+				cell->sequence.store (pos + mMask + 1, std::memory_order_release);
+				return true;
+			}
+	};
+
+	/** Pool of persistent worker threads executing jobs.
+		Jobs are added with addJob() and run by executeJobs(), which hands them to the workers
+		through a lock-free queue. The workers spin for a while before parking on a condition,
+		so a stream of small jobs doesn't pay for a wake up each. The calling thread finishes
+		the completed jobs in batches and helps executing the queued ones while it waits.
+		Derived classes implement runJob(); the job type must have a finish() function and
+		a virtual destructor.
+	*/
+	template <class Job>
+	class JobPool
+	{
+		public:
+			enum
+			{
+				/// Maximum number of jobs handed to the workers at once
+				QUEUE_SIZE=256,
+				/// Number of polls before a waiting thread parks
+				SPIN_COUNT=1000
+			};
+
+		private:
+			BoundedQueue<Job*> mQueue;
+			BoundedQueue<Job*> mDone;
+			std::queue<Job*> mPending;
+
+			ThreadGroup mThreads;
+			Mutex mMutex;
+			Condition mCond, mMainCond;
+
+			// spinning only pays off if every thread has its own core
+			unsigned mSpinCount;
+			std::atomic<bool> mThreadsDone;
+			std::atomic<bool> mMainParked;
+			std::atomic<unsigned> mParked;
+			std::atomic<size_t> mThreadCount;
+			// these two can drop below zero for a moment, since they are updated after the queue operation
+			std::atomic<int> mQueued;
+			std::atomic<int> mFinished;
+
+			JobPool (const JobPool &);
+			JobPool &operator= (const JobPool &);
+
+			void threadFunction ()
+			{
+				const size_t thread = ++mThreadCount;
+				Job *job;
+				for (;;)
+				{
+					if (mQueue.pop (job))
+					{
+						--mQueued;
+						runJob (job, thread);
+						mDone.push (job);
+						++mFinished;
+						if (mMainParked.load ())
+						{
+							Mutex::Lock lk(mMutex);
+							mMainCond.notifyOne ();
+						}
+						continue;
+					}
+					if (mThreadsDone.load ())
+						break;
+					for (unsigned i=0;i<mSpinCount && mQueued.load (std::memory_order_relaxed) <= 0 && !mThreadsDone.load (std::memory_order_relaxed);++i)
+					{
+						THREADPP_PAUSE ();
+					}
+					if (mQueued.load () <= 0)
+					{
+						Mutex::Lock lk(mMutex);
+						++mParked;
+						while (mQueued.load () <= 0 && !mThreadsDone.load ())
+							mCond.wait (lk);
+						--mParked;
+					}
+				}
+			}
+			static void *threadEntry (void *pool)
+			{
+				(static_cast<JobPool<Job>*>(pool))->threadFunction ();
+				return NULL;
+			}
+			void finishJob (Job *job)
+			{
+				job->finish ();
+				delete job;
+			}
+
+		protected:
+			/// Executes a job.
+			/// @param job The job
+			/// @param thread Index of the executing thread, 0 for the thread calling executeJobs() and 1 to numberOfThreads for the workers
+			virtual void runJob (Job *job, size_t thread) = 0;
+
+			/// Stops and joins the worker threads. Derived classes must call this in their destructor
+			/// before releasing anything runJob() uses.
+			void stopThreads ()
+			{
+				if (mThreadsDone.load ())
+					return;
+				{
+					Mutex::Lock lk(mMutex);
+					mThreadsDone.store (true);
+					mCond.notifyAll ();
+				}
+				mThreads.join ();
+				mThreads.clear ();
+			}
+
+		public:
+			/// Constructor.
+			/// @param numberOfThreads The number of worker threads
+			JobPool (size_t numberOfThreads) : mQueue(QUEUE_SIZE), mDone(QUEUE_SIZE),
+				mSpinCount(numberOfThreads < std::thread::hardware_concurrency() ? SPIN_COUNT : 0), mThreadsDone(false), mMainParked(false),
+				mParked(0), mThreadCount(0), mQueued(0), mFinished(0)
+			{
+				assert (numberOfThreads > 0);
+				for (size_t i=0;i<numberOfThreads;++i)
+				{
+					mThreads.createThread (threadEntry, this);
+				}
+			}
+			/// Destructor.
+			virtual ~JobPool ()
+			{
+				stopThreads ();
+				while (!mPending.empty())
+				{
+					delete mPending.front ();
+					mPending.pop ();
+				}
+			}
+			/// Adds a job. It is executed in the next executeJobs() call.
+			/// Must be called from the thread calling executeJobs(), and not from runJob(). Any number of jobs
+			/// can be added, executeJobs() keeps the ones beyond QUEUE_SIZE until earlier ones finish.
+			void addJob (Job *job)
+			{
+				mPending.push (job);
+			}
+			/// Executes all the added jobs and waits for them.
+			/// The finish() function of the jobs is called in the calling thread.
+			void executeJobs ()
+			{
+				// in flight jobs, never more than QUEUE_SIZE so that the done queue can't overflow
+				size_t outstanding = 0;
+				Job *job;
+				for (;;)
+				{
+					bool published = false;
+					while (!mPending.empty() && outstanding < (size_t)QUEUE_SIZE)
+					{
+						mQueue.push (mPending.front ());
+						mPending.pop ();
+						++mQueued;
+						++outstanding;
+						published = true;
+					}
+					if (published && mParked.load () > 0)
+					{
+						Mutex::Lock lk(mMutex);
+						mCond.notifyAll ();
+					}
+
+					bool finished = false;
+					while (mDone.pop (job))
+					{
+						--mFinished;
+						--outstanding;
+						finishJob (job);
+						finished = true;
+					}
+					if (finished)
+						continue;
+					if (outstanding == 0 && mPending.empty())
+						break;
+
+					if (mQueue.pop (job))
+					{
+						--mQueued;
+						runJob (job, 0);
+						--outstanding;
+						finishJob (job);
+						continue;
+					}
+
+					for (unsigned i=0;i<mSpinCount && mFinished.load (std::memory_order_relaxed) <= 0;++i)
+					{
+						THREADPP_PAUSE ();
+					}
+					if (mFinished.load () <= 0)
+					{
+						Mutex::Lock lk(mMutex);
+						mMainParked.store (true);
+						while (mFinished.load () <= 0)
+							mMainCond.wait (lk);
+						mMainParked.store (false);
+					}
+				}
+			}
+	};
+};
+
+#endif
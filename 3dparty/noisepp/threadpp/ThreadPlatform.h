@@ -38,4 +38,13 @@
 #    define THREADPP_INLINE inline
 #endif
 
+// Hint for the CPU inside spin-wait loops
+#if THREADPP_PLATFORM == THREADPP_PLATFORM_WINDOWS
+#    define THREADPP_PAUSE() YieldProcessor()
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#    define THREADPP_PAUSE() __builtin_ia32_pause()
+#else
+#    define THREADPP_PAUSE() ((void)0)
+#endif
+
 #endif
@@ -24,7 +24,11 @@
 #define THREADPP_STDHEADERS_H
 
 #include <cassert>
+#include <cstddef>
 #include <vector>
+#include <queue>
 #include <limits>
+#include <atomic>
+#include <thread>
 
 #endif
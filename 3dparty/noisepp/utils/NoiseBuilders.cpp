@@ -120,12 +120,14 @@ class SeamlessPlaneLineJob2D : public PipelineJob
 			Real y0, y1;
 			for (int i=0;i<n;++i)
 			{
-				// cleans the cache
+				// calculates the values, the cache has to be cleaned for each set of coordinates
 				mPipe->cleanCache (cache);
-				// calculates the values
 				blValue = mElement->getValue(x, y, cache);
+				mPipe->cleanCache (cache);
 				brValue = mElement->getValue(x+xExtent, y, cache);
+				mPipe->cleanCache (cache);
 				tlValue = mElement->getValue(x, y+yExtent, cache);
+				mPipe->cleanCache (cache);
 				trValue = mElement->getValue(x+xExtent, y+yExtent, cache);
 				xBlend = Real(1) - ((x-lowerX) / xExtent);
 				y0 = Math::InterpLinear(blValue, brValue, xBlend);
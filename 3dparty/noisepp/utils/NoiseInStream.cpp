@@ -68,7 +68,8 @@ void FileInStream::close ()
 void FileInStream::read (void *buffer, size_t len)
 {
 	mFile.read ((char*)buffer, (std::streamsize)len);
-	if (mFile.bad())
+	// a truncated file only sets the fail bit
+	if (mFile.gcount() != (std::streamsize)len)
 		throw std::runtime_error ("Unexpected EOF");
 }
 
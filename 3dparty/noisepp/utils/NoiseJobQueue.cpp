@@ -60,75 +60,30 @@ JobQueue::~JobQueue ()
 }
 
 #if NOISEPP_ENABLE_THREADS
-void ThreadedJobQueue::threadFunction ()
+void ThreadedJobQueue::runJob (Job *job, size_t thread)
 {
-	threadpp::Mutex::Lock lk(mMutex);
-	while (!mThreadsDone)
-	{
-		if (mJobs.empty())
-			mCond.wait(lk);
-		if (!mJobs.empty())
-		{
-			Job *job = mJobs.front ();
-			mJobs.pop ();
-			++mWorkingThreads;
-			lk.unlock ();
-			job->execute();
-			lk.lock ();
-			--mWorkingThreads;
-			mJobsDone.push (job);
-			mMainCond.notifyOne ();
-		}
-	}
-}
-
-void *ThreadedJobQueue::threadEntry (void *queue)
-{
-	(static_cast<ThreadedJobQueue*>(queue))->threadFunction ();
-	return NULL;
+	job->execute();
 }
 
-ThreadedJobQueue::ThreadedJobQueue (size_t numberOfThreads) : mThreadsDone(false), mWorkingThreads(0)
+ThreadedJobQueue::ThreadedJobQueue (size_t numberOfThreads) : threadpp::JobPool<Job>(numberOfThreads)
 {
 	NoiseAssert (numberOfThreads > 0, numberOfThreads);
-	for (size_t i=0;i<numberOfThreads;++i)
-	{
-		mThreads.createThread (threadEntry, this);
-	}
 }
 
 void ThreadedJobQueue::executeJobs ()
 {
-	mCond.notifyAll();
-	threadpp::Mutex::Lock lk(mMutex);
-	while (!mJobs.empty() || mWorkingThreads > 0)
-	{
-		if (!mJobs.empty() || mWorkingThreads > 0)
-			mMainCond.wait(lk);
-		while (!mJobsDone.empty())
-		{
-			Job *job = mJobsDone.front ();
-			mJobsDone.pop ();
-			lk.unlock ();
-			job->finish ();
-			delete job;
-			lk.lock ();
-		}
-	}
+	threadpp::JobPool<Job>::executeJobs ();
 }
 
 void ThreadedJobQueue::addJob (Job *job)
 {
 	NoiseAssert (job != NULL, job);
-	threadpp::Mutex::Lock lk(mMutex);
-	mJobs.push (job);
+	threadpp::JobPool<Job>::addJob (job);
 }
 
 ThreadedJobQueue::~ThreadedJobQueue ()
 {
-	mThreadsDone = true;
-	mCond.notifyAll();
-	mThreads.join ();
+	threadpp::JobPool<Job>::stopThreads ();
 }
 #endif
 
@@ -57,8 +57,12 @@ class JobQueue
 
 	public:
 		/// Adds a job to the queue.
+		/// Only call this from the thread which calls executeJobs(), never from a job or from another thread.
+		/// There is no limit on the number of jobs added, but ThreadedJobQueue hands at most
+		/// threadpp::JobPool::QUEUE_SIZE of them to the workers at a time and keeps the others until some finish.
 		virtual void addJob (Job *job);
 		/// executes the jobs in queue
+		/// It returns once every job added before is executed and finished.
 		virtual void executeJobs ();
 		/// Destructor.
 		virtual ~JobQueue ();
@@ -67,24 +71,14 @@ class JobQueue
 #if NOISEPP_ENABLE_THREADS
 /// A threaded job queue.
 /// You can add jobs to this queue which will be executed in several threads when you call the executeJobs() function.
-class ThreadedJobQueue : public JobQueue
+/// The workers take the jobs from a lock-free queue, the thread calling executeJobs() helps executing them.
+class ThreadedJobQueue : public JobQueue, private threadpp::JobPool<Job>
 {
 	private:
-		/// A queue for done jobs
-		std::queue<Job*> mJobsDone;
-
-		threadpp::ThreadGroup mThreads;
-		threadpp::Mutex mMutex;
-		threadpp::Condition mCond, mMainCond;
-
-		bool mThreadsDone;
-		unsigned mWorkingThreads;
-
-		void threadFunction ();
-		static void *threadEntry (void *queue);
+		virtual void runJob (Job *job, size_t thread);
 	public:
 		/// Constructor.
-		/// @param numberOfThreads The number of threads
+		/// @param numberOfThreads The number of worker threads
 		ThreadedJobQueue (size_t numberOfThreads);
 		/// @copydoc noisepp::utils::JobQueue::executeJobs()
 		virtual void executeJobs ();
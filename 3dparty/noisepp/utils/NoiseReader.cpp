@@ -127,6 +127,9 @@ void Reader::readModule ()
 		case MODULE_VORONOI:
 			module = new VoronoiModule;
 			break;
+		case MODULE_SIMPLEX:
+			module = new SimplexModule;
+			break;
 	}
 	if (!module)
 		throw ReaderException ("Invalid module type ID");
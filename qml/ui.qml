@@ -61,17 +61,33 @@ Item {
                     text: "Num triangles: " + NumTriangles + "\nNum draw calls: " + NumDrawCalls
                 }
                 Column {
-                    width: 100
+                    width: 200
+                    spacing: 2
                     Rectangle {
                         color: "white"
-                        width: parent.width
+                        width: 100
                         height: 18
                         TextInput {
+                            id: seedInput
                             anchors.fill: parent
                             verticalAlignment: TextEdit.AlignVCenter
                             validator: IntValidator {}
 
-                            onAccepted: Game.generateMap(text)
+                            onAccepted: Game.generateMap(text, graphInput.text)
+                        }
+                    }
+                    // optional .noise file with the module graph of the terrain
+                    Rectangle {
+                        color: "white"
+                        width: parent.width
+                        height: 18
+                        TextInput {
+                            id: graphInput
+                            anchors.fill: parent
+                            verticalAlignment: TextEdit.AlignVCenter
+                            clip: true
+
+                            onAccepted: Game.generateMap(seedInput.text, text)
                         }
                     }
                 }
@@ -83,5 +99,21 @@ Item {
                 }
             }
         }
+
+        Rectangle {
+            y: 55
+            x: 5
+            width: generatorProfile.width + 10
+            height: generatorProfile.height + 10
+            color: "#AA64C2D4"
+            visible: GeneratorProfile != ""
+
+            Text {
+                id: generatorProfile
+                x: 5
+                y: 5
+                text: GeneratorProfile
+            }
+        }
     }
 }
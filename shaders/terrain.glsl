@@ -27,11 +27,15 @@ uniform highp mat4 model;
 uniform highp int meshSize;
 uniform highp vec4 nodeData;
 uniform highp vec2 morphData;
+// the height of the tile at 0 in the heightmap and how much it grows to 1
+uniform highp vec2 heightRange;
 uniform highp int faceSize;
 uniform highp vec3 cameraPos;
 uniform highp vec3 cursorPos;
 
 uniform sampler2DRect heightmap;
+// the heights of the parent tile, which the tile morphs to
+uniform sampler2DRect parentHeightmap;
 uniform sampler2DRect overlay;
 in highp vec2 vertex;
 
@@ -90,7 +94,10 @@ void main(void)
         posInGrid += displace * meshSize;
     }
     vec2 uv = makeUV(posInGrid);
-    float height = texture(heightmap, uv).r;
+    vec4 heightSample = texture(heightmap, uv);
+    // the heights morph too, so that fully morphed the tile has the surface of its parent, and of
+    // the bigger neighbours next to it
+    float height = heightRange.x + mix(heightSample.r, texture(parentHeightmap, uv).r, morphing) * heightRange.y;
 
     height += texture(overlay, uv).r;
 
@@ -111,21 +118,8 @@ void main(void)
 
     gl_Position = proj * view * vec4(mapToSphere(modelPos.xyz, height), 1.);
 
-    vec3 off = vec3(-1. - morphing, 0., 1. + morphing);
-    float s01 = texture(heightmap, uv + off.xy).r;
-    float s21 = texture(heightmap, uv + off.zy).r;
-    float s10 = texture(heightmap, uv + off.yx).r;
-    float s12 = texture(heightmap, uv + off.yz).r;
-
-    vec3 v01 = mapToSphere((model * vec4(vertexGridPos(vec2(posInGrid + off.xy)), 0., 1.)).xyz, s01);
-    vec3 v21 = mapToSphere((model * vec4(vertexGridPos(vec2(posInGrid + off.zy)), 0., 1.)).xyz, s21);
-    vec3 v10 = mapToSphere((model * vec4(vertexGridPos(vec2(posInGrid + off.yx)), 0., 1.)).xyz, s10);
-    vec3 v12 = mapToSphere((model * vec4(vertexGridPos(vec2(posInGrid + off.yz)), 0., 1.)).xyz, s12);
-
-    vec3 va = v21 - v01;
-    vec3 vb = v12 - v10;
-
-    normal = vec3(cross(va, vb));
+    // the generator stores the normal of the terrain next to the height, from -1 at 0 to 1 at 1
+    normal = heightSample.gba * 2. - 1.;
 
     cursorDistance = length(cursorPos - modelPos.xyz);
 }
@@ -57,18 +57,11 @@ vec2 vertexGridPos(vec2 p)
 void main(void)
 {
     vec4 pos = vec4(vertexGridPos(vertex), 0., 1.);
-    gl_Position = pv * vec4(mapToSphere((model * pos).xyz, waterLevel), 1.);
+    vec3 p = mapToSphere((model * pos).xyz, waterLevel);
+    gl_Position = pv * vec4(p, 1.);
 
-    vec3 off = vec3(-1., 0., 1.);
-    vec3 v01 = mapToSphere((model * vec4(vertexGridPos(vec2(vertex + off.xy)), 0., 1.)).xyz, waterLevel);
-    vec3 v21 = mapToSphere((model * vec4(vertexGridPos(vec2(vertex + off.zy)), 0., 1.)).xyz, waterLevel);
-    vec3 v10 = mapToSphere((model * vec4(vertexGridPos(vec2(vertex + off.yx)), 0., 1.)).xyz, waterLevel);
-    vec3 v12 = mapToSphere((model * vec4(vertexGridPos(vec2(vertex + off.yz)), 0., 1.)).xyz, waterLevel);
-
-    vec3 va = v21 - v01;
-    vec3 vb = v12 - v10;
-
-    normal = vec3(cross(va, vb));
+    // the water is a sphere, so the normal points away from the centre
+    normal = p;
 }
 
 [fragment]
@@ -25,6 +25,8 @@
 #include <QDebug>
 #include <qmath.h>
 
+#include "NoiseSIMD.h"
+
 #include "miscutils.h"
 
 /*
@@ -168,6 +170,158 @@ QVector3D MiscUtils::mapCubeToSphere(const QVector3D &pos, double faceSize)
     return p;
 }
 
+/*
+ * The kernels of the batch versions. The AVX2 ones do the very same operations in the very same
+ * order, so the points they leave over to the scalar ones are the same as if they did them.
+ */
+static inline double cubeToSphereFactor(double a2, double b2)
+{
+    return sqrt(1.0 - a2 * 0.5 - b2 * 0.5 + a2 * b2 / 3.0);
+}
+
+static inline void cubeToSphere(double &x, double &y, double &z, double halfSize)
+{
+    const double x2 = (x / halfSize) * (x / halfSize);
+    const double y2 = (y / halfSize) * (y / halfSize);
+    const double z2 = (z / halfSize) * (z / halfSize);
+    x *= cubeToSphereFactor(y2, z2);
+    y *= cubeToSphereFactor(z2, x2);
+    z *= cubeToSphereFactor(x2, y2);
+}
+
+static inline void sphereToCube(double &x, double &y, double &z)
+{
+    const double fx = fabs(x);
+    const double fy = fabs(y);
+    const double fz = fabs(z);
+    const bool onY = fy >= fx && fy >= fz;
+    const bool onX = !onY && fx >= fy && fx >= fz;
+
+    // a and b are the coordinates on the face, the major one is the axis of the face
+    const double a = onX ? y : x;
+    const double b = onX || onY ? z : y;
+    const double major = onY ? y : onX ? x : z;
+
+    const double inverseSqrt2 = 0.70710676908493042;
+    const double a2 = a * a * 2.0;
+    const double b2 = b * b * 2.0;
+    const double inner = b2 - a2 - 3.0;
+    const double innersqrt = -sqrt(qMax(inner * inner - 12.0 * a2, 0.));
+    double ca = a == 0. ? 0. : qMin(sqrt(qMax(innersqrt + a2 - b2 + 3.0, 0.)) * inverseSqrt2, 1.);
+    double cb = b == 0. ? 0. : qMin(sqrt(qMax(innersqrt + b2 - a2 + 3.0, 0.)) * inverseSqrt2, 1.);
+    ca = a < 0. ? -ca : ca;
+    cb = b < 0. ? -cb : cb;
+    const double face = major > 0. ? 1. : -1.;
+
+    x = onX ? face : ca;
+    y = onY ? face : onX ? ca : cb;
+    z = onX || onY ? cb : face;
+}
+
+#if NOISEPP_SIMD_X86
+static NOISEPP_SIMD_AVX2_INLINE __m256d cubeToSphereFactorAVX2(__m256d a2, __m256d b2)
+{
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d sum = _mm256_sub_pd(_mm256_sub_pd(_mm256_set1_pd(1.0), _mm256_mul_pd(a2, half)), _mm256_mul_pd(b2, half));
+    return _mm256_sqrt_pd(_mm256_add_pd(sum, _mm256_div_pd(_mm256_mul_pd(a2, b2), _mm256_set1_pd(3.0))));
+}
+
+static NOISEPP_SIMD_AVX2 int cubeToSphereAVX2(double *x, double *y, double *z, int count, double halfSize)
+{
+    const __m256d d = _mm256_set1_pd(halfSize);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d px = _mm256_loadu_pd(x + i);
+        const __m256d py = _mm256_loadu_pd(y + i);
+        const __m256d pz = _mm256_loadu_pd(z + i);
+        const __m256d nx = _mm256_div_pd(px, d);
+        const __m256d ny = _mm256_div_pd(py, d);
+        const __m256d nz = _mm256_div_pd(pz, d);
+        const __m256d x2 = _mm256_mul_pd(nx, nx);
+        const __m256d y2 = _mm256_mul_pd(ny, ny);
+        const __m256d z2 = _mm256_mul_pd(nz, nz);
+        _mm256_storeu_pd(x + i, _mm256_mul_pd(px, cubeToSphereFactorAVX2(y2, z2)));
+        _mm256_storeu_pd(y + i, _mm256_mul_pd(py, cubeToSphereFactorAVX2(z2, x2)));
+        _mm256_storeu_pd(z + i, _mm256_mul_pd(pz, cubeToSphereFactorAVX2(x2, y2)));
+    }
+    return i;
+}
+
+static NOISEPP_SIMD_AVX2_INLINE __m256d sphereToCubeCoordAVX2(__m256d c, __m256d innersqrt, __m256d plus, __m256d minus)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    // sqrt(max(innersqrt + plus - minus + 3, 0)) / sqrt(2), at most 1, 0 if c is 0, with the sign of c
+    __m256d r = _mm256_add_pd(_mm256_sub_pd(_mm256_add_pd(innersqrt, plus), minus), _mm256_set1_pd(3.0));
+    r = _mm256_mul_pd(_mm256_sqrt_pd(_mm256_max_pd(r, zero)), _mm256_set1_pd(0.70710676908493042));
+    r = _mm256_min_pd(r, _mm256_set1_pd(1.0));
+    r = _mm256_blendv_pd(r, zero, _mm256_cmp_pd(c, zero, _CMP_EQ_OQ));
+    return _mm256_blendv_pd(r, _mm256_sub_pd(zero, r), _mm256_cmp_pd(c, zero, _CMP_LT_OQ));
+}
+
+static NOISEPP_SIMD_AVX2 int sphereToCubeAVX2(double *x, double *y, double *z, int count)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d px = _mm256_loadu_pd(x + i);
+        const __m256d py = _mm256_loadu_pd(y + i);
+        const __m256d pz = _mm256_loadu_pd(z + i);
+        const __m256d fx = _mm256_and_pd(px, absMask);
+        const __m256d fy = _mm256_and_pd(py, absMask);
+        const __m256d fz = _mm256_and_pd(pz, absMask);
+        const __m256d onY = _mm256_and_pd(_mm256_cmp_pd(fy, fx, _CMP_GE_OQ), _mm256_cmp_pd(fy, fz, _CMP_GE_OQ));
+        const __m256d onX = _mm256_andnot_pd(onY, _mm256_and_pd(_mm256_cmp_pd(fx, fy, _CMP_GE_OQ), _mm256_cmp_pd(fx, fz, _CMP_GE_OQ)));
+        const __m256d onXY = _mm256_or_pd(onX, onY);
+
+        const __m256d a = _mm256_blendv_pd(px, py, onX);
+        const __m256d b = _mm256_blendv_pd(py, pz, onXY);
+        const __m256d major = _mm256_blendv_pd(_mm256_blendv_pd(pz, px, onX), py, onY);
+
+        const __m256d two = _mm256_set1_pd(2.0);
+        const __m256d a2 = _mm256_mul_pd(_mm256_mul_pd(a, a), two);
+        const __m256d b2 = _mm256_mul_pd(_mm256_mul_pd(b, b), two);
+        const __m256d inner = _mm256_sub_pd(_mm256_sub_pd(b2, a2), _mm256_set1_pd(3.0));
+        const __m256d discriminant = _mm256_sub_pd(_mm256_mul_pd(inner, inner), _mm256_mul_pd(_mm256_set1_pd(12.0), a2));
+        const __m256d innersqrt = _mm256_sub_pd(zero, _mm256_sqrt_pd(_mm256_max_pd(discriminant, zero)));
+        const __m256d ca = sphereToCubeCoordAVX2(a, innersqrt, a2, b2);
+        const __m256d cb = sphereToCubeCoordAVX2(b, innersqrt, b2, a2);
+        const __m256d face = _mm256_blendv_pd(_mm256_set1_pd(-1.0), _mm256_set1_pd(1.0), _mm256_cmp_pd(major, zero, _CMP_GT_OQ));
+
+        _mm256_storeu_pd(x + i, _mm256_blendv_pd(ca, face, onX));
+        _mm256_storeu_pd(y + i, _mm256_blendv_pd(_mm256_blendv_pd(cb, ca, onX), face, onY));
+        _mm256_storeu_pd(z + i, _mm256_blendv_pd(face, cb, onXY));
+    }
+    return i;
+}
+#endif
+
+void MiscUtils::mapCubeToSphereN(double *x, double *y, double *z, int count, double halfSize)
+{
+    int i = 0;
+#if NOISEPP_SIMD_X86
+    if (noisepp::SIMD::getLevel() >= noisepp::SIMD_AVX2) {
+        i = cubeToSphereAVX2(x, y, z, count, halfSize);
+    }
+#endif
+    for (; i < count; ++i) {
+        cubeToSphere(x[i], y[i], z[i], halfSize);
+    }
+}
+
+void MiscUtils::mapSphereToCubeN(double *x, double *y, double *z, int count)
+{
+    int i = 0;
+#if NOISEPP_SIMD_X86
+    if (noisepp::SIMD::getLevel() >= noisepp::SIMD_AVX2) {
+        i = sphereToCubeAVX2(x, y, z, count);
+    }
+#endif
+    for (; i < count; ++i) {
+        sphereToCube(x[i], y[i], z[i]);
+    }
+}
+
 
 QString MiscUtils::shaderCode(const QString &fileName, const QString &shaderName)
 {
@@ -212,6 +366,8 @@ QString FileFinder::findFile(FileFinder::Type type, const QString &name)
             return QString("shaders/%1").arg(name);
         case Type::Qml:
             return QString("qml/%1").arg(name);
+        case Type::TilePack:
+            return QString("packs/%1").arg(name);
     }
 
     return QString();
@@ -31,6 +31,14 @@ public:
      */
     static QVector3D mapSphereToCube(const QVector3D &position);
     static QVector3D mapCubeToSphere(const QVector3D &pos, double faceSize);
+    /**
+     * The same as the above for count points at once, in place. The cube goes from -halfSize
+     * to halfSize, and the points of mapSphereToCubeN() must be normalized.
+     * Four points at a time are done with AVX2 if the CPU has it, see noisepp::SIMD. The results
+     * are the same either way, and differ from the single point versions only in the rounding.
+     */
+    static void mapCubeToSphereN(double *x, double *y, double *z, int count, double halfSize);
+    static void mapSphereToCubeN(double *x, double *y, double *z, int count);
 
     static QString shaderCode(const QString &filename, const QString &shader);
 };
@@ -41,7 +49,8 @@ public:
     enum class Type {
         Texture,
         Shader,
-        Qml
+        Qml,
+        TilePack
     };
 
     static QString findFile(Type type, const QString &name);
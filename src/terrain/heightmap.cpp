@@ -20,21 +20,51 @@
 #include <QSize>
 #include <QRect>
 #include <QDebug>
-#include <QVector3D>
+#include <QElapsedTimer>
+#include <QFile>
+
+#include <sstream>
+#include <string.h>
+#include <math.h>
 
 #include "heightmap.h"
 #include "terrain.h"
+#include "tilecache.h"
+#include "tilepack.h"
+#include "miscutils.h"
+
+#include "NoiseThreadedPipeline.h"
+#include "NoiseInStream.h"
 
-HeightMap::HeightMap(Generator *gen)
+HeightMap::HeightMap(Generator *gen, TileCache *cache, TilePack *pack)
          : m_size(gen->size())
          , m_generator(gen)
+         , m_cache(cache)
+         , m_pack(pack)
+         , m_generatorHash(gen->hash())
 {
     gen->map = this;
+
+    // a power of two, so the heights divide exactly and the quantisation depends on nothing but
+    // the height. One step less than 65535 fit the range, for the base rounded down to a step
+    double minHeight, maxHeight;
+    gen->heightRange(&minHeight, &maxHeight);
+    int exponent;
+    frexp(qMax(maxHeight - minHeight, 0.) / 65534., &exponent);
+    m_heightStep = ldexp(1., exponent);
+    m_heightBase = floor(minHeight / m_heightStep) * m_heightStep;
+
+    if (m_pack && (!m_generatorHash || m_pack->generatorHash() != m_generatorHash || m_pack->seed() != gen->seed())) {
+        qWarning() << "The tile pack was baked by another generator, ignoring it";
+        delete m_pack;
+        m_pack = nullptr;
+    }
 }
 
 HeightMap::~HeightMap()
 {
     delete m_generator;
+    delete m_pack;
 }
 
 HeightMapChunk *HeightMap::chunk(Face face, int x, int y, int size)
@@ -48,29 +78,373 @@ HeightMapChunk *HeightMap::chunk(Face face, int x, int y, int size)
     return chunk;
 }
 
+const quint16 *HeightMapChunk::mappedData(int size)
+{
+    TilePack *pack = map->m_pack;
+    if (!pack || pack->destSize() != size) {
+        return nullptr;
+    }
+    return pack->tile((int)m_face, m_x, m_y, m_size, &m_minHeight, &m_maxHeight);
+}
+
 bool HeightMapChunk::fetchData(int size, float *data)
 {
-    return map->m_generator->fetchData(size, m_face, QPoint(m_x, m_y), m_size, data);
+    const int count = SampleSize * (size + 4) * (size + 4);
+    if (!map->m_generator->fetchData(size, m_face, QPoint(m_x, m_y), m_size, data)) {
+        return false;
+    }
+
+    m_minHeight = m_maxHeight = data[0];
+    for (int i = 0; i < count; i += SampleSize) {
+        m_minHeight = qMin(m_minHeight, qMin(data[i], data[i + SampleSize - 1]));
+        m_maxHeight = qMax(m_maxHeight, qMax(data[i], data[i + SampleSize - 1]));
+    }
+    return true;
+}
+
+bool HeightMapChunk::fetchData(int size, quint16 *data)
+{
+    const int count = SampleSize * (size + 4) * (size + 4);
+    if (const quint16 *mapped = mappedData(size)) {
+        memcpy(data, mapped, count * sizeof(quint16));
+        return true;
+    }
+
+    const bool cached = map->m_cache && map->m_generatorHash;
+    const TileCache::Key key = { map->m_generatorHash, map->m_generator->seed(), (qint32)m_face, m_x, m_y, m_size, size };
+    if (cached && map->m_cache->load(key, data, count, &m_minHeight, &m_maxHeight)) {
+        return true;
+    }
+
+    QVector<float> samples(count);
+    if (!fetchData(size, samples.data())) {
+        return false;
+    }
+    quantise(samples.constData(), count / SampleSize, map->m_heightBase, map->m_heightStep, data);
+
+    if (cached) {
+        map->m_cache->store(key, data, count, m_minHeight, m_maxHeight);
+    }
+    return true;
+}
+
+void HeightMapChunk::quantise(const float *samples, int count, double baseHeight, double heightStep, quint16 *data)
+{
+    auto height = [=](float h) -> quint16 { return qBound(0., floor((h - baseHeight) / heightStep + 0.5), 65535.); };
+    for (int i = 0; i < count * SampleSize; i += SampleSize) {
+        data[i] = height(samples[i]);
+        for (int j = 1; j < SampleSize - 1; ++j) {
+            data[i + j] = qBound(0.f, (samples[i + j] + 1.f) * 32767.5f + 0.5f, 65535.f);
+        }
+        data[i + SampleSize - 1] = height(samples[i + SampleSize - 1]);
+    }
+}
+
+/**
+ * Bump when the terrain of the generators changes without their parameters doing so,
+ * so that the tiles cached on disk get generated again
+ */
+static const int GeneratorVersion = 8;
+
+/**
+ * The lines of samples kept around the edges of the tiles, the edge and the two lines on either
+ * side of it, which are the apron of the tile and the samples the neighbour needs for its apron
+ */
+static const int BorderLines = 5;
+
+
+/**
+ * The point of the cube at (x, y) on a face, with the cube going from -mapSize / 2 to mapSize / 2
+ */
+static void cubePoint(HeightMap::Face face, int mapSize, int x, int y, int point[3])
+{
+    const int s = mapSize / 2;
+    const int p[][3] = { { -s + x, -s + y, s },     // Top
+                         { s - y,  s - x,  -s },    // Bottom
+                         { -s + x, -s,     -s + y }, // Front
+                         { s,      -s + x, -s + y }, // Right
+                         { -s,     s - x,  -s + y }, // Left
+                         { s - x,  s,      -s + y } }; // Back
+    memcpy(point, p[(int)face], sizeof(p[0]));
+}
+
+/**
+ * The point of the cube of the sample (i, j) of a tile, apron included, with the cube going from
+ * -mapSize / 2 to mapSize / 2 scaled to the noise sphere. The coordinates are integers on a grid
+ * destSize - 1 times finer than the map until the last multiplication, so every tile and every
+ * face calculates a point they share to the same bit.
+ */
+static void tileCubePoint(int mapSize, int destSize, HeightMap::Face face, const QPoint &pos, int size, int i, int j, double point[3])
+{
+    const int steps = destSize - 1;
+    int p[3];
+    // the apron starts two samples before the tile
+    cubePoint(face, mapSize * steps, pos.x() * steps + (j - 2) * size, pos.y() * steps + (i - 2) * size, p);
+    const double multiplier = 1. / 8000. / steps;
+    for (int k = 0; k < 3; ++k) {
+        point[k] = p[k] * multiplier;
+    }
+}
+
+/**
+ * Fills x, y and z with the points on the noise sphere of the samples of a tile, apron included.
+ * Returns the distance between the samples.
+ */
+static double tilePoints(int mapSize, int destSize, HeightMap::Face face, const QPoint &pos, int size,
+                         QVector<noisepp::Real> &x, QVector<noisepp::Real> &y, QVector<noisepp::Real> &z)
+{
+    const double multiplier = 1. / 8000.;
+    const double faceSize = mapSize * multiplier;
+    const double stepSize = size * multiplier / (double)(destSize - 1);
+
+    const int width = destSize + 4;
+    const int count = width * width;
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+
+    int n = 0;
+    for (int i = 0; i < width; ++i) {
+        for (int j = 0; j < width; ++j) {
+            double point[3];
+            tileCubePoint(mapSize, destSize, face, pos, size, i, j, point);
+            x[n] = point[0];
+            y[n] = point[1];
+            z[n] = point[2];
+            ++n;
+        }
+    }
+    MiscUtils::mapCubeToSphereN(x.data(), y.data(), z.data(), count, faceSize / 2.);
+
+    return stepSize;
+}
+
+/**
+ * The tile of twice the size containing a tile, see QuadTreeNode::selectNode()
+ */
+static QPoint parentPos(const QPoint &pos, int size)
+{
+    return QPoint(pos.x() - pos.x() % (2 * size), pos.y() - pos.y() % (2 * size));
+}
+
+/**
+ * The indices in the parent of a tile of the samples an even number of steps from the corner of
+ * the tile, apron included, in rows of destSize / 2 + 3. destSize must be odd.
+ */
+static QVector<int> parentSamples(int destSize, const QPoint &pos, int size)
+{
+    const int width = destSize + 4;
+    const int half = width / 2 + 1;
+    const QPoint parent = parentPos(pos, size);
+    // where the tile starts in the parent, in samples of the parent
+    const int x = (pos.x() - parent.x()) * (destSize - 1) / (2 * size);
+    const int y = (pos.y() - parent.y()) * (destSize - 1) / (2 * size);
+
+    QVector<int> indices;
+    indices.reserve(half * half);
+    for (int a = 0; a < half; ++a) {
+        for (int b = 0; b < half; ++b) {
+            // the sample 2 * a of the tile is a - 1 of the parent from the corner, then both have the apron
+            indices << (y + a + 1) * width + x + b + 1;
+        }
+    }
+    return indices;
+}
+
+/**
+ * Fills the parent heights of a tile, see Generator::fetchData(), from the samples of the parent
+ * at parentSamples(). Without a parent, on the tile of a whole face, with the heights of the tile.
+ */
+static void storeParentHeights(int destSize, const float *parent, float *data)
+{
+    const int width = destSize + 4;
+    const int half = width / 2 + 1;
+    const int h = HeightMapChunk::SampleSize - 1;
+    auto height = [&](int i, int j) -> float & { return data[(i * width + j) * HeightMapChunk::SampleSize + h]; };
+
+    if (!parent) {
+        for (int i = 0; i < width * width; ++i) {
+            data[i * HeightMapChunk::SampleSize + h] = data[i * HeightMapChunk::SampleSize];
+        }
+        return;
+    }
+
+    for (int a = 0; a < half; ++a) {
+        for (int b = 0; b < half; ++b) {
+            height(2 * a, 2 * b) = parent[(a * half + b) * HeightMapChunk::SampleSize];
+        }
+    }
+    // the mesh of the parent is flat in between. Its quads are split along the diagonal from the
+    // corner with the larger x and the smaller y to the other, see QuadTreeNode::uploadData()
+    for (int i = 0; i < width; i += 2) {
+        for (int j = 1; j < width; j += 2) {
+            height(i, j) = (height(i, j - 1) + height(i, j + 1)) / 2.f;
+            if (i + 2 < width) {
+                height(i + 1, j - 1) = (height(i, j - 1) + height(i + 2, j - 1)) / 2.f;
+                height(i + 1, j) = (height(i, j + 1) + height(i + 2, j - 1)) / 2.f;
+            }
+        }
+        if (i + 2 < width) {
+            height(i + 1, width - 1) = (height(i, width - 1) + height(i + 2, width - 1)) / 2.f;
+        }
+    }
+}
+
+/**
+ * Turns the noise values and their gradient at the points on the noise sphere into the
+ * samples of a tile, see HeightMapChunk::SampleSize.
+ */
+static void storeSamples(int count, const noisepp::Real *x, const noisepp::Real *y, const noisepp::Real *z,
+                         const noisepp::Real *values, const noisepp::Real *dx, const noisepp::Real *dy, const noisepp::Real *dz,
+                         double heightScale, double radius, float *data)
+{
+    for (int i = 0; i < count; ++i) {
+        const double height = heightScale * (values[i] + 1.) / 2.;
+        float *sample = data + HeightMapChunk::SampleSize * i;
+        sample[0] = height;
+
+        // the point on the noise sphere is also the direction of the vertex
+        const double length = sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+        const double u[3] = { x[i] / length, y[i] / length, z[i] / length };
+        const double gradient[3] = { heightScale / 2. * dx[i], heightScale / 2. * dy[i], heightScale / 2. * dz[i] };
+        const double radial = gradient[0] * u[0] + gradient[1] * u[1] + gradient[2] * u[2];
+        // a step along the surface moves the noise point by length / (radius + height) times as much,
+        // only the tangential part of the gradient tilts the normal
+        const double k = length / (radius + height);
+        double normal[3];
+        for (int j = 0; j < 3; ++j) {
+            normal[j] = u[j] - k * (gradient[j] - radial * u[j]);
+        }
+        const double normalLength = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (int j = 0; j < 3; ++j) {
+            sample[j + 1] = normal[j] / normalLength;
+        }
+    }
+}
+
+/**
+ * The bounds of the values of an element on the whole noise sphere, or -1 to 1 if it can't bound them
+ */
+static void sphereBounds(const noisepp::PipelineElement3D *element, int mapSize, noisepp::Real *lower, noisepp::Real *upper)
+{
+    const double radius = mapSize / 8000. / 2.;
+    noisepp::Box3D box;
+    for (int k = 0; k < 3; ++k) {
+        box.min[k] = -radius;
+        box.max[k] = radius;
+    }
+    if (!element->getBounds(box, *lower, *upper)) {
+        *lower = -1;
+        *upper = 1;
+    }
+}
+
+/**
+ * The range of the heights of the graph on the whole noise sphere, or the one of its values from
+ * -1 to 1 if it can't bound them
+ */
+static void graphHeightRange(const noisepp::PipelineElement3D *root, int mapSize, double heightScale, double *minHeight, double *maxHeight)
+{
+    noisepp::Real lower, upper;
+    sphereBounds(root, mapSize, &lower, &upper);
+    *minHeight = heightScale * (lower + 1.) / 2.;
+    *maxHeight = heightScale * (upper + 1.) / 2.;
 }
 
+/**
+ * A bound of the error the map and the patches add to the octaves of a Perlin module at the spacing.
+ * Until the spacing resolves the levels after the map, the tile takes the level of the map it resolves, then
+ * the whole map and the patch of the levels after it. The errors are the ones of the levels of the map.
+ * Every patch level has as many samples per wave of its highest octave as the levels of the map, so
+ * its error is taken as the one of the top level of the map, scaled down to the amplitude of its octave.
+ */
+static double bakedError(const noisepp::ShellMap *map, const QVector<double> &errors, double persistence, double spacing)
+{
+    const int patchLevel = noisepp::ShellPatch(map).getLevel(spacing);
+    if (patchLevel == 0) {
+        const int level = map->getLevel(spacing);
+        return level > 0 ? errors[level - 1] : 0.;
+    }
+    const int top = map->getOctaveCount();
+    double error = errors[top - 1];
+    for (int n = top + 1; n <= patchLevel; ++n) {
+        error += errors[top - 1] * pow(persistence, n - top);
+    }
+    return error;
+}
 
-static QVector3D mapToSphere(const QVector3D &pos, double faceSize)
+class RandomGenerator::RowsJob : public noisepp::PipelineJob
 {
-    QVector3D p = pos;
-    double d = faceSize / 2.;
-    double x = p.x() / d;
-    double y = p.y() / d;
-    double z = p.z() / d;
-    p[0] *= sqrt(1.0 - y * y * 0.5 - z * z * 0.5 + y * y * z * z / 3.0);
-    p[1] *= sqrt(1.0 - z * z * 0.5 - x * x * 0.5 + z * z * x * x / 3.0);
-    p[2] *= sqrt(1.0 - x * x * 0.5 - y * y * 0.5 + x * x * y * y / 3.0);
+public:
+    RowsJob(RandomGenerator *generator, int offset, int count, double spacing, double radius, float *data)
+        : m_planet(generator->m_planet)
+        , m_count(count)
+        , m_x(generator->m_x.constData() + offset)
+        , m_y(generator->m_y.constData() + offset)
+        , m_z(generator->m_z.constData() + offset)
+        , m_spacing(spacing)
+        , m_heightScale(generator->m_heightScale)
+        , m_radius(radius)
+        , m_values(generator->m_values.data() + offset)
+        , m_dx(generator->m_dx.data() + offset)
+        , m_dy(generator->m_dy.data() + offset)
+        , m_dz(generator->m_dz.data() + offset)
+        , m_data(data + HeightMapChunk::SampleSize * offset)
+    {
+    }
+
+    void execute(noisepp::Cache *) override
+    {
+        m_planet->getDerivatives(m_count, m_x, m_y, m_z, m_values, m_dx, m_dy, m_dz, m_spacing);
+        storeSamples(m_count, m_x, m_y, m_z, m_values, m_dx, m_dy, m_dz, m_heightScale, m_radius, m_data);
+    }
+
+private:
+    const Planet *m_planet;
+    int m_count;
+    const noisepp::Real *m_x;
+    const noisepp::Real *m_y;
+    const noisepp::Real *m_z;
+    double m_spacing;
+    double m_heightScale;
+    double m_radius;
+    noisepp::Real *m_values;
+    noisepp::Real *m_dx;
+    noisepp::Real *m_dy;
+    noisepp::Real *m_dz;
+    float *m_data;
+};
 
-    return p;
+static const noisepp::PerlinElement3D *bakedElement(noisepp::Pipeline3D *pipeline, const noisepp::PerlinModule &module)
+{
+    return static_cast<const noisepp::PerlinElement3D *>(pipeline->getElement(module.addToPipeline(pipeline)));
 }
 
-RandomGenerator::RandomGenerator(int size, double heightScale, int seed)
+RandomGenerator::RandomGenerator(int size, double heightScale, int seed, int threads, bool bake)
+               : RandomGenerator(size, heightScale, seed, threads, bake, nullptr)
+{
+}
+
+RandomGenerator::RandomGenerator(RandomGenerator *other, int threads)
+               : RandomGenerator(other->m_size, other->m_heightScale, other->m_seed, threads, other->m_bake, other)
+{
+}
+
+RandomGenerator::RandomGenerator(int size, double heightScale, int seed, int threads, bool bake, RandomGenerator *other)
                : m_size(size)
                , m_heightScale(heightScale)
+               , m_seed(seed)
+               , m_threads(qMax(threads, 1))
+               , m_bake(bake)
+               , m_continentsMap(nullptr)
+               , m_mountainDefinitionMap(nullptr)
+               , m_ownsMaps(!other)
+               , m_patches(nullptr)
+               , m_bakeTime(-1)
+               // in KB too, a border of a tile of 33 samples takes about 3
+               , m_borders(8 * 1024)
+               , m_borderHits(0)
+               , m_borderSamples(0)
 {
     m_ocean.setValue(-1.0);
 
@@ -122,65 +496,779 @@ RandomGenerator::RandomGenerator(int size, double heightScale, int seed)
     m_continentSelect.setLowerBound(0.0);
     m_continentSelect.setEdgeFalloff(0.1);
 
-    m_pipeline = new noisepp::Pipeline3D;
-    noisepp::ElementID id = m_continentSelect.addToPipeline(m_pipeline);
-    m_element = m_pipeline->getElement(id);
-    m_cache = m_pipeline->createCache();
+    // a plain pipeline runs the jobs in the calling thread. The threaded one also uses it, together with the workers
+    m_pipeline = m_threads > 1 ? new noisepp::ThreadedPipeline3D(m_threads - 1) : new noisepp::Pipeline3D;
+
+    if (bake && other) {
+        // the maps only hold the octaves, which are the same for the same seed. The elements of the
+        // other pipeline they sample to build the patches are never changed, so any thread can use them
+        other->buildMaps();
+        m_continentsMap = other->m_continentsMap;
+        m_mountainDefinitionMap = other->m_mountainDefinitionMap;
+        m_patchCache = other->m_patchCache;
+    } else if (bake) {
+        // the maps are only built by the first fetchData(), on the thread generating the tiles
+        // the radius of the sphere fetchData() samples the noise on
+        const double radius = size / 8000. / 2.;
+        // 6 octaves of the continents and 3 of the mountain definition take about 20 MB with the default
+        // resolution, more octaves quickly get expensive since every one quadruples the samples
+        m_continentsMap = new noisepp::ShellMap(bakedElement(m_pipeline, m_continents), radius, 6);
+        m_mountainDefinitionMap = new noisepp::ShellMap(bakedElement(m_pipeline, m_mountainDefinition), radius * m_mountainDefinitionScalePoint.getScaleX(), 3);
+        m_patchCache = std::make_shared<PatchCache>();
+    }
+    if (bake) {
+        m_patches = new Patches{ noisepp::ShellPatch(m_continentsMap), noisepp::ShellPatch(m_mountainDefinitionMap) };
+    }
+
+    // the graph is fixed, so build it as a compiled pipeline. m_pipeline only owns the generator elements
+    using namespace noisepp::compiled;
+    m_planet = new Planet(m_continentSelect, Constant(m_ocean),
+                          Land(m_mountainSelectScaleBias,
+                               Select<Lowlands, Mountains, MountainDefinition>(m_mountainSelect,
+                                   Lowlands(m_lowlandsScalePoint, ScaleBias<Element<noisepp::BillowElement3D>>(m_lowlandsScaleBias,
+                                            Element<noisepp::BillowElement3D>(m_pipeline, m_lowlands))),
+                                   Mountains(m_mountainsScalePoint, ScaleBias<Element<noisepp::RidgedMultiElement3D>>(m_mountainsScaleBias,
+                                             Element<noisepp::RidgedMultiElement3D>(m_pipeline, m_mountains))),
+                                   MountainDefinition(m_mountainDefinitionScalePoint, Perlin(m_pipeline, m_mountainDefinition, m_mountainDefinitionMap,
+                                                                                                        m_patches ? &m_patches->mountainDefinition : nullptr)))),
+                          Perlin(m_pipeline, m_continents, m_continentsMap, m_patches ? &m_patches->continents : nullptr));
+}
+
+RandomGenerator::~RandomGenerator()
+{
+    delete m_planet;
+    delete m_patches;
+    if (m_ownsMaps) {
+        delete m_continentsMap;
+        delete m_mountainDefinitionMap;
+    }
+    delete m_pipeline;
+}
+
+/**
+ * An edge between two tiles of the same size, on the side of a tile
+ */
+struct RandomGenerator::Edge {
+    quint64 key;
+    // the sample of the tile at the start of its border, and the steps along and across the edge
+    int first;
+    int along;
+    int across;
+    // the samples of the border along the edge and across it
+    int length;
+    int lines;
+};
+
+/**
+ * The edges at x and at x + size run along y, the other two along x. Both the tiles on the sides
+ * of an edge find it with the same key.
+ */
+static quint64 edgeKey(HeightMap::Face face, bool alongY, int size, int line, int start)
+{
+    return ((((quint64)face * 2 + alongY) * 0x10000 + size) * 0x10000 + line) * 0x10000 + start;
+}
+
+/**
+ * The key of a segment of one of the twelve edges of the cube, the same for both the faces on it.
+ * Returns false in reversed if the segment runs from a to b on the edge, true if from b to a.
+ */
+static quint64 seamKey(const int a[3], const int b[3], int mapSize, int destSize, bool *reversed)
+{
+    // only one coordinate changes along an edge, the other two are on the sides of the cube
+    const int axis = a[0] != b[0] ? 0 : a[1] != b[1] ? 1 : 2;
+    const int sides = (a[(axis + 1) % 3] > 0) * 2 + (a[(axis + 2) % 3] > 0);
+    *reversed = a[axis] > b[axis];
+    const int start = qMin(a[axis], b[axis]) + mapSize / 2;
+    const int end = qMax(a[axis], b[axis]) + mapSize / 2;
+    // apart from the keys of the edges inside the faces
+    return (1ULL << 63) | (((((quint64)axis * 4 + sides) * 0x10000 + start) * 0x10000 + end) * 0x10000 + destSize);
+}
+
+void RandomGenerator::tileEdges(int destSize, HeightMap::Face face, const QPoint &pos, int size, Edge *edges) const
+{
+    // the rows of the tile go along y and the columns along x, with the apron the edges of the tile
+    // are the third line and the third to last
+    const int width = destSize + 4;
+    const int last = destSize + 1;
+    const int mapSize = map->size();
+    const int x = pos.x();
+    const int y = pos.y();
+
+    // on the edges of the face the neighbour is on another face, and its samples are on a differently
+    // bent plane. Only the line of the edge itself is at the same points, but maybe the other way round
+    auto seam = [&](int x0, int y0, int x1, int y1, int first, int along) -> Edge {
+        int a[3], b[3];
+        cubePoint(face, mapSize, x0, y0, a);
+        cubePoint(face, mapSize, x1, y1, b);
+        bool reversed;
+        const quint64 key = seamKey(a, b, mapSize, destSize, &reversed);
+        return reversed ? Edge{ key, first + (destSize - 1) * along, -along, 0, destSize, 1 }
+                        : Edge{ key, first, along, 0, destSize, 1 };
+    };
+
+    edges[0] = x > 0 ? Edge{ edgeKey(face, true, size, x, y), 0, width, 1, width, BorderLines }
+                     : seam(x, y, x, y + size, 2 * width + 2, width);
+    edges[1] = x + size < mapSize ? Edge{ edgeKey(face, true, size, x + size, y), last - 2, width, 1, width, BorderLines }
+                                  : seam(x + size, y, x + size, y + size, 2 * width + last, width);
+    edges[2] = y > 0 ? Edge{ edgeKey(face, false, size, y, x), 0, 1, width, width, BorderLines }
+                     : seam(x, y, x + size, y, 2 * width + 2, 1);
+    edges[3] = y + size < mapSize ? Edge{ edgeKey(face, false, size, y + size, x), (last - 2) * width, 1, width, width, BorderLines }
+                                  : seam(x, y + size, x + size, y + size, last * width + 2, 1);
 }
 
 bool RandomGenerator::fetchData(int destSize, HeightMap::Face face, const QPoint &pos, int size, float *data)
 {
-    const double multiplier = 1. / 8000.;
+    buildMaps();
+
+    // take the borders the neighbours left, marking their samples as done
+    const int width = destSize + 4;
+    const int count = width * width;
+    Edge edges[4];
+    tileEdges(destSize, face, pos, size, edges);
+    QVector<bool> done(count, false);
+    bool taken[4] = { false, false, false, false };
+    for (int e = 0; e < 4; ++e) {
+        // only two tiles share an edge, so the border is of no use anymore after this
+        const Edge &edge = edges[e];
+        Border *border = m_borders.take(edge.key);
+        if (border && border->destSize == destSize) {
+            for (int a = 0; a < edge.length; ++a) {
+                for (int l = 0; l < edge.lines; ++l) {
+                    const int i = edge.first + a * edge.along + l * edge.across;
+                    memcpy(data + i * HeightMapChunk::SampleSize, border->samples.constData() + (a * edge.lines + l) * HeightMapChunk::SampleSize,
+                           HeightMapChunk::SampleSize * sizeof(float));
+                    done[i] = true;
+                }
+            }
+            taken[e] = true;
+        }
+        delete border;
+    }
+
+    QVector<int> left;
+    left.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        if (!done[i]) {
+            left << i;
+        }
+    }
+    m_borderHits += count - left.size();
+    m_borderSamples += count;
 
-    double fw = (double)(size) * multiplier;
+    QVector<float> samples(left.size() * HeightMapChunk::SampleSize);
+    calculate(destSize, face, pos, size, left, samples.data());
+    for (int k = 0; k < left.size(); ++k) {
+        memcpy(data + left[k] * HeightMapChunk::SampleSize, samples.constData() + k * HeightMapChunk::SampleSize,
+               HeightMapChunk::SampleSize * sizeof(float));
+    }
+
+    // calculated the way the parent calculates them, at its spacing and with the patches of the
+    // same tiles, so they are its samples to the bit
+    if (2 * size <= map->size()) {
+        const QVector<int> indices = parentSamples(destSize, pos, size);
+        samples.resize(indices.size() * HeightMapChunk::SampleSize);
+        calculate(destSize, face, parentPos(pos, size), 2 * size, indices, samples.data());
+        storeParentHeights(destSize, samples.constData(), data);
+    } else {
+        storeParentHeights(destSize, nullptr, data);
+    }
+
+    // leave the other borders to the neighbours still to come
+    for (int e = 0; e < 4; ++e) {
+        if (taken[e]) {
+            continue;
+        }
+        const Edge &edge = edges[e];
+        Border *border = new Border{ destSize, QVector<float>(edge.length * edge.lines * HeightMapChunk::SampleSize) };
+        for (int a = 0; a < edge.length; ++a) {
+            for (int l = 0; l < edge.lines; ++l) {
+                const int i = edge.first + a * edge.along + l * edge.across;
+                memcpy(border->samples.data() + (a * edge.lines + l) * HeightMapChunk::SampleSize, data + i * HeightMapChunk::SampleSize,
+                       HeightMapChunk::SampleSize * sizeof(float));
+            }
+        }
+        m_borders.insert(edge.key, border, border->samples.size() * sizeof(float) / 1024 + 1);
+    }
+
+    return true;
+}
 
-    const double faceSize = map->size() * multiplier;
-    const double stepSize = fw / (double)(destSize - 1);
-    double s = faceSize / 2.;
+void RandomGenerator::calculate(int destSize, HeightMap::Face face, const QPoint &pos, int size, const QVector<int> &indices, float *data)
+{
+    QVector<noisepp::Real> tileX, tileY, tileZ;
+    const double stepSize = tilePoints(map->size(), destSize, face, pos, size, tileX, tileY, tileZ);
+    const int width = destSize + 4;
+    const int n = indices.size();
 
-    double fx = pos.x() * multiplier - 2*stepSize;
-    double fy = pos.y() * multiplier - 2*stepSize;
+    // the samples around the edges are also calculated by the neighbours, so they must come out
+    // the same whichever tile calculates them. They take the patches of the first tile, by y and x,
+    // of the ones of this size having them: the neighbour before the tile for the lines on either
+    // side of its left and top edges, the tile itself for the others. The edges of the cube are on
+    // two faces, which have different patches, so they are calculated without any
+    enum Owner { Own, Left, Top, TopLeft, Seam, Owners };
+    const int steps = destSize - 1;
+    const int mapSize = map->size() * steps;
+    QVector<int> owners(n, Own);
+    int ownerCount[Owners] = { };
+    for (int k = 0; k < n; ++k) {
+        const int i = indices[k];
+        if (m_patches) {
+            const int u = pos.x() * steps + (i % width - 2) * size;
+            const int v = pos.y() * steps + (i / width - 2) * size;
+            const bool left = pos.x() > 0 && i % width - 2 <= BorderLines / 2;
+            const bool top = pos.y() > 0 && i / width - 2 <= BorderLines / 2;
+            owners[k] = u == 0 || u == mapSize || v == 0 || v == mapSize ? Seam : left && top ? TopLeft : left ? Left : top ? Top : Own;
+        }
+        ++ownerCount[owners[k]];
+    }
+    int ownerStart[Owners + 1] = { 0 };
+    for (int o = 0; o < Owners; ++o) {
+        ownerStart[o + 1] = ownerStart[o] + ownerCount[o];
+    }
 
-    QVector3D start = face == HeightMap::Face::Bottom ? QVector3D(s - fy,  s - fx,  -s) :
-                        face == HeightMap::Face::Front  ? QVector3D(-s + fx, -s,      -s + fy) :
-                        face == HeightMap::Face::Right  ? QVector3D(s,       -s + fx, -s + fy) :
-                        face == HeightMap::Face::Back   ? QVector3D(s - fx,  s,       -s + fy) :
-                        face == HeightMap::Face::Left   ? QVector3D(-s,      s - fx,  -s + fy) :
-                                                        QVector3D(-s + fx, -s + fy, s);
+    // sort the points by owner
+    int next[Owners];
+    memcpy(next, ownerStart, sizeof(next));
+    m_x.resize(n);
+    m_y.resize(n);
+    m_z.resize(n);
+    m_indices.resize(n);
+    for (int k = 0; k < n; ++k) {
+        const int sorted = next[owners[k]]++;
+        m_x[sorted] = tileX[indices[k]];
+        m_y[sorted] = tileY[indices[k]];
+        m_z[sorted] = tileZ[indices[k]];
+        m_indices[sorted] = k;
+    }
 
+    m_values.resize(n);
+    m_dx.resize(n);
+    m_dy.resize(n);
+    m_dz.resize(n);
+    m_samples.resize(n * HeightMapChunk::SampleSize);
 
-    QVector3D step = face == HeightMap::Face::Bottom ? QVector3D(0, -stepSize, 0) :
-                        face == HeightMap::Face::Front  ? QVector3D(stepSize, 0, 0) :
-                        face == HeightMap::Face::Right  ? QVector3D(0, stepSize, 0) :
-                        face == HeightMap::Face::Back   ? QVector3D(-stepSize, 0, 0) :
-                        face == HeightMap::Face::Left   ? QVector3D(0, -stepSize, 0) :
-                                                        QVector3D(stepSize, 0, 0);
+    // two jobs per thread, so a slow one doesn't keep the others waiting. Jobs of a few rows
+    // also keep the batches big enough for the Select elements to skip the dead branches
+    const int pointsPerJob = qMax(2 * width, (n + 2 * m_threads - 1) / (2 * m_threads));
+    // the renderer shrinks the faces by (destSize - 1) / destSize, so neighbouring tiles share their edges
+    const double radius = map->size() / 2. * (destSize - 1) / destSize;
+    const QPoint owner[] = { pos, QPoint(pos.x() - size, pos.y()), QPoint(pos.x(), pos.y() - size), QPoint(pos.x() - size, pos.y() - size) };
+    for (int o = 0; o < Owners; ++o) {
+        if (ownerCount[o] == 0) {
+            continue;
+        }
+        if (m_patches) {
+            // copied, the cache may drop them while making the ones of another owner or in another generator
+            if (o == Seam || !patches(destSize, face, owner[o], size, m_patches)) {
+                m_patches->continents.clear();
+                m_patches->mountainDefinition.clear();
+            }
+        }
+        for (int offset = ownerStart[o]; offset < ownerStart[o + 1]; offset += pointsPerJob) {
+            // the octaves finer than the distance between the samples only add aliasing, skip them
+            m_pipeline->addJob(new RowsJob(this, offset, qMin(pointsPerJob, ownerStart[o + 1] - offset), stepSize, radius, m_samples.data()));
+        }
+        m_pipeline->executeJobs();
+    }
 
-    QVector3D lineStep = face == HeightMap::Face::Bottom ? QVector3D(-stepSize, 0, 0) :
-                            face == HeightMap::Face::Front  ? QVector3D(0, 0, stepSize) :
-                            face == HeightMap::Face::Right  ? QVector3D(0, 0, stepSize) :
-                            face == HeightMap::Face::Back   ? QVector3D(0, 0, stepSize) :
-                            face == HeightMap::Face::Left   ? QVector3D(0, 0, stepSize) :
-                                                            QVector3D(0, stepSize, 0);
+    for (int k = 0; k < n; ++k) {
+        memcpy(data + m_indices[k] * HeightMapChunk::SampleSize, m_samples.constData() + k * HeightMapChunk::SampleSize,
+               HeightMapChunk::SampleSize * sizeof(float));
+    }
+}
 
+static quint64 tileKey(HeightMap::Face face, const QPoint &pos, int size)
+{
+    return (((quint64)face * 0x10000 + size) * 0x10000 + pos.x()) * 0x10000 + pos.y();
+}
 
+static void buildPatch(noisepp::ShellPatch &patch, const noisepp::ShellPatch *parent, double spacing, double scale,
+                       const QVector<noisepp::Real> &x, const QVector<noisepp::Real> &y, const QVector<noisepp::Real> &z)
+{
+    const size_t level = patch.getLevel(spacing * scale);
+    if (level == 0) {
+        return;
+    }
+    if (scale == 1.) {
+        patch.build(level, x.size(), x.constData(), y.constData(), z.constData(), parent);
+        return;
+    }
+    QVector<noisepp::Real> sx(x.size()), sy(y.size()), sz(z.size());
+    for (int i = 0; i < x.size(); ++i) {
+        sx[i] = x[i] * scale;
+        sy[i] = y[i] * scale;
+        sz[i] = z[i] * scale;
+    }
+    patch.build(level, sx.size(), sx.constData(), sy.constData(), sz.constData(), parent);
+}
 
-    float *ptr = data;
-    QVector3D line = start;
-    for (int i = 0; i < destSize + 4; ++i) {
-        QVector3D point = line;
-        for (int j = 0; j < destSize + 4; ++j) {
-            QVector3D p = mapToSphere(point, faceSize);
-            *ptr++ = m_heightScale * (m_element->getValue(p.x(), p.y(), p.z(), m_cache) + 1.) / 2.;
-            point += step;
+bool RandomGenerator::patches(int destSize, HeightMap::Face face, const QPoint &pos, int size, Patches *patches)
+{
+    const quint64 key = tileKey(face, pos, size);
+    {
+        QMutexLocker lock(&m_patchCache->mutex);
+        if (const Patches *cached = m_patchCache->patches.object(key)) {
+            *patches = *cached;
+            return true;
         }
-        line += lineStep;
     }
 
+    QVector<noisepp::Real> x, y, z;
+    const double spacing = tilePoints(map->size(), destSize, face, pos, size, x, y, z);
+    const double scale = m_mountainDefinitionScalePoint.getScaleX();
+    if (m_patches->continents.getLevel(spacing) == 0 && m_patches->mountainDefinition.getLevel(spacing * scale) == 0) {
+        return false;
+    }
+
+    // a tile is split in four of half its size, see QuadTreeNode::selectNode(). The parent is rebuilt
+    // if it is gone, so that the patches of a tile are always the same and the tiles agree on their edges.
+    // Built without the lock, two generators may build the same patches, to the same bits
+    Patches parent{ noisepp::ShellPatch(m_continentsMap), noisepp::ShellPatch(m_mountainDefinitionMap) };
+    const bool hasParent = 2 * size <= map->size() && this->patches(destSize, face, parentPos(pos, size), 2 * size, &parent);
+    *patches = Patches{ noisepp::ShellPatch(m_continentsMap), noisepp::ShellPatch(m_mountainDefinitionMap) };
+    buildPatch(patches->continents, hasParent ? &parent.continents : nullptr, spacing, 1., x, y, z);
+    buildPatch(patches->mountainDefinition, hasParent ? &parent.mountainDefinition : nullptr, spacing, scale, x, y, z);
+
+    const int cost = (patches->continents.getMemoryUsage() + patches->mountainDefinition.getMemoryUsage()) / 1024 + 1;
+    QMutexLocker lock(&m_patchCache->mutex);
+    m_patchCache->patches.insert(key, new Patches(*patches), cost);
     return true;
 }
 
+void RandomGenerator::buildMaps()
+{
+    if (m_ownsMaps && m_continentsMap && m_bakeTime.load() < 0) {
+        QElapsedTimer timer;
+        timer.start();
+        m_continentsMap->build(m_pipeline);
+        m_mountainDefinitionMap->build(m_pipeline);
+        m_bakeTime.store(timer.elapsed());
+    }
+}
+
+double RandomGenerator::bakingError(double spacing)
+{
+    if (!m_bake) {
+        return 0.;
+    }
+    buildMaps();
+    if (m_continentsErrors.isEmpty()) {
+        // every 4th row and column of cells of every level is plenty to find the largest error. Without
+        // a cache, since the elements of shared maps are not in m_pipeline
+        for (size_t level = 1; level <= m_continentsMap->getOctaveCount(); ++level) {
+            m_continentsErrors << m_continentsMap->getInterpolationError(level, 4, nullptr);
+        }
+        for (size_t level = 1; level <= m_mountainDefinitionMap->getOctaveCount(); ++level) {
+            m_mountainDefinitionErrors << m_mountainDefinitionMap->getInterpolationError(level, 4, nullptr);
+        }
+    }
+    const double continents = bakedError(m_continentsMap, m_continentsErrors, m_continents.getPersistence(), spacing);
+    const double mountainDefinition = bakedError(m_mountainDefinitionMap, m_mountainDefinitionErrors, m_mountainDefinition.getPersistence(),
+                                                 spacing * m_mountainDefinitionScalePoint.getScaleX());
+
+    // the heights only follow the controls where the selects blend their sources, by up to the slope
+    // of the blending curve, 1.5 across the falloff on either side of a bound, times the gap between the sources
+    noisepp::Pipeline3D pipeline;
+    noisepp::Real landLower, landUpper, lowlandsLower, lowlandsUpper, mountainsLower, mountainsUpper;
+    sphereBounds(pipeline.getElement(m_mountainSelectScaleBias.addToPipeline(&pipeline)), m_size, &landLower, &landUpper);
+    sphereBounds(pipeline.getElement(m_lowlandsScalePoint.addToPipeline(&pipeline)), m_size, &lowlandsLower, &lowlandsUpper);
+    sphereBounds(pipeline.getElement(m_mountainsScalePoint.addToPipeline(&pipeline)), m_size, &mountainsLower, &mountainsUpper);
+    const double ocean = m_ocean.getValue();
+    const double continentSlope = 1.5 / (2. * m_continentSelect.getEdgeFalloff())
+                                  * qMax(fabs(landUpper - ocean), fabs(landLower - ocean));
+    // the land only blends with the ocean, so it changes the heights by at most as much as it changes
+    const double mountainSlope = fabs(m_mountainSelectScaleBias.getScale()) * 1.5 / (2. * m_mountainSelect.getEdgeFalloff())
+                                 * qMax(fabs(mountainsUpper - lowlandsLower), fabs(lowlandsUpper - mountainsLower));
+    return m_heightScale / 2. * (continentSlope * continents + mountainSlope * mountainDefinition);
+}
+
 int RandomGenerator::size() const
 {
     return m_size;
 }
+
+void RandomGenerator::heightRange(double *minHeight, double *maxHeight) const
+{
+    // the compiled pipeline would bound the baked octaves with the maps, which may not be built yet
+    noisepp::Pipeline3D pipeline;
+    graphHeightRange(pipeline.getElement(m_continentSelect.addToPipeline(&pipeline)), m_size, m_heightScale, minHeight, maxHeight);
+}
+
+quint64 RandomGenerator::hash() const
+{
+    // the threads don't change the output, the baking does with its interpolation error
+    const double parameters[] = { (double)GeneratorVersion, (double)m_size, m_heightScale, (double)m_bake };
+    return TileCache::hash(parameters, sizeof(parameters), TileCache::hash("RandomGenerator", 15));
+}
+
+int RandomGenerator::seed() const
+{
+    return m_seed;
+}
+
+QString RandomGenerator::profile() const
+{
+    QString text = QString("borders: %1% of the samples reused\n").arg(100. * borderHitRate(), 0, 'f', 1);
+    const qint64 bakeTime = m_bakeTime.load();
+    if (m_continentsMap && !m_ownsMaps) {
+        text += QString("shell maps: shared, %1 MB\n")
+                .arg((m_continentsMap->getMemoryUsage() + m_mountainDefinitionMap->getMemoryUsage()) / 1048576., 0, 'f', 1);
+    } else if (bakeTime >= 0) {
+        text += QString("shell maps: baked in %1 ms, %2 MB\n").arg(bakeTime)
+                .arg((m_continentsMap->getMemoryUsage() + m_mountainDefinitionMap->getMemoryUsage()) / 1048576., 0, 'f', 1);
+    }
+
+#if NOISEPP_ENABLE_PROFILING
+    const struct {
+        const char *name;
+        const noisepp::Module &module;
+    } modules[] = {
+        { "planet", m_continentSelect },
+        { "continents", m_continents },
+        { "land", m_mountainSelect },
+        { "mountain definition", m_mountainDefinition },
+        { "mountains", m_mountains },
+        { "lowlands", m_lowlands },
+        { "ocean", m_ocean },
+    };
+
+    // the times include the sources, so the share of the planet is the total
+    const double total = m_continentSelect.getProfile().getTicks();
+    for (const auto &m: modules) {
+        const noisepp::Profile &profile = m.module.getProfile();
+        text += QString("%1: %2k evals, %3%\n").arg(m.name)
+                                              .arg(profile.evaluations / 1000)
+                                              .arg(total > 0. ? 100. * profile.getTicks() / total : 0., 0, 'f', 1);
+    }
+#endif
+    return text.trimmed();
+}
+
+const noisepp::Module &RandomGenerator::root() const
+{
+    return m_continentSelect;
+}
+
+double RandomGenerator::borderHitRate() const
+{
+    const qint64 samples = m_borderSamples;
+    return samples > 0 ? (double)m_borderHits / samples : 0.;
+}
+
+
+class GraphGenerator::RowsJob : public noisepp::PipelineJob
+{
+public:
+    RowsJob(GraphGenerator *generator, int offset, int count, double spacing, double radius, float *data)
+        : m_generator(generator)
+        , m_count(count)
+        , m_x(generator->m_x.constData() + offset)
+        , m_y(generator->m_y.constData() + offset)
+        , m_z(generator->m_z.constData() + offset)
+        , m_spacing(spacing)
+        , m_radius(radius)
+        , m_values(generator->m_values.data() + offset)
+        , m_dx(generator->m_dx.data() + offset)
+        , m_dy(generator->m_dy.data() + offset)
+        , m_dz(generator->m_dz.data() + offset)
+        , m_data(data + HeightMapChunk::SampleSize * offset)
+    {
+    }
+
+    void execute(noisepp::Cache *cache) override
+    {
+        const noisepp::PipelineElement3D *root = m_generator->m_root;
+        if (!m_generator->m_derivatives.load() ||
+            !root->getDerivatives(m_count, m_x, m_y, m_z, m_values, m_dx, m_dy, m_dz, cache, m_spacing)) {
+            // the graph has elements without derivatives, difference the values one sample apart instead
+            m_generator->m_derivatives.store(false);
+            root->getValues(m_count, m_x, m_y, m_z, m_values, cache, m_spacing);
+            differentiate(root, cache, 1, 0, 0, m_dx);
+            differentiate(root, cache, 0, 1, 0, m_dy);
+            differentiate(root, cache, 0, 0, 1, m_dz);
+        }
+        storeSamples(m_count, m_x, m_y, m_z, m_values, m_dx, m_dy, m_dz, m_generator->m_heightScale, m_radius, m_data);
+    }
+
+private:
+    void differentiate(const noisepp::PipelineElement3D *root, noisepp::Cache *cache, int ax, int ay, int az, noisepp::Real *d) const
+    {
+        QVector<noisepp::Real> x(m_count), y(m_count), z(m_count);
+        for (int i = 0; i < m_count; ++i) {
+            x[i] = m_x[i] + ax * m_spacing;
+            y[i] = m_y[i] + ay * m_spacing;
+            z[i] = m_z[i] + az * m_spacing;
+        }
+        root->getValues(m_count, x.constData(), y.constData(), z.constData(), d, cache, m_spacing);
+        for (int i = 0; i < m_count; ++i) {
+            d[i] = (d[i] - m_values[i]) / m_spacing;
+        }
+    }
+
+    GraphGenerator *m_generator;
+    int m_count;
+    const noisepp::Real *m_x;
+    const noisepp::Real *m_y;
+    const noisepp::Real *m_z;
+    double m_spacing;
+    double m_radius;
+    noisepp::Real *m_values;
+    noisepp::Real *m_dx;
+    noisepp::Real *m_dy;
+    noisepp::Real *m_dz;
+    float *m_data;
+};
+
+GraphGenerator::GraphGenerator(const QString &file, int size, double heightScale, int seed, int threads)
+              : m_size(size)
+              , m_heightScale(heightScale)
+              , m_seed(seed)
+              , m_threads(qMax(threads, 1))
+              , m_reader(nullptr)
+              , m_pipeline(nullptr)
+              , m_root(nullptr)
+              , m_derivatives(1)
+{
+    QFile graph(file);
+    if (!graph.open(QIODevice::ReadOnly)) {
+        throw noisepp::Exception("cannot open the file");
+    }
+    // the same bytes are hashed and parsed, so an edited graph never gets the tiles of the old one
+    QByteArray contents = graph.readAll();
+    m_hash = TileCache::hash(contents.constData(), contents.size());
+    noisepp::utils::MemoryInStream stream;
+    stream.open(contents.data(), contents.size());
+
+    try {
+        // the reader owns the modules, keep it around for the profiling counters
+        m_reader = new noisepp::utils::Reader(stream);
+        const noisepp::Module *root = m_reader->getModule(0);
+        if (!root) {
+            throw noisepp::ReaderException("the file has no modules");
+        }
+
+        // the same setup as RandomGenerator, one pipeline whose jobs get a cache per thread
+        m_pipeline = m_threads > 1 ? new noisepp::ThreadedPipeline3D(m_threads - 1) : new noisepp::Pipeline3D;
+        m_pipeline->setSeed(seed);
+        // the derivatives are always calculated in Real precision, this only speeds up the graphs
+        // which have elements without them, whose derivatives are differenced from the values
+        m_pipeline->setPrecision(noisepp::NOISE_PRECISION_SINGLE);
+        m_root = m_pipeline->getElement(root->addToPipeline(m_pipeline));
+        // graphs made by hand often use the same noise in several places
+        m_pipeline->shareLattices();
+    } catch (...) {
+        delete m_pipeline;
+        delete m_reader;
+        throw;
+    }
+}
+
+GraphGenerator::~GraphGenerator()
+{
+    delete m_pipeline;
+    delete m_reader;
+}
+
+bool GraphGenerator::fetchData(int destSize, HeightMap::Face face, const QPoint &pos, int size, float *data)
+{
+    const double stepSize = tilePoints(map->size(), destSize, face, pos, size, m_x, m_y, m_z);
+    calculate(destSize, stepSize, data);
+
+    if (2 * size <= map->size()) {
+        QVector<noisepp::Real> x, y, z;
+        const double parentStepSize = tilePoints(map->size(), destSize, face, parentPos(pos, size), 2 * size, x, y, z);
+        const QVector<int> indices = parentSamples(destSize, pos, size);
+        m_x.resize(indices.size());
+        m_y.resize(indices.size());
+        m_z.resize(indices.size());
+        for (int k = 0; k < indices.size(); ++k) {
+            m_x[k] = x[indices[k]];
+            m_y[k] = y[indices[k]];
+            m_z[k] = z[indices[k]];
+        }
+        QVector<float> samples(indices.size() * HeightMapChunk::SampleSize);
+        calculate(destSize, parentStepSize, samples.data());
+        storeParentHeights(destSize, samples.constData(), data);
+    } else {
+        storeParentHeights(destSize, nullptr, data);
+    }
+
+    return true;
+}
+
+void GraphGenerator::calculate(int destSize, double spacing, float *data)
+{
+    const int count = m_x.size();
+    m_values.resize(count);
+    m_dx.resize(count);
+    m_dy.resize(count);
+    m_dz.resize(count);
+
+    // same jobs as RandomGenerator::calculate()
+    const int width = destSize + 4;
+    const int pointsPerJob = qMax(2 * width, (count + 2 * m_threads - 1) / (2 * m_threads));
+    const double radius = map->size() / 2. * (destSize - 1) / destSize;
+    for (int offset = 0; offset < count; offset += pointsPerJob) {
+        m_pipeline->addJob(new RowsJob(this, offset, qMin(pointsPerJob, count - offset), spacing, radius, data));
+    }
+    m_pipeline->executeJobs();
+}
+
+int GraphGenerator::size() const
+{
+    return m_size;
+}
+
+void GraphGenerator::heightRange(double *minHeight, double *maxHeight) const
+{
+    graphHeightRange(m_root, m_size, m_heightScale, minHeight, maxHeight);
+}
+
+quint64 GraphGenerator::hash() const
+{
+    const double parameters[] = { (double)GeneratorVersion, (double)m_size, m_heightScale };
+    return TileCache::hash(parameters, sizeof(parameters), TileCache::hash("GraphGenerator", 14, m_hash));
+}
+
+int GraphGenerator::seed() const
+{
+    return m_seed;
+}
+
+#if NOISEPP_ENABLE_PROFILING
+QString GraphGenerator::profile() const
+{
+    // the modules have no names in the file, list the elements
+    std::ostringstream stream;
+    m_pipeline->dumpProfile(stream);
+    return QString::fromStdString(stream.str()).trimmed();
+}
+#endif
+
+/**
+ * The step of the central differences on the noise sphere. The finest octave of the mountains has
+ * 25 * 2^11 waves per unit, so this is about 1/20000 of its wavelength. Larger steps are off where
+ * the octaves are steep, smaller ones lose more to rounding than they gain.
+ */
+static const double NormalStep = 1e-9;
+
+ReferenceGenerator::ReferenceGenerator(int size, double heightScale, int seed)
+                  : m_terrain(new RandomGenerator(size, heightScale, seed, 1, false))
+                  , m_heightScale(heightScale)
+{
+    // Real is the default precision, it's set anyway since it's the point of the reference
+    m_pipeline.setPrecision(noisepp::NOISE_PRECISION_REAL);
+    m_root = m_pipeline.getElement(m_terrain->root().addToPipeline(&m_pipeline));
+    m_cache = m_pipeline.createCache();
+}
+
+ReferenceGenerator::~ReferenceGenerator()
+{
+    m_pipeline.freeCache(m_cache);
+    delete m_terrain;
+}
+
+double ReferenceGenerator::height(const double point[3])
+{
+    m_pipeline.cleanCache(m_cache);
+    return m_heightScale * (m_root->getValue(point[0], point[1], point[2], m_cache) + 1.) / 2.;
+}
+
+/**
+ * The displaced surface above the point of the noise sphere moved by step along direction
+ */
+void ReferenceGenerator::surfacePoint(const double point[3], const double direction[3], double step, double radius, double surface[3])
+{
+    const double length = sqrt(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]);
+    double moved[3];
+    for (int k = 0; k < 3; ++k) {
+        moved[k] = point[k] + step * direction[k];
+    }
+    const double movedLength = sqrt(moved[0] * moved[0] + moved[1] * moved[1] + moved[2] * moved[2]);
+    for (int k = 0; k < 3; ++k) {
+        moved[k] *= length / movedLength;
+    }
+    const double h = height(moved);
+    for (int k = 0; k < 3; ++k) {
+        surface[k] = moved[k] / length * (radius + h);
+    }
+}
+
+bool ReferenceGenerator::fetchData(int destSize, HeightMap::Face face, const QPoint &pos, int size, float *data)
+{
+    const int mapSize = map->size();
+    const double multiplier = 1. / 8000.;
+    const double radius = mapSize / 2. * (destSize - 1) / destSize;
+
+    const int width = destSize + 4;
+    for (int i = 0; i < width; ++i) {
+        for (int j = 0; j < width; ++j) {
+            double point[3];
+            tileCubePoint(mapSize, destSize, face, pos, size, i, j, point);
+            // one point at a time, so always the scalar code
+            MiscUtils::mapCubeToSphereN(&point[0], &point[1], &point[2], 1, mapSize * multiplier / 2.);
+
+            const double length = sqrt(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]);
+            const double up[3] = { point[0] / length, point[1] / length, point[2] / length };
+            // two directions along the sphere, across the axis up is the furthest from
+            const int axis = fabs(up[0]) <= fabs(up[1]) && fabs(up[0]) <= fabs(up[2]) ? 0 : fabs(up[1]) <= fabs(up[2]) ? 1 : 2;
+            double first[3] = { 0, 0, 0 };
+            first[(axis + 1) % 3] = -up[(axis + 2) % 3];
+            first[(axis + 2) % 3] = up[(axis + 1) % 3];
+            const double firstLength = sqrt(first[0] * first[0] + first[1] * first[1] + first[2] * first[2]);
+            for (int k = 0; k < 3; ++k) {
+                first[k] /= firstLength;
+            }
+            const double second[3] = { up[1] * first[2] - up[2] * first[1],
+                                       up[2] * first[0] - up[0] * first[2],
+                                       up[0] * first[1] - up[1] * first[0] };
+
+            double a0[3], a1[3], b0[3], b1[3];
+            surfacePoint(point, first, -NormalStep, radius, a0);
+            surfacePoint(point, first, NormalStep, radius, a1);
+            surfacePoint(point, second, -NormalStep, radius, b0);
+            surfacePoint(point, second, NormalStep, radius, b1);
+            const double a[3] = { a1[0] - a0[0], a1[1] - a0[1], a1[2] - a0[2] };
+            const double b[3] = { b1[0] - b0[0], b1[1] - b0[1], b1[2] - b0[2] };
+            double normal[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+            const double outwards = normal[0] * up[0] + normal[1] * up[1] + normal[2] * up[2] < 0 ? -1. : 1.;
+            const double normalLength = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+            float *sample = data + HeightMapChunk::SampleSize * (i * width + j);
+            sample[0] = height(point);
+            for (int k = 0; k < 3; ++k) {
+                sample[k + 1] = outwards * normal[k] / normalLength;
+            }
+        }
+    }
+
+    // all the octaves at any spacing, so the parent has the same heights at the same points
+    if (2 * size <= mapSize) {
+        const int half = width / 2 + 1;
+        QVector<float> parent(half * half * HeightMapChunk::SampleSize);
+        for (int a = 0; a < half; ++a) {
+            for (int b = 0; b < half; ++b) {
+                parent[(a * half + b) * HeightMapChunk::SampleSize] = data[(2 * a * width + 2 * b) * HeightMapChunk::SampleSize];
+            }
+        }
+        storeParentHeights(destSize, parent.constData(), data);
+    } else {
+        storeParentHeights(destSize, nullptr, data);
+    }
+    return true;
+}
+
+int ReferenceGenerator::size() const
+{
+    return m_terrain->size();
+}
+
+void ReferenceGenerator::heightRange(double *minHeight, double *maxHeight) const
+{
+    m_terrain->heightRange(minHeight, maxHeight);
+}
+
+int ReferenceGenerator::seed() const
+{
+    return m_terrain->seed();
+}
@@ -20,7 +20,14 @@
 #ifndef HEIGHTMAP_H
 #define HEIGHTMAP_H
 
+#include <atomic>
+#include <memory>
+
 #include <QVector>
+#include <QString>
+#include <QAtomicInt>
+#include <QCache>
+#include <QMutex>
 
 #include "NoisePerlin.h"
 #include "NoiseSelect.h"
@@ -29,9 +36,13 @@
 #include "NoiseRidgedMulti.h"
 #include "NoiseScaleBias.h"
 #include "NoiseBillow.h"
+#include "NoiseCompiled.h"
+#include "NoiseReader.h"
 
 class HeightMapChunk;
 class Generator;
+class TileCache;
+class TilePack;
 
 class HeightMap
 {
@@ -45,16 +56,35 @@ public:
         Back
     };
 
-    HeightMap(Generator *generator);
+    /**
+     * If cache is not null the chunks look for their data in it before generating it, and store
+     * it there after. The cache is not owned by the HeightMap, so it can outlive it.
+     * If pack is not null the chunks take their data from it first. The HeightMap takes ownership
+     * of it, and ignores it if it was baked by another generator.
+     */
+    HeightMap(Generator *generator, TileCache *cache = nullptr, TilePack *pack = nullptr);
     ~HeightMap();
 
     HeightMapChunk *chunk(Face face, int x, int y, int size);
     inline int size() const { return m_size; }
+    inline Generator *generator() const { return m_generator; }
+    /**
+     * The heights of every tile are quantised in steps of heightStep() from heightBase(), see
+     * HeightMapChunk::quantise(). The step is a power of two, and 65535 steps cover the height range
+     * of the generator.
+     */
+    inline double heightBase() const { return m_heightBase; }
+    inline double heightStep() const { return m_heightStep; }
 
 private:
     int m_size;
+    double m_heightBase;
+    double m_heightStep;
     QVector<float> m_data;
     Generator *m_generator;
+    TileCache *m_cache;
+    TilePack *m_pack;
+    quint64 m_generatorHash;
 
     friend HeightMapChunk;
 };
@@ -63,21 +93,54 @@ class HeightMapChunk
 {
 public:
     /**
-     * A padding of one sample will be added all around the chunk, so the data pointer
-     * MUST be of size (size + 2) * (size + 2)
+     * Every sample is the height followed by the unit normal of the terrain, then the height of
+     * the parent tile at the sample, see Generator::fetchData().
+     */
+    static const int SampleSize = 5;
+
+    /**
+     * A padding of two samples will be added all around the chunk, so the data pointer
+     * MUST be of size SampleSize * (size + 4) * (size + 4)
+     * The samples come straight from the generator, in full precision.
      */
     bool fetchData(int size, float *data);
+    /**
+     * The same as above, but with the samples quantised to 16 bits, see quantise(). This is
+     * what the tiles are stored and uploaded as, so the chunk is taken from the TilePack or the
+     * TileCache of the map if it is there, and stored in the cache after being generated.
+     */
+    bool fetchData(int size, quint16 *data);
+    /**
+     * Returns the quantised data of the chunk if it is in the TilePack of the map, without
+     * copying it, or nullptr. The data stays valid as long as the map.
+     */
+    const quint16 *mappedData(int size);
     HeightMapChunk *chunk(int x, int y, int w, int h);
 
+    /**
+     * Quantises count samples to 16 bits for every channel. The heights and the parent heights
+     * go up by one every heightStep from 0 at baseHeight, the normal from 0 at -1 to 65535 at 1.
+     * With the same base and step for every tile, see HeightMap::heightStep(), the samples two tiles
+     * share are quantised the same, and the renderer turns them back into the same heights.
+     * Compared to half floats, the heights are a lot more precise and take the same.
+     */
+    static void quantise(const float *samples, int count, double baseHeight, double heightStep, quint16 *data);
+
     inline int x() const { return m_x; }
     inline int y() const { return m_y; }
     inline int size() const { return m_size; }
     inline HeightMap::Face face() const { return m_face; }
+    /**
+     * The range of the heights of the last fetched or mapped data, padding and parent heights included
+     */
+    inline float minHeight() const { return m_minHeight; }
+    inline float maxHeight() const { return m_maxHeight; }
 
 // private:
     HeightMap *map;
     HeightMap::Face m_face;
     int m_x, m_y, m_size;
+    float m_minHeight, m_maxHeight;
 
     friend class HeightMap;
 };
@@ -88,8 +151,33 @@ public:
     Generator() {}
     virtual ~Generator() {}
 
+    /**
+     * Fills data with the samples of the tile, apron included, see HeightMapChunk::SampleSize.
+     * The parent height is what the tile of twice the size containing it has there, which the
+     * renderer morphs the tile to before switching to the parent: the height of the parent at the
+     * samples an even number of steps from the corner of the tile, and in between the height the
+     * mesh of the parent has, with its samples. The tile of a whole face has no parent and takes
+     * its own heights.
+     */
     virtual bool fetchData(int destSize, HeightMap::Face face, const QPoint &pos, int size, float *data) = 0;
     virtual int size() const = 0;
+    /**
+     * The range the heights of the tiles are in. The generators which can't tell return the one
+     * most of them are in, and the heights out of it get clamped when quantised.
+     */
+    virtual void heightRange(double *minHeight, double *maxHeight) const = 0;
+    /**
+     * Returns a hash of everything but the seed the output of fetchData() depends on, which
+     * together with the seed identifies the tiles in a TileCache. 0 means the tiles must not
+     * be cached.
+     */
+    virtual quint64 hash() const { return 0; }
+    virtual int seed() const { return 0; }
+    /**
+     * Returns a human readable summary of where the generation time goes, or an empty
+     * string if the generator doesn't profile itself.
+     */
+    virtual QString profile() const { return QString(); }
 
 protected:
     HeightMap *map;
@@ -100,14 +188,103 @@ protected:
 class RandomGenerator : public Generator
 {
 public:
-    RandomGenerator(int size, double heightScale, int seed);
+    /**
+     * With more than one thread the tiles are split in jobs of a few rows, which are
+     * generated in parallel by a noisepp::ThreadedPipeline3D.
+     * The normals come from the analytic derivatives of the noise.
+     * If bake is true the lowest octaves of the continents and of the mountain definition,
+     * which are the bulk of the work, are baked in noisepp::ShellMaps. That takes a while, so it
+     * is left to the first fetchData() call, on the thread generating the tiles. The tiles then
+     * sample the maps instead of calculating the octaves, at the cost of some memory and a small
+     * interpolation error, see noisepp::compiled::BakedPerlin.
+     * Every tile then also bakes the octaves its spacing resolves well in noisepp::ShellPatches,
+     * and keeps them for a while. The four tiles refining it interpolate those and only calculate
+     * the octaves in between.
+     * The lines of samples around the edges the tile shares with a neighbour on the same face are
+     * kept too, until the neighbour is generated and takes them instead of calculating them. On the
+     * edges of the cube the samples of the edge itself are shared in the same way with the tile on
+     * the other face. Either tile would calculate the shared samples to the same bit, at the same
+     * points and with the patches of the same tile, or without patches on the edges of the cube, so
+     * the seams match exactly and a tile is the same whichever order the tiles are generated in.
+     * The parent heights are calculated in the same way by the parent tile, at its spacing, so they
+     * are the heights of the parent to the bit.
+     */
+    RandomGenerator(int size, double heightScale, int seed, int threads = 1, bool bake = true);
+    /**
+     * A generator of the same planet as other, which takes the ShellMaps of other instead of baking
+     * its own, and shares its cache of patches, so generators working on the tiles in parallel bake
+     * the maps once and find the patches of a parent whichever of them generated it. The maps
+     * are built here if they aren't yet. other must outlive the generator.
+     */
+    RandomGenerator(RandomGenerator *other, int threads = 1);
+    ~RandomGenerator();
 
     bool fetchData(int destSize, HeightMap::Face face, const QPoint &pos, int size, float *data) override;
     int size() const override;
+    void heightRange(double *minHeight, double *maxHeight) const override;
+    quint64 hash() const override;
+    int seed() const override;
+    QString profile() const override;
+    /**
+     * The share of the samples taken from the borders of the neighbours so far
+     */
+    double borderHitRate() const;
+    /**
+     * The root of the module graph, whose values are the heights from -1 to 1 before the height scale
+     */
+    const noisepp::Module &root() const;
+    /**
+     * A bound of the difference baking makes to the heights of a tile with the spacing, from the
+     * interpolation errors of the maps and the slopes of the selects they control. 0 without baking.
+     * Builds the maps if they aren't yet.
+     */
+    double bakingError(double spacing);
 
 private:
+    class RowsJob;
+    struct Patches {
+        noisepp::ShellPatch continents;
+        noisepp::ShellPatch mountainDefinition;
+    };
+    /**
+     * The samples of a tile from two lines before one of its edges to two lines after it,
+     * which its neighbour across the edge has at the same places. On the edges of the cube
+     * only the line of the edge, from one end of the edge of the cube to the other.
+     */
+    struct Border {
+        int destSize;
+        QVector<float> samples;
+    };
+    struct Edge;
+    /**
+     * The patches of the last tiles, by tile, locked since the generators sharing the maps share it
+     */
+    struct PatchCache {
+        // in KB, a tile takes about 15
+        PatchCache() : patches(16 * 1024) {}
+
+        QMutex mutex;
+        QCache<quint64, Patches> patches;
+    };
+
+    RandomGenerator(int size, double heightScale, int seed, int threads, bool bake, RandomGenerator *other);
+    void buildMaps();
+    /**
+     * Copies the patches of the tile into patches, building them and the ones of its parents if they
+     * aren't in the cache. Returns false if its spacing resolves no octave after the maps.
+     */
+    bool patches(int destSize, HeightMap::Face face, const QPoint &pos, int size, Patches *patches);
+    /**
+     * Calculates the samples at the indices in the tile, apron included, into data in their order
+     */
+    void calculate(int destSize, HeightMap::Face face, const QPoint &pos, int size, const QVector<int> &indices, float *data);
+    void tileEdges(int destSize, HeightMap::Face face, const QPoint &pos, int size, Edge *edges) const;
+
     int m_size;
     double m_heightScale;
+    int m_seed;
+    int m_threads;
+    bool m_bake;
     noisepp::PerlinModule m_continents;
     noisepp::SelectModule m_continentSelect;
     noisepp::ConstantModule m_ocean;
@@ -122,9 +299,126 @@ private:
     noisepp::ScaleBiasModule m_lowlandsScaleBias;
     noisepp::ScalePointModule m_lowlandsScalePoint;
 
+    typedef noisepp::compiled::BakedPerlin Perlin;
+    typedef noisepp::compiled::ScalePoint<noisepp::compiled::ScaleBias<noisepp::compiled::Element<noisepp::BillowElement3D>>> Lowlands;
+    typedef noisepp::compiled::ScalePoint<noisepp::compiled::ScaleBias<noisepp::compiled::Element<noisepp::RidgedMultiElement3D>>> Mountains;
+    typedef noisepp::compiled::ScalePoint<Perlin> MountainDefinition;
+    typedef noisepp::compiled::ScaleBias<noisepp::compiled::Select<Lowlands, Mountains, MountainDefinition>> Land;
+    typedef noisepp::compiled::Select<noisepp::compiled::Constant, Land, Perlin> Planet;
+
+    noisepp::Pipeline3D *m_pipeline;
+    noisepp::ShellMap *m_continentsMap;
+    noisepp::ShellMap *m_mountainDefinitionMap;
+    // false if the maps are the ones of another generator
+    bool m_ownsMaps;
+    // the patches of the tile being generated
+    Patches *m_patches;
+    // the interpolation errors of the levels of the maps, by level, empty until bakingError() needs them
+    QVector<double> m_continentsErrors;
+    QVector<double> m_mountainDefinitionErrors;
+    // the time building the maps took in ms, -1 until they are built
+    std::atomic<qint64> m_bakeTime;
+    std::shared_ptr<PatchCache> m_patchCache;
+    // the borders waiting for their neighbour, by edge
+    QCache<quint64, Border> m_borders;
+    std::atomic<qint64> m_borderHits;
+    std::atomic<qint64> m_borderSamples;
+    Planet *m_planet;
+
+    QVector<noisepp::Real> m_x;
+    QVector<noisepp::Real> m_y;
+    QVector<noisepp::Real> m_z;
+    QVector<noisepp::Real> m_values;
+    QVector<noisepp::Real> m_dx;
+    QVector<noisepp::Real> m_dy;
+    QVector<noisepp::Real> m_dz;
+    // the order in calculate() of the points being calculated, and their samples
+    QVector<int> m_indices;
+    QVector<float> m_samples;
+};
+
+/**
+ * Generates the terrain with a module graph saved with noisepp::utils::Writer, so that worlds
+ * can be designed without recompiling. The graph goes through the same batch evaluation as the
+ * one of RandomGenerator, with the jobs of a noisepp::ThreadedPipeline3D.
+ */
+class GraphGenerator : public Generator
+{
+public:
+    /**
+     * Loads the graph in file, whose root is the module with ID 0. The seed is the master seed
+     * of the pipeline, it is added to the seeds of the modules.
+     * Throws a std::exception if the file can't be read or the graph is incomplete.
+     */
+    GraphGenerator(const QString &file, int size, double heightScale, int seed, int threads = 1);
+    ~GraphGenerator();
+
+    bool fetchData(int destSize, HeightMap::Face face, const QPoint &pos, int size, float *data) override;
+    int size() const override;
+    void heightRange(double *minHeight, double *maxHeight) const override;
+    quint64 hash() const override;
+    int seed() const override;
+#if NOISEPP_ENABLE_PROFILING
+    QString profile() const override;
+#endif
+
+private:
+    class RowsJob;
+
+    /**
+     * Calculates the samples of the points in m_x, m_y and m_z into data
+     */
+    void calculate(int destSize, double spacing, float *data);
+
+    int m_size;
+    double m_heightScale;
+    int m_seed;
+    int m_threads;
+    // of the graph file
+    quint64 m_hash;
+    noisepp::utils::Reader *m_reader;
     noisepp::Pipeline3D *m_pipeline;
+    const noisepp::PipelineElement3D *m_root;
+    // cleared by the first job whose batch needs an element that can't calculate derivatives
+    QAtomicInt m_derivatives;
+
+    QVector<noisepp::Real> m_x;
+    QVector<noisepp::Real> m_y;
+    QVector<noisepp::Real> m_z;
+    QVector<noisepp::Real> m_values;
+    QVector<noisepp::Real> m_dx;
+    QVector<noisepp::Real> m_dy;
+    QVector<noisepp::Real> m_dz;
+};
+
+/**
+ * The terrain of RandomGenerator calculated the plain way, to check its optimisations against,
+ * see trainsplanet-equivalence. Every sample is a getValue() with all the octaves of the graph,
+ * in Real precision, and nothing is kept from one sample or tile to the next. The points on the
+ * sphere are calculated one by one and the normals are central differences of the displaced
+ * surface. It takes five evaluations of the graph per sample, so it is only meant for tools.
+ */
+class ReferenceGenerator : public Generator
+{
+public:
+    ReferenceGenerator(int size, double heightScale, int seed);
+    ~ReferenceGenerator();
+
+    bool fetchData(int destSize, HeightMap::Face face, const QPoint &pos, int size, float *data) override;
+    int size() const override;
+    void heightRange(double *minHeight, double *maxHeight) const override;
+    int seed() const override;
+
+private:
+    double height(const double point[3]);
+    void surfacePoint(const double point[3], const double direction[3], double step, double radius, double surface[3]);
+
+    // only for its module graph
+    RandomGenerator *m_terrain;
+    double m_heightScale;
+    noisepp::Pipeline3D m_pipeline;
+    const noisepp::PipelineElement3D *m_root;
     noisepp::Cache *m_cache;
-    noisepp::PipelineElement3D *m_element;
 };
 
 #endif
@@ -18,6 +18,7 @@
  */
 
 #include <assert.h>
+#include <string.h>
 
 #include <QOpenGLBuffer>
 #include <QOpenGLTexture>
@@ -40,6 +41,7 @@ QuadTreeNode::QuadTreeNode(QuadTreeNode *p, HeightMapChunk *map, int l)
     , chunk(map)
     , lod(l)
     , mapData(nullptr)
+    , m_ownsData(false)
     , m_dataFetched(false)
     , buffer(nullptr)
 {
@@ -53,9 +55,12 @@ QuadTreeNode::QuadTreeNode(QuadTreeNode *p, HeightMapChunk *map, int l)
 QuadTreeNode::~QuadTreeNode()
 {
     delete chunk;
-    delete[] mapData;
+    if (m_ownsData) {
+        delete[] mapData;
+    }
     if (buffer) {
         delete texture;
+        delete parentTexture;
         delete overlayTexture;
         delete buffer;
         delete mesh.indices;
@@ -84,18 +89,20 @@ bool QuadTreeNode::dataUploaded() const
 
 void QuadTreeNode::fetchData()
 {
-    int size = MESHSIZE + 4;
-    mapData = new float[size * size];
-    chunk->fetchData(MESHSIZE, mapData);
-    for (int i = 0; i < size * size; ++i) {
-        float h = mapData[i];
-        if (i == 0 || h > maxHeight) {
-            maxHeight = h;
-        }
-        if (i == 0 || h < minHeight) {
-            minHeight = h;
-        }
+    // a baked planet has the tile in memory already, in the layout the texture takes
+    mapData = chunk->mappedData(MESHSIZE);
+    m_ownsData = !mapData;
+    if (m_ownsData) {
+        int size = MESHSIZE + 4;
+        quint16 *data = new quint16[size * size * HeightMapChunk::SampleSize];
+        chunk->fetchData(MESHSIZE, data);
+        mapData = data;
     }
+    maxHeight = chunk->maxHeight();
+    minHeight = chunk->minHeight();
+    // the same for every tile, so the samples they share end up at the same heights
+    heightRange[0] = chunk->map->heightBase();
+    heightRange[1] = 65535. * chunk->map->heightStep();
 
     static const double M = double(MESHSIZE - 1) / (double)MESHSIZE;
     geometry = QVector4D(chunk->x() * M, chunk->y() * M, chunk->size(), chunk->size());
@@ -124,10 +131,31 @@ void QuadTreeNode::uploadData()
     glTexParameterf( GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
     glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexImage2D(GL_TEXTURE_RECTANGLE, 0, GL_R16F, MESHSIZE + 4, MESHSIZE + 4, 0, GL_RED, GL_FLOAT, mapData);
+    // the height in the red channel and the normal in the others, scaled back by the shader. The
+    // parent heights go in a texture of their own
+    const int count = (MESHSIZE + 4) * (MESHSIZE + 4);
+    QVector<quint16> samples(count * 4);
+    QVector<quint16> parentHeights(count);
+    for (int i = 0; i < count; ++i) {
+        memcpy(samples.data() + i * 4, mapData + i * HeightMapChunk::SampleSize, 4 * sizeof(quint16));
+        parentHeights[i] = mapData[i * HeightMapChunk::SampleSize + 4];
+    }
+    glTexImage2D(GL_TEXTURE_RECTANGLE, 0, GL_RGBA16, MESHSIZE + 4, MESHSIZE + 4, 0, GL_RGBA, GL_UNSIGNED_SHORT, samples.constData());
     texture->release();
 
-    delete[] mapData;
+    parentTexture = new QOpenGLTexture(QOpenGLTexture::TargetRectangle);
+    parentTexture->create();
+    parentTexture->bind();
+    glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameterf(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_RECTANGLE, 0, GL_R16, MESHSIZE + 4, MESHSIZE + 4, 0, GL_RED, GL_UNSIGNED_SHORT, parentHeights.constData());
+    parentTexture->release();
+
+    if (m_ownsData) {
+        delete[] mapData;
+    }
     mapData = nullptr;
 
 
@@ -373,7 +401,28 @@ bool boxIntersectsSphere(QVector3D min, QVector3D max, QVector3D p, double r)
     return dmin <= SQR(r);
 }
 
-bool QuadTreeNode::selectNode(const QVector3D &pos, const Frustum &frustum, QList<QuadTreeNode *> &list, bool &again)
+/**
+ * Maps the centres of count nodes, at most four, to the sphere at once
+ */
+static void sphereCentres(QuadTreeNode *const *nodes, int count, QVector3D *centres)
+{
+    const double M = double(MESHSIZE - 1) / (double)MESHSIZE;
+    double x[4], y[4], z[4];
+    for (int i = 0; i < count; ++i) {
+        const HeightMapChunk *chunk = nodes[i]->chunk;
+        const QVector3D c = nodes[i]->tree->m_transform * QVector3D(chunk->x() * M + chunk->size() / 2., chunk->y() * M + chunk->size() / 2., 0.);
+        x[i] = c.x();
+        y[i] = c.y();
+        z[i] = c.z();
+    }
+    // the same as MiscUtils::mapCubeToSphere()
+    MiscUtils::mapCubeToSphereN(x, y, z, count, nodes[0]->chunk->map->size() / 2. * M);
+    for (int i = 0; i < count; ++i) {
+        centres[i] = QVector3D(x[i], y[i], z[i]);
+    }
+}
+
+bool QuadTreeNode::selectNode(const QVector3D &pos, const QVector3D &centre, const Frustum &frustum, QList<QuadTreeNode *> &list, bool &again)
 {
     double range = RANGEMULTIPLIER * chunk->size() / (double)MESHSIZE;
 
@@ -391,9 +440,7 @@ bool QuadTreeNode::selectNode(const QVector3D &pos, const Frustum &frustum, QLis
     // TODO: improve it
     QVector3D c((min + max) / 2.);
     double z = c.z();
-    c[2] = 0.;
-    c = MiscUtils::mapCubeToSphere(tree->m_transform * c, chunk->map->size());
-    c += c.normalized() * z;
+    c = centre + centre.normalized() * z;
     double r = (max - min).length() / 2.;
     if (!frustum.testSphere(c, r)) {
         return true;
@@ -408,6 +455,8 @@ bool QuadTreeNode::selectNode(const QVector3D &pos, const Frustum &frustum, QLis
     double nextRange = RANGEMULTIPLIER * chunk->size() / (double)(MESHSIZE * 2);
     if (boxIntersectsSphere(min, max, pos, nextRange)) {
         if (children[0]) {
+            QVector3D centres[4];
+            sphereCentres(children, 4, centres);
             bool n= true;
             QList<QuadTreeNode *> l;
             for (int i = 0; i < 4; ++i) {
@@ -418,7 +467,7 @@ bool QuadTreeNode::selectNode(const QVector3D &pos, const Frustum &frustum, QLis
                 if (!child->dataFetched()) {
                     again = true;
                 }
-                if (!child->dataFetched() || !child->selectNode(pos, frustum, list, again)) {
+                if (!child->dataFetched() || !child->selectNode(pos, centres[i], frustum, list, again)) {
                     if (n) list << this;
                     n = false;
 
@@ -454,22 +503,23 @@ bool QuadTreeNode::findNearestPoint(QVector3D &p)
     return false;
 }
 
-QList<QuadTreeNode *> QuadTree::findNodes(const QVector3D &p, const Frustum &frustum, bool &again)
+QList<QuadTreeNode *> QuadTree::findNodes(const QVector3D &cam, const Frustum &frustum, bool &again)
 {
     QList<QuadTreeNode *> nodes;
 
     // We need to account for the deformations the mapping to the sphere does to the
     // nodes. If we map the nodes' AABB to the sphere not only the AABB will not be AA
     // anymore, but it also won't be a box anymore, but some trapezoid. Instead of doing
-    // that we map the camera position from the sphere space to the cube space, and we do
-    // the same thing in the vertex shader for the morphing.
+    // that we map the camera position from the sphere space to the cube space, see
+    // Terrain::update(), and we do the same thing in the vertex shader for the morphing.
     // That means that when the camera is over a cube vertex the boundary between the most
     // refined nodes and the less ones on the three faces visible will not form a nice circle
     // but a triangle-like shape, which should not be a problem.
-    QVector3D cam = MiscUtils::mapSphereToCube(p.normalized()) * p.length();
     QVector3D pos = m_transform.inverted().map(-cam);
 
-    m_head->selectNode(pos, frustum, nodes, again);
+    QVector3D centre;
+    sphereCentres(&m_head, 1, &centre);
+    m_head->selectNode(pos, centre, frustum, nodes, again);
     if (nodes.isEmpty()) {
         nodes << m_head;
     }
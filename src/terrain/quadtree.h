@@ -43,7 +43,10 @@ public:
 
     void fetchData();
     void uploadData();
-    bool selectNode(const QVector3D &pos, const Frustum &frustum, QList<QuadTreeNode *> &list, bool &again);
+    /**
+     * centre is the centre of the node on the sphere, at height 0
+     */
+    bool selectNode(const QVector3D &pos, const QVector3D &centre, const Frustum &frustum, QList<QuadTreeNode *> &list, bool &again);
     bool findNearestPoint(QVector3D &p);
 
     bool dataFetched() const;
@@ -57,10 +60,15 @@ public:
     int maxHeight;
     int minHeight;
     int lod;
-    float *mapData;
+    // quantised, see HeightMapChunk::quantise()
+    const quint16 *mapData;
+    // false if mapData points in the TilePack of the map
+    bool m_ownsData;
     bool m_dataFetched;
 
     float morphData[2];
+    // the height of the samples at 0 and how much it grows to 1
+    float heightRange[2];
 
     enum class Parts {
         Entire = 0,
@@ -83,6 +91,8 @@ public:
     Mesh subMesh[4];
     QOpenGLBuffer *buffer;
     QOpenGLTexture *texture;
+    // the parent heights of the samples, see Generator::fetchData()
+    QOpenGLTexture *parentTexture;
     QOpenGLTexture *overlayTexture;
 };
 
@@ -93,7 +103,10 @@ public:
     QuadTree(DataFetcher *fetcher, HeightMap::Face face, HeightMap *heightMap, int lodLevels);
     ~QuadTree();
 
-    QList<QuadTreeNode *> findNodes(const QVector3D &pos, const Frustum &frustum, bool &again);
+    /**
+     * cam is the position of the camera mapped to the cube, see MiscUtils::mapSphereToCube()
+     */
+    QList<QuadTreeNode *> findNodes(const QVector3D &cam, const Frustum &frustum, bool &again);
     QVector3D findNearestPoint(const QVector3D &p);
 // private:
 
@@ -23,9 +23,13 @@
 #include <QOpenGLBuffer>
 #include <QOpenGLTexture>
 #include <QOpenGLVertexArrayObject>
+#include <QStandardPaths>
+#include <QFile>
 #include <QDebug>
 
 #include "heightmap.h"
+#include "tilecache.h"
+#include "tilepack.h"
 #include "quadtree.h"
 #include "terrain.h"
 #include "miscutils.h"
@@ -34,6 +38,8 @@
 
 static const int FACESIZE = 8192;
 static const int MESHSIZE = 33;
+// a tile takes 37 * 37 * 4 quint16 and a 64 bytes record, about 11 KB, so some 24000 tiles
+static const qint64 TILECACHESIZE = 256 * 1024 * 1024;
 
 Terrain::Terrain(QObject *parent)
         : QObject(parent)
@@ -48,11 +54,13 @@ Terrain::Terrain(QObject *parent)
 
     memset(m_tree, 0, sizeof(m_tree));
 
+    m_tileCache = new TileCache(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/tiles", TILECACHESIZE);
+
     int seed = 2;//rand();
     generateMap(seed);
 }
 
-void Terrain::generateMap(int seed)
+void Terrain::generateMap(int seed, const QString &graphFile)
 {
     m_dataFetcherThread.quit();
     m_dataFetcherThread.wait();
@@ -63,7 +71,29 @@ void Terrain::generateMap(int seed)
     }
 
     delete m_heightMap;
-    m_heightMap = new HeightMap(new RandomGenerator(FACESIZE, m_heightScale, seed));
+    // the data fetcher thread only waits while the tile jobs run, so use all the cores
+    Generator *generator = nullptr;
+    if (!graphFile.isEmpty()) {
+        try {
+            generator = new GraphGenerator(graphFile, FACESIZE, m_heightScale, seed, QThread::idealThreadCount());
+        } catch (const std::exception &e) {
+            qWarning() << "Cannot load the terrain graph" << graphFile << ":" << e.what();
+        }
+    }
+    if (!generator) {
+        generator = new RandomGenerator(FACESIZE, m_heightScale, seed, QThread::idealThreadCount());
+    }
+    // the planets baked with trainsplanet-bake
+    TilePack *pack = nullptr;
+    const QString packFile = FileFinder::findFile(FileFinder::Type::TilePack, QString("planet-%1.tilepack").arg(seed));
+    if (QFile::exists(packFile)) {
+        pack = new TilePack(packFile);
+        if (!pack->isValid()) {
+            delete pack;
+            pack = nullptr;
+        }
+    }
+    m_heightMap = new HeightMap(generator, m_tileCache, pack);
 
     m_tree[0] = new QuadTree(m_dataFetcher, HeightMap::Face::Top, m_heightMap, 2);
     m_tree[1] = new QuadTree(m_dataFetcher, HeightMap::Face::Front, m_heightMap, 2);
@@ -117,6 +147,7 @@ Terrain::~Terrain()
         delete m_tree[i];
     }
     delete m_heightMap;
+    delete m_tileCache;
 }
 
 void Terrain::init()
@@ -285,12 +316,16 @@ void Terrain::pick(const QPointF &mouse, const QMatrix4x4 &proj, const QMatrix4x
 
 bool Terrain::update(const QVector3D &camera, const Frustum &frustum)
 {
+    // once for all the faces
+    const QVector3D direction = camera.normalized();
+    double x = direction.x(), y = direction.y(), z = direction.z();
+    MiscUtils::mapSphereToCubeN(&x, &y, &z, 1);
+    m_cameraPos = QVector3D(x, y, z) * camera.length();
+
     bool again = false;
     for (int i = 0; i < 6; ++i) {
-        m_nodes[i] = m_tree[i]->findNodes(camera, frustum, again);
+        m_nodes[i] = m_tree[i]->findNodes(m_cameraPos, frustum, again);
     }
-
-    m_cameraPos = MiscUtils::mapSphereToCube(camera.normalized()) * camera.length();
     return again;
 }
 
@@ -323,6 +358,7 @@ void Terrain::renderTerrain(const QMatrix4x4 &proj, const QMatrix4x4 &view)
     static const int modelLoc = m_program->uniformLocation("model");
     static const int nodeDataLoc = m_program->uniformLocation("nodeData");
     static const int morphDataLoc = m_program->uniformLocation("morphData");
+    static const int heightRangeLoc = m_program->uniformLocation("heightRange");
 
     QOpenGLVertexArrayObject::Binder vao(m_vao);
 
@@ -345,11 +381,16 @@ void Terrain::renderTerrain(const QMatrix4x4 &proj, const QMatrix4x4 &view)
             glUniform1i(m_program->uniformLocation("heightmap"), 0);
             node->texture->bind();
 
+            glActiveTexture(GL_TEXTURE4);
+            glUniform1i(m_program->uniformLocation("parentHeightmap"), 4);
+            node->parentTexture->bind();
+
             glActiveTexture(GL_TEXTURE3);
             glUniform1i(m_program->uniformLocation("overlay"), 3);
             node->overlayTexture->bind();
 
             m_program->setUniformValue(morphDataLoc, node->morphData[0], node->morphData[1]);
+            m_program->setUniformValue(heightRangeLoc, node->heightRange[0], node->heightRange[1]);
 
             if (node->drawParts == 0) {
                 renderMesh(&node->mesh, m_statistics);
@@ -369,6 +410,7 @@ void Terrain::renderTerrain(const QMatrix4x4 &proj, const QMatrix4x4 &view)
             }
 
             node->texture->release();
+            node->parentTexture->release();
             node->overlayTexture->release();
             node->buffer->release();
         }
@@ -392,6 +434,7 @@ void Terrain::renderTerrainWf(const QMatrix4x4 &proj, const QMatrix4x4 &view)
     static const int modelLoc = m_wfprogram->uniformLocation("model");
     static const int nodeDataLoc = m_wfprogram->uniformLocation("nodeData");
     static const int morphDataLoc = m_wfprogram->uniformLocation("morphData");
+    static const int heightRangeLoc = m_wfprogram->uniformLocation("heightRange");
 
     QOpenGLVertexArrayObject::Binder vao(m_wfvao);
 
@@ -414,11 +457,16 @@ void Terrain::renderTerrainWf(const QMatrix4x4 &proj, const QMatrix4x4 &view)
             glUniform1i(m_wfprogram->uniformLocation("heightmap"), 0);
             node->texture->bind();
 
+            glActiveTexture(GL_TEXTURE4);
+            glUniform1i(m_wfprogram->uniformLocation("parentHeightmap"), 4);
+            node->parentTexture->bind();
+
             glActiveTexture(GL_TEXTURE3);
             glUniform1i(m_wfprogram->uniformLocation("overlay"), 3);
             node->overlayTexture->bind();
 
             m_wfprogram->setUniformValue(morphDataLoc, node->morphData[0], node->morphData[1]);
+            m_wfprogram->setUniformValue(heightRangeLoc, node->heightRange[0], node->heightRange[1]);
 
             if (node->drawParts == 0) {
                 renderWireFrameMesh(&node->mesh, m_statistics);
@@ -438,6 +486,7 @@ void Terrain::renderTerrainWf(const QMatrix4x4 &proj, const QMatrix4x4 &view)
             }
 
             node->texture->release();
+            node->parentTexture->release();
             node->buffer->release();
         }
     }
@@ -512,5 +561,6 @@ Terrain::Statistics Terrain::render(const QMatrix4x4 &proj, const QMatrix4x4 &vi
     glBlendFuncSeparate(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA, GL_ZERO, GL_ONE);
     renderWater(proj, view);
 
+    m_statistics.generatorProfile = m_heightMap->generator()->profile();
     return m_statistics;
 }
@@ -32,6 +32,7 @@ class QOpenGLTexture;
 class QMatrix4x4;
 
 class HeightMap;
+class TileCache;
 class QuadTree;
 class QuadTreeNode;
 class Frustum;
@@ -45,6 +46,7 @@ public:
     struct Statistics {
         int numDrawCalls;
         int numTriangles;
+        QString generatorProfile;
     };
 
     Terrain(QObject *parent = nullptr);
@@ -56,7 +58,12 @@ public:
     Statistics render(const QMatrix4x4 &proj, const QMatrix4x4 &view);
     void cycleRenderMode();
 
-    void generateMap(int seed);
+    /**
+     * Replaces the terrain with a new one. If graphFile is not empty the terrain comes from the
+     * module graph saved in it, see GraphGenerator, or from the built-in RandomGenerator if the
+     * file can't be loaded.
+     */
+    void generateMap(int seed, const QString &graphFile = QString());
 
 private:
     void renderTerrain(const QMatrix4x4 &proj, const QMatrix4x4 &view);
@@ -75,6 +82,7 @@ private:
     QOpenGLTexture *m_grass2;
 
     HeightMap *m_heightMap;
+    TileCache *m_tileCache;
     QuadTree *m_tree[6];
     QList<QuadTreeNode *> m_nodes[6];
 
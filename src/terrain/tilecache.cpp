@@ -0,0 +1,266 @@
+/*
+ * Copyright 2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of TrainsPlanet
+ *
+ * TrainsPlanet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TrainsPlanet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TrainsPlanet.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <QDir>
+#include <QStringList>
+#include <QMutexLocker>
+#include <QDebug>
+
+#include "tilecache.h"
+
+static const quint32 RecordMagic = 0x32545054; // "TPT2"
+
+/**
+ * Every tile is a record followed by its samples
+ */
+struct TileCache::Record {
+    quint32 magic;
+    // the bytes of the samples
+    quint32 size;
+    Key key;
+    float minHeight;
+    float maxHeight;
+    quint64 samplesHash;
+    // the hash of all the fields above
+    quint64 hash;
+};
+
+static quint64 recordHash(const void *record, int size)
+{
+    return TileCache::hash(record, size - sizeof(quint64));
+}
+
+TileCache::TileCache(const QString &path, qint64 maxSize)
+         : m_path(path)
+         , m_maxSize(maxSize)
+         // the smaller the segments the less is thrown away at once, but every one is a file to open
+         , m_segmentSize(qMax(maxSize / 16, qint64(1024 * 1024)))
+         , m_size(0)
+         , m_segment(0)
+{
+    static_assert(sizeof(Record) == 64, "the records are written as they are, they must have no padding");
+
+    QDir dir(path);
+    if (!dir.mkpath(".")) {
+        qWarning() << "Cannot create the tile cache in" << path;
+        return;
+    }
+
+    for (const QString &name: dir.entryList(QStringList() << "*.tiles", QDir::Files, QDir::Name)) {
+        bool ok;
+        int segment = name.section('.', 0, 0).toInt(&ok);
+        if (ok) {
+            scan(segment);
+        }
+    }
+
+    if (m_segments.isEmpty()) {
+        openSegment(0);
+    } else if (m_segments.last() < m_segmentSize) {
+        openSegment(m_segments.lastKey());
+    } else {
+        openSegment(m_segments.lastKey() + 1);
+    }
+    evict();
+}
+
+TileCache::~TileCache()
+{
+}
+
+/**
+ * Adds the tiles of a segment to the index. A record which is damaged or goes past the end
+ * of the file is the end of the segment, so what a crash left half written is truncated away.
+ */
+void TileCache::scan(int segment)
+{
+    QFile file(segmentPath(segment));
+    if (!file.open(QIODevice::ReadWrite)) {
+        qWarning() << "Cannot open the tile cache segment" << file.fileName() << ":" << file.errorString();
+        return;
+    }
+
+    const qint64 fileSize = file.size();
+    qint64 offset = 0;
+    Record record;
+    while (offset + (qint64)sizeof(Record) <= fileSize) {
+        if (!file.seek(offset) || file.read((char *)&record, sizeof(Record)) != sizeof(Record) ||
+            record.magic != RecordMagic || record.hash != recordHash(&record, sizeof(Record)) ||
+            offset + (qint64)sizeof(Record) + record.size > fileSize) {
+            break;
+        }
+        m_index.insert(record.key, Entry{ segment, offset });
+        offset += sizeof(Record) + record.size;
+    }
+
+    if (offset < fileSize) {
+        qWarning() << "Dropping" << fileSize - offset << "damaged bytes at the end of" << file.fileName();
+        file.resize(offset);
+    }
+    m_segments.insert(segment, offset);
+    m_size += offset;
+}
+
+bool TileCache::openSegment(int segment)
+{
+    m_file.close();
+    m_file.setFileName(segmentPath(segment));
+    m_segment = segment;
+    if (!m_segments.contains(segment)) {
+        m_segments.insert(segment, 0);
+    }
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Cannot open the tile cache segment" << m_file.fileName() << ":" << m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool TileCache::load(const Key &key, quint16 *data, int count, float *minHeight, float *maxHeight)
+{
+    QMutexLocker lock(&m_mutex);
+
+    auto it = m_index.constFind(key);
+    if (it == m_index.constEnd()) {
+        return false;
+    }
+    const Entry entry = *it;
+
+    QFile file(segmentPath(entry.segment));
+    Record record;
+    const qint64 bytes = count * sizeof(quint16);
+    const bool valid = file.open(QIODevice::ReadOnly) && file.seek(entry.offset) &&
+                       file.read((char *)&record, sizeof(Record)) == sizeof(Record) &&
+                       record.magic == RecordMagic && record.hash == recordHash(&record, sizeof(Record)) &&
+                       record.key == key && record.size == bytes &&
+                       file.read((char *)data, bytes) == bytes && record.samplesHash == hash(data, bytes);
+    if (!valid) {
+        qWarning() << "The tile cache segment" << file.fileName() << "is damaged at" << entry.offset;
+        m_index.remove(key);
+        return false;
+    }
+
+    *minHeight = record.minHeight;
+    *maxHeight = record.maxHeight;
+
+    // the segment will be the next one to go, move the tile out of it since it is still in use
+    if (entry.segment == m_segments.firstKey() && entry.segment != m_segment && m_size + m_segmentSize > m_maxSize) {
+        append(key, data, count, record.minHeight, record.maxHeight);
+    }
+    return true;
+}
+
+void TileCache::store(const Key &key, const quint16 *data, int count, float minHeight, float maxHeight)
+{
+    QMutexLocker lock(&m_mutex);
+    append(key, data, count, minHeight, maxHeight);
+}
+
+void TileCache::append(const Key &key, const quint16 *data, int count, float minHeight, float maxHeight)
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    Record record;
+    record.magic = RecordMagic;
+    record.size = count * sizeof(quint16);
+    record.key = key;
+    record.minHeight = minHeight;
+    record.maxHeight = maxHeight;
+    record.samplesHash = hash(data, record.size);
+    record.hash = recordHash(&record, sizeof(Record));
+
+    const qint64 offset = m_segments.value(m_segment);
+    if (m_file.write((const char *)&record, sizeof(Record)) != sizeof(Record) ||
+        m_file.write((const char *)data, record.size) != record.size || !m_file.flush()) {
+        qWarning() << "Cannot write to the tile cache segment" << m_file.fileName() << ":" << m_file.errorString();
+        // the next tiles must not end up after a partial one
+        m_file.resize(offset);
+        return;
+    }
+
+    m_index.insert(key, Entry{ m_segment, offset });
+    const qint64 end = offset + sizeof(Record) + record.size;
+    m_segments[m_segment] = end;
+    m_size += end - offset;
+    if (end >= m_segmentSize) {
+        openSegment(m_segment + 1);
+    }
+    evict();
+}
+
+void TileCache::evict()
+{
+    while (m_size > m_maxSize && m_segments.size() > 1) {
+        const int oldest = m_segments.firstKey();
+        m_size -= m_segments.take(oldest);
+        for (auto it = m_index.begin(); it != m_index.end();) {
+            if (it->segment == oldest) {
+                it = m_index.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        QFile::remove(segmentPath(oldest));
+    }
+}
+
+qint64 TileCache::size() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_size;
+}
+
+QString TileCache::segmentPath(int segment) const
+{
+    return QString("%1/%2.tiles").arg(m_path).arg(segment, 8, 10, QChar('0'));
+}
+
+quint64 TileCache::hash(const void *data, int size, quint64 hash)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    int i = 0;
+    for (; i + 8 <= size; i += 8) {
+        quint64 word;
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool operator==(const TileCache::Key &a, const TileCache::Key &b)
+{
+    return a.generator == b.generator && a.seed == b.seed && a.face == b.face &&
+           a.x == b.x && a.y == b.y && a.size == b.size && a.destSize == b.destSize;
+}
+
+uint qHash(const TileCache::Key &key, uint seed)
+{
+    // the multiplications only carry upwards, fold the high bits in
+    quint64 h = TileCache::hash(&key, sizeof(key), seed ^ 14695981039346656037ULL);
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    return uint(h ^ (h >> 32));
+}
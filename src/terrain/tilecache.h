@@ -0,0 +1,111 @@
+/*
+ * Copyright 2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of TrainsPlanet
+ *
+ * TrainsPlanet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TrainsPlanet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TrainsPlanet.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <QString>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QFile>
+
+/**
+ * Keeps the generated tiles on disk, so that the places already visited, in this session or
+ * in a previous one, don't need to be generated again.
+ * The tiles are only ever appended to segment files, each a small part of the maximum size.
+ * A crash can at most leave a truncated tile at the end of the last segment, which is dropped
+ * when the cache is opened again, and every tile is checksummed before being returned.
+ * When the segments grow over the maximum size the oldest one is deleted. The tiles read from
+ * it while it is about to go are appended again first, so the ones in use survive.
+ */
+class TileCache
+{
+public:
+    struct Key {
+        /**
+         * The hash of everything but the seed the tiles depend on, see Generator::hash()
+         */
+        quint64 generator;
+        qint32 seed;
+        qint32 face;
+        qint32 x;
+        qint32 y;
+        qint32 size;
+        /**
+         * The samples on a side of the tile, without the apron
+         */
+        qint32 destSize;
+    };
+
+    /**
+     * Opens the cache in the directory path, creating it if needed. maxSize is in bytes.
+     */
+    TileCache(const QString &path, qint64 maxSize);
+    ~TileCache();
+
+    /**
+     * Reads the count quantised values of the tile key in data, and its height range, see
+     * HeightMapChunk::quantise(). Returns false if the tile is not in the cache or it is
+     * damaged, in which case data is undefined.
+     */
+    bool load(const Key &key, quint16 *data, int count, float *minHeight, float *maxHeight);
+    void store(const Key &key, const quint16 *data, int count, float minHeight, float maxHeight);
+
+    /**
+     * The bytes taken on disk
+     */
+    qint64 size() const;
+
+    /**
+     * A variant of FNV-1a which works on 64 bit words. Unlike qHash() it is the same in every
+     * run, so it can identify things on disk.
+     */
+    static quint64 hash(const void *data, int size, quint64 hash = 14695981039346656037ULL);
+
+private:
+    struct Record;
+    struct Entry {
+        int segment;
+        qint64 offset;
+    };
+
+    void scan(int segment);
+    void append(const Key &key, const quint16 *data, int count, float minHeight, float maxHeight);
+    bool openSegment(int segment);
+    void evict();
+    QString segmentPath(int segment) const;
+
+    QString m_path;
+    qint64 m_maxSize;
+    qint64 m_segmentSize;
+    qint64 m_size;
+    mutable QMutex m_mutex;
+    QHash<Key, Entry> m_index;
+    // the size of every segment, the oldest first
+    QMap<int, qint64> m_segments;
+    // the last segment, which the tiles are appended to
+    QFile m_file;
+    int m_segment;
+};
+
+bool operator==(const TileCache::Key &a, const TileCache::Key &b);
+uint qHash(const TileCache::Key &key, uint seed = 0);
+
+#endif
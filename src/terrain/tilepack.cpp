@@ -0,0 +1,216 @@
+/*
+ * Copyright 2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of TrainsPlanet
+ *
+ * TrainsPlanet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TrainsPlanet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TrainsPlanet.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <QDebug>
+
+#include "tilepack.h"
+#include "heightmap.h"
+
+static const quint32 PackMagic = 0x4b505054; // "TPPK"
+static const quint32 PackVersion = 2;
+
+static bool operator<(const TilePack::Entry &a, const TilePack::Entry &b)
+{
+    if (a.face != b.face) {
+        return a.face < b.face;
+    }
+    if (a.size != b.size) {
+        return a.size < b.size;
+    }
+    if (a.y != b.y) {
+        return a.y < b.y;
+    }
+    return a.x < b.x;
+}
+
+static qint64 tileBytes(int destSize)
+{
+    return (qint64)(destSize + 4) * (destSize + 4) * HeightMapChunk::SampleSize * sizeof(quint16);
+}
+
+TilePack::TilePack(const QString &file)
+        : m_file(file)
+        , m_data(nullptr)
+        , m_header(nullptr)
+        , m_index(nullptr)
+{
+    static_assert(sizeof(Header) == 64 && sizeof(Entry) == 32, "the pack is mapped as it is, there must be no padding");
+
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot open the tile pack" << file << ":" << m_file.errorString();
+        return;
+    }
+
+    const qint64 size = m_file.size();
+    if (size < (qint64)sizeof(Header)) {
+        qWarning() << "The tile pack" << file << "is truncated";
+        return;
+    }
+    const uchar *data = m_file.map(0, size);
+    if (!data) {
+        qWarning() << "Cannot map the tile pack" << file << ":" << m_file.errorString();
+        return;
+    }
+
+    const Header *header = reinterpret_cast<const Header *>(data);
+    const qint64 bytes = tileBytes(header->destSize);
+    if (header->magic != PackMagic || header->version != PackVersion || header->sampleSize != HeightMapChunk::SampleSize ||
+        header->destSize < 1 || header->tileCount < 0 || header->indexOffset < sizeof(Header) ||
+        (qint64)header->indexOffset + header->tileCount * (qint64)sizeof(Entry) != size) {
+        qWarning() << "The tile pack" << file << "is not valid";
+        m_file.unmap(const_cast<uchar *>(data));
+        return;
+    }
+
+    // the lookups are binary searches, and they must not read past the tiles
+    const Entry *index = reinterpret_cast<const Entry *>(data + header->indexOffset);
+    for (int i = 0; i < header->tileCount; ++i) {
+        if (index[i].offset < sizeof(Header) || index[i].offset + (quint64)bytes > header->indexOffset || (i > 0 && !(index[i - 1] < index[i]))) {
+            qWarning() << "The tile pack" << file << "has a broken index";
+            m_file.unmap(const_cast<uchar *>(data));
+            return;
+        }
+    }
+
+    m_data = data;
+    m_header = header;
+    m_index = index;
+}
+
+TilePack::~TilePack()
+{
+}
+
+bool TilePack::isValid() const
+{
+    return m_data;
+}
+
+quint64 TilePack::generatorHash() const
+{
+    return m_header ? m_header->generatorHash : 0;
+}
+
+int TilePack::seed() const
+{
+    return m_header ? m_header->seed : 0;
+}
+
+int TilePack::destSize() const
+{
+    return m_header ? m_header->destSize : 0;
+}
+
+int TilePack::tileCount() const
+{
+    return m_header ? m_header->tileCount : 0;
+}
+
+const quint16 *TilePack::tile(int face, int x, int y, int size, float *minHeight, float *maxHeight) const
+{
+    if (!m_data) {
+        return nullptr;
+    }
+
+    const Entry key = { face, size, y, x, 0, 0, 0 };
+    const Entry *end = m_index + m_header->tileCount;
+    const Entry *entry = std::lower_bound(m_index, end, key);
+    if (entry == end || key < *entry) {
+        return nullptr;
+    }
+
+    *minHeight = entry->minHeight;
+    *maxHeight = entry->maxHeight;
+    return reinterpret_cast<const quint16 *>(m_data + entry->offset);
+}
+
+
+TilePackWriter::TilePackWriter(const QString &file, quint64 generatorHash, int seed, int destSize)
+              : m_file(file)
+              , m_generatorHash(generatorHash)
+              , m_seed(seed)
+              , m_destSize(destSize)
+              , m_valid(false)
+{
+    if (!m_file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot create the tile pack" << file << ":" << m_file.errorString();
+        return;
+    }
+
+    // the real header goes in when finishing
+    const TilePack::Header header = {};
+    m_valid = m_file.write((const char *)&header, sizeof(header)) == sizeof(header);
+}
+
+TilePackWriter::~TilePackWriter()
+{
+}
+
+bool TilePackWriter::isValid() const
+{
+    return m_valid;
+}
+
+bool TilePackWriter::add(int face, int x, int y, int size, const quint16 *data, float minHeight, float maxHeight)
+{
+    if (!m_valid) {
+        return false;
+    }
+
+    const TilePack::Entry entry = { face, size, y, x, minHeight, maxHeight, (quint64)m_file.pos() };
+    const qint64 bytes = tileBytes(m_destSize);
+    if (m_file.write((const char *)data, bytes) != bytes) {
+        qWarning() << "Cannot write the tile pack" << m_file.fileName() << ":" << m_file.errorString();
+        m_valid = false;
+        return false;
+    }
+    m_index << entry;
+    return true;
+}
+
+bool TilePackWriter::finish()
+{
+    if (!m_valid) {
+        m_file.cancelWriting();
+        return false;
+    }
+
+    std::sort(m_index.begin(), m_index.end());
+
+    TilePack::Header header = {};
+    header.magic = PackMagic;
+    header.version = PackVersion;
+    header.generatorHash = m_generatorHash;
+    header.seed = m_seed;
+    header.destSize = m_destSize;
+    header.sampleSize = HeightMapChunk::SampleSize;
+    header.tileCount = m_index.size();
+    header.indexOffset = m_file.pos();
+
+    const qint64 indexBytes = m_index.size() * sizeof(TilePack::Entry);
+    m_valid = m_file.write((const char *)m_index.constData(), indexBytes) == indexBytes &&
+              m_file.seek(0) && m_file.write((const char *)&header, sizeof(header)) == sizeof(header) &&
+              m_file.commit();
+    if (!m_valid) {
+        qWarning() << "Cannot write the tile pack" << m_file.fileName() << ":" << m_file.errorString();
+    }
+    return m_valid;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of TrainsPlanet
+ *
+ * TrainsPlanet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TrainsPlanet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TrainsPlanet.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILEPACK_H
+#define TILEPACK_H
+
+#include <QString>
+#include <QFile>
+#include <QSaveFile>
+#include <QVector>
+
+/**
+ * A read only container of the pre-baked tiles of a planet, mapped in memory.
+ * The file is a header, the tiles and an index sorted by (face, size, y, x). The tiles are
+ * quantised, in the layout of HeightMapChunk::fetchData(), which is the one the textures are
+ * made from, so they can be uploaded from the mapping without being parsed, and only the pages
+ * of the tiles in use end up in memory.
+ * The numbers are stored in the byte order of the machine which baked the pack.
+ */
+class TilePack
+{
+public:
+    struct Header {
+        quint32 magic;
+        quint32 version;
+        quint64 generatorHash;
+        qint32 seed;
+        qint32 destSize;
+        qint32 sampleSize;
+        qint32 tileCount;
+        quint64 indexOffset;
+        quint64 reserved[3];
+    };
+
+    struct Entry {
+        qint32 face;
+        qint32 size;
+        qint32 y;
+        qint32 x;
+        float minHeight;
+        float maxHeight;
+        quint64 offset;
+    };
+
+    /**
+     * Maps the pack in file. Check isValid() before using it.
+     */
+    explicit TilePack(const QString &file);
+    ~TilePack();
+
+    bool isValid() const;
+
+    /**
+     * The generator the tiles come from, see Generator::hash() and Generator::seed()
+     */
+    quint64 generatorHash() const;
+    int seed() const;
+    /**
+     * The samples on a side of the tiles, without the apron
+     */
+    int destSize() const;
+    int tileCount() const;
+
+    /**
+     * Returns the samples of a tile and its height range, or nullptr if the pack doesn't have it.
+     * The samples stay valid as long as the pack.
+     */
+    const quint16 *tile(int face, int x, int y, int size, float *minHeight, float *maxHeight) const;
+
+private:
+    QFile m_file;
+    const uchar *m_data;
+    const Header *m_header;
+    const Entry *m_index;
+};
+
+/**
+ * Writes a TilePack. The tiles are written as they are added, the index when finishing.
+ * Until then the pack is a temporary file, so a pack with the same name is never left broken.
+ */
+class TilePackWriter
+{
+public:
+    TilePackWriter(const QString &file, quint64 generatorHash, int seed, int destSize);
+    ~TilePackWriter();
+
+    bool isValid() const;
+
+    /**
+     * Adds a tile, whose samples are quantised in the layout of HeightMapChunk::fetchData().
+     * Every tile must be added only once.
+     */
+    bool add(int face, int x, int y, int size, const quint16 *data, float minHeight, float maxHeight);
+    /**
+     * Writes the index and the header. The pack is unusable if this is not called, or fails.
+     */
+    bool finish();
+
+private:
+    // the pack appears only once it is complete
+    QSaveFile m_file;
+    quint64 m_generatorHash;
+    int m_seed;
+    int m_destSize;
+    bool m_valid;
+    QVector<TilePack::Entry> m_index;
+};
+
+#endif
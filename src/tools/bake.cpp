@@ -0,0 +1,270 @@
+/*
+ * Copyright 2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of TrainsPlanet
+ *
+ * TrainsPlanet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TrainsPlanet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TrainsPlanet.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Generates every tile of the planet of a seed down to a LOD depth and writes them in a TilePack,
+ * which the game picks up from packs/planet-<seed>.tilepack instead of generating the tiles.
+ *
+ * Usage: trainsplanet-bake <seed> <max lod> [output] [threads]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QDir>
+#include <QFileInfo>
+
+#include "NoiseBuilders.h"
+
+#include "terrain/heightmap.h"
+#include "terrain/tilepack.h"
+
+// the same as the terrain, see Terrain::generateMap()
+static const int FACESIZE = 8192;
+static const int MESHSIZE = 33;
+static const double HEIGHTSCALE = 50;
+
+struct Tile {
+    HeightMap::Face face;
+    int x, y, size, lod;
+};
+
+/**
+ * Every worker has its own deque of tiles. It takes the tiles from the back and pushes the children
+ * there, so it walks its subtrees depth first and the children find the patches of their parent in
+ * the cache the generators share. A worker with nothing left steals from the front of the others,
+ * which is where the biggest subtrees are, so steals are rare, and the stolen tile finds the
+ * patches of its parent in the cache too. The deques are locked, a tile takes far longer than
+ * any contention on them.
+ */
+class Scheduler
+{
+public:
+    explicit Scheduler(int workers)
+        : m_queues(workers)
+        , m_pending(0)
+    {
+    }
+
+    void push(int worker, const Tile &tile)
+    {
+        ++m_pending;
+        Queue &queue = m_queues[worker];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tiles.push_back(tile);
+    }
+
+    /**
+     * Waits for a tile for worker, returns false once all the tiles are done.
+     */
+    bool pop(int worker, Tile &tile)
+    {
+        for (;;) {
+            if (take(m_queues[worker], tile, false)) {
+                return true;
+            }
+            for (size_t i = 1; i < m_queues.size(); ++i) {
+                if (take(m_queues[(worker + i) % m_queues.size()], tile, true)) {
+                    return true;
+                }
+            }
+            // the tiles being generated may still push their children
+            if (m_pending.load() == 0) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    /**
+     * Must be called after a tile popped is done and its children are pushed
+     */
+    void done()
+    {
+        --m_pending;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Tile> tiles;
+    };
+
+    static bool take(Queue &queue, Tile &tile, bool steal)
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tiles.empty()) {
+            return false;
+        }
+        if (steal) {
+            tile = queue.tiles.front();
+            queue.tiles.pop_front();
+        } else {
+            tile = queue.tiles.back();
+            queue.tiles.pop_back();
+        }
+        return true;
+    }
+
+    std::vector<Queue> m_queues;
+    std::atomic<int> m_pending;
+};
+
+class Progress : public noisepp::utils::BuilderCallback
+{
+public:
+    explicit Progress(int total)
+        : m_total(total)
+        , m_percent(-1)
+    {
+    }
+
+    void progress(int cur) override
+    {
+        const int percent = (long long)cur * 100 / m_total;
+        if (percent != m_percent) {
+            m_percent = percent;
+            fprintf(stderr, "\r%3d%% (%d of %d tiles)", percent, cur, m_total);
+            if (cur == m_total) {
+                fprintf(stderr, "\n");
+            }
+        }
+    }
+
+private:
+    int m_total;
+    int m_percent;
+};
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <seed> <max lod> [output] [threads]\n", argv[0]);
+        return 1;
+    }
+
+    const int seed = atoi(argv[1]);
+    const int maxLod = atoi(argv[2]);
+    const QString output = argc > 3 ? QString(argv[3]) : QString("packs/planet-%1.tilepack").arg(seed);
+    const int threads = argc > 4 ? std::max(atoi(argv[4]), 1) : std::max<int>(std::thread::hardware_concurrency(), 1);
+    int lodLevels = 0;
+    while ((FACESIZE >> (lodLevels + 1)) > 0) {
+        ++lodLevels;
+    }
+    if (maxLod < 0 || maxLod > lodLevels) {
+        fprintf(stderr, "The max lod must be between 0 and %d\n", lodLevels);
+        return 1;
+    }
+
+#ifndef __OPTIMIZE__
+    fprintf(stderr, "Warning: built without optimizations, the timings are meaningless\n");
+#endif
+
+    auto start = std::chrono::steady_clock::now();
+    // every worker has a generator of its own, single threaded. They share the ShellMaps of the
+    // first one, baked once, and its cache of the patches
+    RandomGenerator *generator = new RandomGenerator(FACESIZE, HEIGHTSCALE, seed, 1);
+    std::vector<HeightMap *> maps(threads);
+    maps[0] = new HeightMap(generator);
+    for (int i = 1; i < threads; ++i) {
+        maps[i] = new HeightMap(new RandomGenerator(generator, 1));
+    }
+
+    QDir().mkpath(QFileInfo(output).absolutePath());
+    TilePackWriter writer(output, maps[0]->generator()->hash(), seed, MESHSIZE);
+    if (!writer.isValid()) {
+        return 1;
+    }
+
+    // all the levels of the six quadtrees
+    int total = 0;
+    for (int lod = 0; lod <= maxLod; ++lod) {
+        total += 6 << (2 * lod);
+    }
+
+    static const HeightMap::Face faces[] = { HeightMap::Face::Top, HeightMap::Face::Bottom, HeightMap::Face::Front,
+                                             HeightMap::Face::Right, HeightMap::Face::Left, HeightMap::Face::Back };
+    Scheduler scheduler(threads);
+    for (int i = 0; i < 6; ++i) {
+        scheduler.push(i % threads, Tile{ faces[i], 0, 0, FACESIZE, 0 });
+    }
+
+    Progress progress(total);
+    std::mutex writerMutex;
+    std::atomic<bool> failed(false);
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back([&, i]() {
+            std::vector<quint16> data((MESHSIZE + 4) * (MESHSIZE + 4) * HeightMapChunk::SampleSize);
+            Tile tile;
+            while (scheduler.pop(i, tile)) {
+                HeightMapChunk *chunk = maps[i]->chunk(tile.face, tile.x, tile.y, tile.size);
+                if (chunk->fetchData(MESHSIZE, data.data())) {
+                    std::lock_guard<std::mutex> lock(writerMutex);
+                    if (!writer.add((int)tile.face, tile.x, tile.y, tile.size, data.data(), chunk->minHeight(), chunk->maxHeight())) {
+                        failed = true;
+                    }
+                    progress.callback();
+                } else {
+                    failed = true;
+                }
+
+                // pushed only now, so the patches of the tile are in the shared cache by the time
+                // any worker takes them
+                if (tile.lod < maxLod) {
+                    // the same children as QuadTreeNode::selectNode()
+                    const int s = tile.size / 2;
+                    scheduler.push(i, Tile{ tile.face, tile.x, tile.y, s, tile.lod + 1 });
+                    scheduler.push(i, Tile{ tile.face, tile.x, tile.y + s, s, tile.lod + 1 });
+                    scheduler.push(i, Tile{ tile.face, tile.x + s, tile.y + s, s, tile.lod + 1 });
+                    scheduler.push(i, Tile{ tile.face, tile.x + s, tile.y, s, tile.lod + 1 });
+                }
+                delete chunk;
+                scheduler.done();
+            }
+        });
+    }
+    for (std::thread &t: workers) {
+        t.join();
+    }
+    const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // the first generator last, the others use its maps
+    for (int i = threads; i-- > 0;) {
+        delete maps[i];
+    }
+
+    if (failed || !writer.finish()) {
+        fprintf(stderr, "Baking failed\n");
+        return 1;
+    }
+
+    const double samples = (double)total * (MESHSIZE + 4) * (MESHSIZE + 4);
+    printf("%d tiles in %.2f s with %d threads, baking the ShellMaps included\n", total, time, threads);
+    printf("%.1f tiles/s, %.0f samples/s\n", total / time, samples / time);
+    printf("written %s\n", output.toLocal8Bit().constData());
+    return 0;
+}
@@ -0,0 +1,486 @@
+/*
+ * Copyright 2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of TrainsPlanet
+ *
+ * TrainsPlanet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TrainsPlanet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TrainsPlanet.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Generates a fixed set of tiles with the reference generator and with a candidate one, then
+ * compares them and times both. The reference is a ReferenceGenerator: the graph of RandomGenerator
+ * with all its octaves in Real precision, one sample at a time, and normals from central differences.
+ * The tiles cover every face at several LODs, with the corners and the middle of the edges of the
+ * faces, for a few seeds. The results are written as JSON, to track them over time.
+ * The candidates skip the octaves finer than the spacing of the samples, so the errors shrink
+ * with the LOD. The ULP errors are only telling where the errors are tiny: across zero, where the
+ * ocean and the normals often are, any small difference is a huge number of ULPs.
+ * The tiles are then generated again in the reverse order, with a new candidate generator. A tile
+ * must never depend on the ones generated before it, since the TileCache and the TilePacks keep
+ * whichever came first, so the tool fails if any differs.
+ * Every tile is also checked against the tiles of the next LOD next to its parent, which it is
+ * drawn next to when fully morphed: its parent heights on the sides it shares with them must be
+ * their heights to the bit, in full precision and quantised. Quantised, the samples it shares
+ * with its neighbours of the same size must be the same too.
+ * The baked candidate is also compared with RandomGenerator without baking, which skips the same
+ * octaves at the same spacing, so the difference is only the one of the ShellMaps and patches. It
+ * fails if that exceeds RandomGenerator::bakingError(), which bounds it from the interpolation
+ * errors of the maps and the slopes of the graph, not from the tiles.
+ *
+ * Usage: trainsplanet-equivalence [candidate] [output]
+ *   candidate: baked (default), the ShellMaps and patches of RandomGenerator
+ *              threaded, RandomGenerator without them, with a thread per core
+ *              graph:<file>, a GraphGenerator loading file
+ *   output: the JSON file, the standard output if missing
+ * Exits with 1 if the order of the tiles changes them, if they don't match their neighbours or the
+ * next LOD, or if the baked candidate is further from the unbaked one than its bound.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "terrain/heightmap.h"
+
+// the same as the terrain, see Terrain::generateMap()
+static const int FACESIZE = 8192;
+static const int MESHSIZE = 33;
+static const double HEIGHTSCALE = 50;
+
+static const int Seeds[] = { 1, 2, 1234 };
+static const int Lods[] = { 0, 2, 4, 6, 8 };
+
+struct Tile {
+    HeightMap::Face face;
+    int x, y, size, lod;
+};
+
+static std::vector<Tile> tileSet()
+{
+    static const HeightMap::Face faces[] = { HeightMap::Face::Top, HeightMap::Face::Bottom, HeightMap::Face::Front,
+                                             HeightMap::Face::Right, HeightMap::Face::Left, HeightMap::Face::Back };
+    std::vector<Tile> tiles;
+    for (HeightMap::Face face: faces) {
+        for (int lod: Lods) {
+            const int size = FACESIZE >> lod;
+            const int last = FACESIZE - size;
+            const int middle = last / 2 / size * size;
+            // the corners and the middle of the edges of the face, where the seams are, and the centre.
+            // The neighbours of a corner along the seams and of the centre share borders with them at
+            // every LOD, for the check of the order
+            const int positions[][2] = { { 0, 0 }, { last, 0 }, { 0, last }, { last, last },
+                                         { middle, 0 }, { 0, middle }, { last, middle }, { middle, last }, { middle, middle },
+                                         { size, 0 }, { 0, size }, { middle + size, middle }, { middle, middle + size },
+                                         { middle + size, middle + size } };
+            std::set<std::pair<int, int>> done;
+            for (const int *p: positions) {
+                if (p[0] < FACESIZE && p[1] < FACESIZE && done.insert(std::make_pair(p[0], p[1])).second) {
+                    tiles.push_back(Tile{ face, p[0], p[1], size, lod });
+                }
+            }
+        }
+    }
+    return tiles;
+}
+
+/**
+ * The distance between two floats in units in the last place, 0 if they are the same float
+ */
+static long long ulps(float a, float b)
+{
+    int ia, ib;
+    memcpy(&ia, &a, sizeof(ia));
+    memcpy(&ib, &b, sizeof(ib));
+    // the negative floats in reverse, so the integers are ordered like the floats
+    const long long la = ia < 0 ? (long long)INT32_MIN - ia : ia;
+    const long long lb = ib < 0 ? (long long)INT32_MIN - ib : ib;
+    return std::llabs(la - lb);
+}
+
+struct Error {
+    Error() : maxAbsolute(0), sumAbsolute(0), maxUlps(0), sumUlps(0), identical(0), count(0) {}
+
+    void add(float reference, float candidate)
+    {
+        const double absolute = std::fabs((double)reference - candidate);
+        const long long u = ulps(reference, candidate);
+        // a NaN on either side must not hide in the maximum
+        maxAbsolute = absolute == absolute ? std::max(maxAbsolute, absolute) : INFINITY;
+        sumAbsolute += absolute;
+        maxUlps = std::max(maxUlps, u);
+        sumUlps += u;
+        identical += u == 0;
+        ++count;
+    }
+
+    void add(const Error &other)
+    {
+        maxAbsolute = std::max(maxAbsolute, other.maxAbsolute);
+        sumAbsolute += other.sumAbsolute;
+        maxUlps = std::max(maxUlps, other.maxUlps);
+        sumUlps += other.sumUlps;
+        identical += other.identical;
+        count += other.count;
+    }
+
+    void print(FILE *file, const char *name) const
+    {
+        fprintf(file, "\"%s\": { \"max_abs\": %.9g, \"mean_abs\": %.9g, \"max_ulp\": %lld, \"mean_ulp\": %.3f, \"identical\": %.6f }", name,
+                maxAbsolute, count ? sumAbsolute / count : 0., maxUlps, count ? sumUlps / count : 0., count ? (double)identical / count : 1.);
+    }
+
+    double maxAbsolute;
+    double sumAbsolute;
+    long long maxUlps;
+    double sumUlps;
+    long long identical;
+    long long count;
+};
+
+struct LodErrors {
+    Error height;
+    Error normal;
+    Error parentHeight;
+    // the heights of the baked candidate against the unbaked ones, and the largest bound of the seeds
+    Error baking;
+    double bakingBound = 0;
+};
+
+/**
+ * Compares the parent heights of a tile along the sides it shares with its parent with the heights
+ * of the tiles of twice its size on the other side, on the same face. Those are drawn next to the
+ * tile, which is fully morphed to its parent there, so the samples on the sides must be the ones
+ * of the bigger tiles, to the bit, and the samples in between the mean of the two around.
+ * Quantised, the means are not checked: the renderer folds them on the samples around when fully
+ * morphed, and the mean of two quantised heights is not a quantised height.
+ * Returns the samples which don't match.
+ */
+template<typename T>
+static int lodBoundaryMismatches(HeightMap &map, const Tile &tile, const std::vector<T> &data)
+{
+    const int width = MESHSIZE + 4;
+    const int steps = MESHSIZE - 1;
+    const int h = HeightMapChunk::SampleSize - 1;
+    const int parentX = tile.x - tile.x % (2 * tile.size);
+    const int parentY = tile.y - tile.y % (2 * tile.size);
+    std::vector<T> neighbour(data.size());
+
+    int mismatches = 0;
+    // the neighbour of the parent to the left, right, top and bottom
+    const int directions[][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+    for (const int *d: directions) {
+        const int x = parentX + d[0] * 2 * tile.size;
+        const int y = parentY + d[1] * 2 * tile.size;
+        // the side of the tile must be on the side of the parent
+        const bool onSide = d[0] < 0 ? tile.x == parentX : d[0] > 0 ? tile.x > parentX
+                                                                   : d[1] < 0 ? tile.y == parentY : tile.y > parentY;
+        if (tile.size == FACESIZE || !onSide || x < 0 || y < 0 || x >= FACESIZE || y >= FACESIZE) {
+            continue;
+        }
+        HeightMapChunk *chunk = map.chunk(tile.face, x, y, 2 * tile.size);
+        chunk->fetchData(MESHSIZE, neighbour.data());
+        delete chunk;
+
+        // the line of the tile and of the neighbour, and where the tile starts along it in the neighbour
+        const int line = d[0] + d[1] < 0 ? 0 : steps;
+        const int otherLine = steps - line;
+        const int start = d[0] ? (tile.y - parentY) * steps / (2 * tile.size) : (tile.x - parentX) * steps / (2 * tile.size);
+        auto sample = [&](int along, int across) { return d[0] ? (along + 2) * width + across + 2 : (across + 2) * width + along + 2; };
+        for (int a = 0; a <= steps; ++a) {
+            if (a % 2 && !std::is_floating_point<T>::value) {
+                continue;
+            }
+            const T parent = data[sample(a, line) * HeightMapChunk::SampleSize + h];
+            const T *first = &neighbour[sample(start + a / 2, otherLine) * HeightMapChunk::SampleSize];
+            const T *second = &neighbour[sample(start + (a + 1) / 2, otherLine) * HeightMapChunk::SampleSize];
+            const T expected = a % 2 ? (first[0] + second[0]) / (T)2 : first[0];
+            mismatches += memcmp(&parent, &expected, sizeof(T)) != 0;
+        }
+    }
+    return mismatches;
+}
+
+/**
+ * Compares the quantised samples a tile shares with the tiles of its size to the right and below
+ * it, on the same face: the lines around the edge between them, which are the apron of either.
+ * The heights of every tile are quantised with the same base and step, so those must be the same.
+ * Returns the samples which are not.
+ */
+static int quantisedSeamMismatches(HeightMap &map, const Tile &tile, const std::vector<quint16> &data)
+{
+    const int width = MESHSIZE + 4;
+    const int steps = MESHSIZE - 1;
+    std::vector<quint16> neighbour(data.size());
+
+    int mismatches = 0;
+    for (int right = 0; right < 2; ++right) {
+        const int x = tile.x + right * tile.size;
+        const int y = tile.y + (1 - right) * tile.size;
+        if (x >= FACESIZE || y >= FACESIZE) {
+            continue;
+        }
+        HeightMapChunk *chunk = map.chunk(tile.face, x, y, tile.size);
+        chunk->fetchData(MESHSIZE, neighbour.data());
+        delete chunk;
+
+        // the lines from two before the edge to two after it, the first four of the neighbour
+        for (int along = 0; along < width; ++along) {
+            for (int across = 0; across < 5; ++across) {
+                const int i = right ? along * width + steps + across : (steps + across) * width + along;
+                const int j = right ? along * width + across : across * width + along;
+                mismatches += memcmp(&data[i * HeightMapChunk::SampleSize], &neighbour[j * HeightMapChunk::SampleSize],
+                                     HeightMapChunk::SampleSize * sizeof(quint16)) != 0;
+            }
+        }
+    }
+    return mismatches;
+}
+
+/**
+ * The string as a JSON string literal
+ */
+static std::string jsonString(const std::string &string)
+{
+    std::string json = "\"";
+    for (char c: string) {
+        if (c == '"' || c == '\\') {
+            json += '\\';
+            json += c;
+        } else if ((unsigned char)c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            json += escaped;
+        } else {
+            json += c;
+        }
+    }
+    return json + '"';
+}
+
+static Generator *createCandidate(const std::string &candidate, int seed)
+{
+    if (candidate == "baked") {
+        return new RandomGenerator(FACESIZE, HEIGHTSCALE, seed, 1, true);
+    } else if (candidate == "threaded") {
+        return new RandomGenerator(FACESIZE, HEIGHTSCALE, seed, std::max<int>(std::thread::hardware_concurrency(), 1), false);
+    } else if (candidate.compare(0, 6, "graph:") == 0) {
+        return new GraphGenerator(QString::fromStdString(candidate.substr(6)), FACESIZE, HEIGHTSCALE, seed, 1);
+    }
+    return nullptr;
+}
+
+int main(int argc, char **argv)
+{
+    const std::string candidate = argc > 1 ? argv[1] : "baked";
+    FILE *output = argc > 2 ? fopen(argv[2], "w") : stdout;
+    if (!output) {
+        fprintf(stderr, "Cannot write %s\n", argv[2]);
+        return 1;
+    }
+
+#ifndef __OPTIMIZE__
+    fprintf(stderr, "Warning: built without optimizations, the timings are meaningless\n");
+#endif
+
+    const std::vector<Tile> tiles = tileSet();
+    const int count = (MESHSIZE + 4) * (MESHSIZE + 4);
+    std::vector<float> reference(count * HeightMapChunk::SampleSize);
+    std::vector<float> result(count * HeightMapChunk::SampleSize);
+
+    LodErrors errors[sizeof(Lods) / sizeof(Lods[0])];
+    double referenceTime = 0, candidateTime = 0;
+    long long samples = 0;
+    int reordered = 0;
+    int lodMismatches = 0;
+    int seamMismatches = 0;
+    long long outOfBounds = 0;
+    std::vector<float> unbaked(count * HeightMapChunk::SampleSize);
+
+    for (int seed: Seeds) {
+        Generator *candidateGenerator, *reorderedGenerator;
+        try {
+            candidateGenerator = createCandidate(candidate, seed);
+            reorderedGenerator = createCandidate(candidate, seed);
+        } catch (const std::exception &e) {
+            fprintf(stderr, "Cannot create the candidate %s: %s\n", candidate.c_str(), e.what());
+            return 1;
+        }
+        if (!candidateGenerator) {
+            fprintf(stderr, "Unknown candidate %s\n", candidate.c_str());
+            return 1;
+        }
+        HeightMap referenceMap(new ReferenceGenerator(FACESIZE, HEIGHTSCALE, seed));
+        HeightMap candidateMap(candidateGenerator);
+        HeightMap reorderedMap(reorderedGenerator);
+        RandomGenerator *bakedGenerator = candidate == "baked" ? static_cast<RandomGenerator *>(candidateGenerator) : nullptr;
+        HeightMap *unbakedMap = bakedGenerator ? new HeightMap(new RandomGenerator(FACESIZE, HEIGHTSCALE, seed, 1, false)) : nullptr;
+        // the candidate tiles, to compare them with the ones generated in the other order
+        std::vector<std::vector<float>> results(tiles.size());
+
+        for (size_t t = 0; t < tiles.size(); ++t) {
+            const Tile &tile = tiles[t];
+            HeightMapChunk *referenceChunk = referenceMap.chunk(tile.face, tile.x, tile.y, tile.size);
+            HeightMapChunk *candidateChunk = candidateMap.chunk(tile.face, tile.x, tile.y, tile.size);
+
+            auto start = std::chrono::steady_clock::now();
+            referenceChunk->fetchData(MESHSIZE, reference.data());
+            referenceTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            start = std::chrono::steady_clock::now();
+            candidateChunk->fetchData(MESHSIZE, result.data());
+            candidateTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            samples += count;
+            results[t] = result;
+
+            LodErrors &e = errors[std::find(Lods, Lods + sizeof(Lods) / sizeof(Lods[0]), tile.lod) - Lods];
+            for (int i = 0; i < count; ++i) {
+                const float *r = &reference[i * HeightMapChunk::SampleSize];
+                const float *c = &result[i * HeightMapChunk::SampleSize];
+                e.height.add(r[0], c[0]);
+                for (int j = 1; j < HeightMapChunk::SampleSize - 1; ++j) {
+                    e.normal.add(r[j], c[j]);
+                }
+                e.parentHeight.add(r[HeightMapChunk::SampleSize - 1], c[HeightMapChunk::SampleSize - 1]);
+            }
+
+            delete referenceChunk;
+            delete candidateChunk;
+
+            if (unbakedMap) {
+                const double bound = bakedGenerator->bakingError(tile.size / 8000. / (MESHSIZE - 1));
+                e.bakingBound = std::max(e.bakingBound, bound);
+                HeightMapChunk *chunk = unbakedMap->chunk(tile.face, tile.x, tile.y, tile.size);
+                chunk->fetchData(MESHSIZE, unbaked.data());
+                delete chunk;
+                for (int i = 0; i < count; ++i) {
+                    const float u = unbaked[i * HeightMapChunk::SampleSize];
+                    const float c = result[i * HeightMapChunk::SampleSize];
+                    e.baking.add(u, c);
+                    // a NaN is out of bounds too
+                    outOfBounds += !(std::fabs((double)u - c) <= bound);
+                }
+            }
+        }
+        delete unbakedMap;
+
+        for (size_t t = tiles.size(); t-- > 0;) {
+            const Tile &tile = tiles[t];
+            HeightMapChunk *chunk = reorderedMap.chunk(tile.face, tile.x, tile.y, tile.size);
+            chunk->fetchData(MESHSIZE, result.data());
+            // bitwise, a -0.0 for a 0.0 in a normal would be a different tile too
+            reordered += memcmp(result.data(), results[t].data(), result.size() * sizeof(float)) != 0;
+            delete chunk;
+        }
+
+        std::vector<quint16> quantised(result.size());
+        for (size_t t = 0; t < tiles.size(); ++t) {
+            const Tile &tile = tiles[t];
+            lodMismatches += lodBoundaryMismatches(candidateMap, tile, results[t]);
+            HeightMapChunk *chunk = candidateMap.chunk(tile.face, tile.x, tile.y, tile.size);
+            chunk->fetchData(MESHSIZE, quantised.data());
+            delete chunk;
+            lodMismatches += lodBoundaryMismatches(candidateMap, tile, quantised);
+            seamMismatches += quantisedSeamMismatches(candidateMap, tile, quantised);
+        }
+    }
+
+    LodErrors total;
+    for (const LodErrors &e: errors) {
+        total.height.add(e.height);
+        total.normal.add(e.normal);
+        total.parentHeight.add(e.parentHeight);
+        total.baking.add(e.baking);
+    }
+
+    fprintf(output, "{\n");
+    fprintf(output, "  \"candidate\": %s,\n", jsonString(candidate).c_str());
+    fprintf(output, "  \"seeds\": [");
+    for (size_t i = 0; i < sizeof(Seeds) / sizeof(Seeds[0]); ++i) {
+        fprintf(output, "%s%d", i ? ", " : "", Seeds[i]);
+    }
+    fprintf(output, "],\n");
+    fprintf(output, "  \"tiles\": %d,\n", (int)(tiles.size() * sizeof(Seeds) / sizeof(Seeds[0])));
+    fprintf(output, "  \"samples\": %lld,\n", samples);
+    fprintf(output, "  \"reference_samples_per_second\": %.0f,\n", samples / referenceTime);
+    fprintf(output, "  \"candidate_samples_per_second\": %.0f,\n", samples / candidateTime);
+    fprintf(output, "  \"tiles_changed_by_order\": %d,\n", reordered);
+    fprintf(output, "  \"lod_boundary_mismatches\": %d,\n", lodMismatches);
+    fprintf(output, "  \"quantised_seam_mismatches\": %d,\n", seamMismatches);
+    if (candidate == "baked") {
+        fprintf(output, "  \"baking_out_of_bounds\": %lld,\n", outOfBounds);
+    }
+    fprintf(output, "  ");
+    total.height.print(output, "height");
+    fprintf(output, ",\n  ");
+    total.normal.print(output, "normal");
+    fprintf(output, ",\n  ");
+    total.parentHeight.print(output, "parent_height");
+    if (candidate == "baked") {
+        fprintf(output, ",\n  ");
+        total.baking.print(output, "baking");
+    }
+    fprintf(output, ",\n  \"lods\": [\n");
+    for (size_t i = 0; i < sizeof(Lods) / sizeof(Lods[0]); ++i) {
+        fprintf(output, "    { \"lod\": %d, ", Lods[i]);
+        errors[i].height.print(output, "height");
+        fprintf(output, ", ");
+        errors[i].normal.print(output, "normal");
+        fprintf(output, ", ");
+        errors[i].parentHeight.print(output, "parent_height");
+        if (candidate == "baked") {
+            fprintf(output, ", ");
+            errors[i].baking.print(output, "baking");
+            fprintf(output, ", \"baking_bound\": %.9g", errors[i].bakingBound);
+        }
+        fprintf(output, " }%s\n", i + 1 < sizeof(Lods) / sizeof(Lods[0]) ? "," : "");
+    }
+    fprintf(output, "  ]\n}\n");
+
+    if (output != stdout) {
+        fclose(output);
+    }
+    fprintf(stderr, "%s: %.0f samples/s against %.0f of the reference, height error max %g mean %g\n", candidate.c_str(),
+            samples / candidateTime, samples / referenceTime, total.height.maxAbsolute,
+            total.height.count ? total.height.sumAbsolute / total.height.count : 0.);
+    bool ok = true;
+    if (reordered) {
+        fprintf(stderr, "%s: %d tiles changed when generated in the reverse order\n", candidate.c_str(), reordered);
+        ok = false;
+    }
+    if (lodMismatches) {
+        fprintf(stderr, "%s: %d samples on the sides of the tiles differ from the bigger neighbours\n", candidate.c_str(), lodMismatches);
+        ok = false;
+    }
+    if (seamMismatches) {
+        fprintf(stderr, "%s: %d quantised samples differ from the ones of the neighbours\n", candidate.c_str(), seamMismatches);
+        ok = false;
+    }
+    if (outOfBounds) {
+        for (size_t i = 0; i < sizeof(Lods) / sizeof(Lods[0]); ++i) {
+            fprintf(stderr, "%s: baking error at LOD %d max %g, bound %g\n", candidate.c_str(),
+                    Lods[i], errors[i].baking.maxAbsolute, errors[i].bakingBound);
+        }
+        fprintf(stderr, "%s: %lld heights differ from the unbaked ones by more than the bound\n", candidate.c_str(), outOfBounds);
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,387 @@
+/*
+ * Copyright 2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of TrainsPlanet
+ *
+ * TrainsPlanet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TrainsPlanet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TrainsPlanet.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmarks of the machinery of noisepp around the noise itself.
+ *
+ * cache: evaluates graphs one point at a time, cleaning the cache before every point, which is
+ *        what the per-point users of a pipeline do. It only uses the public API of the pipelines,
+ *        so it also builds against older versions of noisepp, to compare them. The checksums
+ *        must be the same in every version.
+ *
+ * jobs:  runs batches of jobs through a noisepp::utils::ThreadedJobQueue, the lock-free
+ *        threadpp::JobPool, and through the mutex and condition queue it replaced, which is
+ *        copied here.
+ *
+ * Usage: trainsplanet-noisebench [benchmark]
+ *   benchmark: cache or jobs, all of them if missing
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Noise.h"
+#include "NoiseJobQueue.h"
+
+// the radius of the sphere the terrain samples the noise on, see RandomGenerator::fetchData()
+static const double NoiseRadius = 8192. / 8000. / 2.;
+
+struct Samples {
+    std::vector<noisepp::Real> x, y, z;
+};
+
+// points on a longitude/latitude grid, see trainsplanet-noisecompare
+static Samples sphereSamples(int width, int height)
+{
+    Samples s;
+    for (int j = 0; j < height; ++j) {
+        const double lat = M_PI / 2. - (j + 0.5) / height * M_PI;
+        for (int i = 0; i < width; ++i) {
+            const double lon = (i + 0.5) / width * 2. * M_PI - M_PI;
+            s.x.push_back(NoiseRadius * std::cos(lat) * std::cos(lon));
+            s.y.push_back(NoiseRadius * std::cos(lat) * std::sin(lon));
+            s.z.push_back(NoiseRadius * std::sin(lat));
+        }
+    }
+    return s;
+}
+
+// best of a few runs, in nanoseconds per call of function
+template<class Function>
+static double timeRuns(size_t calls, Function function)
+{
+    double best = 0;
+    for (int run = 0; run < 5; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (run == 0 || time < best)
+            best = time;
+    }
+    return best / calls * 1e9;
+}
+
+/**
+ * The graph of RandomGenerator, see its constructor
+ */
+struct TerrainGraph {
+    noisepp::PerlinModule continents;
+    noisepp::SelectModule continentSelect;
+    noisepp::ConstantModule ocean;
+    noisepp::PerlinModule mountainDefinition;
+    noisepp::ScalePointModule mountainDefinitionScalePoint;
+    noisepp::SelectModule mountainSelect;
+    noisepp::ScaleBiasModule mountainSelectScaleBias;
+    noisepp::RidgedMultiModule mountains;
+    noisepp::ScaleBiasModule mountainsScaleBias;
+    noisepp::ScalePointModule mountainsScalePoint;
+    noisepp::BillowModule lowlands;
+    noisepp::ScaleBiasModule lowlandsScaleBias;
+    noisepp::ScalePointModule lowlandsScalePoint;
+
+    explicit TerrainGraph(int seed)
+    {
+        ocean.setValue(-1.0);
+
+        mountains.setOctaveCount(12);
+        mountains.setSeed(seed);
+        mountainsScaleBias.setSourceModule(0, mountains);
+        mountainsScaleBias.setScale(3.0);
+        mountainsScaleBias.setBias(0.5);
+        mountainsScalePoint.setSourceModule(0, mountainsScaleBias);
+        mountainsScalePoint.setScaleX(25);
+        mountainsScalePoint.setScaleY(25);
+        mountainsScalePoint.setScaleZ(25);
+
+        lowlands.setOctaveCount(7);
+        lowlands.setSeed(seed);
+        lowlandsScaleBias.setSourceModule(0, lowlands);
+        lowlandsScaleBias.setScale(0.2);
+        lowlandsScaleBias.setBias(-0.8);
+        lowlandsScalePoint.setSourceModule(0, lowlandsScaleBias);
+        lowlandsScalePoint.setScaleX(50);
+        lowlandsScalePoint.setScaleY(50);
+        lowlandsScalePoint.setScaleZ(50);
+
+        mountainDefinition.setOctaveCount(12);
+        mountainDefinitionScalePoint.setSourceModule(0, mountainDefinition);
+        mountainDefinitionScalePoint.setScaleX(10);
+        mountainDefinitionScalePoint.setScaleY(10);
+        mountainDefinitionScalePoint.setScaleZ(10);
+
+        mountainSelect.setControlModule(mountainDefinitionScalePoint);
+        mountainSelect.setSourceModule(0, lowlandsScalePoint);
+        mountainSelect.setSourceModule(1, mountainsScalePoint);
+        mountainSelect.setEdgeFalloff(0.1);
+        mountainSelect.setLowerBound(0.5);
+        mountainSelectScaleBias.setSourceModule(0, mountainSelect);
+        mountainSelectScaleBias.setScale(0.5);
+        mountainSelectScaleBias.setBias(0.5);
+
+        continents.setSeed(seed);
+        continents.setOctaveCount(12);
+        continents.setFrequency(1.0);
+        continents.setLacunarity(2.0);
+        continents.setPersistence(0.625);
+
+        continentSelect.setControlModule(continents);
+        continentSelect.setSourceModule(0, ocean);
+        continentSelect.setSourceModule(1, mountainSelectScaleBias);
+        continentSelect.setLowerBound(0.0);
+        continentSelect.setEdgeFalloff(0.1);
+    }
+
+    const noisepp::Module &root() const { return continentSelect; }
+};
+
+/**
+ * A chain of additions whose every link also uses a single octave Perlin, so most of the time
+ * goes to looking up the Perlin in the cache
+ */
+struct SharedGraph {
+    static const int Users = 32;
+    noisepp::PerlinModule perlin;
+    noisepp::ScaleBiasModule scaleBias[Users];
+    noisepp::AdditionModule addition[Users];
+
+    SharedGraph()
+    {
+        perlin.setOctaveCount(1);
+        for (int i = 0; i < Users; ++i) {
+            scaleBias[i].setSourceModule(0, perlin);
+            scaleBias[i].setScale(1. + i * 0.01);
+            addition[i].setSourceModule(0, i ? (const noisepp::Module &)addition[i - 1] : (const noisepp::Module &)perlin);
+            addition[i].setSourceModule(1, scaleBias[i]);
+        }
+    }
+
+    const noisepp::Module &root() const { return addition[Users - 1]; }
+};
+
+static void benchmarkCache(const char *name, const noisepp::Module &module, int precision, const Samples &s)
+{
+    noisepp::Pipeline3D pipeline;
+    pipeline.setPrecision(precision);
+    const noisepp::PipelineElement3D *root = pipeline.getElement(module.addToPipeline(&pipeline));
+    noisepp::Cache *cache = pipeline.createCache();
+
+    const size_t count = s.x.size();
+    double checksum = 0;
+    const double ns = timeRuns(count, [&]() {
+        checksum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            pipeline.cleanCache(cache);
+            checksum += root->getValue(s.x[i], s.y[i], s.z[i], cache);
+        }
+    });
+    pipeline.freeCache(cache);
+
+    printf("  %-8s %-6s %8.1f ns/sample  checksum %.17g\n", name, precision == noisepp::NOISE_PRECISION_REAL ? "real" : "single", ns, checksum);
+}
+
+static void benchmarkCache()
+{
+    printf("cache: one point at a time, cleaning the cache before every point\n");
+    const Samples samples = sphereSamples(128, 64);
+    const TerrainGraph terrain(2);
+    const SharedGraph shared;
+    for (int precision: { (int)noisepp::NOISE_PRECISION_REAL, (int)noisepp::NOISE_PRECISION_SINGLE }) {
+        benchmarkCache("terrain", terrain.root(), precision, samples);
+    }
+    benchmarkCache("shared", shared.root(), noisepp::NOISE_PRECISION_REAL, samples);
+}
+
+/**
+ * The ThreadedJobQueue before threadpp::JobPool. It had a lost completion: if the workers finished
+ * every job before executeJobs() took the lock, the jobs were never finish()ed. Here they are
+ * drained after the loop, and the destructor stops the workers under the lock so that none misses
+ * the wake up. Otherwise it is as it was.
+ */
+class MutexJobQueue : public noisepp::utils::JobQueue
+{
+public:
+    explicit MutexJobQueue(size_t numberOfThreads)
+        : m_threadsDone(false)
+        , m_workingThreads(0)
+    {
+        for (size_t i = 0; i < numberOfThreads; ++i) {
+            m_threads.createThread(threadEntry, this);
+        }
+    }
+    ~MutexJobQueue()
+    {
+        {
+            threadpp::Mutex::Lock lk(m_mutex);
+            m_threadsDone = true;
+            m_cond.notifyAll();
+        }
+        m_threads.join();
+    }
+
+    void addJob(noisepp::utils::Job *job) override
+    {
+        threadpp::Mutex::Lock lk(m_mutex);
+        mJobs.push(job);
+    }
+    void executeJobs() override
+    {
+        m_cond.notifyAll();
+        threadpp::Mutex::Lock lk(m_mutex);
+        while (!mJobs.empty() || m_workingThreads > 0) {
+            if (!mJobs.empty() || m_workingThreads > 0)
+                m_mainCond.wait(lk);
+            finishDone(lk);
+        }
+        finishDone(lk);
+    }
+
+private:
+    void finishDone(threadpp::Mutex::Lock &lk)
+    {
+        while (!m_jobsDone.empty()) {
+            noisepp::utils::Job *job = m_jobsDone.front();
+            m_jobsDone.pop();
+            lk.unlock();
+            job->finish();
+            delete job;
+            lk.lock();
+        }
+    }
+    void threadFunction()
+    {
+        threadpp::Mutex::Lock lk(m_mutex);
+        while (!m_threadsDone) {
+            if (mJobs.empty())
+                m_cond.wait(lk);
+            if (!mJobs.empty()) {
+                noisepp::utils::Job *job = mJobs.front();
+                mJobs.pop();
+                ++m_workingThreads;
+                lk.unlock();
+                job->execute();
+                lk.lock();
+                --m_workingThreads;
+                m_jobsDone.push(job);
+                m_mainCond.notifyOne();
+            }
+        }
+    }
+    static void *threadEntry(void *queue)
+    {
+        static_cast<MutexJobQueue *>(queue)->threadFunction();
+        return nullptr;
+    }
+
+    std::queue<noisepp::utils::Job *> m_jobsDone;
+    threadpp::ThreadGroup m_threads;
+    threadpp::Mutex m_mutex;
+    threadpp::Condition m_cond, m_mainCond;
+    bool m_threadsDone;
+    unsigned m_workingThreads;
+};
+
+/**
+ * Does iterations of busy work and counts the finished jobs
+ */
+class BenchJob : public noisepp::utils::Job
+{
+public:
+    BenchJob(int iterations, std::atomic<int> *finished) : m_iterations(iterations), m_finished(finished) {}
+    void execute() override
+    {
+        volatile double x = 1.0;
+        for (int i = 0; i < m_iterations; ++i) {
+            x = x * 1.0000001 + 1e-9;
+        }
+    }
+    void finish() override { ++*m_finished; }
+
+private:
+    int m_iterations;
+    std::atomic<int> *m_finished;
+};
+
+static const int JobCount = 20000;
+static const int JobBatch = 16;
+
+// nanoseconds per job, or a negative number if some job wasn't finished
+static double timeJobs(noisepp::utils::JobQueue *queue, int iterations)
+{
+    std::atomic<int> finished(0);
+    const double ns = timeRuns(JobCount, [&]() {
+        for (int i = 0; i < JobCount; i += JobBatch) {
+            for (int j = 0; j < JobBatch; ++j) {
+                queue->addJob(new BenchJob(iterations, &finished));
+            }
+            queue->executeJobs();
+        }
+    });
+    return finished == JobCount * 5 ? ns : -1;
+}
+
+static bool benchmarkJobs()
+{
+    printf("jobs: %d jobs in batches of %d, on %u hardware threads\n", JobCount, JobBatch, std::thread::hardware_concurrency());
+    bool ok = true;
+    // 500 iterations take about 2 us
+    for (int iterations: { 0, 500 }) {
+        for (size_t workers: { (size_t)1, (size_t)4 }) {
+            double mutex, pool;
+            {
+                MutexJobQueue queue(workers);
+                mutex = timeJobs(&queue, iterations);
+            }
+            {
+                noisepp::utils::ThreadedJobQueue queue(workers);
+                pool = timeJobs(&queue, iterations);
+            }
+            printf("  %-7s jobs, %zu worker%s: mutex queue %8.1f ns/job, job pool %8.1f ns/job\n",
+                   iterations ? "busy" : "trivial", workers, workers > 1 ? "s" : " ", mutex, pool);
+            ok = ok && mutex >= 0 && pool >= 0;
+        }
+    }
+    if (!ok)
+        fprintf(stderr, "Some jobs were never finished\n");
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    const std::string benchmark = argc > 1 ? argv[1] : "";
+
+#ifndef __OPTIMIZE__
+    fprintf(stderr, "Warning: built without optimizations, the timings are meaningless\n");
+#endif
+
+    if (benchmark != "" && benchmark != "cache" && benchmark != "jobs") {
+        fprintf(stderr, "Unknown benchmark %s\n", benchmark.c_str());
+        return 1;
+    }
+    bool ok = true;
+    if (benchmark == "" || benchmark == "cache")
+        benchmarkCache();
+    if (benchmark == "" || benchmark == "jobs")
+        ok = benchmarkJobs();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,472 @@
+/*
+ * Copyright 2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of TrainsPlanet
+ *
+ * TrainsPlanet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TrainsPlanet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TrainsPlanet.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Checks that noisepp::Pipeline::shareLattices() doesn't change the noise. A graph whose generators
+ * use the same lattices directly, through a ScalePoint and behind transforms which must not share
+ * is evaluated with and without sharing, for single points and for batches of values and
+ * derivatives, in both precisions and at every SIMD level. The results must match bit for bit.
+ * Then checks that the bounds of the generators contain their values: for random boxes and spacings,
+ * the values at random points of the box must be within what getBounds() returns for it, for
+ * Perlin, Billow, RidgedMulti and Simplex modules and for the levels of a ShellMap and a chain of
+ * ShellPatches. It also derives a bound of the simplex noise and checks the maximum used for the
+ * bounds of the Simplex modules is above it.
+ *
+ * Usage: trainsplanet-noisecheck
+ * Exits with 1 if the results differ or a value is out of its bounds.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Noise.h"
+
+// the radius of the sphere the terrain samples the noise on, see RandomGenerator::fetchData()
+static const double NoiseRadius = 8192. / 8000. / 2.;
+// the size of a tile with its apron, the terrain evaluates batches of this size
+static const int BatchSize = 37 * 37;
+
+/**
+ * All the generators have the same seed. The control of the Select, the Billow and the RidgedMulti
+ * have the same lattices, and so does the Perlin behind the ScalePoint, whose frequency is half.
+ * The Perlins behind the Turbulence and the TranslatePoint would have them too if the coordinates
+ * weren't moved, so they must not share.
+ */
+struct Graph {
+    noisepp::PerlinModule control;
+    noisepp::BillowModule billow;
+    noisepp::RidgedMultiModule ridged;
+    noisepp::SelectModule select;
+    noisepp::PerlinModule halfPerlin;
+    noisepp::ScalePointModule scalePoint;
+    noisepp::PerlinModule turbulent;
+    noisepp::TurbulenceModule turbulence;
+    noisepp::PerlinModule translated;
+    noisepp::TranslatePointModule translatePoint;
+    noisepp::MultiplyModule multiply;
+    noisepp::AdditionModule transformed;
+    noisepp::AdditionModule root;
+    // the part which can calculate derivatives
+    noisepp::AdditionModule smooth;
+
+    explicit Graph(int seed)
+    {
+        control.setSeed(seed);
+        control.setOctaveCount(8);
+        control.setFrequency(3.0);
+        billow.setSeed(seed);
+        billow.setOctaveCount(6);
+        billow.setFrequency(3.0);
+        ridged.setSeed(seed);
+        ridged.setOctaveCount(8);
+        ridged.setFrequency(3.0);
+        select.setControlModule(control);
+        select.setSourceModule(0, billow);
+        select.setSourceModule(1, ridged);
+        select.setEdgeFalloff(0.2);
+
+        halfPerlin.setSeed(seed);
+        halfPerlin.setOctaveCount(8);
+        halfPerlin.setFrequency(1.5);
+        scalePoint.setSourceModule(0, halfPerlin);
+        scalePoint.setScaleX(2.0);
+        scalePoint.setScaleY(2.0);
+        scalePoint.setScaleZ(2.0);
+
+        turbulent.setSeed(seed);
+        turbulent.setOctaveCount(8);
+        turbulent.setFrequency(3.0);
+        turbulence.setSourceModule(0, turbulent);
+        translated.setSeed(seed);
+        translated.setOctaveCount(8);
+        translated.setFrequency(3.0);
+        translatePoint.setSourceModule(0, translated);
+        translatePoint.setTranslationX(0.25);
+
+        multiply.setSourceModule(0, scalePoint);
+        multiply.setSourceModule(1, turbulence);
+        transformed.setSourceModule(0, multiply);
+        transformed.setSourceModule(1, translatePoint);
+        root.setSourceModule(0, select);
+        root.setSourceModule(1, transformed);
+        smooth.setSourceModule(0, select);
+        smooth.setSourceModule(1, scalePoint);
+    }
+};
+
+struct Samples {
+    std::vector<noisepp::Real> x, y, z;
+};
+
+// points on a longitude/latitude grid, see trainsplanet-noisecompare
+static Samples sphereSamples(int width, int height)
+{
+    Samples s;
+    for (int j = 0; j < height; ++j) {
+        const double lat = M_PI / 2. - (j + 0.5) / height * M_PI;
+        for (int i = 0; i < width; ++i) {
+            const double lon = (i + 0.5) / width * 2. * M_PI - M_PI;
+            s.x.push_back(NoiseRadius * std::cos(lat) * std::cos(lon));
+            s.y.push_back(NoiseRadius * std::cos(lat) * std::sin(lon));
+            s.z.push_back(NoiseRadius * std::sin(lat));
+        }
+    }
+    return s;
+}
+
+/**
+ * Evaluates the graph in every way a pipeline can, returning all the results one after the other
+ */
+static std::vector<noisepp::Real> evaluate(const Graph &graph, const Samples &s, int precision, bool share, size_t *shared)
+{
+    noisepp::Pipeline3D pipeline;
+    pipeline.setPrecision(precision);
+    const noisepp::PipelineElement3D *root = pipeline.getElement(graph.root.addToPipeline(&pipeline));
+    const noisepp::PipelineElement3D *smooth = pipeline.getElement(graph.smooth.addToPipeline(&pipeline));
+    *shared = share ? pipeline.shareLattices() : 0;
+    noisepp::Cache *cache = pipeline.createCache();
+
+    const size_t count = s.x.size();
+    std::vector<noisepp::Real> results;
+    std::vector<noisepp::Real> values(count), dx(count), dy(count), dz(count);
+    for (size_t i = 0; i < count; ++i) {
+        pipeline.cleanCache(cache);
+        values[i] = root->getValue(s.x[i], s.y[i], s.z[i], cache);
+    }
+    results.insert(results.end(), values.begin(), values.end());
+
+    // a coarse spacing too, so some octaves are skipped
+    for (double spacing: { 0., 0.01 }) {
+        for (size_t i = 0; i < count; i += BatchSize) {
+            const size_t n = std::min<size_t>(BatchSize, count - i);
+            root->getValues(n, &s.x[i], &s.y[i], &s.z[i], &values[i], cache, spacing);
+        }
+        results.insert(results.end(), values.begin(), values.end());
+        for (size_t i = 0; i < count; i += BatchSize) {
+            const size_t n = std::min<size_t>(BatchSize, count - i);
+            smooth->getDerivatives(n, &s.x[i], &s.y[i], &s.z[i], &values[i], &dx[i], &dy[i], &dz[i], cache, spacing);
+        }
+        for (const std::vector<noisepp::Real> *v: { &values, &dx, &dy, &dz }) {
+            results.insert(results.end(), v->begin(), v->end());
+        }
+    }
+
+    pipeline.freeCache(cache);
+    return results;
+}
+
+/**
+ * A box of a random size from 0.001 to 1, around a random point within the radius of the sphere
+ * of the terrain, or around a point on it if onSphere
+ */
+static noisepp::Box3D randomBox(std::mt19937 &random, bool onSphere)
+{
+    std::uniform_real_distribution<double> unit(-1., 1.);
+    double centre[3];
+    double length = 0;
+    for (int d = 0; d < 3; ++d) {
+        centre[d] = unit(random);
+        length += centre[d] * centre[d];
+    }
+    length = onSphere ? std::sqrt(length) : 1.;
+    const double size = std::pow(10., 1.5 * unit(random) - 1.5);
+    noisepp::Box3D box;
+    for (int d = 0; d < 3; ++d) {
+        box.min[d] = NoiseRadius * centre[d] / length - size * (unit(random) + 1.) / 2.;
+        box.max[d] = box.min[d] + size;
+    }
+    return box;
+}
+
+/**
+ * Random points inside the box, its corners first
+ */
+static Samples boxSamples(std::mt19937 &random, const noisepp::Box3D &box, int count)
+{
+    std::uniform_real_distribution<double> unit(0., 1.);
+    Samples s;
+    for (int i = 0; i < count; ++i) {
+        noisepp::Real p[3];
+        for (int d = 0; d < 3; ++d) {
+            const double a = i < 8 ? (i >> d) & 1 : unit(random);
+            p[d] = std::min(box.min[d] + a * (box.max[d] - box.min[d]), box.max[d]);
+        }
+        s.x.push_back(p[0]);
+        s.y.push_back(p[1]);
+        s.z.push_back(p[2]);
+    }
+    return s;
+}
+
+/**
+ * Counts the values outside the bounds, with the largest amount they are out by
+ */
+struct BoundsCheck {
+    BoundsCheck() : boxes(0), values(0), outside(0), maxExcess(0) {}
+
+    void check(const std::vector<noisepp::Real> &v, noisepp::Real lower, noisepp::Real upper)
+    {
+        ++boxes;
+        for (noisepp::Real value: v) {
+            ++values;
+            // a NaN is outside too
+            if (!(value >= lower && value <= upper)) {
+                ++outside;
+                maxExcess = std::max<double>(maxExcess, value == value ? std::max(lower - value, value - upper) : INFINITY);
+            }
+        }
+    }
+
+    bool print(const char *name) const
+    {
+        printf("%s: %d boxes, %d of %d values out of the bounds, by up to %g\n", name, boxes, outside, values, maxExcess);
+        return outside == 0;
+    }
+
+    int boxes;
+    int values;
+    int outside;
+    double maxExcess;
+};
+
+static const int BoundsBoxes = 2000;
+static const int BoundsSamples = 64;
+
+/**
+ * Checks the bounds of the generator modules at random spacings, some of which skip octaves
+ */
+static bool checkModuleBounds()
+{
+    noisepp::PerlinModule perlin;
+    noisepp::BillowModule billow;
+    noisepp::RidgedMultiModule ridged;
+    noisepp::SimplexModule simplex;
+    perlin.setSeed(7);
+    perlin.setOctaveCount(8);
+    perlin.setFrequency(3.0);
+    billow.setSeed(7);
+    billow.setOctaveCount(8);
+    billow.setFrequency(3.0);
+    ridged.setSeed(7);
+    ridged.setOctaveCount(8);
+    ridged.setFrequency(3.0);
+    simplex.setSeed(7);
+    simplex.setOctaveCount(8);
+    simplex.setFrequency(3.0);
+    const struct {
+        const char *name;
+        const noisepp::Module &module;
+    } modules[] = { { "Perlin", perlin }, { "Billow", billow }, { "RidgedMulti", ridged }, { "Simplex", simplex } };
+
+    bool ok = true;
+    std::mt19937 random(7);
+    std::uniform_real_distribution<double> unit(0., 1.);
+    for (const auto &m: modules) {
+        noisepp::Pipeline3D pipeline;
+        const noisepp::PipelineElement3D *element = pipeline.getElement(m.module.addToPipeline(&pipeline));
+        noisepp::Cache *cache = pipeline.createCache();
+        BoundsCheck check;
+        std::vector<noisepp::Real> values(BoundsSamples);
+        for (int b = 0; b < BoundsBoxes; ++b) {
+            const noisepp::Box3D box = randomBox(random, false);
+            const Samples s = boxSamples(random, box, BoundsSamples);
+            // a quarter at full resolution, the others from 0.0001 to 0.1
+            const double spacing = b % 4 ? std::pow(10., -4. + 3. * unit(random)) : 0.;
+            noisepp::Real lower, upper;
+            if (!element->getBounds(box, lower, upper, spacing)) {
+                continue;
+            }
+            pipeline.cleanCache(cache);
+            element->getValues(BoundsSamples, s.x.data(), s.y.data(), s.z.data(), values.data(), cache, spacing);
+            check.check(values, lower, upper);
+        }
+        pipeline.freeCache(cache);
+        ok = check.print(m.name) && check.boxes > 0 && ok;
+    }
+    return ok;
+}
+
+/**
+ * Checks the bounds of every level of a ShellMap, and of a chain of ShellPatches built like the
+ * ones of the tiles of the terrain, down from a tile of a quarter of a face
+ */
+static bool checkShellBounds()
+{
+    noisepp::PerlinModule perlin;
+    perlin.setSeed(7);
+    perlin.setOctaveCount(12);
+    noisepp::Pipeline3D pipeline;
+    const noisepp::PerlinElement3D *element = static_cast<const noisepp::PerlinElement3D *>(pipeline.getElement(perlin.addToPipeline(&pipeline)));
+    noisepp::ShellMap map(element, NoiseRadius, 4);
+    map.build(&pipeline);
+
+    bool ok = true;
+    std::mt19937 random(7);
+    BoundsCheck mapCheck;
+    std::vector<noisepp::Real> values(BoundsSamples);
+    for (int b = 0; b < BoundsBoxes; ++b) {
+        const noisepp::Box3D box = randomBox(random, true);
+        const Samples s = boxSamples(random, box, BoundsSamples);
+        const size_t level = b % map.getOctaveCount() + 1;
+        noisepp::Real lower, upper;
+        map.getBounds(level, box, lower, upper);
+        map.getValues(level, BoundsSamples, s.x.data(), s.y.data(), s.z.data(), values.data());
+        mapCheck.check(values, lower, upper);
+    }
+    ok = mapCheck.print("ShellMap") && ok;
+
+    // tiles of 33 by 33 samples on the top of the sphere, each the top left quarter of the one before
+    BoundsCheck patchCheck;
+    noisepp::ShellPatch parent(&map);
+    for (int t = 0; t < 8; ++t) {
+        const double size = 1. / (2 << t);
+        Samples tile;
+        for (int j = 0; j < 33; ++j) {
+            for (int i = 0; i < 33; ++i) {
+                const double u = -1. + size * i / 32., v = -1. + size * j / 32.;
+                const double scale = NoiseRadius / std::sqrt(1. + u * u + v * v);
+                tile.x.push_back(u * scale);
+                tile.y.push_back(v * scale);
+                tile.z.push_back(scale);
+            }
+        }
+        const double spacing = NoiseRadius * size / 32.;
+        noisepp::ShellPatch patch(&map);
+        const size_t level = patch.getLevel(spacing);
+        if (level == 0) {
+            continue;
+        }
+        patch.build(level, tile.x.size(), tile.x.data(), tile.y.data(), tile.z.data(), parent.getOctaveCount() ? &parent : nullptr);
+        noisepp::Box3D tileBox;
+        for (int d = 0; d < 3; ++d) {
+            const std::vector<noisepp::Real> &c = d == 0 ? tile.x : d == 1 ? tile.y : tile.z;
+            tileBox.min[d] = *std::min_element(c.begin(), c.end());
+            tileBox.max[d] = *std::max_element(c.begin(), c.end());
+        }
+        std::uniform_real_distribution<double> unit(0., 1.);
+        for (int b = 0; b < BoundsBoxes / 8; ++b) {
+            // boxes of the tile from a sample to the whole tile
+            noisepp::Box3D box;
+            const double boxSize = std::pow(10., -1.5 * unit(random));
+            for (int d = 0; d < 3; ++d) {
+                const double extent = (tileBox.max[d] - tileBox.min[d]) * boxSize;
+                box.min[d] = tileBox.min[d] + (tileBox.max[d] - tileBox.min[d] - extent) * unit(random);
+                box.max[d] = box.min[d] + extent;
+            }
+            const Samples s = boxSamples(random, box, BoundsSamples);
+            noisepp::Real lower, upper;
+            patch.getBounds(box, lower, upper);
+            patch.getValues(BoundsSamples, s.x.data(), s.y.data(), s.z.data(), values.data());
+            patchCheck.check(values, lower, upper);
+        }
+        parent = patch;
+    }
+    ok = patchCheck.print("ShellPatch") && patchCheck.boxes > 0 && ok;
+    return ok;
+}
+
+/**
+ * Bounds the simplex noise from its definition, without sampling it: every corner of the simplex
+ * containing a point contributes (0.5 - r^2)^4 * (g . d), at most (0.5 - r^2)^4 * r * |g|. The largest
+ * sum of those over a grid of one of the simplices, which are all alike, is a bound once the most the
+ * sum can grow between the grid and any point is added. Returns that bound at scale 1.
+ */
+static double simplexNoiseBound()
+{
+    double gradient = 0;
+    for (int i = 0; i < 256; ++i) {
+        const noisepp::Real *g = noisepp::randomVectors3D + 4 * i;
+        gradient = std::max(gradient, std::sqrt(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]));
+    }
+
+    // the corners of the simplex stepping along x, then y, see SimplexGenerator3D::locateSimplex()
+    const double G3 = 1. / 6.;
+    const double corners[4][3] = { { 0, 0, 0 }, { 1 - G3, -G3, -G3 }, { 1 - 2 * G3, 1 - 2 * G3, -2 * G3 }, { 0.5, 0.5, 0.5 } };
+    const int steps = 800;
+    double largest = 0;
+    for (int a = 0; a <= steps; ++a) {
+        for (int b = 0; a + b <= steps; ++b) {
+            for (int c = 0; a + b + c <= steps; ++c) {
+                const double w[3] = { (double)a / steps, (double)b / steps, (double)c / steps };
+                double p[3];
+                for (int d = 0; d < 3; ++d) {
+                    p[d] = w[0] * corners[1][d] + w[1] * corners[2][d] + w[2] * corners[3][d];
+                }
+                double sum = 0;
+                for (const double *corner: corners) {
+                    const double r2 = (p[0] - corner[0]) * (p[0] - corner[0]) + (p[1] - corner[1]) * (p[1] - corner[1])
+                                      + (p[2] - corner[2]) * (p[2] - corner[2]);
+                    const double t = std::max(0.5 - r2, 0.);
+                    sum += t * t * t * t * std::sqrt(r2);
+                }
+                largest = std::max(largest, sum);
+            }
+        }
+    }
+
+    // rounding the weights of the other corners down moves a point by less than a step of each of their edges
+    double distance = 0;
+    for (int k = 1; k < 4; ++k) {
+        distance += std::sqrt(corners[k][0] * corners[k][0] + corners[k][1] * corners[k][1] + corners[k][2] * corners[k][2]) / steps;
+    }
+    // the slope of t^4 r is t^4 - 8 t^3 r^2, at most t^3 (t + 8 r^2), which peaks at r^2 = 1/14
+    const double slope = std::pow(0.5 - 1. / 14., 3) * (0.5 - 1. / 14. + 8. / 14.);
+    return (largest + 4. * slope * distance) * gradient;
+}
+
+int main()
+{
+    const Graph graph(7);
+    const Samples samples = sphereSamples(256, 128);
+    const int simdLevel = noisepp::SIMD::getLevel();
+
+    bool ok = true;
+    for (int level = noisepp::SIMD_NONE; level <= simdLevel; ++level) {
+        noisepp::SIMD::setLevel(level);
+        for (int precision: { (int)noisepp::NOISE_PRECISION_REAL, (int)noisepp::NOISE_PRECISION_SINGLE }) {
+            size_t shared, none;
+            const std::vector<noisepp::Real> with = evaluate(graph, samples, precision, true, &shared);
+            const std::vector<noisepp::Real> without = evaluate(graph, samples, precision, false, &none);
+            size_t differing = 0;
+            for (size_t i = 0; i < with.size(); ++i) {
+                // bitwise, a -0.0 for a 0.0 is a difference too
+                differing += memcmp(&with[i], &without[i], sizeof(noisepp::Real)) != 0;
+            }
+            printf("SIMD level %d, %s precision: %zu shared lattices, %zu of %zu results differ\n", level,
+                   precision == noisepp::NOISE_PRECISION_REAL ? "real" : "single", shared, differing, with.size());
+            // with nothing shared the check proves nothing
+            ok = ok && differing == 0 && shared > 0;
+        }
+    }
+    noisepp::SIMD::setLevel(simdLevel);
+
+    ok = checkModuleBounds() && ok;
+    ok = checkShellBounds() && ok;
+    const double simplexBound = simplexNoiseBound();
+    const double simplexMaximum = noisepp::SimplexGenerator3D::getSimplexNoiseMaximum(1.);
+    printf("simplex noise: bound %.6f, maximum of the bounds %.6f\n", simplexBound, simplexMaximum);
+    ok = simplexBound <= simplexMaximum && ok;
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of TrainsPlanet
+ *
+ * TrainsPlanet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TrainsPlanet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TrainsPlanet.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compares the Perlin modules of RandomGenerator with SimplexModules using the same parameters.
+ * For each module it renders a map of the whole planet for both noises, prints the statistics
+ * which decide the look of the terrain and times the evaluation.
+ *
+ * Usage: trainsplanet-noisecompare [seed] [width] [output prefix]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "Noise.h"
+#include "NoiseImage.h"
+#include "NoiseGradientRenderer.h"
+
+// the radius of the sphere the terrain samples the noise on, see RandomGenerator::fetchData()
+static const double NoiseRadius = 8192. / 8000. / 2.;
+
+struct ModuleSetup {
+    const char *name;
+    int octaves;
+    double frequency;
+    double persistence;
+    int seed;
+    // the select modules switch at this value
+    double threshold;
+};
+
+struct Samples {
+    std::vector<noisepp::Real> x, y, z;
+    double spacing;
+};
+
+// samples on a longitude/latitude grid, so the maps show the whole planet
+static Samples mapSamples(int width, int height)
+{
+    Samples s;
+    s.x.resize(width * height);
+    s.y.resize(width * height);
+    s.z.resize(width * height);
+    for (int j = 0; j < height; ++j) {
+        const double lat = M_PI / 2. - (j + 0.5) / height * M_PI;
+        for (int i = 0; i < width; ++i) {
+            const double lon = (i + 0.5) / width * 2. * M_PI - M_PI;
+            const int n = j * width + i;
+            s.x[n] = NoiseRadius * std::cos(lat) * std::cos(lon);
+            s.y[n] = NoiseRadius * std::cos(lat) * std::sin(lon);
+            s.z[n] = NoiseRadius * std::sin(lat);
+        }
+    }
+    // the distance between the pixels at the equator
+    s.spacing = 2. * M_PI * NoiseRadius / width;
+    return s;
+}
+
+static void setup(noisepp::PerlinModuleBase &module, const ModuleSetup &setup)
+{
+    module.setOctaveCount(setup.octaves);
+    module.setFrequency(setup.frequency);
+    module.setPersistence(setup.persistence);
+    module.setSeed(setup.seed);
+}
+
+static void saveMap(const std::string &file, const std::vector<noisepp::Real> &values, int width, int height, double threshold)
+{
+    noisepp::utils::GradientRenderer renderer;
+    renderer.addGradient(-1.0, noisepp::utils::ColourValue(0.0f, 0.0f, 0.3f));
+    renderer.addGradient(threshold, noisepp::utils::ColourValue(0.2f, 0.4f, 0.8f));
+    renderer.addGradient(threshold + 0.001, noisepp::utils::ColourValue(0.2f, 0.5f, 0.1f));
+    renderer.addGradient(1.0, noisepp::utils::ColourValue(1.0f, 1.0f, 1.0f));
+
+    noisepp::utils::Image image;
+    image.create(width, height);
+    renderer.renderImage(image, &values[0]);
+    if (!image.saveBMP(file.c_str()))
+        fprintf(stderr, "Failed to write %s\n", file.c_str());
+}
+
+static void printStatistics(const char *name, const std::vector<noisepp::Real> &values, double threshold)
+{
+    double sum = 0, sum2 = 0, min = values[0], max = values[0];
+    size_t above = 0;
+    for (double v: values) {
+        sum += v;
+        sum2 += v * v;
+        min = std::min(min, v);
+        max = std::max(max, v);
+        above += v >= threshold;
+    }
+    const double mean = sum / values.size();
+    printf("  %-8s mean %7.3f  stddev %6.3f  range [%6.3f, %6.3f]  above %.2f: %5.1f%%\n", name, mean,
+           std::sqrt(std::max(sum2 / values.size() - mean * mean, 0.)), min, max, threshold, 100. * above / values.size());
+}
+
+// best of a few runs, in nanoseconds per sample
+template<class Function>
+static double timeBatches(size_t count, Function function)
+{
+    double best = 0;
+    for (int run = 0; run < 5; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        // batches of the size of a tile, like the terrain uses
+        for (size_t i = 0; i < count; i += 37 * 37)
+            function(i, std::min<size_t>(37 * 37, count - i));
+        const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (run == 0 || time < best)
+            best = time;
+    }
+    return best / count * 1e9;
+}
+
+struct Timings {
+    double values, singleValues, derivatives;
+};
+
+static Timings benchmark(const noisepp::Module &module, const Samples &s)
+{
+    const size_t count = s.x.size();
+    std::vector<noisepp::Real> values(count), dx(count), dy(count), dz(count);
+    Timings timings;
+
+    noisepp::Pipeline3D pipeline;
+    noisepp::PipelineElement3D *element = pipeline.getElement(module.addToPipeline(&pipeline));
+    noisepp::Cache *cache = pipeline.createCache();
+    // all the octaves, as for the closest tiles
+    timings.values = timeBatches(count, [&](size_t i, size_t n) {
+        element->getValues(n, &s.x[i], &s.y[i], &s.z[i], &values[i], cache);
+    });
+    timings.derivatives = timeBatches(count, [&](size_t i, size_t n) {
+        element->getDerivatives(n, &s.x[i], &s.y[i], &s.z[i], &values[i], &dx[i], &dy[i], &dz[i], cache);
+    });
+    pipeline.freeCache(cache);
+
+    noisepp::Pipeline3D singlePipeline;
+    singlePipeline.setPrecision(noisepp::NOISE_PRECISION_SINGLE);
+    element = singlePipeline.getElement(module.addToPipeline(&singlePipeline));
+    cache = singlePipeline.createCache();
+    timings.singleValues = timeBatches(count, [&](size_t i, size_t n) {
+        element->getValues(n, &s.x[i], &s.y[i], &s.z[i], &values[i], cache);
+    });
+    singlePipeline.freeCache(cache);
+
+    return timings;
+}
+
+static std::vector<noisepp::Real> evaluate(const noisepp::Module &module, const Samples &s)
+{
+    std::vector<noisepp::Real> values(s.x.size());
+    noisepp::Pipeline3D pipeline;
+    noisepp::PipelineElement3D *element = pipeline.getElement(module.addToPipeline(&pipeline));
+    noisepp::Cache *cache = pipeline.createCache();
+    // skip the octaves finer than the pixels, they would only add aliasing
+    element->getValues(s.x.size(), &s.x[0], &s.y[0], &s.z[0], &values[0], cache, s.spacing);
+    pipeline.freeCache(cache);
+    return values;
+}
+
+int main(int argc, char **argv)
+{
+    const int seed = argc > 1 ? atoi(argv[1]) : 0;
+    const int width = argc > 2 ? std::max(atoi(argv[2]), 16) : 1024;
+    const std::string prefix = argc > 3 ? argv[3] : "noisecompare";
+    const int height = width / 2;
+
+#ifndef __OPTIMIZE__
+    fprintf(stderr, "Warning: built without optimizations, the timings are meaningless\n");
+#endif
+
+    // same parameters as in RandomGenerator. The mountain definition is scaled by 10 there
+    const ModuleSetup setups[] = {
+        { "continents", 12, 1.0, 0.625, seed, 0.0 },
+        { "mountaindefinition", 12, 10.0, 0.5, 0, 0.5 },
+    };
+
+    const Samples samples = mapSamples(width, height);
+    for (const ModuleSetup &s: setups) {
+        noisepp::PerlinModule perlin;
+        noisepp::SimplexModule simplex;
+        setup(perlin, s);
+        setup(simplex, s);
+
+        printf("%s\n", s.name);
+        const std::vector<noisepp::Real> perlinValues = evaluate(perlin, samples);
+        const std::vector<noisepp::Real> simplexValues = evaluate(simplex, samples);
+        printStatistics("perlin", perlinValues, s.threshold);
+        printStatistics("simplex", simplexValues, s.threshold);
+        saveMap(prefix + "-" + s.name + "-perlin.bmp", perlinValues, width, height, s.threshold);
+        saveMap(prefix + "-" + s.name + "-simplex.bmp", simplexValues, width, height, s.threshold);
+
+        const Timings p = benchmark(perlin, samples);
+        const Timings x = benchmark(simplex, samples);
+        printf("  ns/sample        perlin  simplex  speedup\n");
+        printf("  values          %7.1f  %7.1f  %6.2fx\n", p.values, x.values, p.values / x.values);
+        printf("  single values   %7.1f  %7.1f  %6.2fx\n", p.singleValues, x.singleValues, p.singleValues / x.singleValues);
+        printf("  derivatives     %7.1f  %7.1f  %6.2fx\n", p.derivatives, x.derivatives, p.derivatives / x.derivatives);
+    }
+
+    return 0;
+}
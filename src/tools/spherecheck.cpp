@@ -0,0 +1,188 @@
+/*
+ * Copyright 2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of TrainsPlanet
+ *
+ * TrainsPlanet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TrainsPlanet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TrainsPlanet.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Checks MiscUtils::mapCubeToSphereN() and MiscUtils::mapSphereToCubeN() at every SIMD level.
+ * A grid on every face of the cube, with the edges and the corners of the faces, and some random
+ * points on the faces are mapped to the sphere, and the same points projected on the sphere are
+ * mapped back to the cube. The results must be the same bit for bit at every level, within the
+ * bounds below of the single point versions, and mapping the cube points back to the sphere must
+ * give the points again.
+ *
+ * Usage: trainsplanet-spherecheck
+ * Exits with 1 if the results differ or are out of bounds.
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "NoiseSIMD.h"
+#include "miscutils.h"
+
+// the same as the terrain, see Terrain::generateMap(). mapCubeToSphere() takes the size of the
+// face and maps the cube going from -HalfSize to HalfSize
+static const double FaceSize = 8192;
+static const double HalfSize = FaceSize / 2. * 32. / 33.;
+// the points on a side of a face. Odd, so the middle of the face is on the grid too
+static const int GridSize = 257;
+static const int RandomPoints = 65537;
+
+// the single point versions calculate in float, the batch ones in double
+static const double CubeToSphereBound = 4. * FLT_EPSILON * HalfSize;
+// mapSphereToCube() takes float square roots of differences of numbers around 3, which are
+// around 0 near the middle lines of the faces, so there its error is about the root of the
+// float epsilon. The grid misses those points, the random ones don't
+static const double SphereToCubeBound = 2. * std::sqrt(FLT_EPSILON);
+// the same happens in double on the way back
+static const double RoundTripBound = 4. * std::sqrt(DBL_EPSILON);
+
+struct Points {
+    std::vector<double> x, y, z;
+};
+
+// 6 * 257 * 257 + 65537 points, not a multiple of the four of AVX2, so the scalar kernels do some too
+static Points cubePoints()
+{
+    Points p;
+    auto add = [&p](const double *c) {
+        p.x.push_back(c[0]);
+        p.y.push_back(c[1]);
+        p.z.push_back(c[2]);
+    };
+    for (int axis = 0; axis < 3; ++axis) {
+        for (double face: { -HalfSize, HalfSize }) {
+            for (int j = 0; j < GridSize; ++j) {
+                for (int i = 0; i < GridSize; ++i) {
+                    double c[3];
+                    c[axis] = face;
+                    c[(axis + 1) % 3] = HalfSize * (2. * i / (GridSize - 1) - 1.);
+                    c[(axis + 2) % 3] = HalfSize * (2. * j / (GridSize - 1) - 1.);
+                    add(c);
+                }
+            }
+        }
+    }
+    // always the same ones
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> coordinate(-HalfSize, HalfSize);
+    for (int i = 0; i < RandomPoints; ++i) {
+        double c[3] = { coordinate(random), coordinate(random), coordinate(random) };
+        c[i % 3] = i % 2 ? HalfSize : -HalfSize;
+        add(c);
+    }
+    return p;
+}
+
+// the same points projected on the unit sphere
+static Points spherePoints(const Points &cube)
+{
+    Points p = cube;
+    for (size_t i = 0; i < p.x.size(); ++i) {
+        const double length = std::sqrt(p.x[i] * p.x[i] + p.y[i] * p.y[i] + p.z[i] * p.z[i]);
+        p.x[i] /= length;
+        p.y[i] /= length;
+        p.z[i] /= length;
+    }
+    return p;
+}
+
+static double distance(const Points &a, size_t i, double x, double y, double z)
+{
+    return std::sqrt((a.x[i] - x) * (a.x[i] - x) + (a.y[i] - y) * (a.y[i] - y) + (a.z[i] - z) * (a.z[i] - z));
+}
+
+static size_t differing(const Points &a, const Points &b)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < a.x.size(); ++i) {
+        n += a.x[i] != b.x[i] || a.y[i] != b.y[i] || a.z[i] != b.z[i];
+    }
+    return n;
+}
+
+static bool check(const char *name, size_t differ, double error, double bound)
+{
+    const bool ok = differ == 0 && error <= bound;
+    printf("  %s: %zu points differ from SIMD level 0, max error %g, bound %g%s\n", name, differ, error, bound,
+           ok ? "" : ", FAILED");
+    return ok;
+}
+
+int main()
+{
+    const Points cube = cubePoints();
+    const Points sphere = spherePoints(cube);
+    const int count = cube.x.size();
+
+    // the single point versions, which don't depend on the SIMD level
+    Points single = cube, singleBack = sphere;
+    for (int i = 0; i < count; ++i) {
+        const QVector3D s = MiscUtils::mapCubeToSphere(QVector3D(cube.x[i], cube.y[i], cube.z[i]), FaceSize);
+        single.x[i] = s.x();
+        single.y[i] = s.y();
+        single.z[i] = s.z();
+        const QVector3D c = MiscUtils::mapSphereToCube(QVector3D(sphere.x[i], sphere.y[i], sphere.z[i]));
+        singleBack.x[i] = c.x();
+        singleBack.y[i] = c.y();
+        singleBack.z[i] = c.z();
+    }
+
+    const int simdLevel = noisepp::SIMD::getLevel();
+    // with a multiple of the vector width the scalar kernels would be left out
+    bool ok = count % 4 != 0;
+    Points firstForward, firstBack, firstRoundTrip;
+    for (int level = noisepp::SIMD_NONE; level <= simdLevel; ++level) {
+        noisepp::SIMD::setLevel(level);
+        printf("SIMD level %d, %d points:\n", level, count);
+
+        Points forward = cube;
+        MiscUtils::mapCubeToSphereN(forward.x.data(), forward.y.data(), forward.z.data(), count, HalfSize);
+        Points back = sphere;
+        MiscUtils::mapSphereToCubeN(back.x.data(), back.y.data(), back.z.data(), count);
+        Points roundTrip = back;
+        MiscUtils::mapCubeToSphereN(roundTrip.x.data(), roundTrip.y.data(), roundTrip.z.data(), count, 1.);
+        if (level == noisepp::SIMD_NONE) {
+            firstForward = forward;
+            firstBack = back;
+            firstRoundTrip = roundTrip;
+        }
+
+        double forwardError = 0, backError = 0, roundTripError = 0;
+        for (int i = 0; i < count; ++i) {
+            // a NaN must not hide in the maximum
+            const double f = distance(single, i, forward.x[i], forward.y[i], forward.z[i]);
+            const double b = distance(singleBack, i, back.x[i], back.y[i], back.z[i]);
+            const double r = distance(sphere, i, roundTrip.x[i], roundTrip.y[i], roundTrip.z[i]);
+            forwardError = f == f ? std::max(forwardError, f) : INFINITY;
+            backError = b == b ? std::max(backError, b) : INFINITY;
+            roundTripError = r == r ? std::max(roundTripError, r) : INFINITY;
+        }
+        ok = check("cube to sphere", differing(forward, firstForward), forwardError, CubeToSphereBound) && ok;
+        ok = check("sphere to cube", differing(back, firstBack), backError, SphereToCubeBound) && ok;
+        ok = check("round trip", differing(roundTrip, firstRoundTrip), roundTripError, RoundTripBound) && ok;
+    }
+    noisepp::SIMD::setLevel(simdLevel);
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -256,11 +256,12 @@ double Window::perSecond(double n) const
     return n * m_frameTime;
 }
 
-void Window::generateMap(int seed)
+void Window::generateMap(int seed, const QString &graphFile)
 {
     QMutexLocker lock(&m_mutex);
     m_generate = true;
     m_mapSeed = seed;
+    m_mapGraph = graphFile;
 }
 
 void Window::sync()
@@ -293,7 +294,7 @@ void Window::sync()
     }
 
     if (m_generate) {
-        m_terrain->generateMap(m_mapSeed);
+        m_terrain->generateMap(m_mapSeed, m_mapGraph);
         m_needsUpdate = true;
         m_generate = false;
     }
@@ -319,6 +320,7 @@ void Window::updateUi()
     rootContext()->setContextProperty("Fps", m_fps);
     rootContext()->setContextProperty("NumDrawCalls", m_numDrawCalls);
     rootContext()->setContextProperty("NumTriangles", m_numTriangles);
+    rootContext()->setContextProperty("GeneratorProfile", m_generatorProfile);
 }
 
 void Window::renderNow()
@@ -343,6 +345,7 @@ void Window::renderNow()
     Terrain::Statistics stats = m_terrain->render(m_projection, m_view);
     m_numDrawCalls = stats.numDrawCalls;
     m_numTriangles = stats.numTriangles;
+    m_generatorProfile = stats.generatorProfile;
 //     m_device->setSize(size());
 //     QPainter painter(m_device);
 //
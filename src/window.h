@@ -47,7 +47,10 @@ public:
     bool paused() const { return m_paused; }
     void setPaused(bool p);
 
-    Q_INVOKABLE void generateMap(int seed);
+    /**
+     * Schedules the generation of a new terrain, see Terrain::generateMap().
+     */
+    Q_INVOKABLE void generateMap(int seed, const QString &graphFile = QString());
 
 signals:
     void pausedChanged();
@@ -74,6 +77,7 @@ private:
     bool m_needsUpdate;
     bool m_generate;
     int m_mapSeed;
+    QString m_mapGraph;
     QMutex m_mutex;
     bool m_paused;
 
@@ -82,6 +86,7 @@ private:
     unsigned int m_curTimeId;
     int m_numDrawCalls;
     int m_numTriangles;
+    QString m_generatorProfile;
 
     void buildView();
 